@@ -1,7 +1,13 @@
 #include "Z80.hpp"
+#include "Z80Tables.hpp"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
-Z80::Z80(Memory& memory) : registers(), memory(memory), halted(false), cycles(0) {
+Z80::Z80(Memory& memory)
+    : nmi_line(false), registers(), memory(memory), halted(false), cycles(0),
+      m1WaitStates(MSX_M1_WAIT_STATES), indexAddress(0), sliceEnd(0), eiSliceEnd(0), afterEI(false),
+      blockCacheEnabled(Z80_BLOCK_CACHE), jitEnabled(false), interrupt_pending(false) {
     reset();
 }
 
@@ -9,70 +15,321 @@ void Z80::reset() {
     registers.reset();
     halted = false;
     cycles = 0;
+    sliceEnd = 0;
 }
 
 void Z80::loadProgram(const std::vector<uint8_t>& program, uint16_t startAddress) {
     for (size_t i = 0; i < program.size(); ++i) {
         memory.writeByte(startAddress + i, program[i]);
     }
-    cycles += program.size() * 3; // Basic memory write timing
 }
 
 void Z80::executeInstruction() {
+    // No run() slice: block instructions do exactly one pass per call
+    sliceEnd = 0;
     if (!halted) {
-        uint8_t opcode = fetchOpcode();
-        cycles += decodeAndExecuteMainInstruction(opcode);
+        const uint8_t opcode = fetchOpcode();
+        cycles += CYCLES_MAIN[opcode];
+        (this->*MAIN_OPS[opcode])();
     } else {
-        cycles += 4; // Halt instruction takes 4 cycles
+        // HALT keeps running NOP M1 cycles
+        registers.R = (registers.R & 0x80) | ((registers.R + 1) & 0x7F);
+        cycles += 4 + m1WaitStates;
     }
     handleInterrupts();
 }
 
+int Z80::run(int cycleBudget) {
+    const uint64_t end = cycles + cycleBudget;
+    sliceEnd = end;
+    afterEI = false;
+    handleInterrupts();
+
+    for (;;) {
+        // EI and HALT pull sliceEnd in to leave this loop early
+        if (!halted) {
+            while (cycles < sliceEnd) {
+                if (Z80_BLOCK_CACHE && blockCacheEnabled && runBlock()) {
+                    continue;
+                }
+                const uint8_t opcode = fetchOpcode();
+                cycles += CYCLES_MAIN[opcode];
+                (this->*MAIN_OPS[opcode])();
+            }
+        }
+
+        if (afterEI) {
+            // The instruction after EI is done: resume the slice and let a
+            // pending interrupt in now
+            afterEI = false;
+            sliceEnd = eiSliceEnd;
+            handleInterrupts();
+            continue;
+        }
+        if (halted && cycles < end) {
+            cycles = end;
+        }
+        return static_cast<int>(cycles - end);
+    }
+}
+
+void Z80::setM1WaitStates(uint8_t states) {
+    m1WaitStates = states;
+    flushBlockCache();      // Cached ops carry their wait states
+}
+
+void Z80::setBlockCacheEnabled(bool enabled) {
+    blockCacheEnabled = Z80_BLOCK_CACHE && enabled;
+    flushBlockCache();
+}
+
+void Z80::setJITEnabled(bool enabled) {
+    if (enabled && !jit) {
+        auto offset = [this](const void* field) {
+            return static_cast<size_t>(static_cast<const char*>(field) - reinterpret_cast<const char*>(this));
+        };
+        jit = std::make_unique<Z80JIT>(Z80JIT::Layout{
+            offset(&registers.R), offset(&registers.PC), offset(&registers.IX), offset(&registers.IY),
+            offset(&indexAddress), offset(&cycles), offset(&sliceEnd), memory.getCodeEpochAddress()});
+    }
+    jitEnabled = enabled && isJITAvailable();
+    flushBlockCache();
+}
+
+// --- Block cache ---
+// run() looks the block up by the page and offset of PC and replays its ops:
+// each one does what fetchOpcode() and the prefix dispatchers would have
+// done (R, cycles, PC past the opcode, the DD CB displacement) and calls the
+// final handler. The block is left as soon as an op jumps, the slice ends or
+// the code epoch moves (a write into cached code, a remap).
+bool Z80::runBlock() {
+    const uint16_t pc = registers.PC;
+    const unsigned page = pc >> 13;
+    if (!memory.getDirectReadPage(page)) {
+        return false;
+    }
+
+    auto& blocks = blockCache[page];
+    if (blocks.empty()) {
+        blocks.resize(Memory::PAGE_SIZE);
+    }
+    std::unique_ptr<CachedBlock>& block = blocks[pc & (Memory::PAGE_SIZE - 1)];
+    if (!block) {
+        block = std::make_unique<CachedBlock>();
+        decodeBlock(pc, *block);
+    } else if (block->generation != memory.getPageGeneration(page)) {
+        decodeBlock(pc, *block);
+    }
+    if (block->ops.empty()) {
+        return false;
+    }
+
+    if (block->compiled) {
+        block->compiled(this);
+        return true;
+    }
+    if (jitEnabled && ++block->runs == JIT_THRESHOLD) {
+        compileBlock(*block);
+        if (block->compiled) {
+            block->compiled(this);
+            return true;
+        }
+    }
+
+    const uint32_t epoch = memory.getCodeEpoch();
+    for (const CachedOp& op : block->ops) {
+        registers.R = (registers.R & 0x80) | ((registers.R + op.fetches) & 0x7F);
+        cycles += op.cycles;
+        registers.PC = op.operandPC;
+        if (op.index) {
+            indexAddress = (op.index == 1 ? registers.IX : registers.IY) + op.displacement;
+        }
+        (this->*op.handler)();
+        if (registers.PC != op.nextPC || cycles >= sliceEnd || memory.getCodeEpoch() != epoch) {
+            break;
+        }
+    }
+    return true;
+}
+
+void Z80::decodeBlock(uint16_t pc, CachedBlock& block) {
+    const unsigned page = pc >> 13;
+    const uint8_t* code = memory.getDirectReadPage(page);
+    const uint16_t base = pc & ~(Memory::PAGE_SIZE - 1);
+    unsigned offset = pc & (Memory::PAGE_SIZE - 1);
+
+    block.ops.clear();
+    block.generation = memory.getPageGeneration(page);
+    block.runs = 0;
+    block.compiled = nullptr;     // Dropped, the arena is only reclaimed by a flush
+    while (block.ops.size() < MAX_BLOCK_OPS && offset < Memory::PAGE_SIZE) {
+        CachedOp op;
+        unsigned length;
+        bool endsBlock;
+        if (!decodeOp(code, offset, op, length, endsBlock)) {
+            break;
+        }
+        op.operandPC += base + offset;
+        op.nextPC = base + offset + length;
+        block.ops.push_back(op);
+        memory.watchCode(base + offset, length);
+        offset += length;
+        if (endsBlock) {
+            break;
+        }
+    }
+}
+
+// Decode one instruction at offset into the page. Instructions that run
+// over the end of the page or stack several DD/FD/ED prefixes are left to
+// the interpreter.
+bool Z80::decodeOp(const uint8_t* page, unsigned offset, CachedOp& op, unsigned& length, bool& endsBlock) const {
+    const unsigned available = Memory::PAGE_SIZE - offset;
+    const uint8_t* bytes = page + offset;
+    unsigned prefix;
+
+    op.index = 0;
+    op.displacement = 0;
+    const uint8_t first = bytes[0];
+    if (first == 0xCB || first == 0xED || first == 0xDD || first == 0xFD) {
+        if (available < 2) return false;
+        const uint8_t second = bytes[1];
+        op.fetches = 2;
+        if (first == 0xCB) {
+            op.handler = CB_OPS[second];
+            op.cycles = CYCLES_CB[second];
+            prefix = 2;
+            length = 2;
+            endsBlock = false;
+        } else if (first == 0xED) {
+            op.handler = ED_OPS[second];
+            op.cycles = CYCLES_ED[second];
+            prefix = 2;
+            length = 2 + OPERANDS_ED[second];
+            endsBlock = (second & 0xC7) == 0x45;                    // RETN, RETI
+        } else if (second == 0xCB) {
+            if (available < 4) return false;
+            op.handler = INDEX_CB_OPS[bytes[3]];
+            op.cycles = CYCLES_XXCB[bytes[3]];
+            op.index = first == 0xDD ? 1 : 2;
+            op.displacement = static_cast<int8_t>(bytes[2]);
+            prefix = 4;
+            length = 4;
+            endsBlock = false;
+        } else if (second == 0xDD || second == 0xED || second == 0xFD) {
+            return false;
+        } else {
+            op.handler = (first == 0xDD ? IX_OPS : IY_OPS)[second];
+            op.cycles = CYCLES_XX[second];
+            prefix = 2;
+            length = 2 + OPERANDS_XX[second];
+            endsBlock = second == 0xE9;                             // JP (IX)
+        }
+    } else {
+        op.handler = MAIN_OPS[first];
+        op.cycles = CYCLES_MAIN[first];
+        op.fetches = 1;
+        prefix = 1;
+        length = 1 + OPERANDS_MAIN[first];
+        // JP nn, JR e, CALL nn, RET, JP (HL), HALT, RST p
+        endsBlock = first == 0xC3 || first == 0x18 || first == 0xCD || first == 0xC9 ||
+                    first == 0xE9 || first == 0x76 || (first & 0xC7) == 0xC7;
+    }
+    if (length > available) {
+        return false;
+    }
+
+    op.cycles += op.fetches * m1WaitStates;
+    op.operandPC = prefix;
+    return true;
+}
+
+void Z80::flushBlockCache() {
+    for (auto& blocks : blockCache) {
+        blocks.clear();
+    }
+    if (jit) {
+        jit->flush();
+    }
+}
+
+// --- JIT ---
+// Handlers are non-virtual members of a class without bases, so under the
+// Itanium C++ ABI their pointers are {entry point, this adjustment 0} and
+// the entry point can be called directly with the Z80 in RDI.
+static const void* handlerEntry(void (Z80::*handler)()) {
+    struct { uintptr_t ptr; ptrdiff_t adj; } parts;
+    static_assert(sizeof(parts) == sizeof(handler), "Itanium member function pointers expected");
+    std::memcpy(&parts, &handler, sizeof(parts));
+    return (parts.ptr & 1) || parts.adj ? nullptr : reinterpret_cast<const void*>(parts.ptr);
+}
+
+void Z80::compileBlock(CachedBlock& block) {
+    std::vector<Z80JIT::Op> ops;
+    ops.reserve(block.ops.size());
+    for (const CachedOp& op : block.ops) {
+        const void* entry = handlerEntry(op.handler);
+        if (!entry) {
+            return;
+        }
+        ops.push_back({entry, op.operandPC, op.nextPC, op.cycles, op.fetches, op.index, op.displacement});
+    }
+
+    block.compiled = jit->compile(ops);
+    if (!block.compiled) {
+        // Arena full: drop every compiled block and start over
+        for (auto& blocks : blockCache) {
+            for (auto& cached : blocks) {
+                if (cached) {
+                    cached->compiled = nullptr;
+                    cached->runs = 0;
+                }
+            }
+        }
+        jit->flush();
+        block.compiled = jit->compile(ops);
+    }
+}
+
 uint8_t Z80::fetchOpcode() {
     uint8_t opcode = memory.readByte(registers.PC);
     registers.PC++;
-    registers.R = (registers.R + 1) & 0x7F; // Increment refresh register (lower 7 bits)
-    cycles += 4; // Basic memory read timing
+    registers.R = (registers.R & 0x80) | ((registers.R + 1) & 0x7F); // Refresh counter, bit 7 is kept
+    cycles += m1WaitStates;     // The T-states themselves are in the CYCLES_* tables
     return opcode;
 }
 
 uint8_t Z80::fetchByte() {
     uint8_t byte = memory.readByte(registers.PC);
     registers.PC++;
-    cycles += 3; // Memory read timing
     return byte;
 }
 
 uint16_t Z80::fetchWord() {
     uint16_t word = memory.readWord(registers.PC);
     registers.PC += 2;
-    cycles += 6; // Double memory read timing
     return word;
 }
 
 void Z80::pushByte(uint8_t value) {
     registers.SP--;
     memory.writeByte(registers.SP, value);
-    cycles += 3; // Memory write timing
 }
 
 uint8_t Z80::popByte() {
     uint8_t value = memory.readByte(registers.SP);
     registers.SP++;
-    cycles += 3; // Memory read timing
     return value;
 }
 
 void Z80::pushWord(uint16_t value) {
     pushByte((value >> 8) & 0xFF); // Push high byte first
     pushByte(value & 0xFF);        // Then push low byte
-    cycles += 1; // Additional overhead for word operation
 }
 
 uint16_t Z80::popWord() {
     uint8_t lowByte = popByte();
     uint8_t highByte = popByte();
-    cycles += 1; // Additional overhead for word operation
     return (highByte << 8) | lowByte;
 }
 
@@ -80,946 +337,480 @@ int8_t Z80::signExtend(uint8_t value) {
     return (int8_t)value;
 }
 
-void Z80::calculateParity(uint8_t value) {
-    int count = 0;
-    for (int i = 0; i < 8; ++i) {
-        if ((value >> i) & 0x01) {
-            count++;
-        }
-    }
-    registers.setFlag(Z80Registers::ParityOverflow, (count % 2) == 0);
-    cycles += 4; // Flag calculation overhead
+// S, Z and P/V from the value; the other flags are left alone
+void Z80::updateFlags_SZP(uint8_t value) {
+    constexpr uint8_t SZP = Z80Registers::Sign | Z80Registers::Zero | Z80Registers::ParityOverflow;
+    registers.setFlags((registers.getF() & ~SZP) | PZS_TABLE[value]);
 }
 
-void Z80::updateFlags_SZP(uint8_t value) {
-    registers.setFlag(Z80Registers::Sign, (value & 0x80) != 0);
-    registers.setFlag(Z80Registers::Zero, value == 0);
-    calculateParity(value);
-    cycles += 2; // Flag update overhead
-}
-
-void Z80::updateFlagsArithmetic(uint8_t result, bool isSubtraction, bool carry, bool halfCarry, bool overflow) {
-    registers.setFlag(Z80Registers::Sign, (result & 0x80) != 0);
-    registers.setFlag(Z80Registers::Zero, result == 0);
-    registers.setFlag(Z80Registers::HalfCarry, halfCarry);
-    registers.setFlag(Z80Registers::ParityOverflow, overflow);
-    registers.setFlag(Z80Registers::Subtract, isSubtraction);
-    registers.setFlag(Z80Registers::Carry, carry);
-    registers.updateFlagsRegister();
-    cycles += 2; // Flag update overhead
-}
-
-void Z80::updateFlagsLogical(uint8_t result, bool carry, bool halfCarry) {
-    registers.setFlag(Z80Registers::Sign, (result & 0x80) != 0);
-    registers.setFlag(Z80Registers::Zero, result == 0);
-    registers.setFlag(Z80Registers::HalfCarry, halfCarry);
-    registers.setFlag(Z80Registers::ParityOverflow, __builtin_parity(result) == 0);
-    registers.setFlag(Z80Registers::Subtract, false);
-    registers.setFlag(Z80Registers::Carry, carry);
-    registers.updateFlagsRegister();
-    cycles += 2; // Flag update overhead
+// --- 8-bit ALU ---
+// These only record operands and result; Z80Registers works the flags out
+// if and when they are read.
+void Z80::aluAdd(uint8_t value, uint8_t carry) {
+    uint8_t result = registers.A + value + carry;
+    registers.setLazyFlags(Z80Registers::FlagOp::Add, registers.A, value, carry, result);
+    registers.A = result;
+}
+
+void Z80::aluSub(uint8_t value, uint8_t carry) {
+    uint8_t result = registers.A - value - carry;
+    registers.setLazyFlags(Z80Registers::FlagOp::Sub, registers.A, value, carry, result);
+    registers.A = result;
+}
+
+void Z80::aluCompare(uint8_t value) {
+    registers.setLazyFlags(Z80Registers::FlagOp::Sub, registers.A, value, 0, registers.A - value);
+}
+
+void Z80::aluAnd(uint8_t value) {
+    registers.A &= value;
+    registers.setLazyFlags(Z80Registers::FlagOp::And, 0, 0, 0, registers.A);
+}
+
+void Z80::aluXor(uint8_t value) {
+    registers.A ^= value;
+    registers.setLazyFlags(Z80Registers::FlagOp::Logic, 0, 0, 0, registers.A);
+}
+
+void Z80::aluOr(uint8_t value) {
+    registers.A |= value;
+    registers.setLazyFlags(Z80Registers::FlagOp::Logic, 0, 0, 0, registers.A);
+}
+
+uint8_t Z80::aluInc(uint8_t value) {
+    uint8_t result = value + 1;
+    registers.setLazyFlags(Z80Registers::FlagOp::Inc, value, 1, registers.getFlag(Z80Registers::Carry), result);
+    return result;
+}
+
+uint8_t Z80::aluDec(uint8_t value) {
+    uint8_t result = value - 1;
+    registers.setLazyFlags(Z80Registers::FlagOp::Dec, value, 1, registers.getFlag(Z80Registers::Carry), result);
+    return result;
 }
 
 void Z80::checkBit(uint8_t value, uint8_t bit) {
-    bool isSet = (value >> bit) & 0x01;
-    registers.setFlag(Z80Registers::Zero, !isSet);
-    registers.setFlag(Z80Registers::HalfCarry, true);
-    registers.setFlag(Z80Registers::Subtract, false);
-    registers.setFlag(Z80Registers::Sign, bit == 7 && isSet);
-    registers.setFlag(Z80Registers::ParityOverflow, !isSet);
-    registers.updateFlagsRegister();
-    cycles += 4; // Bit test overhead
+    // As fMSX's M_BIT: C kept, H set, S/Z/P/V from the tested bit alone
+    registers.setFlags((registers.getF() & Z80Registers::Carry) | Z80Registers::HalfCarry |
+                       PZS_TABLE[value & (1 << bit)]);
 }
 
 void Z80::setInterruptLine(bool high) {
     interrupt_pending = high;
-    cycles += 2; // Interrupt line setting overhead
-}
-
-int Z80::decodeAndExecuteMainInstruction(uint8_t opcode) {
-    switch (opcode) {
-        case 0x00: NOP(); return 4;
-        case 0x01: LD_BC_d16(); return 10;
-        case 0x02: LD_iBC_A(); return 7;
-        case 0x03: INC_nn(registers.BC); return 6;
-        case 0x04: INC_r(registers.B); return 4;
-        case 0x05: DEC_r(registers.B); return 4;
-        case 0x06: LD_r_n(registers.B, fetchOpcode()); return 7;
-        case 0x07: RLCA(); return 4;
-        case 0x08: EX_AF_AF(); return 4;
-        case 0x09: ADD_HL_ss(registers.BC); return 11;
-        case 0x0A: LD_A_iBC(); return 7;
-        case 0x0B: DEC_nn(registers.BC); return 6;
-        case 0x0C: INC_r(registers.C); return 4;
-        case 0x0D: DEC_r(registers.C); return 4;
-        case 0x0E: LD_r_n(registers.C, fetchOpcode()); return 7;
-        case 0x0F: RRCA(); return 4;
-        case 0x10: DJNZ_d8(); return (registers.B != 0) ? 13 : 8;
-        case 0x11: LD_DE_d16(); return 10;
-        case 0x12: LD_iDE_A(); return 7;
-        case 0x13: INC_nn(registers.DE); return 6;
-        case 0x14: INC_r(registers.D); return 4;
-        case 0x15: DEC_r(registers.D); return 4;
-        case 0x16: LD_r_n(registers.D, fetchOpcode()); return 7;
-        case 0x17: RLA(); return 4;
-        case 0x18: JR_d8(); return 12;
-        case 0x19: ADD_HL_ss(registers.DE); return 11;
-        case 0x1A: LD_A_iDE(); return 7;
-        case 0x1B: DEC_nn(registers.DE); return 6;
-        case 0x1C: INC_r(registers.E); return 4;
-        case 0x1D: DEC_r(registers.E); return 4;
-        case 0x1E: LD_r_n(registers.E, fetchOpcode()); return 7;
-        case 0x1F: RRA(); return 4;
-        case 0x20: JR_NZ_d8(); return (registers.getFlag(Z80Registers::Flag::Zero) == 0) ? 12 : 7;
-        case 0x21: LD_HL_d16(); return 10;
-        case 0x22: LD_inn_HL(); return 16;
-        case 0x23: INC_nn(registers.HL); return 6;
-        case 0x24: INC_r(registers.H); return 4;
-        case 0x25: DEC_r(registers.H); return 4;
-        case 0x26: LD_r_n(registers.H, fetchOpcode()); return 7;
-        case 0x27: DAA(); return 4;
-        case 0x28: JR_Z_d8(); return (registers.getFlag(Z80Registers::Flag::Zero) == 1) ? 12 : 7;
-        case 0x29: ADD_HL_ss(registers.HL); return 11;
-        case 0x2A: LD_HL_inn(); return 16;
-        case 0x2B: DEC_nn(registers.HL); return 6;
-        case 0x2C: INC_r(registers.L); return 4;
-        case 0x2D: DEC_r(registers.L); return 4;
-        case 0x2E: LD_r_n(registers.L, fetchOpcode()); return 7;
-        case 0x2F: CPL(); return 4;
-        case 0x30: JR_NC_d8(); return (registers.getFlag(Z80Registers::Flag::Carry) == 0) ? 12 : 7;
-        case 0x31: LD_SP_d16(); return 10;
-        case 0x32: LD_inn_A(); return 13;
-        case 0x33: INC_nn(registers.SP); return 6;
-        case 0x34: INC_iHL(); return 11;
-        case 0x35: DEC_iHL(); return 11;
-        case 0x36: LD_iHL_n(fetchOpcode()); return 10;
-        case 0x37: SCF(); return 4;
-        case 0x38: JR_C_d8(); return (registers.getFlag(Z80Registers::Flag::Carry) == 1) ? 12 : 7;
-        case 0x39: ADD_HL_ss(registers.SP); return 11;
-        case 0x3A: LD_A_inn(); return 13;
-        case 0x3B: DEC_nn(registers.SP); return 6;
-        case 0x3C: INC_r(registers.A); return 4;
-        case 0x3D: DEC_r(registers.A); return 4;
-        case 0x3E: LD_r_n(registers.A, fetchOpcode()); return 7;
-        case 0x3F: CCF(); return 4;
-        case 0x40: LD_r_r(registers.B, registers.B); return 4;
-        case 0x41: LD_r_r(registers.B, registers.C); return 4;
-        case 0x42: LD_r_r(registers.B, registers.D); return 4;
-        case 0x43: LD_r_r(registers.B, registers.E); return 4;
-        case 0x44: LD_r_r(registers.B, registers.H); return 4;
-        case 0x45: LD_r_r(registers.B, registers.L); return 4;
-        case 0x46: LD_r_iHL(registers.B); return 7;
-        case 0x47: LD_r_r(registers.B, registers.A); return 4;
-        case 0x48: LD_r_r(registers.C, registers.B); return 4;
-        case 0x49: LD_r_r(registers.C, registers.C); return 4;
-        case 0x4A: LD_r_r(registers.C, registers.D); return 4;
-        case 0x4B: LD_r_r(registers.C, registers.E); return 4;
-        case 0x4C: LD_r_r(registers.C, registers.H); return 4;
-        case 0x4D: LD_r_r(registers.C, registers.L); return 4;
-        case 0x4E: LD_r_iHL(registers.C); return 7;
-        case 0x4F: LD_r_r(registers.C, registers.A); return 4;
-        case 0x50: LD_r_r(registers.D, registers.B); return 4;
-        case 0x51: LD_r_r(registers.D, registers.C); return 4;
-        case 0x52: LD_r_r(registers.D, registers.D); return 4;
-        case 0x53: LD_r_r(registers.D, registers.E); return 4;
-        case 0x54: LD_r_r(registers.D, registers.H); return 4;
-        case 0x55: LD_r_r(registers.D, registers.L); return 4;
-        case 0x56: LD_r_iHL(registers.D); return 7;
-        case 0x57: LD_r_r(registers.D, registers.A); return 4;
-        case 0x58: LD_r_r(registers.E, registers.B); return 4;
-        case 0x59: LD_r_r(registers.E, registers.C); return 4;
-        case 0x5A: LD_r_r(registers.E, registers.D); return 4;
-        case 0x5B: LD_r_r(registers.E, registers.E); return 4;
-        case 0x5C: LD_r_r(registers.E, registers.H); return 4;
-        case 0x5D: LD_r_r(registers.E, registers.L); return 4;
-        case 0x5E: LD_r_iHL(registers.E); return 7;
-        case 0x5F: LD_r_r(registers.E, registers.A); return 4;
-        case 0x60: LD_r_r(registers.H, registers.B); return 4;
-        case 0x61: LD_r_r(registers.H, registers.C); return 4;
-        case 0x62: LD_r_r(registers.H, registers.D); return 4;
-        case 0x63: LD_r_r(registers.H, registers.E); return 4;
-        case 0x64: LD_r_r(registers.H, registers.H); return 4;
-        case 0x65: LD_r_r(registers.H, registers.L); return 4;
-        case 0x66: LD_r_iHL(registers.H); return 7;
-        case 0x67: LD_r_r(registers.H, registers.A); return 4;
-        case 0x68: LD_r_r(registers.L, registers.B); return 4;
-        case 0x69: LD_r_r(registers.L, registers.C); return 4;
-        case 0x6A: LD_r_r(registers.L, registers.D); return 4;
-        case 0x6B: LD_r_r(registers.L, registers.E); return 4;
-        case 0x6C: LD_r_r(registers.L, registers.H); return 4;
-        case 0x6D: LD_r_r(registers.L, registers.L); return 4;
-        case 0x6E: LD_r_iHL(registers.L); return 7;
-        case 0x6F: LD_r_r(registers.L, registers.A); return 4;
-        case 0x70: LD_iHL_r(registers.B); return 7;
-        case 0x71: LD_iHL_r(registers.C); return 7;
-        case 0x72: LD_iHL_r(registers.D); return 7;
-        case 0x73: LD_iHL_r(registers.E); return 7;
-        case 0x74: LD_iHL_r(registers.H); return 7;
-        case 0x75: LD_iHL_r(registers.L); return 7;
-        case 0x76: HALT(); return 4;
-        case 0x77: LD_iHL_r(registers.A); return 7;
-        case 0x78: LD_r_r(registers.A, registers.B); return 4;
-        case 0x79: LD_r_r(registers.A, registers.C); return 4;
-        case 0x7A: LD_r_r(registers.A, registers.D); return 4;
-        case 0x7B: LD_r_r(registers.A, registers.E); return 4;
-        case 0x7C: LD_r_r(registers.A, registers.H); return 4;
-        case 0x7D: LD_r_r(registers.A, registers.L); return 4;
-        case 0x7E: LD_r_iHL(registers.A); return 7;
-        case 0x7F: LD_r_r(registers.A, registers.A); return 4;
-        case 0x80: ADD_A_r(registers.B); return 4;
-        case 0x81: ADD_A_r(registers.C); return 4;
-        case 0x82: ADD_A_r(registers.D); return 4;
-        case 0x83: ADD_A_r(registers.E); return 4;
-        case 0x84: ADD_A_r(registers.H); return 4;
-        case 0x85: ADD_A_r(registers.L); return 4;
-        case 0x86: ADD_A_iHL(); return 7;
-        case 0x87: ADD_A_r(registers.A); return 4;
-        case 0x88: ADC_A_r(registers.B); return 4;
-        case 0x89: ADC_A_r(registers.C); return 4;
-        case 0x8A: ADC_A_r(registers.D); return 4;
-        case 0x8B: ADC_A_r(registers.E); return 4;
-        case 0x8C: ADC_A_r(registers.H); return 4;
-        case 0x8D: ADC_A_r(registers.L); return 4;
-        case 0x8E: ADC_A_iHL(); return 7;
-        case 0x8F: ADC_A_r(registers.A); return 4;
-        case 0x90: SUB_r(registers.B); return 4;
-        case 0x91: SUB_r(registers.C); return 4;
-        case 0x92: SUB_r(registers.D); return 4;
-        case 0x93: SUB_r(registers.E); return 4;
-        case 0x94: SUB_r(registers.H); return 4;
-        case 0x95: SUB_r(registers.L); return 4;
-        case 0x96: SUB_iHL(); return 7;
-        case 0x97: SUB_r(registers.A); return 4;
-        case 0x98: SBC_A_r(registers.B); return 4;
-        case 0x99: SBC_A_r(registers.C); return 4;
-        case 0x9A: SBC_A_r(registers.D); return 4;
-        case 0x9B: SBC_A_r(registers.E); return 4;
-        case 0x9C: SBC_A_r(registers.H); return 4;
-        case 0x9D: SBC_A_r(registers.L); return 4;
-        case 0x9E: SBC_A_iHL(); return 7;
-        case 0x9F: SBC_A_r(registers.A); return 4;
-        case 0xA0: AND_r(registers.B); return 4;
-        case 0xA1: AND_r(registers.C); return 4;
-        case 0xA2: AND_r(registers.D); return 4;
-        case 0xA3: AND_r(registers.E); return 4;
-        case 0xA4: AND_r(registers.H); return 4;
-        case 0xA5: AND_r(registers.L); return 4;
-        case 0xA6: AND_iHL(); return 7;
-        case 0xA7: AND_r(registers.A); return 4;
-        case 0xA8: XOR_r(registers.B); return 4;
-        case 0xA9: XOR_r(registers.C); return 4;
-        case 0xAA: XOR_r(registers.D); return 4;
-        case 0xAB: XOR_r(registers.E); return 4;
-        case 0xAC: XOR_r(registers.H); return 4;
-        case 0xAD: XOR_r(registers.L); return 4;
-        case 0xAE: XOR_iHL(); return 7;
-        case 0xAF: XOR_r(registers.A); return 4;
-        case 0xB0: OR_r(registers.B); return 4;
-        case 0xB1: OR_r(registers.C); return 4;
-        case 0xB2: OR_r(registers.D); return 4;
-        case 0xB3: OR_r(registers.E); return 4;
-        case 0xB4: OR_r(registers.H); return 4;
-        case 0xB5: OR_r(registers.L); return 4;
-        case 0xB6: OR_iHL(); return 7;
-        case 0xB7: OR_r(registers.A); return 4;
-        case 0xB8: CP_r(registers.B); return 4;
-        case 0xB9: CP_r(registers.C); return 4;
-        case 0xBA: CP_r(registers.D); return 4;
-        case 0xBB: CP_r(registers.E); return 4;
-        case 0xBC: CP_r(registers.H); return 4;
-        case 0xBD: CP_r(registers.L); return 4;
-        case 0xBE: CP_iHL(); return 7;
-        case 0xBF: CP_r(registers.A); return 4;
-        case 0xC0: RET_cc(registers.getFlag(Z80Registers::Flag::Zero) == 0); return (registers.getFlag(Z80Registers::Flag::Zero) == 0) ? 11 : 5;
-        case 0xC1: POP_qq(registers.BC); return 10;
-        case 0xC2: JP_cc_nn(registers.getFlag(Z80Registers::Flag::Zero) == 0); return 10;
-        case 0xC3: JP_nn(); return 10;
-        case 0xC4: CALL_cc_nn(registers.getFlag(Z80Registers::Flag::Zero) == 0); return (registers.getFlag(Z80Registers::Flag::Zero) == 0) ? 17 : 10;
-        case 0xC5: PUSH_qq(registers.BC); return 11;
-        case 0xC6: ADD_A_n(fetchByte()); return 7;
-        case 0xC7: RST_p(0x00); return 11;
-        case 0xC8: RET_cc(registers.getFlag(Z80Registers::Flag::Zero) == 1); return (registers.getFlag(Z80Registers::Flag::Zero) == 1) ? 11 : 5;
-        case 0xC9: RET(); return 10;
-        case 0xCA: JP_cc_nn(registers.getFlag(Z80Registers::Flag::Zero) == 1); return 10;
-        case 0xCB: return decodeAndExecuteCBInstruction(fetchOpcode());
-        case 0xCC: CALL_cc_nn(registers.getFlag(Z80Registers::Flag::Zero) == 1); return (registers.getFlag(Z80Registers::Flag::Zero) == 1) ? 17 : 10;
-        case 0xCD: CALL_nn(); return 17;
-        case 0xCE: ADC_A_n(fetchByte()); return 7;
-        case 0xCF: RST_p(0x08); return 11;
-        case 0xD0: RET_cc(registers.getFlag(Z80Registers::Flag::Carry) == 0); return (registers.getFlag(Z80Registers::Flag::Carry) == 0) ? 11 : 5;
-        case 0xD1: POP_qq(registers.DE); return 10;
-        case 0xD2: JP_cc_nn(registers.getFlag(Z80Registers::Flag::Carry) == 0); return 10;
-        case 0xD3: OUT_in_A(); return 11;
-        case 0xD4: CALL_cc_nn(registers.getFlag(Z80Registers::Flag::Carry) == 0); return (registers.getFlag(Z80Registers::Flag::Carry) == 0) ? 17 : 10;
-        case 0xD5: PUSH_qq(registers.DE); return 11;
-        case 0xD6: SUB_n(fetchByte()); return 7;
-        case 0xD7: RST_p(0x10); return 11;
-        case 0xD8: RET_cc(registers.getFlag(Z80Registers::Flag::Carry) == 1); return (registers.getFlag(Z80Registers::Flag::Carry) == 1) ? 11 : 5;
-        case 0xD9: EXX(); return 4;
-        case 0xDA: JP_cc_nn(registers.getFlag(Z80Registers::Flag::Carry) == 1); return 10;
-        case 0xDB: IN_A_in(); return 11;
-        case 0xDC: CALL_cc_nn(registers.getFlag(Z80Registers::Flag::Carry) == 1); return (registers.getFlag(Z80Registers::Flag::Carry) == 1) ? 17 : 10;
-        case 0xDD: return decodeAndExecuteDDInstruction(fetchOpcode());
-        case 0xDE: SBC_A_n(fetchByte()); return 7;
-        case 0xDF: RST_p(0x18); return 11;
-        case 0xE0: RET_cc(registers.getFlag(Z80Registers::Flag::ParityOverflow) == 0); return (registers.getFlag(Z80Registers::Flag::ParityOverflow) == 0) ? 11 : 5;
-        case 0xE1: POP_qq(registers.HL); return 10;
-        case 0xE2: JP_cc_nn(registers.getFlag(Z80Registers::Flag::ParityOverflow) == 0); return 10;
-        case 0xE3: EX_iSP_HL(); return 19;
-        case 0xE4: CALL_cc_nn(registers.getFlag(Z80Registers::Flag::ParityOverflow) == 0); return (registers.getFlag(Z80Registers::Flag::ParityOverflow) == 0) ? 17 : 10;
-        case 0xE5: PUSH_qq(registers.HL); return 11;
-        case 0xE6: AND_n(fetchByte()); return 7;
-        case 0xE7: RST_p(0x20); return 11;
-        case 0xE8: RET_cc(registers.getFlag(Z80Registers::Flag::ParityOverflow) == 1); return (registers.getFlag(Z80Registers::Flag::ParityOverflow) == 1) ? 11 : 5;
-        case 0xE9: JP_iHL(); return 4;
-        case 0xEA: JP_cc_nn(registers.getFlag(Z80Registers::Flag::ParityOverflow) == 1); return 10;
-        case 0xEB: EX_DE_HL(); return 4;
-        case 0xEC: CALL_cc_nn(registers.getFlag(Z80Registers::Flag::ParityOverflow) == 1); return (registers.getFlag(Z80Registers::Flag::ParityOverflow) == 1) ? 17 : 10;
-        case 0xED: return decodeAndExecuteEDInstruction(fetchOpcode());
-        case 0xEE: XOR_n(fetchByte()); return 7;
-        case 0xEF: RST_p(0x28); return 11;
-        case 0xF0: RET_cc(registers.getFlag(Z80Registers::Flag::Sign) == 0); return (registers.getFlag(Z80Registers::Flag::Sign) == 0) ? 11 : 5;
-        case 0xF1: POP_qq(registers.AF); return 10;
-        case 0xF2: JP_cc_nn(registers.getFlag(Z80Registers::Flag::Sign) == 0); return 10;
-        case 0xF3: DI(); return 4;
-        case 0xF4: CALL_cc_nn(registers.getFlag(Z80Registers::Flag::Sign) == 0); return (registers.getFlag(Z80Registers::Flag::Sign) == 0) ? 17 : 10;
-        case 0xF5: PUSH_qq(registers.AF); return 11;
-        case 0xF6: OR_n(fetchByte()); return 7;
-        case 0xF7: RST_p(0x30); return 11;
-        case 0xF8: RET_cc(registers.getFlag(Z80Registers::Flag::Sign) == 1); return (registers.getFlag(Z80Registers::Flag::Sign) == 1) ? 11 : 5;
-        case 0xF9: LD_iSP_HL(); return 6;
-        case 0xFA: JP_cc_nn(registers.getFlag(Z80Registers::Flag::Sign) == 1); return 10;
-        case 0xFB: EI(); return 4;
-        case 0xFC: CALL_cc_nn(registers.getFlag(Z80Registers::Flag::Sign) == 1); return (registers.getFlag(Z80Registers::Flag::Sign) == 1) ? 17 : 10;
-        case 0xFD: return decodeAndExecuteFDInstruction(fetchOpcode());
-        case 0xFE: CP_n(fetchByte()); return 7;
-        case 0xFF: RST_p(0x38); return 11;
-
-        default:
-            std::cerr << "Unknown opcode: 0x" << std::hex << (int)opcode << std::endl;
-            return 4;
-    }
 }
 
-int Z80::decodeAndExecuteCBInstruction(uint8_t opcode) {
-    switch (opcode) {
-        case 0x00: RLC_r(registers.B); return 8;
-        case 0x01: RLC_r(registers.C); return 8;
-        case 0x02: RLC_r(registers.D); return 8;
-        case 0x03: RLC_r(registers.E); return 8;
-        case 0x04: RLC_r(registers.H); return 8;
-        case 0x05: RLC_r(registers.L); return 8;
-        case 0x06: RLC_iHL(); return 15;
-        case 0x07: RLC_r(registers.A); return 8;
-        case 0x08: RRC_r(registers.B); return 8;
-        case 0x09: RRC_r(registers.C); return 8;
-        case 0x0A: RRC_r(registers.D); return 8;
-        case 0x0B: RRC_r(registers.E); return 8;
-        case 0x0C: RRC_r(registers.H); return 8;
-        case 0x0D: RRC_r(registers.L); return 8;
-        case 0x0E: RRC_iHL(); return 15;
-        case 0x0F: RRC_r(registers.A); return 8;
-        case 0x10: RL_r(registers.B); return 8;
-        case 0x11: RL_r(registers.C); return 8;
-        case 0x12: RL_r(registers.D); return 8;
-        case 0x13: RL_r(registers.E); return 8;
-        case 0x14: RL_r(registers.H); return 8;
-        case 0x15: RL_r(registers.L); return 8;
-        case 0x16: RL_iHL(); return 15;
-        case 0x17: RL_r(registers.A); return 8;
-        case 0x18: RR_r(registers.B); return 8;
-        case 0x19: RR_r(registers.C); return 8;
-        case 0x1A: RR_r(registers.D); return 8;
-        case 0x1B: RR_r(registers.E); return 8;
-        case 0x1C: RR_r(registers.H); return 8;
-        case 0x1D: RR_r(registers.L); return 8;
-        case 0x1E: RR_iHL(); return 15;
-        case 0x1F: RR_r(registers.A); return 8;
-        case 0x20: SLA_r(registers.B); return 8;
-        case 0x21: SLA_r(registers.C); return 8;
-        case 0x22: SLA_r(registers.D); return 8;
-        case 0x23: SLA_r(registers.E); return 8;
-        case 0x24: SLA_r(registers.H); return 8;
-        case 0x25: SLA_r(registers.L); return 8;
-        case 0x26: SLA_iHL(); return 15;
-        case 0x27: SLA_r(registers.A); return 8;
-        case 0x28: SRA_r(registers.B); return 8;
-        case 0x29: SRA_r(registers.C); return 8;
-        case 0x2A: SRA_r(registers.D); return 8;
-        case 0x2B: SRA_r(registers.E); return 8;
-        case 0x2C: SRA_r(registers.H); return 8;
-        case 0x2D: SRA_r(registers.L); return 8;
-        case 0x2E: SRA_iHL(); return 15;
-        case 0x2F: SRA_r(registers.A); return 8;
-        case 0x30: SLL_r(registers.B); return 8;
-        case 0x31: SLL_r(registers.C); return 8;
-        case 0x32: SLL_r(registers.D); return 8;
-        case 0x33: SLL_r(registers.E); return 8;
-        case 0x34: SLL_r(registers.H); return 8;
-        case 0x35: SLL_r(registers.L); return 8;
-        case 0x36: SLL_iHL(); return 15;
-        case 0x37: SLL_r(registers.A); return 8;
-        case 0x38: SRL_r(registers.B); return 8;
-        case 0x39: SRL_r(registers.C); return 8;
-        case 0x3A: SRL_r(registers.D); return 8;
-        case 0x3B: SRL_r(registers.E); return 8;
-        case 0x3C: SRL_r(registers.H); return 8;
-        case 0x3D: SRL_r(registers.L); return 8;
-        case 0x3E: SRL_iHL(); return 15;
-        case 0x3F: SRL_r(registers.A); return 8;
-        case 0x40: BIT_b_r(0, registers.B); return 8;
-        case 0x41: BIT_b_r(0, registers.C); return 8;
-        case 0x42: BIT_b_r(0, registers.D); return 8;
-        case 0x43: BIT_b_r(0, registers.E); return 8;
-        case 0x44: BIT_b_r(0, registers.H); return 8;
-        case 0x45: BIT_b_r(0, registers.L); return 8;
-        case 0x46: BIT_b_iHL(0); return 12;
-        case 0x47: BIT_b_r(0, registers.A); return 8;
-        case 0x48: BIT_b_r(1, registers.B); return 8;
-        case 0x49: BIT_b_r(1, registers.C); return 8;
-        case 0x4A: BIT_b_r(1, registers.D); return 8;
-        case 0x4B: BIT_b_r(1, registers.E); return 8;
-        case 0x4C: BIT_b_r(1, registers.H); return 8;
-        case 0x4D: BIT_b_r(1, registers.L); return 8;
-        case 0x4E: BIT_b_iHL(1); return 12;
-        case 0x4F: BIT_b_r(1, registers.A); return 8;
-        case 0x50: BIT_b_r(2, registers.B); return 8;
-        case 0x51: BIT_b_r(2, registers.C); return 8;
-        case 0x52: BIT_b_r(2, registers.D); return 8;
-        case 0x53: BIT_b_r(2, registers.E); return 8;
-        case 0x54: BIT_b_r(2, registers.H); return 8;
-        case 0x55: BIT_b_r(2, registers.L); return 8;
-        case 0x56: BIT_b_iHL(2); return 12;
-        case 0x57: BIT_b_r(2, registers.A); return 8;
-        case 0x58: BIT_b_r(3, registers.B); return 8;
-        case 0x59: BIT_b_r(3, registers.C); return 8;
-        case 0x5A: BIT_b_r(3, registers.D); return 8;
-        case 0x5B: BIT_b_r(3, registers.E); return 8;
-        case 0x5C: BIT_b_r(3, registers.H); return 8;
-        case 0x5D: BIT_b_r(3, registers.L); return 8;
-        case 0x5E: BIT_b_iHL(3); return 12;
-        case 0x5F: BIT_b_r(3, registers.A); return 8;
-        case 0x60: BIT_b_r(4, registers.B); return 8;
-        case 0x61: BIT_b_r(4, registers.C); return 8;
-        case 0x62: BIT_b_r(4, registers.D); return 8;
-        case 0x63: BIT_b_r(4, registers.E); return 8;
-        case 0x64: BIT_b_r(4, registers.H); return 8;
-        case 0x65: BIT_b_r(4, registers.L); return 8;
-        case 0x66: BIT_b_iHL(4); return 12;
-        case 0x67: BIT_b_r(4, registers.A); return 8;
-        case 0x68: BIT_b_r(5, registers.B); return 8;
-        case 0x69: BIT_b_r(5, registers.C); return 8;
-        case 0x6A: BIT_b_r(5, registers.D); return 8;
-        case 0x6B: BIT_b_r(5, registers.E); return 8;
-        case 0x6C: BIT_b_r(5, registers.H); return 8;
-        case 0x6D: BIT_b_r(5, registers.L); return 8;
-        case 0x6E: BIT_b_iHL(5); return 12;
-        case 0x6F: BIT_b_r(5, registers.A); return 8;
-        case 0x70: BIT_b_r(6, registers.B); return 8;
-        case 0x71: BIT_b_r(6, registers.C); return 8;
-        case 0x72: BIT_b_r(6, registers.D); return 8;
-        case 0x73: BIT_b_r(6, registers.E); return 8;
-        case 0x74: BIT_b_r(6, registers.H); return 8;
-        case 0x75: BIT_b_r(6, registers.L); return 8;
-        case 0x76: BIT_b_iHL(6); return 12;
-        case 0x77: BIT_b_r(6, registers.A); return 8;
-        case 0x78: BIT_b_r(7, registers.B); return 8;
-        case 0x79: BIT_b_r(7, registers.C); return 8;
-        case 0x7A: BIT_b_r(7, registers.D); return 8;
-        case 0x7B: BIT_b_r(7, registers.E); return 8;
-        case 0x7C: BIT_b_r(7, registers.H); return 8;
-        case 0x7D: BIT_b_r(7, registers.L); return 8;
-        case 0x7E: BIT_b_iHL(7); return 12;
-        case 0x7F: BIT_b_r(7, registers.A); return 8;
-        case 0x80: RES_b_r(0, registers.B); return 8;
-        case 0x81: RES_b_r(0, registers.C); return 8;
-        case 0x82: RES_b_r(0, registers.D); return 8;
-        case 0x83: RES_b_r(0, registers.E); return 8;
-        case 0x84: RES_b_r(0, registers.H); return 8;
-        case 0x85: RES_b_r(0, registers.L); return 8;
-        case 0x86: RES_b_iHL(0); return 15;
-        case 0x87: RES_b_r(0, registers.A); return 8;
-        case 0x88: RES_b_r(1, registers.B); return 8;
-        case 0x89: RES_b_r(1, registers.C); return 8;
-        case 0x8A: RES_b_r(1, registers.D); return 8;
-        case 0x8B: RES_b_r(1, registers.E); return 8;
-        case 0x8C: RES_b_r(1, registers.H); return 8;
-        case 0x8D: RES_b_r(1, registers.L); return 8;
-        case 0x8E: RES_b_iHL(1); return 15;
-        case 0x8F: RES_b_r(1, registers.A); return 8;
-        case 0x90: RES_b_r(2, registers.B); return 8;
-        case 0x91: RES_b_r(2, registers.C); return 8;
-        case 0x92: RES_b_r(2, registers.D); return 8;
-        case 0x93: RES_b_r(2, registers.E); return 8;
-        case 0x94: RES_b_r(2, registers.H); return 8;
-        case 0x95: RES_b_r(2, registers.L); return 8;
-        case 0x96: RES_b_iHL(2); return 15;
-        case 0x97: RES_b_r(2, registers.A); return 8;
-        case 0x98: RES_b_r(3, registers.B); return 8;
-        case 0x99: RES_b_r(3, registers.C); return 8;
-        case 0x9A: RES_b_r(3, registers.D); return 8;
-        case 0x9B: RES_b_r(3, registers.E); return 8;
-        case 0x9C: RES_b_r(3, registers.H); return 8;
-        case 0x9D: RES_b_r(3, registers.L); return 8;
-        case 0x9E: RES_b_iHL(3); return 15;
-        case 0x9F: RES_b_r(3, registers.A); return 8;
-        case 0xA0: RES_b_r(4, registers.B); return 8;
-        case 0xA1: RES_b_r(4, registers.C); return 8;
-        case 0xA2: RES_b_r(4, registers.D); return 8;
-        case 0xA3: RES_b_r(4, registers.E); return 8;
-        case 0xA4: RES_b_r(4, registers.H); return 8;
-        case 0xA5: RES_b_r(4, registers.L); return 8;
-        case 0xA6: RES_b_iHL(4); return 15;
-        case 0xA7: RES_b_r(4, registers.A); return 8;
-        case 0xA8: RES_b_r(5, registers.B); return 8;
-        case 0xA9: RES_b_r(5, registers.C); return 8;
-        case 0xAA: RES_b_r(5, registers.D); return 8;
-        case 0xAB: RES_b_r(5, registers.E); return 8;
-        case 0xAC: RES_b_r(5, registers.H); return 8;
-        case 0xAD: RES_b_r(5, registers.L); return 8;
-        case 0xAE: RES_b_iHL(5); return 15;
-        case 0xAF: RES_b_r(5, registers.A); return 8;
-        case 0xB0: RES_b_r(6, registers.B); return 8;
-        case 0xB1: RES_b_r(6, registers.C); return 8;
-        case 0xB2: RES_b_r(6, registers.D); return 8;
-        case 0xB3: RES_b_r(6, registers.E); return 8;
-        case 0xB4: RES_b_r(6, registers.H); return 8;
-        case 0xB5: RES_b_r(6, registers.L); return 8;
-        case 0xB6: RES_b_iHL(6); return 15;
-        case 0xB7: RES_b_r(6, registers.A); return 8;
-        case 0xB8: RES_b_r(7, registers.B); return 8;
-        case 0xB9: RES_b_r(7, registers.C); return 8;
-        case 0xBA: RES_b_r(7, registers.D); return 8;
-        case 0xBB: RES_b_r(7, registers.E); return 8;
-        case 0xBC: RES_b_r(7, registers.H); return 8;
-        case 0xBD: RES_b_r(7, registers.L); return 8;
-        case 0xBE: RES_b_iHL(7); return 15;
-        case 0xBF: RES_b_r(7, registers.A); return 8;
-        case 0xC0: SET_b_r(0, registers.B); return 8;
-        case 0xC1: SET_b_r(0, registers.C); return 8;
-        case 0xC2: SET_b_r(0, registers.D); return 8;
-        case 0xC3: SET_b_r(0, registers.E); return 8;
-        case 0xC4: SET_b_r(0, registers.H); return 8;
-        case 0xC5: SET_b_r(0, registers.L); return 8;
-        case 0xC6: SET_b_iHL(0); return 15;
-        case 0xC7: SET_b_r(0, registers.A); return 8;
-        case 0xC8: SET_b_r(1, registers.B); return 8;
-        case 0xC9: SET_b_r(1, registers.C); return 8;
-        case 0xCA: SET_b_r(1, registers.D); return 8;
-        case 0xCB: SET_b_r(1, registers.E); return 8;
-        case 0xCC: SET_b_r(1, registers.H); return 8;
-        case 0xCD: SET_b_r(1, registers.L); return 8;
-        case 0xCE: SET_b_iHL(1); return 15;
-        case 0xCF: SET_b_r(1, registers.A); return 8;
-        case 0xD0: SET_b_r(2, registers.B); return 8;
-        case 0xD1: SET_b_r(2, registers.C); return 8;
-        case 0xD2: SET_b_r(2, registers.D); return 8;
-        case 0xD3: SET_b_r(2, registers.E); return 8;
-        case 0xD4: SET_b_r(2, registers.H); return 8;
-        case 0xD5: SET_b_r(2, registers.L); return 8;
-        case 0xD6: SET_b_iHL(2); return 15;
-        case 0xD7: SET_b_r(2, registers.A); return 8;
-        case 0xD8: SET_b_r(3, registers.B); return 8;
-        case 0xD9: SET_b_r(3, registers.C); return 8;
-        case 0xDA: SET_b_r(3, registers.D); return 8;
-        case 0xDB: SET_b_r(3, registers.E); return 8;
-        case 0xDC: SET_b_r(3, registers.H); return 8;
-        case 0xDD: SET_b_r(3, registers.L); return 8;
-        case 0xDE: SET_b_iHL(3); return 15;
-        case 0xDF: SET_b_r(3, registers.A); return 8;
-        case 0xE0: SET_b_r(4, registers.B); return 8;
-        case 0xE1: SET_b_r(4, registers.C); return 8;
-        case 0xE2: SET_b_r(4, registers.D); return 8;
-        case 0xE3: SET_b_r(4, registers.E); return 8;
-        case 0xE4: SET_b_r(4, registers.H); return 8;
-        case 0xE5: SET_b_r(4, registers.L); return 8;
-        case 0xE6: SET_b_iHL(4); return 15;
-        case 0xE7: SET_b_r(4, registers.A); return 8;
-        case 0xE8: SET_b_r(5, registers.B); return 8;
-        case 0xE9: SET_b_r(5, registers.C); return 8;
-        case 0xEA: SET_b_r(5, registers.D); return 8;
-        case 0xEB: SET_b_r(5, registers.E); return 8;
-        case 0xEC: SET_b_r(5, registers.H); return 8;
-        case 0xED: SET_b_r(5, registers.L); return 8;
-        case 0xEE: SET_b_iHL(5); return 15;
-        case 0xEF: SET_b_r(5, registers.A); return 8;
-        case 0xF0: SET_b_r(6, registers.B); return 8;
-        case 0xF1: SET_b_r(6, registers.C); return 8;
-        case 0xF2: SET_b_r(6, registers.D); return 8;
-        case 0xF3: SET_b_r(6, registers.E); return 8;
-        case 0xF4: SET_b_r(6, registers.H); return 8;
-        case 0xF5: SET_b_r(6, registers.L); return 8;
-        case 0xF6: SET_b_iHL(6); return 15;
-        case 0xF7: SET_b_r(6, registers.A); return 8;
-        case 0xF8: SET_b_r(7, registers.B); return 8;
-        case 0xF9: SET_b_r(7, registers.C); return 8;
-        case 0xFA: SET_b_r(7, registers.D); return 8;
-        case 0xFB: SET_b_r(7, registers.E); return 8;
-        case 0xFC: SET_b_r(7, registers.H); return 8;
-        case 0xFD: SET_b_r(7, registers.L); return 8;
-        case 0xFE: SET_b_iHL(7); return 15;
-        case 0xFF: SET_b_r(7, registers.A); return 8;
-        default:
-            std::cerr << "Unknown CB opcode: 0x" << std::hex << (int)opcode << std::endl;
-            return 0;
+// --- Operand selectors ---
+// Field values follow the Z80 opcode encoding:
+//   r   = B, C, D, E, H, L, (HL), A
+//   rp  = BC, DE, HL, SP        rp2 = BC, DE, HL, AF
+//   cc  = NZ, Z, NC, C, PO, PE, P, M
+template<int R>
+uint8_t& Z80::reg8() {
+    static_assert(R >= 0 && R <= 7 && R != 6, "(HL) is not a register operand");
+    if constexpr (R == 0) return registers.B;
+    else if constexpr (R == 1) return registers.C;
+    else if constexpr (R == 2) return registers.D;
+    else if constexpr (R == 3) return registers.E;
+    else if constexpr (R == 4) return registers.H;
+    else if constexpr (R == 5) return registers.L;
+    else return registers.A;
+}
+
+template<int R, bool UseIY>
+uint8_t& Z80::reg8x() {
+    if constexpr (R == 4) return UseIY ? registers.IYH : registers.IXH;
+    else if constexpr (R == 5) return UseIY ? registers.IYL : registers.IXL;
+    else return reg8<R>();
+}
+
+template<int P>
+uint16_t& Z80::reg16() {
+    if constexpr (P == 0) return registers.BC;
+    else if constexpr (P == 1) return registers.DE;
+    else if constexpr (P == 2) return registers.HL;
+    else return registers.SP;
+}
+
+template<int P>
+uint16_t& Z80::reg16af() {
+    if constexpr (P == 3) {
+        // PUSH AF needs the real F; for POP AF this just drops the pending record
+        registers.flushFlags();
+        return registers.AF;
+    }
+    else return reg16<P>();
+}
+
+template<bool UseIY>
+uint16_t& Z80::indexReg() {
+    if constexpr (UseIY) return registers.IY;
+    else return registers.IX;
+}
+
+template<int CC>
+bool Z80::condition() const {
+    if constexpr (CC == 0) return !registers.getFlag(Z80Registers::Zero);
+    else if constexpr (CC == 1) return registers.getFlag(Z80Registers::Zero);
+    else if constexpr (CC == 2) return !registers.getFlag(Z80Registers::Carry);
+    else if constexpr (CC == 3) return registers.getFlag(Z80Registers::Carry);
+    else if constexpr (CC == 4) return !registers.getFlag(Z80Registers::ParityOverflow);
+    else if constexpr (CC == 5) return registers.getFlag(Z80Registers::ParityOverflow);
+    else if constexpr (CC == 6) return !registers.getFlag(Z80Registers::Sign);
+    else return registers.getFlag(Z80Registers::Sign);
+}
+
+template<int Y>
+void Z80::aluOp(uint8_t& r) {
+    if constexpr (Y == 0) ADD_A_r(r);
+    else if constexpr (Y == 1) ADC_A_r(r);
+    else if constexpr (Y == 2) SUB_r(r);
+    else if constexpr (Y == 3) SBC_A_r(r);
+    else if constexpr (Y == 4) AND_r(r);
+    else if constexpr (Y == 5) XOR_r(r);
+    else if constexpr (Y == 6) OR_r(r);
+    else CP_r(r);
+}
+
+// --- Opcode handlers ---
+// One handler is instantiated per opcode, so every field decode below is
+// resolved at compile time and the handler body is just the instruction.
+template<uint8_t Op>
+void Z80::opMain() {
+    constexpr int x = Op >> 6, y = (Op >> 3) & 7, z = Op & 7, p = y >> 1, q = y & 1;
+
+    if constexpr (x == 0) {
+        if constexpr (z == 0) {
+            if constexpr (y == 0) NOP();
+            else if constexpr (y == 1) EX_AF_AF();
+            else if constexpr (y == 2) { DJNZ_d8(); if (registers.B != 0) cycles += 5; }
+            else if constexpr (y == 3) JR_d8();
+            else { const bool taken = condition<y - 4>(); JR_cc_d8(taken); if (taken) cycles += 5; }
+        } else if constexpr (z == 1) {
+            if constexpr (q == 1) ADD_HL_ss(reg16<p>());
+            else if constexpr (p == 0) LD_BC_d16();
+            else if constexpr (p == 1) LD_DE_d16();
+            else if constexpr (p == 2) LD_HL_d16();
+            else LD_SP_d16();
+        } else if constexpr (z == 2) {
+            if constexpr (Op == 0x02) LD_iBC_A();
+            else if constexpr (Op == 0x0A) LD_A_iBC();
+            else if constexpr (Op == 0x12) LD_iDE_A();
+            else if constexpr (Op == 0x1A) LD_A_iDE();
+            else if constexpr (Op == 0x22) LD_inn_HL();
+            else if constexpr (Op == 0x2A) LD_HL_inn();
+            else if constexpr (Op == 0x32) LD_inn_A();
+            else LD_A_inn();
+        } else if constexpr (z == 3) {
+            if constexpr (q == 0) INC_nn(reg16<p>());
+            else DEC_nn(reg16<p>());
+        } else if constexpr (z == 4) {
+            if constexpr (y == 6) INC_iHL();
+            else INC_r(reg8<y>());
+        } else if constexpr (z == 5) {
+            if constexpr (y == 6) DEC_iHL();
+            else DEC_r(reg8<y>());
+        } else if constexpr (z == 6) {
+            if constexpr (y == 6) LD_iHL_n(fetchByte());
+            else LD_r_n(reg8<y>(), fetchByte());
+        } else {
+            if constexpr (y == 0) RLCA();
+            else if constexpr (y == 1) RRCA();
+            else if constexpr (y == 2) RLA();
+            else if constexpr (y == 3) RRA();
+            else if constexpr (y == 4) DAA();
+            else if constexpr (y == 5) CPL();
+            else if constexpr (y == 6) SCF();
+            else CCF();
+        }
+    } else if constexpr (x == 1) {
+        if constexpr (Op == 0x76) HALT();
+        else if constexpr (z == 6) LD_r_iHL(reg8<y>());
+        else if constexpr (y == 6) LD_iHL_r(reg8<z>());
+        else LD_r_r(reg8<y>(), reg8<z>());
+    } else if constexpr (x == 2) {
+        if constexpr (z != 6) aluOp<y>(reg8<z>());
+        else if constexpr (y == 0) ADD_A_iHL();
+        else if constexpr (y == 1) ADC_A_iHL();
+        else if constexpr (y == 2) SUB_iHL();
+        else if constexpr (y == 3) SBC_A_iHL();
+        else if constexpr (y == 4) AND_iHL();
+        else if constexpr (y == 5) XOR_iHL();
+        else if constexpr (y == 6) OR_iHL();
+        else CP_iHL();
+    } else {
+        if constexpr (z == 0) {
+            const bool taken = condition<y>();
+            RET_cc(taken);
+            if (taken) cycles += 6;
+        } else if constexpr (z == 1) {
+            if constexpr (q == 0) POP_qq(reg16af<p>());
+            else if constexpr (p == 0) RET();
+            else if constexpr (p == 1) EXX();
+            else if constexpr (p == 2) JP_iHL();
+            else LD_SP_HL();
+        } else if constexpr (z == 2) {
+            JP_cc_nn(condition<y>());
+        } else if constexpr (z == 3) {
+            if constexpr (y == 0) JP_nn();
+            else if constexpr (y == 1) executeCB();
+            else if constexpr (y == 2) OUT_in_A();
+            else if constexpr (y == 3) IN_A_in();
+            else if constexpr (y == 4) EX_iSP_HL();
+            else if constexpr (y == 5) EX_DE_HL();
+            else if constexpr (y == 6) DI();
+            else EI();
+        } else if constexpr (z == 4) {
+            const bool taken = condition<y>();
+            CALL_cc_nn(taken);
+            if (taken) cycles += 7;
+        } else if constexpr (z == 5) {
+            if constexpr (q == 0) PUSH_qq(reg16af<p>());
+            else if constexpr (p == 0) CALL_nn();
+            else if constexpr (p == 1) executeIndex<false>();
+            else if constexpr (p == 2) executeED();
+            else executeIndex<true>();
+        } else if constexpr (z == 6) {
+            const uint8_t value = fetchByte();
+            if constexpr (y == 0) ADD_A_n(value);
+            else if constexpr (y == 1) ADC_A_n(value);
+            else if constexpr (y == 2) SUB_n(value);
+            else if constexpr (y == 3) SBC_A_n(value);
+            else if constexpr (y == 4) AND_n(value);
+            else if constexpr (y == 5) XOR_n(value);
+            else if constexpr (y == 6) OR_n(value);
+            else CP_n(value);
+        } else {
+            RST_p(y * 8);
+        }
     }
 }
 
-int Z80::decodeAndExecuteEDInstruction(uint8_t opcode) {
-    switch (opcode) {
-        case 0x40: IN_r_iC(registers.B); return 12;
-        case 0x41: OUT_iC_r(registers.B); return 12;
-        case 0x42: SBC_HL_ss(registers.BC); return 15;
-        case 0x43: LD_inn_dd(registers.BC); return 20;
-        case 0x44: NEG(); return 8;
-        case 0x45: RETN(); return 14;
-        case 0x46: IM_x(0); return 8;
-        case 0x47: LD_I_A(); return 9;
-        case 0x48: IN_r_iC(registers.C); return 12;
-        case 0x49: OUT_iC_r(registers.C); return 12;
-        case 0x4A: ADC_HL_ss(registers.BC); return 15;
-        case 0x4B: LD_dd_inn(registers.BC); return 20;
-        case 0x4C: NEG(); return 8; // Duplicate opcode, same as 0x44
-        case 0x4D: RETI(); return 14;
-        case 0x4E: IM_x(0); return 8; // Duplicate opcode, same as 0x46
-        case 0x4F: LD_R_A(); return 9;
-        case 0x50: IN_r_iC(registers.D); return 12;
-        case 0x51: OUT_iC_r(registers.D); return 12;
-        case 0x52: SBC_HL_ss(registers.DE); return 15;
-        case 0x53: LD_inn_dd(registers.DE); return 20;
-        case 0x54: NEG(); return 8; // Duplicate opcode, same as 0x44
-        case 0x55: RETN(); return 14; // Duplicate opcode, same as 0x45
-        case 0x56: IM_x(1); return 8;
-        case 0x57: LD_A_I(); return 9;
-        case 0x58: IN_r_iC(registers.E); return 12;
-        case 0x59: OUT_iC_r(registers.E); return 12;
-        case 0x5A: ADC_HL_ss(registers.DE); return 15;
-        case 0x5B: LD_dd_inn(registers.DE); return 20;
-        case 0x5C: NEG(); return 8; // Duplicate opcode, same as 0x44
-        case 0x5D: RETN(); return 14; // Duplicate opcode, same as 0x45
-        case 0x5E: IM_x(2); return 8; // Duplicate opcode, same as 0x5E
-        case 0x5F: LD_A_R(); return 9;
-        case 0x60: IN_r_iC(registers.H); return 12;
-        case 0x61: OUT_iC_r(registers.H); return 12;
-        case 0x62: SBC_HL_ss(registers.HL); return 15;
-        case 0x63: LD_inn_dd(registers.HL); return 20;
-        case 0x64: NEG(); return 8; // Duplicate opcode, same as 0x44
-        case 0x65: RETN(); return 14; // Duplicate opcode, same as 0x45
-        case 0x66: IM_x(0); return 8; // Duplicate opcode, same as 0x46
-        case 0x67: RRD(); return 18;
-        case 0x68: IN_r_iC(registers.L); return 12;
-        case 0x69: OUT_iC_r(registers.L); return 12;
-        case 0x6A: ADC_HL_ss(registers.HL); return 15;
-        case 0x6B: LD_dd_inn(registers.HL); return 20;
-        case 0x6C: NEG(); return 8; // Duplicate opcode, same as 0x44
-        case 0x6D: RETN(); return 14; // Duplicate opcode, same as 0x45
-        case 0x6E: IM_x(0); return 8; // Duplicate opcode, same as 0x46
-        case 0x6F: RLD(); return 18;
-        case 0x70: IN_f_iC(); return 12;
-        case 0x71: OUT_iC_0(); return 12;
-        case 0x72: SBC_HL_ss(registers.SP); return 15;
-        case 0x73: LD_inn_dd(registers.SP); return 20;
-        case 0x74: NEG(); return 8; // Duplicate opcode, same as 0x44
-        case 0x75: RETN(); return 14; // Duplicate opcode, same as 0x45
-        case 0x76: IM_x(1); return 8; // Duplicate opcode, same as 0x56
-        case 0x77: NOP(); return 4; // Undocumented opcode, same as NOP
-        case 0x78: IN_r_iC(registers.A); return 12;
-        case 0x79: OUT_iC_r(registers.A); return 12;
-        case 0x7A: ADC_HL_ss(registers.SP); return 15;
-        case 0x7B: LD_dd_inn(registers.SP); return 20;
-        case 0x7C: NEG(); return 8; // Duplicate opcode, same as 0x44
-        case 0x7D: RETN(); return 14; // Duplicate opcode, same as 0x45
-        case 0x7E: IM_x(2); return 8; // Duplicate opcode, same as 0x5E
-        case 0x7F: NOP(); return 4; // Undocumented opcode, same as NOP
-        case 0xA0: LDI(); return 16;
-        case 0xA1: CPI(); return 16;
-        case 0xA2: INI(); return 16;
-        case 0xA3: OUTI(); return 16;
-        case 0xA8: LDD(); return 16;
-        case 0xA9: CPD(); return 16;
-        case 0xAA: IND(); return 16;
-        case 0xAB: OUTD(); return 16;
-        case 0xB0: LDIR(); return (registers.BC != 0) ? 21 : 16;
-        case 0xB1: CPIR(); return (registers.BC != 0 && !registers.getFlag(Z80Registers::Flag::Zero)) ? 21 : 16;
-        case 0xB2: INIR(); return (registers.B != 0) ? 21 : 16;
-        case 0xB3: OTIR(); return (registers.B != 0) ? 21 : 16;
-        case 0xB8: LDDR(); return (registers.BC != 0) ? 21 : 16;
-        case 0xB9: CPDR(); return (registers.BC != 0 && !registers.getFlag(Z80Registers::Flag::Zero)) ? 21 : 16;
-        case 0xBA: INDR(); return (registers.B != 0) ? 21 : 16;
-        case 0xBB: OTDR(); return (registers.B != 0) ? 21 : 16;
-        default:
-            std::cerr << "Unknown ED opcode: 0x" << std::hex << (int)opcode << std::endl;
-            return 4;
+template<uint8_t Op>
+void Z80::opCB() {
+    constexpr int x = Op >> 6, y = (Op >> 3) & 7, z = Op & 7;
+
+    if constexpr (x == 0) {
+        if constexpr (z == 6) {
+            if constexpr (y == 0) RLC_iHL();
+            else if constexpr (y == 1) RRC_iHL();
+            else if constexpr (y == 2) RL_iHL();
+            else if constexpr (y == 3) RR_iHL();
+            else if constexpr (y == 4) SLA_iHL();
+            else if constexpr (y == 5) SRA_iHL();
+            else if constexpr (y == 6) SLL_iHL();
+            else SRL_iHL();
+        } else {
+            if constexpr (y == 0) RLC_r(reg8<z>());
+            else if constexpr (y == 1) RRC_r(reg8<z>());
+            else if constexpr (y == 2) RL_r(reg8<z>());
+            else if constexpr (y == 3) RR_r(reg8<z>());
+            else if constexpr (y == 4) SLA_r(reg8<z>());
+            else if constexpr (y == 5) SRA_r(reg8<z>());
+            else if constexpr (y == 6) SLL_r(reg8<z>());
+            else SRL_r(reg8<z>());
+        }
+    } else if constexpr (x == 1) {
+        if constexpr (z == 6) BIT_b_iHL(y);
+        else BIT_b_r(y, reg8<z>());
+    } else if constexpr (x == 2) {
+        if constexpr (z == 6) RES_b_iHL(y);
+        else RES_b_r(y, reg8<z>());
+    } else {
+        if constexpr (z == 6) SET_b_iHL(y);
+        else SET_b_r(y, reg8<z>());
     }
 }
 
-int Z80::decodeAndExecuteDDInstruction(uint8_t opcode) {
-    switch (opcode)
-    {
-        case 0x09: ADD_IX_pp(registers.BC); return 15;
-        case 0x19: ADD_IX_pp(registers.DE); return 15;
-        case 0x21: LD_IXIY_nn(registers.IX); return 14;
-        case 0x22: LD_inn_IXIY(registers.IX); return 20;
-        case 0x23: INC_IXIY(registers.IX); return 10;
-        case 0x24: INC_IXIYH(registers.IXH); return 8;
-        case 0x25: DEC_IXIYH(registers.IXH); return 8;
-        case 0x26: LD_IXIYH_n(registers.IXH, fetchByte()); return 11;
-        case 0x29: ADD_IX_pp(registers.IX); return 15;
-        case 0x2A: LD_IXIY_inn(registers.IX); return 20;
-        case 0x2B: DEC_IXIY(registers.IX); return 10;
-        case 0x2C: INC_IXIYL(registers.IXL); return 8;
-        case 0x2D: DEC_IXIYL(registers.IXL); return 8;
-        case 0x2E: LD_IXIYL_n(registers.IXL, fetchByte()); return 11;
-        case 0x34: INC_IXIYd(registers.IX); return 23;
-        case 0x35: DEC_IXIYd(registers.IX); return 23;
-        case 0x36: LD_IXIYd_n(registers.IX, fetchByte()); return 19;
-        case 0x39: ADD_IX_pp(registers.SP); return 15;
-        case 0x44: LD_r_IXIYd(registers.B, registers.IX); return 19;
-        case 0x45: LD_r_IXIYd(registers.B, registers.IX); return 19;
-        case 0x46: LD_r_IXIYd(registers.B, registers.IX); return 19;
-        case 0x4C: LD_r_IXIYd(registers.C, registers.IX); return 19;
-        case 0x4D: LD_r_IXIYd(registers.C, registers.IX); return 19;
-        case 0x4E: LD_r_IXIYd(registers.C, registers.IX); return 19;
-        case 0x54: LD_r_IXIYd(registers.D, registers.IX); return 19;
-        case 0x55: LD_r_IXIYd(registers.D, registers.IX); return 19;
-       case 0x56: LD_r_IXIYd(registers.D, registers.IX); return 19;
-        case 0x5C: LD_r_IXIYd(registers.E, registers.IX); return 19;
-        case 0x5D: LD_r_IXIYd(registers.E, registers.IX); return 19;
-        case 0x5E: LD_r_IXIYd(registers.E, registers.IX); return 19;
-        case 0x60: LD_r_r(registers.IXH, registers.B); return 8;
-        case 0x61: LD_r_r(registers.IXH, registers.C); return 8;
-        case 0x62: LD_r_r(registers.IXH, registers.D); return 8;
-        case 0x63: LD_r_r(registers.IXH, registers.E); return 8;
-        case 0x64: /* LD IXH,IXH */ return 8; // Effectively a NOP
-        case 0x65: LD_r_r(registers.IXH, registers.IXL); return 8;
-        case 0x66: LD_r_IXIYd(registers.H, registers.IX); return 19;
-        case 0x67: LD_r_r(registers.IXH, registers.A); return 8;
-        case 0x68: LD_r_r(registers.IXL, registers.B); return 8;
-        case 0x69: LD_r_r(registers.IXL, registers.C); return 8;
-        case 0x6A: LD_r_r(registers.IXL, registers.D); return 8;
-        case 0x6B: LD_r_r(registers.IXL, registers.E); return 8;
-        case 0x6C: LD_r_r(registers.IXL, registers.IXH); return 8;
-        case 0x6D: /* LD IXL,IXL */ return 8; // Effectively a NOP
-        case 0x6E: LD_r_IXIYd(registers.L, registers.IX); return 19;
-        case 0x6F: LD_r_r(registers.IXL, registers.A); return 8;
-        case 0x70: LD_IXIYd_r(registers.IX, registers.B); return 19;
-        case 0x71: LD_IXIYd_r(registers.IX, registers.C); return 19;
-        case 0x72: LD_IXIYd_r(registers.IX, registers.D); return 19;
-        case 0x73: LD_IXIYd_r(registers.IX, registers.E); return 19;
-        case 0x74: LD_IXIYd_r(registers.IX, registers.H); return 19;
-        case 0x75: LD_IXIYd_r(registers.IX, registers.L); return 19;
-        case 0x77: LD_IXIYd_r(registers.IX, registers.A); return 19;
-        case 0x7C: LD_r_IXIYd(registers.A, registers.IX); return 19;
-        case 0x7D: LD_r_IXIYd(registers.A, registers.IX); return 19;
-        case 0x7E: LD_r_IXIYd(registers.A, registers.IX); return 19;
-        case 0x84: ADD_A_IXIYd(registers.IX); return 19;
-        case 0x85: ADD_A_IXIYd(registers.IX); return 19;
-        case 0x86: ADD_A_IXIYd(registers.IX); return 19;
-        case 0x8C: ADC_A_IXIYd(registers.IX); return 19;
-        case 0x8D: ADC_A_IXIYd(registers.IX); return 19;
-        case 0x8E: ADC_A_IXIYd(registers.IX); return 19;
-        case 0x94: SUB_IXIYd(registers.IX); return 19;
-        case 0x95: SUB_IXIYd(registers.IX); return 19;
-        case 0x96: SUB_IXIYd(registers.IX); return 19;
-        case 0x9C: SBC_A_IXIYd(registers.IX); return 19;
-        case 0x9D: SBC_A_IXIYd(registers.IX); return 19;
-        case 0x9E: SBC_A_IXIYd(registers.IX); return 19;
-        case 0xA4: AND_IXIYd(registers.IX); return 19;
-        case 0xA5: AND_IXIYd(registers.IX); return 19;
-        case 0xA6: AND_IXIYd(registers.IX); return 19;
-        case 0xAC: XOR_IXIYd(registers.IX); return 19;
-        case 0xAD: XOR_IXIYd(registers.IX); return 19;
-        case 0xAE: XOR_IXIYd(registers.IX); return 19;
-        case 0xB4: OR_IXIYd(registers.IX); return 19;
-        case 0xB5: OR_IXIYd(registers.IX); return 19;
-        case 0xB6: OR_IXIYd(registers.IX); return 19;
-        case 0xBC: CP_IXIYd(registers.IX); return 19;
-        case 0xBD: CP_IXIYd(registers.IX); return 19;
-        case 0xBE: CP_IXIYd(registers.IX); return 19;
-        case 0xCB: return decodeAndExecuteDDFDCBInstruction(fetchOpcode(), registers.IX);
-        case 0xE1: POP_qq(registers.IX); return 14;
-        case 0xE3: EX_iSP_IXIY(registers.IX); return 23;
-        case 0xE5: PUSH_qq(registers.IX); return 15;
-        case 0xE9: JP_iIXIY(registers.IX); return 8;
-        case 0xF9: LD_SP_IXIY(registers.IX); return 10;
-        default:
-            std::cerr << "Unknown DD opcode: 0x" << std::hex << (int)opcode << std::endl;
-            return 4;
+template<uint8_t Op>
+void Z80::opED() {
+    constexpr int x = Op >> 6, y = (Op >> 3) & 7, z = Op & 7, p = y >> 1, q = y & 1;
+
+    if constexpr (x == 1) {
+        if constexpr (z == 0) {
+            if constexpr (y == 6) IN_f_iC();
+            else IN_r_iC(reg8<y>());
+        } else if constexpr (z == 1) {
+            if constexpr (y == 6) OUT_iC_0();
+            else OUT_iC_r(reg8<y>());
+        } else if constexpr (z == 2) {
+            if constexpr (q == 0) SBC_HL_ss(reg16<p>());
+            else ADC_HL_ss(reg16<p>());
+        } else if constexpr (z == 3) {
+            if constexpr (q == 0) LD_inn_dd(reg16<p>());
+            else LD_dd_inn(reg16<p>());
+        } else if constexpr (z == 4) {
+            NEG();
+        } else if constexpr (z == 5) {
+            if constexpr (y == 1) RETI();
+            else RETN();
+        } else if constexpr (z == 6) {
+            constexpr uint8_t modes[8] = {0, 0, 1, 2, 0, 0, 1, 2};
+            IM_x(modes[y]);
+        } else {
+            if constexpr (y == 0) LD_I_A();
+            else if constexpr (y == 1) LD_R_A();
+            else if constexpr (y == 2) LD_A_I();
+            else if constexpr (y == 3) LD_A_R();
+            else if constexpr (y == 4) RRD();
+            else if constexpr (y == 5) RLD();
+        }
+    } else if constexpr (x == 2 && z <= 3 && y >= 4) {
+        if constexpr (Op == 0xA0) LDI();
+        else if constexpr (Op == 0xA1) CPI();
+        else if constexpr (Op == 0xA2) INI();
+        else if constexpr (Op == 0xA3) OUTI();
+        else if constexpr (Op == 0xA8) LDD();
+        else if constexpr (Op == 0xA9) CPD();
+        else if constexpr (Op == 0xAA) IND();
+        else if constexpr (Op == 0xAB) OUTD();
+        else if constexpr (Op == 0xB0) LDIR();
+        else if constexpr (Op == 0xB1) CPIR();
+        else if constexpr (Op == 0xB2) INIR();
+        else if constexpr (Op == 0xB3) OTIR();
+        else if constexpr (Op == 0xB8) LDDR();
+        else if constexpr (Op == 0xB9) CPDR();
+        else if constexpr (Op == 0xBA) INDR();
+        else OTDR();
+    }
+    // Everything else in the ED page executes as an 8 T-state NOP.
+}
+
+template<uint8_t Op, bool UseIY>
+void Z80::opIndex() {
+    constexpr int x = Op >> 6, y = (Op >> 3) & 7, z = Op & 7, p = y >> 1;
+    constexpr bool usesHL = (x == 1 && Op != 0x76 && (y == 4 || y == 5 || y == 6 || z == 4 || z == 5 || z == 6)) ||
+                            (x == 2 && (z == 4 || z == 5 || z == 6));
+    uint16_t& index = indexReg<UseIY>();
+
+    if constexpr (Op == 0x09 || Op == 0x19 || Op == 0x39) ADD_IXIY_ss(index, reg16<p>());
+    else if constexpr (Op == 0x29) ADD_IXIY_ss(index, index);
+    else if constexpr (Op == 0x21) LD_IXIY_nn(index);
+    else if constexpr (Op == 0x22) LD_inn_IXIY(index);
+    else if constexpr (Op == 0x23) INC_IXIY(index);
+    else if constexpr (Op == 0x24) INC_IXIYH(reg8x<4, UseIY>());
+    else if constexpr (Op == 0x25) DEC_IXIYH(reg8x<4, UseIY>());
+    else if constexpr (Op == 0x26) LD_IXIYH_n(reg8x<4, UseIY>(), fetchByte());
+    else if constexpr (Op == 0x2A) LD_IXIY_inn(index);
+    else if constexpr (Op == 0x2B) DEC_IXIY(index);
+    else if constexpr (Op == 0x2C) INC_IXIYL(reg8x<5, UseIY>());
+    else if constexpr (Op == 0x2D) DEC_IXIYL(reg8x<5, UseIY>());
+    else if constexpr (Op == 0x2E) LD_IXIYL_n(reg8x<5, UseIY>(), fetchByte());
+    else if constexpr (Op == 0x34) INC_IXIYd(index);
+    else if constexpr (Op == 0x35) DEC_IXIYd(index);
+    else if constexpr (Op == 0x36) LD_IXIYd_n(index);
+    else if constexpr (x == 1 && usesHL) {
+        if constexpr (z == 6) LD_r_IXIYd(reg8<y>(), index);
+        else if constexpr (y == 6) LD_IXIYd_r(index, reg8<z>());
+        else LD_r_r(reg8x<y, UseIY>(), reg8x<z, UseIY>());
+    } else if constexpr (x == 2 && usesHL) {
+        if constexpr (z != 6) aluOp<y>(reg8x<z, UseIY>());
+        else if constexpr (y == 0) ADD_A_IXIYd(index);
+        else if constexpr (y == 1) ADC_A_IXIYd(index);
+        else if constexpr (y == 2) SUB_IXIYd(index);
+        else if constexpr (y == 3) SBC_A_IXIYd(index);
+        else if constexpr (y == 4) AND_IXIYd(index);
+        else if constexpr (y == 5) XOR_IXIYd(index);
+        else if constexpr (y == 6) OR_IXIYd(index);
+        else CP_IXIYd(index);
+    }
+    else if constexpr (Op == 0xCB) executeIndexCB<UseIY>();
+    else if constexpr (Op == 0xE1) POP_qq(index);
+    else if constexpr (Op == 0xE3) EX_iSP_IXIY(index);
+    else if constexpr (Op == 0xE5) PUSH_qq(index);
+    else if constexpr (Op == 0xE9) JP_iIXIY(index);
+    else if constexpr (Op == 0xF9) LD_SP_IXIY(index);
+    else {
+        // The prefix has no effect on this opcode: run the unprefixed form.
+        (this->*MAIN_OPS[Op])();
     }
 }
 
-int Z80::decodeAndExecuteFDInstruction(uint8_t opcode) {
-    switch (opcode) {
-        case 0x09: ADD_IX_pp(registers.BC); return 15;
-        case 0x19: ADD_IX_pp(registers.DE); return 15;
-        case 0x21: LD_IXIY_nn(registers.IY); return 14;
-        case 0x22: LD_inn_IXIY(registers.IY); return 20;
-        case 0x23: INC_IXIY(registers.IY); return 10;
-        case 0x24: INC_IXIYH(registers.IYH); return 8;
-        case 0x25: DEC_IXIYH(registers.IYH); return 8;
-        case 0x26: LD_IXIYH_n(registers.IYH, fetchByte()); return 11;
-        case 0x29: ADD_IX_pp(registers.IY); return 15;
-        case 0x2A: LD_IXIY_inn(registers.IY); return 20;
-        case 0x2B: DEC_IXIY(registers.IY); return 10;
-        case 0x2C: INC_IXIYL(registers.IYL); return 8;
-        case 0x2D: DEC_IXIYL(registers.IYL); return 8;
-        case 0x2E: LD_IXIYL_n(registers.IYL, fetchByte()); return 11;
-        case 0x34: INC_IXIYd(registers.IY); return 23;
-        case 0x35: DEC_IXIYd(registers.IY); return 23;
-        case 0x36: LD_IXIYd_n(registers.IY, fetchByte()); return 19;
-        case 0x39: ADD_IX_pp(registers.SP); return 15;
-        case 0x44: LD_r_IXIYd(registers.B, registers.IY); return 19;
-        case 0x45: LD_r_IXIYd(registers.B, registers.IY); return 19;
-        case 0x46: LD_r_IXIYd(registers.B, registers.IY); return 19;
-        case 0x4C: LD_r_IXIYd(registers.C, registers.IY); return 19;
-        case 0x4D: LD_r_IXIYd(registers.C, registers.IY); return 19;
-        case 0x4E: LD_r_IXIYd(registers.C, registers.IY); return 19;
-        case 0x54: LD_r_IXIYd(registers.D, registers.IY); return 19;
-        case 0x55: LD_r_IXIYd(registers.D, registers.IY); return 19;
-        case 0x56: LD_r_IXIYd(registers.D, registers.IY); return 19;
-        case 0x5C: LD_r_IXIYd(registers.E, registers.IY); return 19;
-        case 0x5D: LD_r_IXIYd(registers.E, registers.IY); return 19;
-        case 0x5E: LD_r_IXIYd(registers.E, registers.IY); return 19;
-        case 0x60: LD_r_r(registers.IYH, registers.B); return 8;
-        case 0x61: LD_r_r(registers.IYH, registers.C); return 8;
-        case 0x62: LD_r_r(registers.IYH, registers.D); return 8;
-        case 0x63: LD_r_r(registers.IYH, registers.E); return 8;
-        case 0x64: /* LD IYH,IYH */ return 8; // Effectively a NOP
-        case 0x65: LD_r_r(registers.IYH, registers.IYL); return 8;
-        case 0x66: LD_r_IXIYd(registers.H, registers.IY); return 19;
-        case 0x67: LD_r_r(registers.IYH, registers.A); return 8;
-        case 0x68: LD_r_r(registers.IYL, registers.B); return 8;
-        case 0x69: LD_r_r(registers.IYL, registers.C); return 8;
-        case 0x6A: LD_r_r(registers.IYL, registers.D); return 8;
-        case 0x6B: LD_r_r(registers.IYL, registers.E); return 8;
-        case 0x6C: LD_r_r(registers.IYL, registers.IYH); return 8;
-        case 0x6D: /* LD IYL,IYL */ return 8; // Effectively a NOP
-        case 0x6E: LD_r_IXIYd(registers.L, registers.IY); return 19;
-        case 0x6F: LD_r_r(registers.IYL, registers.A); return 8;
-        case 0x70: LD_IXIYd_r(registers.IY, registers.B); return 19;
-        case 0x71: LD_IXIYd_r(registers.IY, registers.C); return 19;
-        case 0x72: LD_IXIYd_r(registers.IY, registers.D); return 19;
-        case 0x73: LD_IXIYd_r(registers.IY, registers.E); return 19;
-        case 0x74: LD_IXIYd_r(registers.IY, registers.H); return 19;
-        case 0x75: LD_IXIYd_r(registers.IY, registers.L); return 19;
-        case 0x77: LD_IXIYd_r(registers.IY, registers.A); return 19;
-        case 0x7C: LD_r_IXIYd(registers.A, registers.IY); return 19;
-        case 0x7D: LD_r_IXIYd(registers.A, registers.IY); return 19;
-        case 0x7E: LD_r_IXIYd(registers.A, registers.IY); return 19;
-        case 0x84: ADD_A_IXIYd(registers.IY); return 19;
-        case 0x85: ADD_A_IXIYd(registers.IY); return 19;
-        case 0x86: ADD_A_IXIYd(registers.IY); return 19;
-        case 0x8C: ADC_A_IXIYd(registers.IY); return 19;
-        case 0x8D: ADC_A_IXIYd(registers.IY); return 19;
-        case 0x8E: ADC_A_IXIYd(registers.IY); return 19;
-        case 0x94: SUB_IXIYd(registers.IY); return 19;
-        case 0x95: SUB_IXIYd(registers.IY); return 19;
-        case 0x96: SUB_IXIYd(registers.IY); return 19;
-        case 0x9C: SBC_A_IXIYd(registers.IY); return 19;
-        case 0x9D: SBC_A_IXIYd(registers.IY); return 19;
-        case 0x9E: SBC_A_IXIYd(registers.IY); return 19;
-        case 0xA4: AND_IXIYd(registers.IY); return 19;
-        case 0xA5: AND_IXIYd(registers.IY); return 19;
-        case 0xA6: AND_IXIYd(registers.IY); return 19;
-        case 0xAC: XOR_IXIYd(registers.IY); return 19;
-        case 0xAD: XOR_IXIYd(registers.IY); return 19;
-        case 0xAE: XOR_IXIYd(registers.IY); return 19;
-        case 0xB4: OR_IXIYd(registers.IY); return 19;
-        case 0xB5: OR_IXIYd(registers.IY); return 19;
-        case 0xB6: OR_IXIYd(registers.IY); return 19;
-        case 0xBC: CP_IXIYd(registers.IY); return 19;
-        case 0xBD: CP_IXIYd(registers.IY); return 19;
-        case 0xBE: CP_IXIYd(registers.IY); return 19;
-        case 0xCB: return decodeAndExecuteDDFDCBInstruction(fetchOpcode(), registers.IY);
-        case 0xE1: POP_qq(registers.IY); return 14;
-        case 0xE3: EX_iSP_IXIY(registers.IY); return 23;
-        case 0xE5: PUSH_qq(registers.IY); return 15;
-        case 0xE9: JP_iIXIY(registers.IY); return 8;
-        case 0xF9: LD_SP_IXIY(registers.IY); return 10;
-        default:
-            std::cerr << "Unknown FD opcode: 0x" << std::hex << (int)opcode << std::endl;
-            return 4;
+template<uint8_t Op>
+void Z80::opIndexCB() {
+    constexpr int x = Op >> 6, y = (Op >> 3) & 7;
+
+    // Undocumented register-copy forms (z != 6) are executed as their
+    // (IX+d) counterpart, as fMSX does.
+    if constexpr (x == 0) {
+        if constexpr (y == 0) RLC_IXIYd(indexAddress);
+        else if constexpr (y == 1) RRC_IXIYd(indexAddress);
+        else if constexpr (y == 2) RL_IXIYd(indexAddress);
+        else if constexpr (y == 3) RR_IXIYd(indexAddress);
+        else if constexpr (y == 4) SLA_IXIYd(indexAddress);
+        else if constexpr (y == 5) SRA_IXIYd(indexAddress);
+        else if constexpr (y == 6) SLL_IXIYd(indexAddress);
+        else SRL_IXIYd(indexAddress);
+    } else if constexpr (x == 1) {
+        BIT_b_IXIYd(y, indexAddress);
+    } else if constexpr (x == 2) {
+        RES_b_IXIYd(y, indexAddress);
+    } else {
+        SET_b_IXIYd(y, indexAddress);
     }
 }
 
-int Z80::decodeAndExecuteDDFDInstruction(uint8_t opcode, uint16_t& indexRegister) {
-    // The majority of these instructions are handled by the other decoding functions
-    // This function is mainly for instructions that directly modify the index registers
-    switch (opcode) {
-        case 0x09: ADD_IXIY_ss(indexRegister, registers.BC); return 15;
-        case 0x19: ADD_IXIY_ss(indexRegister, registers.DE); return 15;
-        case 0x21: LD_IXIY_nn(indexRegister); return 14;
-        case 0x22: LD_inn_IXIY(indexRegister); return 20;
-        case 0x23: INC_IXIY(indexRegister); return 10;
-        case 0x29: ADD_IXIY_ss(indexRegister, indexRegister); return 15;
-        case 0x2A: LD_IXIY_inn(indexRegister); return 20;
-        case 0x2B: DEC_IXIY(indexRegister); return 10;
-        case 0x34: INC_IXIYd(indexRegister); return 23;
-        case 0x35: DEC_IXIYd(indexRegister); return 23;
-        case 0x36: LD_IXIYd_n(indexRegister, fetchByte()); return 19;
-        case 0x39: ADD_IXIY_ss(indexRegister, registers.SP); return 15;
-        case 0x86: ADD_A_IXIYd(indexRegister); return 19;
-        case 0x8E: ADC_A_IXIYd(indexRegister); return 19;
-        case 0x96: SUB_IXIYd(indexRegister); return 19;
-        case 0x9E: SBC_A_IXIYd(indexRegister); return 19;
-        case 0xA6: AND_IXIYd(indexRegister); return 19;
-        case 0xAE: XOR_IXIYd(indexRegister); return 19;
-        case 0xB6: OR_IXIYd(indexRegister); return 19;
-        case 0xBE: CP_IXIYd(indexRegister); return 19;
-        case 0xE1: POP_qq(indexRegister); return 14;
-        case 0xE3: EX_iSP_IXIY(indexRegister); return 23;
-        case 0xE5: PUSH_qq(indexRegister); return 15;
-        case 0xE9: JP_iIXIY(indexRegister); return 8;
-        case 0xF9: LD_SP_IXIY(indexRegister); return 10;
-        default:
-            std::cerr << "Unhandled DDFD opcode: 0x" << std::hex << (int)opcode << std::endl;
-            return 4;
-    }
+// --- Handler tables ---
+template<size_t... Op>
+constexpr std::array<Z80::OpHandler, 256> Z80::makeMainTable(std::index_sequence<Op...>) {
+    return {{ &Z80::opMain<Op>... }};
 }
 
-int Z80::decodeAndExecuteDDFDCBInstruction(uint8_t opcode, uint16_t& indexRegister) {
-    int8_t displacement = signExtend(fetchByte());
-    uint8_t nextOpcode = fetchOpcode();
-    uint16_t address = indexRegister + displacement;
-    uint8_t value = memory.readByte(address);
+template<size_t... Op>
+constexpr std::array<Z80::OpHandler, 256> Z80::makeCBTable(std::index_sequence<Op...>) {
+    return {{ &Z80::opCB<Op>... }};
+}
 
-    switch (nextOpcode) {
-        case 0x06: RLC_IXIYd(indexRegister); return 23;
-        case 0x0E: RRC_IXIYd(indexRegister); return 23;
-        case 0x16: RL_IXIYd(indexRegister); return 23;
-        case 0x1E: RR_IXIYd(indexRegister); return 23;
-        case 0x26: SLA_IXIYd(indexRegister); return 23;
-        case 0x2E: SRA_IXIYd(indexRegister); return 23;
-        case 0x36: SLL_IXIYd(indexRegister); return 23;
-        case 0x3E: SRL_IXIYd(indexRegister); return 23;
-        case 0x46: BIT_b_IXIYd(0, indexRegister); return 20;
-        case 0x4E: BIT_b_IXIYd(1, indexRegister); return 20;
-        case 0x56: BIT_b_IXIYd(2, indexRegister); return 20;
-        case 0x5E: BIT_b_IXIYd(3, indexRegister); return 20;
-        case 0x66: BIT_b_IXIYd(4, indexRegister); return 20;
-        case 0x6E: BIT_b_IXIYd(5, indexRegister); return 20;
-        case 0x76: BIT_b_IXIYd(6, indexRegister); return 20;
-        case 0x7E: BIT_b_IXIYd(7, indexRegister); return 20;
-        case 0x86: RES_b_IXIYd(0, indexRegister); return 23;
-        case 0x8E: RES_b_IXIYd(1, indexRegister); return 23;
-        case 0x96: RES_b_IXIYd(2, indexRegister); return 23;
-        case 0x9E: RES_b_IXIYd(3, indexRegister); return 23;
-        case 0xA6: RES_b_IXIYd(4, indexRegister); return 23;
-        case 0xAE: RES_b_IXIYd(5, indexRegister); return 23;
-        case 0xB6: RES_b_IXIYd(6, indexRegister); return 23;
-        case 0xBE: RES_b_IXIYd(7, indexRegister); return 23;
-        case 0xC6: SET_b_IXIYd(0, indexRegister); return 23;
-        case 0xCE: SET_b_IXIYd(1, indexRegister); return 23;
-        case 0xD6: SET_b_IXIYd(2, indexRegister); return 23;
-        case 0xDE: SET_b_IXIYd(3, indexRegister); return 23;
-        case 0xE6: SET_b_IXIYd(4, indexRegister); return 23;
-        case 0xEE: SET_b_IXIYd(5, indexRegister); return 23;
-        case 0xF6: SET_b_IXIYd(6, indexRegister); return 23;
-        case 0xFE: SET_b_IXIYd(7, indexRegister); return 23;
-        default:
-            std::cerr << "Unknown DDFDCB opcode: 0x" << std::hex << (int)nextOpcode << std::endl;
-            return 4;
-    }
+template<size_t... Op>
+constexpr std::array<Z80::OpHandler, 256> Z80::makeEDTable(std::index_sequence<Op...>) {
+    return {{ &Z80::opED<Op>... }};
+}
+
+template<bool UseIY, size_t... Op>
+constexpr std::array<Z80::OpHandler, 256> Z80::makeIndexTable(std::index_sequence<Op...>) {
+    return {{ &Z80::opIndex<Op, UseIY>... }};
+}
+
+template<size_t... Op>
+constexpr std::array<Z80::OpHandler, 256> Z80::makeIndexCBTable(std::index_sequence<Op...>) {
+    return {{ &Z80::opIndexCB<Op>... }};
+}
+
+constexpr std::array<Z80::OpHandler, 256> Z80::MAIN_OPS = Z80::makeMainTable(std::make_index_sequence<256>{});
+constexpr std::array<Z80::OpHandler, 256> Z80::CB_OPS = Z80::makeCBTable(std::make_index_sequence<256>{});
+constexpr std::array<Z80::OpHandler, 256> Z80::ED_OPS = Z80::makeEDTable(std::make_index_sequence<256>{});
+constexpr std::array<Z80::OpHandler, 256> Z80::IX_OPS = Z80::makeIndexTable<false>(std::make_index_sequence<256>{});
+constexpr std::array<Z80::OpHandler, 256> Z80::IY_OPS = Z80::makeIndexTable<true>(std::make_index_sequence<256>{});
+constexpr std::array<Z80::OpHandler, 256> Z80::INDEX_CB_OPS = Z80::makeIndexCBTable(std::make_index_sequence<256>{});
+
+// --- Prefix dispatch ---
+void Z80::executeCB() {
+    const uint8_t opcode = fetchOpcode();
+    cycles += CYCLES_CB[opcode];
+    (this->*CB_OPS[opcode])();
+}
+
+void Z80::executeED() {
+    const uint8_t opcode = fetchOpcode();
+    cycles += CYCLES_ED[opcode];
+    (this->*ED_OPS[opcode])();
+}
+
+template<bool UseIY>
+void Z80::executeIndex() {
+    const uint8_t opcode = fetchOpcode();
+    cycles += CYCLES_XX[opcode];
+    (this->*(UseIY ? IY_OPS : IX_OPS)[opcode])();
+}
+
+template<bool UseIY>
+void Z80::executeIndexCB() {
+    // DD CB d op: the displacement comes before the final opcode byte, which
+    // is an ordinary memory read rather than an M1 cycle, so R and the wait
+    // states only count DD and CB
+    indexAddress = indexReg<UseIY>() + signExtend(fetchByte());
+    const uint8_t opcode = fetchByte();
+    cycles += CYCLES_XXCB[opcode];
+    (this->*INDEX_CB_OPS[opcode])();
 }
 
 void Z80::handleInterrupts() {
@@ -1027,7 +818,6 @@ void Z80::handleInterrupts() {
     if (nmi_line) {
         handleNMI();
         nmi_line = false;
-        cycles += 11;  // NMI handling overhead
         return;
     }
 
@@ -1035,146 +825,120 @@ void Z80::handleInterrupts() {
     if (registers.IFF1 && interrupt_pending) {
         halted = false;
         registers.IFF1 = false;
+        acknowledgeInterrupt();
 
         switch (registers.interruptMode) {
             case 0:
                 RST_p(0x38);  // Simulate RST 38h
-                cycles += 13;
+                cycles += CYCLES_IM0;
                 break;
             case 1:
                 RST_p(0x38);
-                cycles += 13;
+                cycles += CYCLES_IM1;
                 break;
             case 2:
                 if (checkForInterrupts()) {
                     uint8_t interruptVector = 0;
                     uint16_t address = (registers.I << 8) | interruptVector;
                     generateInterrupt(address);
-                    cycles += 19;
+                    cycles += CYCLES_IM2;
                 }
                 break;
             default:
                 std::cerr << "Invalid interrupt mode: " << registers.interruptMode << std::endl;
-                cycles += 4;  // Error handling overhead
                 break;
         }
         interrupt_pending = false;
     }
 }
 
+// Interrupt acknowledge runs an M1 cycle: R counts it and the MSX wait state
+// applies
+void Z80::acknowledgeInterrupt() {
+    registers.R = (registers.R & 0x80) | ((registers.R + 1) & 0x7F);
+    cycles += m1WaitStates;
+}
+
 void Z80::handleNMI() {
     halted = false;
     registers.IFF2 = registers.IFF1;
     registers.IFF1 = false;
+    acknowledgeInterrupt();
     pushWord(registers.PC);
     registers.PC = 0x0066;
-    cycles += 11;
+    cycles += CYCLES_NMI;
 }
 
 bool Z80::checkForInterrupts() {
-    cycles += 4;  // Interrupt check overhead
     return interrupt_pending;
 }
 
 void Z80::generateInterrupt(uint16_t address) {
     pushWord(registers.PC);
     registers.PC = address;
-    cycles += 11;  // Interrupt generation overhead
 }
 
 
 // --- Instruction Implementations ---
 // temp
-void Z80::ADD_IX_pp(uint16_t& pp) {
-    uint32_t result = registers.IX + pp;
-    bool halfCarry = ((registers.IX & 0xFFF) + (pp & 0xFFF)) > 0xFFF;
-    bool carry = result > 0xFFFF;
-    registers.setFlag(Z80Registers::Flag::Subtract, false);
-    registers.setFlag(Z80Registers::Flag::HalfCarry, halfCarry);
-    registers.setFlag(Z80Registers::Flag::Carry, carry);
-
-    registers.IX = static_cast<uint16_t>(result);
-    cycles += 15;
-}
-
 void Z80::LD_A_iDE() {
         registers.A = memory.readByte(registers.DE);
-        cycles += 7;
     }
 
     void Z80::LD_A_inn() {
         uint16_t address = fetchWord();
         registers.A = memory.readByte(address);
-        cycles += 13;
     }
 
     void Z80::EX_iSP_HL() {
         uint16_t temp = memory.readWord(registers.SP);
         memory.writeWord(registers.SP, registers.HL);
         registers.HL = temp;
-        cycles += 19;
     }
 
     void Z80::LD_HL_inn() {
         uint16_t address = fetchWord();
         registers.HL = memory.readWord(address);
-        cycles += 16;
     }
 
 //// end of temp
 
 void Z80::NOP() {
     // No operation
-    cycles += 4;
 }
 
 void Z80::LD_BC_d16() {
     registers.BC = fetchWord();
-    cycles += 10;
 }
 
 void Z80::LD_iBC_A() {
     memory.writeByte(registers.BC, registers.A);
-    cycles += 7;
 }
 
 void Z80::INC_nn(uint16_t& nn) {
     nn++;
-    cycles += 6;
 }
 
 void Z80::INC_r(uint8_t& r) {
-    bool halfCarry = ((r & 0x0F) == 0x0F);
-    r++;
-    updateFlagsArithmetic(r, false, false, halfCarry, r == 0x80);
-    cycles += 4;
+    r = aluInc(r);
 }
 
 void Z80::DEC_r(uint8_t& r) {
-    bool halfCarry = ((r & 0x0F) == 0x00);
-    r--;
-    updateFlagsArithmetic(r, true, false, halfCarry, r == 0x7F);
-    cycles += 4;
+    r = aluDec(r);
 }
 
 void Z80::LD_r_n(uint8_t& r, uint8_t value) {
     r = value;
-    cycles += 7;
 }
 
 void Z80::RLCA() {
     uint8_t bit7 = (registers.A >> 7) & 1;
     registers.A = (registers.A << 1) | bit7;
-    registers.setFlag(Z80Registers::Flag::Carry, bit7);
-    registers.setFlag(Z80Registers::Flag::HalfCarry, false);
-    registers.setFlag(Z80Registers::Flag::Subtract, false);
-    registers.updateFlagsRegister();
-    cycles += 4;
+    registers.setFlags((registers.getF() & ~(Z80Registers::Carry | Z80Registers::HalfCarry | Z80Registers::Subtract)) | bit7);
 }
 
 void Z80::EX_AF_AF() {
     registers.exchangeAF();
-    cycles += 4;
 }
 
 void Z80::ADD_HL_ss(uint16_t& ss) {
@@ -1184,28 +948,20 @@ void Z80::ADD_HL_ss(uint16_t& ss) {
     registers.setFlag(Z80Registers::Flag::HalfCarry, halfCarry);
     registers.setFlag(Z80Registers::Flag::Carry, result > 0xFFFF);
     registers.HL = (uint16_t)result;
-    registers.updateFlagsRegister();
-    cycles += 11;
 }
 
 void Z80::LD_A_iBC() {
     registers.A = memory.readByte(registers.BC);
-    cycles += 7;
 }
 
 void Z80::DEC_nn(uint16_t& nn) {
     nn--;
-    cycles += 6;
 }
 
 void Z80::RRCA() {
     uint8_t bit0 = registers.A & 1;
     registers.A = (registers.A >> 1) | (bit0 << 7);
-    registers.setFlag(Z80Registers::Flag::Carry, bit0);
-    registers.setFlag(Z80Registers::Flag::HalfCarry, false);
-    registers.setFlag(Z80Registers::Flag::Subtract, false);
-    registers.updateFlagsRegister();
-    cycles += 4;
+    registers.setFlags((registers.getF() & ~(Z80Registers::Carry | Z80Registers::HalfCarry | Z80Registers::Subtract)) | bit0);
 }
 
 void Z80::DJNZ_d8() {
@@ -1213,80 +969,53 @@ void Z80::DJNZ_d8() {
     if (registers.B != 0) {
         int8_t offset = signExtend(fetchByte());
         registers.PC += offset;
-        cycles += 13;
     } else {
         registers.PC++; // Skip the offset byte
-        cycles += 8;
     }
 }
 
 void Z80::LD_DE_d16() {
     registers.DE = fetchWord();
-    cycles += 10;
 }
 
 void Z80::LD_iDE_A() {
     memory.writeByte(registers.DE, registers.A);
-    cycles += 7;
 }
 
 void Z80::RLA() {
     uint8_t bit7 = (registers.A >> 7) & 1;
     uint8_t carry = registers.getFlag(Z80Registers::Flag::Carry);
     registers.A = (registers.A << 1) | carry;
-    registers.setFlag(Z80Registers::Flag::Carry, bit7);
-    registers.setFlag(Z80Registers::Flag::HalfCarry, false);
-    registers.setFlag(Z80Registers::Flag::Subtract, false);
-    registers.updateFlagsRegister();
-    cycles += 4;
+    registers.setFlags((registers.getF() & ~(Z80Registers::Carry | Z80Registers::HalfCarry | Z80Registers::Subtract)) | bit7);
 }
 
 void Z80::JR_d8() {
     int8_t offset = signExtend(fetchByte());
     registers.PC += offset;
-    cycles += 12;
 }
 
 void Z80::RRA() {
     uint8_t bit0 = registers.A & 1;
     uint8_t carry = registers.getFlag(Z80Registers::Flag::Carry);
     registers.A = (registers.A >> 1) | (carry << 7);
-    registers.setFlag(Z80Registers::Flag::Carry, bit0);
-    registers.setFlag(Z80Registers::Flag::HalfCarry, false);
-    registers.setFlag(Z80Registers::Flag::Subtract, false);
-    registers.updateFlagsRegister();
-    cycles += 4;
+    registers.setFlags((registers.getF() & ~(Z80Registers::Carry | Z80Registers::HalfCarry | Z80Registers::Subtract)) | bit0);
 }
 
-void Z80::JR_NZ_d8() {
-    if (!registers.getFlag(Z80Registers::Flag::Zero)) {
+void Z80::JR_cc_d8(bool condition) {
+    if (condition) {
         JR_d8();
-        cycles += 12;
     } else {
         registers.PC++; // Skip offset
-        cycles += 7;
     }
 }
 
 void Z80::LD_HL_d16() {
     registers.HL = fetchWord();
-    cycles += 10;
 }
 
 void Z80::LD_inn_HL() {
     uint16_t address = fetchWord();
     memory.writeWord(address, registers.HL);
-    cycles += 16;
-}
-
-void Z80::JR_Z_d8() {
-    if (registers.getFlag(Z80Registers::Flag::Zero)) {
-        JR_d8();
-        cycles += 12;
-    } else {
-        registers.PC++; // Skip offset
-        cycles += 7;
-    }
 }
 
 void Z80::DAA() {
@@ -1309,55 +1038,25 @@ void Z80::DAA() {
     registers.setFlag(Z80Registers::Flag::Carry, carry);
     registers.setFlag(Z80Registers::Flag::HalfCarry, false);
     updateFlags_SZP(registers.A);
-    registers.updateFlagsRegister();
-    cycles += 4;
 }
 
 void Z80::CPL() {
     registers.A = ~registers.A;
     registers.setFlag(Z80Registers::Flag::HalfCarry, true);
     registers.setFlag(Z80Registers::Flag::Subtract, true);
-    registers.updateFlagsRegister();
-    cycles += 4;
-}
-
-void Z80::JR_NC_d8() {
-    if (!registers.getFlag(Z80Registers::Flag::Carry)) {
-        JR_d8();
-        cycles += 12;
-    } else {
-        registers.PC++; // Skip offset
-        cycles += 7;
-    }
 }
 
 void Z80::LD_SP_d16() {
     registers.SP = fetchWord();
-    cycles += 10;
 }
 
 void Z80::LD_inn_A() {
     uint16_t address = fetchWord();
     memory.writeByte(address, registers.A);
-    cycles += 13;
-}
-
-void Z80::JR_C_d8() {
-    if (registers.getFlag(Z80Registers::Flag::Carry)) {
-        JR_d8();
-        cycles += 12;
-    } else {
-        registers.PC++; // Skip offset
-        cycles += 7;
-    }
 }
 
 void Z80::SCF() {
-    registers.setFlag(Z80Registers::Flag::Carry, true);
-    registers.setFlag(Z80Registers::Flag::HalfCarry, false);
-    registers.setFlag(Z80Registers::Flag::Subtract, false);
-    registers.updateFlagsRegister();
-    cycles += 4;
+    registers.setFlags((registers.getF() & ~(Z80Registers::Carry | Z80Registers::HalfCarry | Z80Registers::Subtract)) | Z80Registers::Carry);
 }
 
 void Z80::CCF() {
@@ -1365,98 +1064,57 @@ void Z80::CCF() {
     registers.setFlag(Z80Registers::Flag::Carry, !carry);
     registers.setFlag(Z80Registers::Flag::HalfCarry, carry);
     registers.setFlag(Z80Registers::Flag::Subtract, false);
-    registers.updateFlagsRegister();
-    cycles += 4;
 }
 
 void Z80::LD_r_r(uint8_t& dst, uint8_t& src) {
     dst = src;
-    cycles += 4;
 }
 
 void Z80::HALT() {
     halted = true;
-    cycles += 4;
+    sliceEnd = 0;
 }
 
 void Z80::ADD_A_r(uint8_t& r) {
-    uint16_t result = registers.A + r;
-    bool halfCarry = ((registers.A & 0x0F) + (r & 0x0F)) > 0x0F;
-    bool overflow = ((registers.A ^ r) & 0x80) == 0 && ((registers.A ^ result) & 0x80) != 0;
-    registers.A = (uint8_t)result;
-    updateFlagsArithmetic(registers.A, false, result > 0xFF, halfCarry, overflow);
-    cycles += 4;
+    aluAdd(r, 0);
 }
 
 void Z80::ADC_A_r(uint8_t& r) {
-    uint8_t carry = registers.getFlag(Z80Registers::Flag::Carry);
-    uint16_t result = registers.A + r + carry;
-    bool halfCarry = ((registers.A & 0x0F) + (r & 0x0F) + carry) > 0x0F;
-    bool overflow = ((registers.A ^ r) & 0x80) == 0 && ((registers.A ^ result) & 0x80) != 0;
-    registers.A = (uint8_t)result;
-    updateFlagsArithmetic(registers.A, false, result > 0xFF, halfCarry, overflow);
-    cycles += 4;
+    aluAdd(r, registers.getFlag(Z80Registers::Carry));
 }
 
 void Z80::SUB_r(uint8_t& r) {
-    uint8_t result = registers.A - r;
-    bool halfCarry = (registers.A & 0x0F) < (r & 0x0F);
-    bool overflow = ((registers.A ^ r) & 0x80) != 0 && ((registers.A ^ result) & 0x80) != 0;
-    registers.A = result;
-    updateFlagsArithmetic(registers.A, true, false, halfCarry, overflow);
-    cycles += 4;
+    aluSub(r, 0);
 }
 
 void Z80::SBC_A_r(uint8_t& r) {
-    uint8_t carry = registers.getFlag(Z80Registers::Flag::Carry);
-    uint8_t result = registers.A - r - carry;
-    bool halfCarry = (registers.A & 0x0F) < ((r & 0x0F) + carry);
-    bool overflow = ((registers.A ^ r) & 0x80) != 0 && ((registers.A ^ result) & 0x80) != 0;
-    registers.A = result;
-    updateFlagsArithmetic(registers.A, true, false, halfCarry, overflow);
-    cycles += 4;
+    aluSub(r, registers.getFlag(Z80Registers::Carry));
 }
 
 void Z80::AND_r(uint8_t& r) {
-    registers.A &= r;
-    updateFlagsLogical(registers.A, false, true);
-    cycles += 4;
+    aluAnd(r);
 }
 
 void Z80::XOR_r(uint8_t& r) {
-    registers.A ^= r;
-    updateFlagsLogical(registers.A, false, false);
-    cycles += 4;
+    aluXor(r);
 }
 
 void Z80::OR_r(uint8_t& r) {
-    registers.A |= r;
-    updateFlagsLogical(registers.A, false, false);
-    cycles += 4;
+    aluOr(r);
 }
 
 void Z80::CP_r(uint8_t& r) {
-    uint8_t result = registers.A - r;
-    bool halfCarry = (registers.A & 0x0F) < (r & 0x0F);
-    bool overflow = ((registers.A ^ r) & 0x80) != 0 && ((registers.A ^ result) & 0x80) != 0;
-    updateFlagsArithmetic(result, true, false, halfCarry, overflow);
-    registers.setFlag(Z80Registers::Flag::Subtract, true);
-    registers.updateFlagsRegister();
-    cycles += 4;
+    aluCompare(r);
 }
 
 void Z80::RET_cc(bool condition) {
     if (condition) {
         registers.PC = popWord();
-        cycles += 11;
-    } else {
-        cycles += 5;
     }
 }
 
 void Z80::POP_qq(uint16_t& qq) {
     qq = popWord();
-    cycles += 10;
 }
 
 void Z80::JP_cc_nn(bool condition) {
@@ -1464,12 +1122,10 @@ void Z80::JP_cc_nn(bool condition) {
     if (condition) {
         registers.PC = address;
     }
-    cycles += 10;
 }
 
 void Z80::JP_nn() {
     registers.PC = fetchWord();
-    cycles += 10;
 }
 
 void Z80::CALL_cc_nn(bool condition) {
@@ -1477,479 +1133,335 @@ void Z80::CALL_cc_nn(bool condition) {
     if (condition) {
         pushWord(registers.PC);
         registers.PC = address;
-        cycles += 17;
-    } else {
-        cycles += 10;
     }
 }
 
 void Z80::PUSH_qq(uint16_t& qq) {
     pushWord(qq);
-    cycles += 11;
 }
 
 void Z80::CALL_nn() {
     pushWord(registers.PC + 2);
     registers.PC = fetchWord();
-    cycles += 17;
 }
 
 void Z80::ADD_A_n(uint8_t value) {
-    uint16_t result = registers.A + value;
-    bool halfCarry = ((registers.A & 0x0F) + (value & 0x0F)) > 0x0F;
-    bool overflow = ((registers.A ^ value) & 0x80) == 0 && ((registers.A ^ result) & 0x80) != 0;
-    registers.A = (uint8_t)result;
-    updateFlagsArithmetic(registers.A, false, result > 0xFF, halfCarry, overflow);
-    cycles += 7;
+    aluAdd(value, 0);
 }
 
 void Z80::RST_p(uint8_t p) {
     pushWord(registers.PC);
     registers.PC = p;
-    cycles += 11;
 }
 
 void Z80::ADC_A_n(uint8_t value) {
-    uint8_t carry = registers.getFlag(Z80Registers::Flag::Carry);
-    uint16_t result = registers.A + value + carry;
-    bool halfCarry = ((registers.A & 0x0F) + (value & 0x0F) + carry) > 0x0F;
-    bool overflow = ((registers.A ^ value) & 0x80) == 0 && ((registers.A ^ result) & 0x80) != 0;
-    registers.A = (uint8_t)result;
-    updateFlagsArithmetic(registers.A, false, result > 0xFF, halfCarry, overflow);
-    cycles += 7;
+    aluAdd(value, registers.getFlag(Z80Registers::Carry));
 }
 
 void Z80::RET() {
     registers.PC = popWord();
-    cycles += 10;
 }
 
 void Z80::EXX() {
     registers.exchangeMainRegisters();
-    cycles += 4;
 }
 
 void Z80::IN_A_in() {
+    // A goes out on the upper address lines; no flags are affected
     uint8_t port = fetchByte();
-    // In a real Z80, IN affects flags, but we'll skip that for simplicity here
-    // TODO: Implement IN instruction
-    cycles += 11;
+    registers.A = ioBus.in((registers.A << 8) | port);
 }
 
 void Z80::OUT_in_A() {
     uint8_t port = fetchByte();
-    // TODO: Implement OUT instruction
-    cycles += 11;
+    ioBus.out((registers.A << 8) | port, registers.A);
 }
 
 void Z80::SUB_n(uint8_t value) {
-    uint8_t result = registers.A - value;
-    bool halfCarry = (registers.A & 0x0F) < (value & 0x0F);
-    bool overflow = ((registers.A ^ value) & 0x80) != 0 && ((registers.A ^ result) & 0x80) != 0;
-    registers.A = result;
-    updateFlagsArithmetic(registers.A, true, false, halfCarry, overflow);
-    cycles += 7;
+    aluSub(value, 0);
 }
 
 void Z80::SBC_A_n(uint8_t value) {
-    uint8_t carry = registers.getFlag(Z80Registers::Flag::Carry);
-    uint8_t result = registers.A - value - carry;
-    bool halfCarry = (registers.A & 0x0F) < ((value & 0x0F) + carry);
-    bool overflow = ((registers.A ^ value) & 0x80) != 0 && ((registers.A ^ result) & 0x80) != 0;
-    registers.A = result;
-    updateFlagsArithmetic(registers.A, true, false, halfCarry, overflow);
-    cycles += 7;
+    aluSub(value, registers.getFlag(Z80Registers::Carry));
 }
 
 void Z80::EX_DE_HL() {
     std::swap(registers.DE, registers.HL);
-    cycles += 4;
 }
 
 void Z80::JP_iHL() {
     registers.PC = registers.HL;
-    cycles += 4;
 }
 
-void Z80::LD_iSP_HL() {
-    memory.writeWord(registers.SP, registers.HL);
-    cycles += 6;
+void Z80::LD_SP_HL() {
+    registers.SP = registers.HL;
 }
 
 void Z80::DI() {
     registers.IFF1 = registers.IFF2 = false;
-    cycles += 4;
 }
 
 void Z80::AND_n(uint8_t value) {
-    registers.A &= value;
-    updateFlagsLogical(registers.A, false, true);
-    cycles += 7;
+    aluAnd(value);
 }
 
 void Z80::EI() {
+    // Interrupts stay blocked for one more instruction: run() ends the slice
+    // after it, as ExecZ80() does with IFF_EI
+    const bool wasEnabled = registers.IFF1;
     registers.IFF1 = registers.IFF2 = true;
-    cycles += 4;
+    if (!wasEnabled && !afterEI) {
+        afterEI = true;
+        eiSliceEnd = sliceEnd;
+        sliceEnd = cycles + 1;
+    }
 }
 
 
 void Z80::XOR_n(uint8_t value) {
-    registers.A ^= value;
-    updateFlagsLogical(registers.A, false, false);
-    cycles += 7;
+    aluXor(value);
 }
 
 void Z80::OR_n(uint8_t value) {
-    registers.A |= value;
-    updateFlagsLogical(registers.A, false, false);
-    cycles += 7;
+    aluOr(value);
 }
 
 void Z80::CP_n(uint8_t value) {
-    uint8_t result = registers.A - value;
-    bool halfCarry = (registers.A & 0x0F) < (value & 0x0F);
-    bool overflow = ((registers.A ^ value) & 0x80) != 0 && ((registers.A ^ result) & 0x80) != 0;
-    updateFlagsArithmetic(result, true, false, halfCarry, overflow);
-    registers.setFlag(Z80Registers::Flag::Subtract, true);
-    registers.updateFlagsRegister();
-    cycles += 7;
+    aluCompare(value);
 }
 
 void Z80::LD_r_iHL(uint8_t& r) {
     r = memory.readByte(registers.HL);
-    cycles += 7;
 }
 
 void Z80::LD_iHL_r(uint8_t& r) {
     memory.writeByte(registers.HL, r);
-    cycles += 7;
 }
 
 void Z80::LD_iHL_n(uint8_t n) {
     memory.writeByte(registers.HL, n);
-    cycles += 10;
 }
 
 void Z80::INC_iHL() {
     uint8_t value = memory.readByte(registers.HL);
-    bool halfCarry = ((value & 0x0F) == 0x0F);
-    value++;
+    value = aluInc(value);
     memory.writeByte(registers.HL, value);
-    updateFlagsArithmetic(value, false, false, halfCarry, value == 0x80);
-    cycles += 11;
 }
 
 void Z80::DEC_iHL() {
     uint8_t value = memory.readByte(registers.HL);
-    bool halfCarry = ((value & 0x0F) == 0x00);
-    value--;
+    value = aluDec(value);
     memory.writeByte(registers.HL, value);
-    updateFlagsArithmetic(value, true, false, halfCarry, value == 0x7F);
-    cycles += 11;
 }
 
 void Z80::ADD_A_iHL() {
     uint8_t value = memory.readByte(registers.HL);
-    uint16_t result = registers.A + value;
-    bool halfCarry = ((registers.A & 0x0F) + (value & 0x0F)) > 0x0F;
-    bool overflow = ((registers.A ^ value) & 0x80) == 0 && ((registers.A ^ result) & 0x80) != 0;
-    registers.A = (uint8_t)result;
-    updateFlagsArithmetic(registers.A, false, result > 0xFF, halfCarry, overflow);
-    cycles += 7;
+    aluAdd(value, 0);
 }
 
 void Z80::ADC_A_iHL() {
     uint8_t value = memory.readByte(registers.HL);
-    uint8_t carry = registers.getFlag(Z80Registers::Flag::Carry);
-    uint16_t result = registers.A + value + carry;
-    bool halfCarry = ((registers.A & 0x0F) + (value & 0x0F) + carry) > 0x0F;
-    bool overflow = ((registers.A ^ value) & 0x80) == 0 && ((registers.A ^ result) & 0x80) != 0;
-    registers.A = (uint8_t)result;
-    updateFlagsArithmetic(registers.A, false, result > 0xFF, halfCarry, overflow);
-    cycles += 7;
+    aluAdd(value, registers.getFlag(Z80Registers::Carry));
 }
 
 void Z80::SUB_iHL() {
     uint8_t value = memory.readByte(registers.HL);
-    uint8_t result = registers.A - value;
-    bool halfCarry = (registers.A & 0x0F) < (value & 0x0F);
-    bool overflow = ((registers.A ^ value) & 0x80) != 0 && ((registers.A ^ result) & 0x80) != 0;
-    registers.A = result;
-    updateFlagsArithmetic(registers.A, true, false, halfCarry, overflow);
-    cycles += 7;
+    aluSub(value, 0);
 }
 
 void Z80::SBC_A_iHL() {
     uint8_t value = memory.readByte(registers.HL);
-    uint8_t carry = registers.getFlag(Z80Registers::Flag::Carry);
-    uint8_t result = registers.A - value - carry;
-    bool halfCarry = (registers.A & 0x0F) < ((value & 0x0F) + carry);
-    bool overflow = ((registers.A ^ value) & 0x80) != 0 && ((registers.A ^ result) & 0x80) != 0;
-    registers.A = result;
-    updateFlagsArithmetic(registers.A, true, false, halfCarry, overflow);
-    cycles += 7;
+    aluSub(value, registers.getFlag(Z80Registers::Carry));
 }
 
 void Z80::AND_iHL() {
     uint8_t value = memory.readByte(registers.HL);
-    registers.A &= value;
-    updateFlagsLogical(registers.A, false, true);
-    cycles += 7;
+    aluAnd(value);
 }
 
 void Z80::XOR_iHL() {
     uint8_t value = memory.readByte(registers.HL);
-    registers.A ^= value;
-    updateFlagsLogical(registers.A, false, false);
-    cycles += 7;
+    aluXor(value);
 }
 
 void Z80::OR_iHL() {
     uint8_t value = memory.readByte(registers.HL);
-    registers.A |= value;
-    updateFlagsLogical(registers.A, false, false);
-    cycles += 7;
+    aluOr(value);
 }
 
 void Z80::CP_iHL() {
     uint8_t value = memory.readByte(registers.HL);
-    uint8_t result = registers.A - value;
-    bool halfCarry = (registers.A & 0x0F) < (value & 0x0F);
-    bool overflow = ((registers.A ^ value) & 0x80) != 0 && ((registers.A ^ result) & 0x80) != 0;
-    updateFlagsArithmetic(result, true, false, halfCarry, overflow);
-    registers.setFlag(Z80Registers::Flag::Subtract, true);
-    registers.updateFlagsRegister();
-    cycles += 7;
+    aluCompare(value);
 }
 
 // 0xCB prefixed instructions
 void Z80::BIT_b_r(uint8_t bit, uint8_t& reg) {
     checkBit(reg, bit);
-    cycles += 8;
 }
 
 void Z80::RES_b_r(uint8_t bit, uint8_t& reg) {
     reg &= ~(1 << bit);
-    cycles += 8;
 }
 
 void Z80::SET_b_r(uint8_t bit, uint8_t& reg) {
     reg |= (1 << bit);
-    cycles += 8;
 }
 
 void Z80::RLC_r(uint8_t& reg) {
     uint8_t bit7 = (reg >> 7) & 1;
     reg = (reg << 1) | bit7;
-    registers.setFlag(Z80Registers::Flag::Carry, bit7);
-    registers.setFlag(Z80Registers::Flag::HalfCarry, false);
-    registers.setFlag(Z80Registers::Flag::Subtract, false);
-    updateFlags_SZP(reg);
-    registers.updateFlagsRegister();
-    cycles += 8;
+    registers.setFlags(PZS_TABLE[reg] | bit7);
 }
 
 void Z80::RRC_r(uint8_t& reg) {
     uint8_t bit0 = reg & 1;
     reg = (reg >> 1) | (bit0 << 7);
-    registers.setFlag(Z80Registers::Flag::Carry, bit0);
-    registers.setFlag(Z80Registers::Flag::HalfCarry, false);
-    registers.setFlag(Z80Registers::Flag::Subtract, false);
-    updateFlags_SZP(reg);
-    registers.updateFlagsRegister();
-    cycles += 8;
+    registers.setFlags(PZS_TABLE[reg] | bit0);
 }
 
 void Z80::RL_r(uint8_t& reg) {
     uint8_t carry = registers.getFlag(Z80Registers::Flag::Carry);
     uint8_t bit7 = (reg >> 7) & 1;
     reg = (reg << 1) | carry;
-    registers.setFlag(Z80Registers::Flag::Carry, bit7);
-    registers.setFlag(Z80Registers::Flag::HalfCarry, false);
-    registers.setFlag(Z80Registers::Flag::Subtract, false);
-    updateFlags_SZP(reg);
-    registers.updateFlagsRegister();
-    cycles += 8;
+    registers.setFlags(PZS_TABLE[reg] | bit7);
 }
 
 void Z80::RR_r(uint8_t& reg) {
     uint8_t carry = registers.getFlag(Z80Registers::Flag::Carry);
     uint8_t bit0 = reg & 1;
     reg = (reg >> 1) | (carry << 7);
-    registers.setFlag(Z80Registers::Flag::Carry, bit0);
-    registers.setFlag(Z80Registers::Flag::HalfCarry, false);
-    registers.setFlag(Z80Registers::Flag::Subtract, false);
-    updateFlags_SZP(reg);
-    registers.updateFlagsRegister();
-    cycles += 8;
+    registers.setFlags(PZS_TABLE[reg] | bit0);
 }
 
 void Z80::SLA_r(uint8_t& reg) {
     uint8_t bit7 = (reg >> 7) & 1;
     reg = reg << 1;
-    registers.setFlag(Z80Registers::Flag::Carry, bit7);
-    registers.setFlag(Z80Registers::Flag::HalfCarry, false);
-    registers.setFlag(Z80Registers::Flag::Subtract, false);
-    updateFlags_SZP(reg);
-    registers.updateFlagsRegister();
-    cycles += 8;
+    registers.setFlags(PZS_TABLE[reg] | bit7);
 }
 
 void Z80::SRA_r(uint8_t& reg) {
     uint8_t bit0 = reg & 1;
     uint8_t bit7 = reg & 0x80;
     reg = (reg >> 1) | bit7;
-    registers.setFlag(Z80Registers::Flag::Carry, bit0);
-    registers.setFlag(Z80Registers::Flag::HalfCarry, false);
-    registers.setFlag(Z80Registers::Flag::Subtract, false);
-    updateFlags_SZP(reg);
-    registers.updateFlagsRegister();
-    cycles += 8;
+    registers.setFlags(PZS_TABLE[reg] | bit0);
 }
 
 void Z80::SLL_r(uint8_t& reg) {
     uint8_t bit7 = (reg >> 7) & 1;
     reg = (reg << 1) | 1;
-    registers.setFlag(Z80Registers::Flag::Carry, bit7);
-    registers.setFlag(Z80Registers::Flag::HalfCarry, false);
-    registers.setFlag(Z80Registers::Flag::Subtract, false);
-    updateFlags_SZP(reg);
-    registers.updateFlagsRegister();
-    cycles += 8;
+    registers.setFlags(PZS_TABLE[reg] | bit7);
 }
 
 void Z80::SRL_r(uint8_t& reg) {
     uint8_t bit0 = reg & 1;
     reg = reg >> 1;
-    registers.setFlag(Z80Registers::Flag::Carry, bit0);
-    registers.setFlag(Z80Registers::Flag::HalfCarry, false);
-    registers.setFlag(Z80Registers::Flag::Subtract, false);
-    updateFlags_SZP(reg);
-    registers.updateFlagsRegister();
-    cycles += 8;
+    registers.setFlags(PZS_TABLE[reg] | bit0);
 }
 
 void Z80::RLC_iHL() {
     uint8_t value = memory.readByte(registers.HL);
     RLC_r(value);
     memory.writeByte(registers.HL, value);
-    cycles += 15;
 }
 
 void Z80::RRC_iHL() {
     uint8_t value = memory.readByte(registers.HL);
     RRC_r(value);
     memory.writeByte(registers.HL, value);
-    cycles += 15;
 }
 
 void Z80::RL_iHL() {
     uint8_t value = memory.readByte(registers.HL);
     RL_r(value);
     memory.writeByte(registers.HL, value);
-    cycles += 15;
 }
 
 void Z80::RR_iHL() {
     uint8_t value = memory.readByte(registers.HL);
     RR_r(value);
     memory.writeByte(registers.HL, value);
-    cycles += 15;
 }
 
 void Z80::SLA_iHL() {
     uint8_t value = memory.readByte(registers.HL);
     SLA_r(value);
     memory.writeByte(registers.HL, value);
-    cycles += 15;
 }
 
 void Z80::SRA_iHL() {
     uint8_t value = memory.readByte(registers.HL);
     SRA_r(value);
     memory.writeByte(registers.HL, value);
-    cycles += 15;
 }
 
 void Z80::SLL_iHL() {
     uint8_t value = memory.readByte(registers.HL);
     SLL_r(value);
     memory.writeByte(registers.HL, value);
-    cycles += 15;
 }
 
 void Z80::SRL_iHL() {
     uint8_t value = memory.readByte(registers.HL);
     SRL_r(value);
     memory.writeByte(registers.HL, value);
-    cycles += 15;
 }
 
 void Z80::BIT_b_iHL(uint8_t bit) {
     uint8_t value = memory.readByte(registers.HL);
     checkBit(value, bit);
-    cycles += 12;
 }
 
 void Z80::RES_b_iHL(uint8_t bit) {
     uint8_t value = memory.readByte(registers.HL);
     value &= ~(1 << bit);
     memory.writeByte(registers.HL, value);
-    cycles += 15;
 }
 
 void Z80::SET_b_iHL(uint8_t bit) {
     uint8_t value = memory.readByte(registers.HL);
     value |= (1 << bit);
     memory.writeByte(registers.HL, value);
-    cycles += 15;
 }
 
 // ED prefixed instructions
 void Z80::IN_r_iC(uint8_t& r) {
-    // TODO: Implement IN instruction
-    registers.setFlag(Z80Registers::Flag::Subtract, false);
-    updateFlags_SZP(r);
-    registers.updateFlagsRegister();
-    cycles += 12;
+    r = ioBus.in(registers.BC);
+    registers.setFlags(PZS_TABLE[r] | (registers.getF() & Z80Registers::Carry));
 }
 
 void Z80::OUT_iC_r(uint8_t& r) {
-    // TODO: Implement OUT instruction
-    cycles += 12;
+    ioBus.out(registers.BC, r);
 }
 
 void Z80::SBC_HL_ss(uint16_t& ss) {
-    uint16_t result = registers.HL - ss - registers.getFlag(Z80Registers::Flag::Carry);
-    bool halfCarry = (registers.HL & 0xFFF) < ((ss & 0xFFF) + registers.getFlag(Z80Registers::Flag::Carry));
-    bool overflow = ((registers.HL ^ ss) & 0x8000) != 0 && ((registers.HL ^ result) & 0x8000) != 0;
-    registers.HL = result;
-    updateFlagsArithmetic(static_cast<uint8_t>(result >> 8), true, false, halfCarry, overflow);
-    registers.setFlag(Z80Registers::Flag::Subtract, true);
-    registers.setFlag(Z80Registers::Flag::Carry, (result & 0x10000) != 0);
-    registers.updateFlagsRegister();
-    cycles += 15;
+    // ss is HL itself for SBC HL,HL: read it before HL changes
+    uint16_t value = ss;
+    uint8_t carry = registers.getFlag(Z80Registers::Carry);
+    uint32_t result = registers.HL - value - carry;
+    uint16_t hl = registers.HL;
+    registers.HL = (uint16_t)result;
+    registers.setFlags(Z80Registers::Subtract |
+                       ((result & 0x10000) ? Z80Registers::Carry : 0) |
+                       (((hl ^ value) & (hl ^ result) & 0x8000) ? Z80Registers::ParityOverflow : 0) |
+                       (((hl ^ value ^ result) & 0x1000) ? Z80Registers::HalfCarry : 0) |
+                       (registers.HL ? 0 : Z80Registers::Zero) |
+                       (registers.H & Z80Registers::Sign));
 }
 
 void Z80::LD_inn_dd(uint16_t& dd) {
     uint16_t address = fetchWord();
     memory.writeWord(address, dd);
-    cycles += 20;
 }
 
 void Z80::NEG() {
-    uint8_t result = 0 - registers.A;
-    bool halfCarry = (registers.A & 0x0F) != 0;
-    bool overflow = registers.A == 0x80;
-    registers.A = result;
-    updateFlagsArithmetic(registers.A, true, false, halfCarry, overflow);
-    cycles += 8;
+    uint8_t value = registers.A;
+    registers.A = 0;
+    aluSub(value, 0);
 }
 
 void Z80::RETN() {
     registers.PC = popWord();
     registers.IFF1 = registers.IFF2;
-    cycles += 14;
 }
 
 void Z80::IM_x(uint8_t x) {
@@ -1958,53 +1470,48 @@ void Z80::IM_x(uint8_t x) {
     } else {
         std::cerr << "Invalid interrupt mode: " << (int)x << std::endl;
     }
-    cycles += 8;
 }
 
 void Z80::LD_I_A() {
     registers.I = registers.A;
-    cycles += 9;
 }
 
 void Z80::IN_f_iC() {
-    // TODO: Implement IN instruction
-    registers.setFlag(Z80Registers::Flag::Subtract, false);
-    registers.setFlag(Z80Registers::Flag::HalfCarry, false);
-    registers.updateFlagsRegister();
-    cycles += 12;
+    // IN (C): flags only, the value is dropped
+    uint8_t value = ioBus.in(registers.BC);
+    registers.setFlags(PZS_TABLE[value] | (registers.getF() & Z80Registers::Carry));
 }
 
 void Z80::OUT_iC_0() {
-    // TODO: Implement OUT instruction
-    cycles += 12;
+    ioBus.out(registers.BC, 0);
 }
 
 void Z80::ADC_HL_ss(uint16_t& ss) {
-    uint32_t result = registers.HL + ss + registers.getFlag(Z80Registers::Flag::Carry);
-    bool halfCarry = ((registers.HL & 0xFFF) + (ss & 0xFFF) + registers.getFlag(Z80Registers::Flag::Carry)) > 0xFFF;
-    bool overflow = ((registers.HL ^ ss) & 0x8000) == 0 && ((registers.HL ^ result) & 0x8000) != 0;
+    // ss is HL itself for ADC HL,HL: read it before HL changes
+    uint16_t value = ss;
+    uint8_t carry = registers.getFlag(Z80Registers::Carry);
+    uint32_t result = registers.HL + value + carry;
+    uint16_t hl = registers.HL;
     registers.HL = (uint16_t)result;
-    updateFlagsArithmetic(static_cast<uint8_t>(result >> 8), false, result > 0xFFFF, halfCarry, overflow);
-    registers.setFlag(Z80Registers::Flag::Subtract, false);
-    registers.updateFlagsRegister();
-    cycles += 15;
+    registers.setFlags(((result & 0x10000) ? Z80Registers::Carry : 0) |
+                       ((~(hl ^ value) & (value ^ result) & 0x8000) ? Z80Registers::ParityOverflow : 0) |
+                       (((hl ^ value ^ result) & 0x1000) ? Z80Registers::HalfCarry : 0) |
+                       (registers.HL ? 0 : Z80Registers::Zero) |
+                       (registers.H & Z80Registers::Sign));
 }
 
 void Z80::LD_dd_inn(uint16_t& dd) {
     uint16_t address = fetchWord();
     dd = memory.readWord(address);
-    cycles += 20;
 }
 
 void Z80::RETI() {
     registers.PC = popWord();
     registers.IFF1 = registers.IFF2;
-    cycles += 14;
 }
 
 void Z80::LD_R_A() {
     registers.R = registers.A;
-    cycles += 9;
 }
 
 void Z80::RRD() {
@@ -2016,8 +1523,6 @@ void Z80::RRD() {
     updateFlags_SZP(registers.A);
     registers.setFlag(Z80Registers::Flag::HalfCarry, false);
     registers.setFlag(Z80Registers::Flag::Subtract, false);
-    registers.updateFlagsRegister();
-    cycles += 18;
 }
 
 void Z80::RLD() {
@@ -2029,8 +1534,6 @@ void Z80::RLD() {
     updateFlags_SZP(registers.A);
     registers.setFlag(Z80Registers::Flag::HalfCarry, false);
     registers.setFlag(Z80Registers::Flag::Subtract, false);
-    registers.updateFlagsRegister();
-    cycles += 18;
 }
 
 void Z80::LDI() {
@@ -2042,8 +1545,6 @@ void Z80::LDI() {
     registers.setFlag(Z80Registers::Flag::HalfCarry, false);
     registers.setFlag(Z80Registers::Flag::ParityOverflow, registers.BC != 0);
     registers.setFlag(Z80Registers::Flag::Subtract, false);
-    registers.updateFlagsRegister();
-    cycles += 16;
 }
 
 void Z80::CPI() {
@@ -2056,32 +1557,23 @@ void Z80::CPI() {
     registers.setFlag(Z80Registers::Flag::HalfCarry, halfCarry);
     registers.setFlag(Z80Registers::Flag::ParityOverflow, registers.BC != 0);
     registers.setFlag(Z80Registers::Flag::Subtract, true);
-    registers.updateFlagsRegister();
-    cycles += 16;
 }
 
 void Z80::INI() {
-    // TODO: Implement IN instruction
-    // uint8_t value = io.read(registers.C);
-    // memory.writeByte(registers.HL, value);
-    registers.B--;
+    memory.writeByte(registers.HL, ioBus.in(registers.BC));
     registers.HL++;
-    registers.setFlag(Z80Registers::Flag::Zero, registers.B == 0);
-    registers.setFlag(Z80Registers::Flag::Subtract, true);
-    registers.updateFlagsRegister();
-    cycles += 16;
+    registers.B--;
+    registers.setFlags(Z80Registers::Subtract | (registers.B ? 0 : Z80Registers::Zero));
 }
 
 void Z80::OUTI() {
-    // TODO: Implement OUT instruction
-    uint8_t value = memory.readByte(registers.HL);
-    // io.write(registers.C, value);
+    // B is decremented before it goes out on the upper address lines
     registers.B--;
+    uint8_t value = memory.readByte(registers.HL);
     registers.HL++;
-    registers.setFlag(Z80Registers::Flag::Zero, registers.B == 0);
-    registers.setFlag(Z80Registers::Flag::Subtract, true);
-    registers.updateFlagsRegister();
-    cycles += 16;
+    ioBus.out(registers.BC, value);
+    registers.setFlags(Z80Registers::Subtract | (registers.B ? 0 : Z80Registers::Zero) |
+                       (registers.L + value > 255 ? (Z80Registers::Carry | Z80Registers::HalfCarry) : 0));
 }
 
 void Z80::LDD() {
@@ -2093,8 +1585,6 @@ void Z80::LDD() {
     registers.setFlag(Z80Registers::Flag::HalfCarry, false);
     registers.setFlag(Z80Registers::Flag::ParityOverflow, registers.BC != 0);
     registers.setFlag(Z80Registers::Flag::Subtract, false);
-    registers.updateFlagsRegister();
-    cycles += 16;
 }
 
 void Z80::CPD() {
@@ -2107,41 +1597,188 @@ void Z80::CPD() {
     registers.setFlag(Z80Registers::Flag::HalfCarry, halfCarry);
     registers.setFlag(Z80Registers::Flag::ParityOverflow, registers.BC != 0);
     registers.setFlag(Z80Registers::Flag::Subtract, true);
-    registers.updateFlagsRegister();
-    cycles += 16;
 }
 
 void Z80::IND() {
-    // TODO: Implement IN instruction
-    // uint8_t value = io.read(registers.C);
-    // memory.writeByte(registers.HL, value);
-    registers.B--;
+    memory.writeByte(registers.HL, ioBus.in(registers.BC));
     registers.HL--;
-    registers.setFlag(Z80Registers::Flag::Zero, registers.B == 0);
-    registers.setFlag(Z80Registers::Flag::Subtract, true);
-    registers.updateFlagsRegister();
-    cycles += 16;
+    registers.B--;
+    registers.setFlags(Z80Registers::Subtract | (registers.B ? 0 : Z80Registers::Zero));
 }
 
 void Z80::OUTD() {
-    // TODO: Implement OUT instruction
-    uint8_t value = memory.readByte(registers.HL);
-    // io.write(registers.C, value);
     registers.B--;
+    uint8_t value = memory.readByte(registers.HL);
     registers.HL--;
-    registers.setFlag(Z80Registers::Flag::Zero, registers.B == 0);
-    registers.setFlag(Z80Registers::Flag::Subtract, true);
-    registers.updateFlagsRegister();
-    cycles += 16;
+    ioBus.out(registers.BC, value);
+    registers.setFlags(Z80Registers::Subtract | (registers.B ? 0 : Z80Registers::Zero) |
+                       (registers.L + value > 255 ? (Z80Registers::Carry | Z80Registers::HalfCarry) : 0));
+}
+
+// --- Block transfer fast path ---
+// Once a repeating LDIR/LDDR/INIR/INDR/OTIR/OTDR has done its first pass, the
+// passes that would follow by re-dispatching the rewound instruction are done
+// here in bulk: as many as would start before the run() slice ends. BC, DE,
+// HL, flags, R and cycles come out exactly as if each pass had been
+// dispatched. Anything left over (slice end, a trapped page, a write over the
+// instruction itself) goes back to normal re-dispatch.
+
+// Bytes from address to the end of its page, walking in Step direction
+template<int Step>
+static uint32_t pageSpan(uint16_t address) {
+    const uint32_t offset = address & (Memory::PAGE_SIZE - 1);
+    return Step > 0 ? Memory::PAGE_SIZE - offset : offset + 1;
+}
+
+// T-states of one more pass of a repeating block instruction: its CYCLES_ED
+// entry, the wait states of both M1 fetches and the 5 T-states of the repeat
+int Z80::blockPassCycles(uint8_t opcode) const {
+    return CYCLES_ED[opcode] + 2 * m1WaitStates + 5;
+}
+
+uint32_t Z80::blockPasses(int passCycles, uint32_t count) const {
+    if (cycles >= sliceEnd) return 0;
+    const uint64_t passes = (sliceEnd - cycles + passCycles - 1) / passCycles;
+    return passes < count ? static_cast<uint32_t>(passes) : count;
+}
+
+// Passes that can write from address on without touching the two bytes of
+// the instruction at PC-2, which the next re-dispatch would fetch again.
+// None if the pass already run wrote there, just before address.
+template<int Step>
+uint32_t Z80::passesBeforeOpcode(uint16_t address) const {
+    const uint16_t opcode = registers.PC - 2;
+    if (static_cast<uint16_t>(address - Step - opcode) < 2) return 0;
+    const uint32_t first = static_cast<uint16_t>(Step * (opcode - address));
+    const uint32_t second = static_cast<uint16_t>(Step * (opcode + 1 - address));
+    return std::min(first, second);
+}
+
+void Z80::finishBlockPasses(uint32_t passes, int passCycles, bool repeating) {
+    // Every pass fetched ED and the opcode; the last one only pays for the
+    // repeat if it goes round again
+    registers.R = (registers.R & 0x80) | ((registers.R + 2 * passes) & 0x7F);
+    cycles += static_cast<uint64_t>(passes) * passCycles - (repeating ? 0 : 5);
+}
+
+template<int Step>
+void Z80::blockCopy(int passCycles) {
+    const uint32_t passes = blockPasses(passCycles, registers.BC);
+    uint32_t done = 0;
+    while (done < passes) {
+        const uint8_t* srcPage = memory.getDirectReadPage(registers.HL >> 13);
+        uint8_t* dstPage = memory.getDirectWritePage(registers.DE >> 13);
+        if (!srcPage || !dstPage) break;
+        const uint32_t count = std::min({passes - done, pageSpan<Step>(registers.HL),
+                                         pageSpan<Step>(registers.DE), passesBeforeOpcode<Step>(registers.DE)});
+        if (count == 0) break;
+
+        const uint8_t* src = srcPage + (registers.HL & (Memory::PAGE_SIZE - 1));
+        uint8_t* dst = dstPage + (registers.DE & (Memory::PAGE_SIZE - 1));
+        // With DE just past HL in the direction of the copy, LDIR/LDDR repeat
+        // the bytes they have already written, which memmove() would not
+        const uintptr_t from = reinterpret_cast<uintptr_t>(src);
+        const uintptr_t to = reinterpret_cast<uintptr_t>(dst);
+        if (Step > 0 ? (to > from && to - from < count) : (from > to && from - to < count)) {
+            for (int i = 0; i < static_cast<int>(count); ++i) {
+                dst[Step * i] = src[Step * i];
+            }
+        } else if (Step > 0) {
+            std::memmove(dst, src, count);
+        } else {
+            std::memmove(dst - (count - 1), src - (count - 1), count);
+        }
+
+        registers.HL += Step * static_cast<int>(count);
+        registers.DE += Step * static_cast<int>(count);
+        registers.BC -= count;
+        done += count;
+    }
+    if (done == 0) return;
+    registers.setFlag(Z80Registers::Flag::ParityOverflow, registers.BC != 0);
+    finishBlockPasses(done, passCycles, registers.BC != 0);
+}
+
+// INIR/INDR and OTIR/OTDR are only batched for ports with a block handler:
+// other devices may remap memory from their port writes, so they keep seeing
+// one access per dispatched pass
+template<int Step>
+void Z80::blockIn(int passCycles) {
+    const uint8_t port = registers.C;
+    if (!ioBus.hasInBlock(port)) return;
+    const uint32_t passes = blockPasses(passCycles, registers.B);
+    std::array<uint8_t, 256> buffer;
+    uint32_t done = 0;
+    while (done < passes) {
+        uint8_t* page = memory.getDirectWritePage(registers.HL >> 13);
+        if (!page) break;
+        const uint32_t count = std::min({passes - done, pageSpan<Step>(registers.HL),
+                                         passesBeforeOpcode<Step>(registers.HL)});
+        if (count == 0) break;
+
+        uint8_t* dst = page + (registers.HL & (Memory::PAGE_SIZE - 1));
+        if (Step > 0) {
+            ioBus.inBlock(port, dst, count);
+        } else {
+            ioBus.inBlock(port, buffer.data(), count);
+            for (int i = 0; i < static_cast<int>(count); ++i) {
+                dst[-i] = buffer[i];
+            }
+        }
+
+        registers.HL += Step * static_cast<int>(count);
+        registers.B -= count;
+        done += count;
+    }
+    if (done == 0) return;
+    registers.setFlags(Z80Registers::Subtract | (registers.B ? 0 : Z80Registers::Zero));
+    finishBlockPasses(done, passCycles, registers.B != 0);
+}
+
+template<int Step>
+void Z80::blockOut(int passCycles) {
+    const uint8_t port = registers.C;
+    if (!ioBus.hasOutBlock(port)) return;
+    const uint32_t passes = blockPasses(passCycles, registers.B);
+    std::array<uint8_t, 256> buffer;
+    uint8_t value = 0;
+    uint32_t done = 0;
+    while (done < passes) {
+        const uint8_t* page = memory.getDirectReadPage(registers.HL >> 13);
+        if (!page) break;
+        const uint32_t count = std::min(passes - done, pageSpan<Step>(registers.HL));
+
+        const uint8_t* src = page + (registers.HL & (Memory::PAGE_SIZE - 1));
+        if (Step > 0) {
+            ioBus.outBlock(port, src, count);
+            value = src[count - 1];
+        } else {
+            for (int i = 0; i < static_cast<int>(count); ++i) {
+                buffer[i] = src[-i];
+            }
+            ioBus.outBlock(port, buffer.data(), count);
+            value = buffer[count - 1];
+        }
+
+        registers.HL += Step * static_cast<int>(count);
+        registers.B -= count;
+        done += count;
+    }
+    if (done == 0) return;
+    registers.setFlags(Z80Registers::Subtract | (registers.B ? 0 : Z80Registers::Zero) |
+                       (registers.L + value > 255 ? (Z80Registers::Carry | Z80Registers::HalfCarry) : 0));
+    finishBlockPasses(done, passCycles, registers.B != 0);
 }
 
+// The repeating forms charge 5 T-states on top of CYCLES_ED when they go
+// round again. LDIR/LDDR/INIR/INDR/OTIR/OTDR then run the following passes in
+// bulk, see blockCopy() and blockIn()/blockOut().
 void Z80::LDIR() {
     LDI();
     if (registers.BC != 0) {
-        registers.PC -= 2;
-        cycles += 21;  // 5 extra cycles if operation repeats
-    } else {
-        cycles += 16;
+        cycles += 5;
+        blockCopy<1>(blockPassCycles(0xB0));
+        if (registers.BC != 0) registers.PC -= 2;
     }
 }
 
@@ -2149,39 +1786,34 @@ void Z80::CPIR() {
     CPI();
     if (registers.BC != 0 && !registers.getFlag(Z80Registers::Flag::Zero)) {
         registers.PC -= 2;
-        cycles += 21;  // 5 extra cycles if operation repeats
-    } else {
-        cycles += 16;
+        cycles += 5;
     }
 }
 
 void Z80::INIR() {
     INI();
     if (registers.B != 0) {
-        registers.PC -= 2;
-        cycles += 21;  // 5 extra cycles if operation repeats
-    } else {
-        cycles += 16;
+        cycles += 5;
+        blockIn<1>(blockPassCycles(0xB2));
+        if (registers.B != 0) registers.PC -= 2;
     }
 }
 
 void Z80::OTIR() {
     OUTI();
     if (registers.B != 0) {
-        registers.PC -= 2;
-        cycles += 21;  // 5 extra cycles if operation repeats
-    } else {
-        cycles += 16;
+        cycles += 5;
+        blockOut<1>(blockPassCycles(0xB3));
+        if (registers.B != 0) registers.PC -= 2;
     }
 }
 
 void Z80::LDDR() {
     LDD();
     if (registers.BC != 0) {
-        registers.PC -= 2;
-        cycles += 21;  // 5 extra cycles if operation repeats
-    } else {
-        cycles += 16;
+        cycles += 5;
+        blockCopy<-1>(blockPassCycles(0xB8));
+        if (registers.BC != 0) registers.PC -= 2;
     }
 }
 
@@ -2189,29 +1821,25 @@ void Z80::CPDR() {
     CPD();
     if (registers.BC != 0 && !registers.getFlag(Z80Registers::Flag::Zero)) {
         registers.PC -= 2;
-        cycles += 21;  // 5 extra cycles if operation repeats
-    } else {
-        cycles += 16;
+        cycles += 5;
     }
 }
 
 void Z80::INDR() {
     IND();
     if (registers.B != 0) {
-        registers.PC -= 2;
-        cycles += 21;  // 5 extra cycles if operation repeats
-    } else {
-        cycles += 16;
+        cycles += 5;
+        blockIn<-1>(blockPassCycles(0xBA));
+        if (registers.B != 0) registers.PC -= 2;
     }
 }
 
 void Z80::OTDR() {
     OUTD();
     if (registers.B != 0) {
-        registers.PC -= 2;
-        cycles += 21;  // 5 extra cycles if operation repeats
-    } else {
-        cycles += 16;
+        cycles += 5;
+        blockOut<-1>(blockPassCycles(0xBB));
+        if (registers.B != 0) registers.PC -= 2;
     }
 }
 
@@ -2222,8 +1850,6 @@ void Z80::LD_A_I() {
     registers.setFlag(Z80Registers::Flag::HalfCarry, false);
     registers.setFlag(Z80Registers::Flag::ParityOverflow, registers.IFF2);
     registers.setFlag(Z80Registers::Flag::Subtract, false);
-    registers.updateFlagsRegister();
-    cycles += 9;
 }
 
 void Z80::LD_A_R() {
@@ -2233,44 +1859,32 @@ void Z80::LD_A_R() {
     registers.setFlag(Z80Registers::Flag::HalfCarry, false);
     registers.setFlag(Z80Registers::Flag::ParityOverflow, registers.IFF2);
     registers.setFlag(Z80Registers::Flag::Subtract, false);
-    registers.updateFlagsRegister();
-    cycles += 9;
 }
 
 // DD/FD prefixed instructions (IX/IY instructions)
 void Z80::LD_IXIY_nn(uint16_t& indexReg) {
     indexReg = fetchWord();
-    cycles += 14;
 }
 
 void Z80::LD_inn_IXIY(uint16_t& indexReg) {
     uint16_t address = fetchWord();
     memory.writeWord(address, indexReg);
-    cycles += 20;
 }
 
 void Z80::INC_IXIY(uint16_t& indexReg) {
     indexReg++;
-    cycles += 10;
 }
 
 void Z80::INC_IXIYH(uint8_t& reg) {
-    bool halfCarry = ((reg & 0x0F) == 0x0F);
-    reg++;
-    updateFlagsArithmetic(reg, false, false, halfCarry, reg == 0x80);
-    cycles += 8;
+    reg = aluInc(reg);
 }
 
 void Z80::DEC_IXIYH(uint8_t& reg) {
-    bool halfCarry = ((reg & 0x0F) == 0x00);
-    reg--;
-    updateFlagsArithmetic(reg, true, false, halfCarry, reg == 0x7F);
-    cycles += 8;
+    reg = aluDec(reg);
 }
 
 void Z80::LD_IXIYH_n(uint8_t& reg, uint8_t value) {
     reg = value;
-    cycles += 11;
 }
 
 void Z80::ADD_IXIY_ss(uint16_t& indexReg, uint16_t& otherReg) {
@@ -2280,336 +1894,215 @@ void Z80::ADD_IXIY_ss(uint16_t& indexReg, uint16_t& otherReg) {
     registers.setFlag(Z80Registers::Flag::Subtract, false);
     registers.setFlag(Z80Registers::Flag::HalfCarry, halfCarry);
     registers.setFlag(Z80Registers::Flag::Carry, result > 0xFFFF);
-    registers.updateFlagsRegister();
-    cycles += 15;
 }
 
 void Z80::LD_IXIY_inn(uint16_t& indexReg) {
     uint16_t address = fetchWord();
     indexReg = memory.readWord(address);
-    cycles += 20;
 }
 
 void Z80::DEC_IXIY(uint16_t& indexReg) {
     indexReg--;
-    cycles += 10;
 }
 
 void Z80::INC_IXIYL(uint8_t& reg) {
-    bool halfCarry = ((reg & 0x0F) == 0x0F);
-    reg++;
-    updateFlagsArithmetic(reg, false, false, halfCarry, reg == 0x80);
-    cycles += 8;
+    reg = aluInc(reg);
 }
 
 void Z80::DEC_IXIYL(uint8_t& reg) {
-    bool halfCarry = ((reg & 0x0F) == 0x00);
-    reg--;
-    updateFlagsArithmetic(reg, true, false, halfCarry, reg == 0x7F);
-    cycles += 8;
+    reg = aluDec(reg);
 }
 
 void Z80::LD_IXIYL_n(uint8_t& reg, uint8_t value) {
     reg = value;
-    cycles += 11;
 }
 
 void Z80::LD_r_IXIYd(uint8_t& reg, uint16_t& indexReg) {
     int8_t displacement = signExtend(fetchByte());
     uint16_t address = indexReg + displacement;
     reg = memory.readByte(address);
-    cycles += 19;
 }
 
 void Z80::LD_IXIYd_r(uint16_t& indexReg, uint8_t& reg) {
     int8_t displacement = signExtend(fetchByte());
     uint16_t address = indexReg + displacement;
     memory.writeByte(address, reg);
-    cycles += 19;
 }
 
-void Z80::LD_IXIYd_n(uint16_t& indexReg, uint8_t value) {
+void Z80::LD_IXIYd_n(uint16_t& indexReg) {
     int8_t displacement = signExtend(fetchByte());
+    uint8_t value = fetchByte();
     uint16_t address = indexReg + displacement;
     memory.writeByte(address, value);
-    cycles += 19;
 }
 
 void Z80::ADD_A_IXIYd(uint16_t& indexReg) {
     int8_t displacement = signExtend(fetchByte());
     uint16_t address = indexReg + displacement;
     uint8_t value = memory.readByte(address);
-    uint16_t result = registers.A + value;
-    bool halfCarry = ((registers.A & 0x0F) + (value & 0x0F)) > 0x0F;
-    bool overflow = ((registers.A ^ value) & 0x80) == 0 && ((registers.A ^ result) & 0x80) != 0;
-    registers.A = (uint8_t)result;
-    updateFlagsArithmetic(registers.A, false, result > 0xFF, halfCarry, overflow);
-    cycles += 19;
+    aluAdd(value, 0);
 }
 
 void Z80::ADC_A_IXIYd(uint16_t& indexReg) {
     int8_t displacement = signExtend(fetchByte());
     uint16_t address = indexReg + displacement;
     uint8_t value = memory.readByte(address);
-    uint8_t carry = registers.getFlag(Z80Registers::Flag::Carry);
-    uint16_t result = registers.A + value + carry;
-    bool halfCarry = ((registers.A & 0x0F) + (value & 0x0F) + carry) > 0x0F;
-    bool overflow = ((registers.A ^ value) & 0x80) == 0 && ((registers.A ^ result) & 0x80) != 0;
-    registers.A = (uint8_t)result;
-    updateFlagsArithmetic(registers.A, false, result > 0xFF, halfCarry, overflow);
-    cycles += 19;
+    aluAdd(value, registers.getFlag(Z80Registers::Carry));
 }
 
 void Z80::SUB_IXIYd(uint16_t& indexReg) {
     int8_t displacement = signExtend(fetchByte());
     uint16_t address = indexReg + displacement;
     uint8_t value = memory.readByte(address);
-    uint8_t result = registers.A - value;
-    bool halfCarry = (registers.A & 0x0F) < (value & 0x0F);
-    bool overflow = ((registers.A ^ value) & 0x80) != 0 && ((registers.A ^ result) & 0x80) != 0;
-    registers.A = result;
-    updateFlagsArithmetic(registers.A, true, false, halfCarry, overflow);
-    cycles += 19;
+    aluSub(value, 0);
 }
 
 void Z80::SBC_A_IXIYd(uint16_t& indexReg) {
     int8_t displacement = signExtend(fetchByte());
     uint16_t address = indexReg + displacement;
     uint8_t value = memory.readByte(address);
-    uint8_t carry = registers.getFlag(Z80Registers::Flag::Carry);
-    uint8_t result = registers.A - value - carry;
-    bool halfCarry = (registers.A & 0x0F) < ((value & 0x0F) + carry);
-    bool overflow = ((registers.A ^ value) & 0x80) != 0 && ((registers.A ^ result) & 0x80) != 0;
-    registers.A = result;
-    updateFlagsArithmetic(registers.A, true, false, halfCarry, overflow);
-    cycles += 19;
+    aluSub(value, registers.getFlag(Z80Registers::Carry));
 }
 
 void Z80::AND_IXIYd(uint16_t& indexReg) {
     int8_t displacement = signExtend(fetchByte());
     uint16_t address = indexReg + displacement;
     uint8_t value = memory.readByte(address);
-    registers.A &= value;
-    updateFlagsLogical(registers.A, false, true);
-    cycles += 19;
+    aluAnd(value);
 }
 
 void Z80::XOR_IXIYd(uint16_t& indexReg) {
     int8_t displacement = signExtend(fetchByte());
     uint16_t address = indexReg + displacement;
     uint8_t value = memory.readByte(address);
-    registers.A ^= value;
-    updateFlagsLogical(registers.A, false, false);
-    cycles += 19;
+    aluXor(value);
 }
 
 void Z80::OR_IXIYd(uint16_t& indexReg) {
     int8_t displacement = signExtend(fetchByte());
     uint16_t address = indexReg + displacement;
     uint8_t value = memory.readByte(address);
-    registers.A |= value;
-    updateFlagsLogical(registers.A, false, false);
-    cycles += 19;
+    aluOr(value);
 }
 
 void Z80::CP_IXIYd(uint16_t& indexReg) {
     int8_t displacement = signExtend(fetchByte());
     uint16_t address = indexReg + displacement;
     uint8_t value = memory.readByte(address);
-    uint8_t result = registers.A - value;
-    bool halfCarry = (registers.A & 0x0F) < (value & 0x0F);
-    bool overflow = ((registers.A ^ value) & 0x80) != 0 && ((registers.A ^ result) & 0x80) != 0;
-    updateFlagsArithmetic(result, true, false, halfCarry, overflow);
-    registers.setFlag(Z80Registers::Flag::Subtract, true);
-    registers.updateFlagsRegister();
-    cycles += 19;
+    aluCompare(value);
 }
 
 void Z80::INC_IXIYd(uint16_t& indexReg) {
     int8_t displacement = signExtend(fetchByte());
     uint16_t address = indexReg + displacement;
     uint8_t value = memory.readByte(address);
-    bool halfCarry = ((value & 0x0F) == 0x0F);
-    value++;
+    value = aluInc(value);
     memory.writeByte(address, value);
-    updateFlagsArithmetic(value, false, false, halfCarry, value == 0x80);
-    cycles += 23;
 }
 
 void Z80::DEC_IXIYd(uint16_t& indexReg) {
     int8_t displacement = signExtend(fetchByte());
     uint16_t address = indexReg + displacement;
     uint8_t value = memory.readByte(address);
-    bool halfCarry = ((value & 0x0F) == 0x00);
-    value--;
+    value = aluDec(value);
     memory.writeByte(address, value);
-    updateFlagsArithmetic(value, true, false, halfCarry, value == 0x7F);
-    cycles += 23;
 }
 
 void Z80::JP_iIXIY(uint16_t& indexReg) {
     registers.PC = indexReg;
-    cycles += 8;
 }
 
 void Z80::LD_SP_IXIY(uint16_t& indexReg) {
     registers.SP = indexReg;
-    cycles += 10;
 }
 
 void Z80::EX_iSP_IXIY(uint16_t& indexReg) {
     uint16_t temp = memory.readWord(registers.SP);
     memory.writeWord(registers.SP, indexReg);
     indexReg = temp;
-    cycles += 23;
 }
 
 // CB prefixed IX/IY instructions
-void Z80::RLC_IXIYd(uint16_t& indexReg) {
-    int8_t displacement = signExtend(fetchByte());
-    uint16_t address = indexReg + displacement;
+void Z80::RLC_IXIYd(uint16_t address) {
     uint8_t value = memory.readByte(address);
     uint8_t bit7 = (value >> 7) & 1;
     value = (value << 1) | bit7;
     memory.writeByte(address, value);
-    registers.setFlag(Z80Registers::Flag::Carry, bit7);
-    registers.setFlag(Z80Registers::Flag::HalfCarry, false);
-    registers.setFlag(Z80Registers::Flag::Subtract, false);
-    updateFlags_SZP(value);
-    registers.updateFlagsRegister();
-    cycles += 23;
+    registers.setFlags(PZS_TABLE[value] | bit7);
 }
 
-void Z80::RRC_IXIYd(uint16_t& indexReg) {
-    int8_t displacement = signExtend(fetchByte());
-    uint16_t address = indexReg + displacement;
+void Z80::RRC_IXIYd(uint16_t address) {
     uint8_t value = memory.readByte(address);
     uint8_t bit0 = value & 1;
     value = (value >> 1) | (bit0 << 7);
     memory.writeByte(address, value);
-    registers.setFlag(Z80Registers::Flag::Carry, bit0);
-    registers.setFlag(Z80Registers::Flag::HalfCarry, false);
-    registers.setFlag(Z80Registers::Flag::Subtract, false);
-    updateFlags_SZP(value);
-    registers.updateFlagsRegister();
-    cycles += 23;
+    registers.setFlags(PZS_TABLE[value] | bit0);
 }
 
-void Z80::RL_IXIYd(uint16_t& indexReg) {
-    int8_t displacement = signExtend(fetchByte());
-    uint16_t address = indexReg + displacement;
+void Z80::RL_IXIYd(uint16_t address) {
     uint8_t value = memory.readByte(address);
     uint8_t carry = registers.getFlag(Z80Registers::Flag::Carry);
     uint8_t bit7 = (value >> 7) & 1;
     value = (value << 1) | carry;
     memory.writeByte(address, value);
-    registers.setFlag(Z80Registers::Flag::Carry, bit7);
-    registers.setFlag(Z80Registers::Flag::HalfCarry, false);
-    registers.setFlag(Z80Registers::Flag::Subtract, false);
-    updateFlags_SZP(value);
-    registers.updateFlagsRegister();
-    cycles += 23;
+    registers.setFlags(PZS_TABLE[value] | bit7);
 }
 
-void Z80::RR_IXIYd(uint16_t& indexReg) {
-    int8_t displacement = signExtend(fetchByte());
-    uint16_t address = indexReg + displacement;
+void Z80::RR_IXIYd(uint16_t address) {
     uint8_t value = memory.readByte(address);
     uint8_t carry = registers.getFlag(Z80Registers::Flag::Carry);
     uint8_t bit0 = value & 1;
     value = (value >> 1) | (carry << 7);
     memory.writeByte(address, value);
-    registers.setFlag(Z80Registers::Flag::Carry, bit0);
-    registers.setFlag(Z80Registers::Flag::HalfCarry, false);
-    registers.setFlag(Z80Registers::Flag::Subtract, false);
-    updateFlags_SZP(value);
-    registers.updateFlagsRegister();
-    cycles += 23;
+    registers.setFlags(PZS_TABLE[value] | bit0);
 }
 
-void Z80::SLA_IXIYd(uint16_t& indexReg) {
-    int8_t displacement = signExtend(fetchByte());
-    uint16_t address = indexReg + displacement;
+void Z80::SLA_IXIYd(uint16_t address) {
     uint8_t value = memory.readByte(address);
     uint8_t bit7 = (value >> 7) & 1;
     value <<= 1;
     memory.writeByte(address, value);
-    registers.setFlag(Z80Registers::Flag::Carry, bit7);
-    registers.setFlag(Z80Registers::Flag::HalfCarry, false);
-    registers.setFlag(Z80Registers::Flag::Subtract, false);
-    updateFlags_SZP(value);
-    registers.updateFlagsRegister();
-    cycles += 23;
+    registers.setFlags(PZS_TABLE[value] | bit7);
 }
 
-void Z80::SRA_IXIYd(uint16_t& indexReg) {
-    int8_t displacement = signExtend(fetchByte());
-    uint16_t address = indexReg + displacement;
+void Z80::SRA_IXIYd(uint16_t address) {
     uint8_t value = memory.readByte(address);
     uint8_t bit0 = value & 1;
     uint8_t bit7 = value & 0x80;
     value = (value >> 1) | bit7;
     memory.writeByte(address, value);
-    registers.setFlag(Z80Registers::Flag::Carry, bit0);
-    registers.setFlag(Z80Registers::Flag::HalfCarry, false);
-    registers.setFlag(Z80Registers::Flag::Subtract, false);
-    updateFlags_SZP(value);
-    registers.updateFlagsRegister();
-    cycles += 23;
+    registers.setFlags(PZS_TABLE[value] | bit0);
 }
 
-void Z80::SLL_IXIYd(uint16_t& indexReg) {
-    int8_t displacement = signExtend(fetchByte());
-    uint16_t address = indexReg + displacement;
+void Z80::SLL_IXIYd(uint16_t address) {
     uint8_t value = memory.readByte(address);
     uint8_t bit7 = (value >> 7) & 1;
     value = (value << 1) | 1;
     memory.writeByte(address, value);
-    registers.setFlag(Z80Registers::Flag::Carry, bit7);
-    registers.setFlag(Z80Registers::Flag::HalfCarry, false);
-    registers.setFlag(Z80Registers::Flag::Subtract, false);
-    updateFlags_SZP(value);
-    registers.updateFlagsRegister();
-    cycles += 23;
+    registers.setFlags(PZS_TABLE[value] | bit7);
 }
 
-void Z80::SRL_IXIYd(uint16_t& indexReg) {
-    int8_t displacement = signExtend(fetchByte());
-    uint16_t address = indexReg + displacement;
+void Z80::SRL_IXIYd(uint16_t address) {
     uint8_t value = memory.readByte(address);
     uint8_t bit0 = value & 1;
     value >>= 1;
     memory.writeByte(address, value);
-    registers.setFlag(Z80Registers::Flag::Carry, bit0);
-    registers.setFlag(Z80Registers::Flag::HalfCarry, false);
-    registers.setFlag(Z80Registers::Flag::Subtract, false);
-    updateFlags_SZP(value);
-    registers.updateFlagsRegister();
-    cycles += 23;
+    registers.setFlags(PZS_TABLE[value] | bit0);
 }
 
-void Z80::BIT_b_IXIYd(uint8_t bit, uint16_t& indexReg) {
-    int8_t displacement = signExtend(fetchByte());
-    uint16_t address = indexReg + displacement;
+void Z80::BIT_b_IXIYd(uint8_t bit, uint16_t address) {
     uint8_t value = memory.readByte(address);
     checkBit(value, bit);
-    cycles += 20;
 }
 
-void Z80::RES_b_IXIYd(uint8_t bit, uint16_t& indexReg) {
-    int8_t displacement = signExtend(fetchByte());
-    uint16_t address = indexReg + displacement;
+void Z80::RES_b_IXIYd(uint8_t bit, uint16_t address) {
     uint8_t value = memory.readByte(address);
     value &= ~(1 << bit);
     memory.writeByte(address, value);
-    cycles += 23;
 }
 
-void Z80::SET_b_IXIYd(uint8_t bit, uint16_t& indexReg) {
-    int8_t displacement = signExtend(fetchByte());
-    uint16_t address = indexReg + displacement;
+void Z80::SET_b_IXIYd(uint8_t bit, uint16_t address) {
     uint8_t value = memory.readByte(address);
     value |= (1 << bit);
     memory.writeByte(address, value);
-    cycles += 23;
 }
@@ -2,10 +2,24 @@
 #ifndef Z80_HPP
 #define Z80_HPP
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <utility>
 #include <vector>
 #include "Z80Registers.hpp"
+#include "Z80JIT.hpp"
 #include "../memory/Memory.hpp" // Adjust path as needed
+#include "../io/IOBus.hpp"
+
+// Building with Z80_NO_BLOCK_CACHE leaves only the plain interpreter, e.g.
+// to rule the cache out when chasing a bug.
+#ifdef Z80_NO_BLOCK_CACHE
+constexpr bool Z80_BLOCK_CACHE = false;
+#else
+constexpr bool Z80_BLOCK_CACHE = true;
+#endif
 
 class Z80 {
 public:
@@ -13,28 +27,91 @@ public:
 
     void reset();
     void executeInstruction();
+    // Execute for at least cycleBudget T-states, like fMSX's ExecZ80(), and
+    // return how many T-states the last instruction overshot the budget by.
+    // Interrupts are only taken at the start of the slice and right after the
+    // instruction that follows EI. HALT burns the rest of the slice.
+    int run(int cycleBudget);
     void loadProgram(const std::vector<uint8_t>& program, uint16_t startAddress);
+    void setProgramCounter(uint16_t address) { registers.PC = address; }
     uint64_t getCycleCount() const { return cycles; } // Add a getter for cycle count
+    IOBus& getIOBus() { return ioBus; }                // Devices for IN/OUT are mapped here
+
+    // T-states come from the CYCLES_* tables in Z80Tables.hpp and nowhere
+    // else. On top of them every M1 cycle (opcode and prefix fetches,
+    // interrupt acknowledge) gets this many wait states: one on the MSX,
+    // zero for a bare Z80.
+    static const uint8_t MSX_M1_WAIT_STATES = 1;
+    void setM1WaitStates(uint8_t states);
+    uint8_t getM1WaitStates() const { return m1WaitStates; }
+
+    // run() executes pre-decoded blocks where it can. Turning the cache off
+    // gives the same results, only slower.
+    void setBlockCacheEnabled(bool enabled);
+
+    // Blocks that have run JIT_THRESHOLD times are compiled to x86-64 code
+    // (see Z80JIT.hpp). Off by default; it needs the block cache, and
+    // enabling it is a no-op where isJITAvailable() is false.
+    void setJITEnabled(bool enabled);
+    bool isJITAvailable() const { return jit && jit->isAvailable(); }
+
     // Optional: For debugging and inspection
-    const Z80Registers& getRegisters() const { return registers; }
+    // Flushes pending ALU flags first, so F/AF read back by callers is exact
+    const Z80Registers& getRegisters() { registers.flushFlags(); return registers; }
     void setInterruptLine(bool high); // Add a function to set the interrupt line state
     bool nmi_line; // Add this variable to the class. Non-maskable interrupt line
 
 private:
     Z80Registers registers;
     Memory& memory;
+    IOBus ioBus;
     bool halted;
     uint64_t cycles;
+    uint8_t m1WaitStates;   // Extra T-states per M1 cycle
+    uint16_t indexAddress;  // IX+d / IY+d latched by a DD CB / FD CB prefix
+    uint64_t sliceEnd;      // Cycle count at which run() returns; EI and HALT cut it short
+    uint64_t eiSliceEnd;    // sliceEnd saved by EI while the next instruction runs
+    bool afterEI;           // EI has shortened the slice to one instruction
+    bool blockCacheEnabled;
 
     // --- Instruction Fetching and Decoding ---
+    // Every opcode page is a 256-entry table of member-function pointers,
+    // generated at compile time from the op*<> templates in Z80.cpp. Cycle
+    // counts for each page live in Z80Tables.hpp.
+    using OpHandler = void (Z80::*)();
+    static const std::array<OpHandler, 256> MAIN_OPS;      // Unprefixed
+    static const std::array<OpHandler, 256> CB_OPS;        // 0xCB
+    static const std::array<OpHandler, 256> ED_OPS;        // 0xED
+    static const std::array<OpHandler, 256> IX_OPS;        // 0xDD
+    static const std::array<OpHandler, 256> IY_OPS;        // 0xFD
+    static const std::array<OpHandler, 256> INDEX_CB_OPS;  // 0xDD 0xCB / 0xFD 0xCB
+
     uint8_t fetchOpcode();
-    int decodeAndExecuteMainInstruction(uint8_t opcode);
-    int decodeAndExecuteCBInstruction(uint8_t opcode);
-    int decodeAndExecuteEDInstruction(uint8_t opcode);
-    int decodeAndExecuteDDInstruction(uint8_t opcode); // Instructions prefixed with 0xDD (IX-related)
-    int decodeAndExecuteFDInstruction(uint8_t opcode); // Instructions prefixed with 0xFD (IY-related)
-    int decodeAndExecuteDDFDInstruction(uint8_t opcode, uint16_t& indexRegister); // Instructions prefixed with 0xDD or 0xFD
-    int decodeAndExecuteDDFDCBInstruction(uint8_t opcode, uint16_t& indexRegister); // Instructions prefixed with 0xDD or 0xFD
+    void executeCB();
+    void executeED();
+    template<bool UseIY> void executeIndex();
+    template<bool UseIY> void executeIndexCB();
+
+    template<uint8_t Op> void opMain();
+    template<uint8_t Op> void opCB();
+    template<uint8_t Op> void opED();
+    template<uint8_t Op, bool UseIY> void opIndex();
+    template<uint8_t Op> void opIndexCB();
+
+    template<size_t... Op> static constexpr std::array<OpHandler, 256> makeMainTable(std::index_sequence<Op...>);
+    template<size_t... Op> static constexpr std::array<OpHandler, 256> makeCBTable(std::index_sequence<Op...>);
+    template<size_t... Op> static constexpr std::array<OpHandler, 256> makeEDTable(std::index_sequence<Op...>);
+    template<bool UseIY, size_t... Op> static constexpr std::array<OpHandler, 256> makeIndexTable(std::index_sequence<Op...>);
+    template<size_t... Op> static constexpr std::array<OpHandler, 256> makeIndexCBTable(std::index_sequence<Op...>);
+
+    // --- Operand selectors (decoded from opcode bit fields) ---
+    template<int R> uint8_t& reg8();                 // B, C, D, E, H, L, -, A
+    template<int R, bool UseIY> uint8_t& reg8x();    // As reg8, with H/L replaced by IXH/IXL or IYH/IYL
+    template<int P> uint16_t& reg16();               // BC, DE, HL, SP
+    template<int P> uint16_t& reg16af();             // BC, DE, HL, AF
+    template<bool UseIY> uint16_t& indexReg();       // IX or IY
+    template<int CC> bool condition() const;         // NZ, Z, NC, C, PO, PE, P, M
+    template<int Y> void aluOp(uint8_t& r);          // ADD, ADC, SUB, SBC, AND, XOR, OR, CP
 
     // --- Helper functions ---
     uint8_t fetchByte();
@@ -44,15 +121,65 @@ private:
     uint8_t popByte();
     void pushWord(uint16_t value);
     uint16_t popWord();
-    void updateFlags(uint8_t result, bool isSubtraction = false, bool is16Bit = false);
     void updateFlags_SZP(uint8_t value);
-    void updateFlagsArithmetic(uint8_t result, bool isSubtraction = false, bool carry = false, bool halfCarry = false, bool overflow = false);
-    void updateFlagsLogical(uint8_t result, bool carry = false, bool halfCarry = false);
-    void calculateParity(uint8_t value);
     void checkBit(uint8_t value, uint8_t bit);
 
+    // --- 8-bit ALU (flags are evaluated lazily by Z80Registers) ---
+    void aluAdd(uint8_t value, uint8_t carry);   // ADD/ADC A,value
+    void aluSub(uint8_t value, uint8_t carry);   // SUB/SBC A,value
+    void aluCompare(uint8_t value);              // CP value
+    void aluAnd(uint8_t value);
+    void aluXor(uint8_t value);
+    void aluOr(uint8_t value);
+    uint8_t aluInc(uint8_t value);
+    uint8_t aluDec(uint8_t value);
+
+    // --- Block cache ---
+    // Straight-line runs of instructions decoded once per 8KB page and start
+    // offset: the final handler with all prefixes resolved, where its
+    // operands start, and the T-states and R increments of the fetches.
+    // Handlers still read their operands from memory, which the page
+    // generation guarantees has not changed since decoding.
+    struct CachedOp {
+        OpHandler handler;
+        uint16_t operandPC;     // PC the handler runs with
+        uint16_t nextPC;        // PC after the instruction when it falls through
+        uint8_t cycles;         // Table T-states plus M1 wait states
+        uint8_t fetches;        // M1 cycles, i.e. R increments
+        uint8_t index;          // DD CB / FD CB: 1 for IX, 2 for IY, else 0
+        int8_t displacement;    // DD CB d / FD CB d
+    };
+    struct CachedBlock {
+        uint32_t generation;    // Memory::getPageGeneration() when decoded
+        uint32_t runs;          // Since decoding, counts up to JIT_THRESHOLD
+        Z80JIT::BlockFunction compiled;
+        std::vector<CachedOp> ops;
+    };
+    static const size_t MAX_BLOCK_OPS = 32;
+    static const uint32_t JIT_THRESHOLD = 64;
+    std::array<std::vector<std::unique_ptr<CachedBlock>>, Memory::NUM_PAGES> blockCache;
+
+    bool runBlock();
+    void decodeBlock(uint16_t pc, CachedBlock& block);
+    bool decodeOp(const uint8_t* page, unsigned offset, CachedOp& op, unsigned& length, bool& endsBlock) const;
+    void flushBlockCache();
+
+    std::unique_ptr<Z80JIT> jit;    // Created on first use
+    bool jitEnabled;
+    void compileBlock(CachedBlock& block);
+
+    // --- Block transfer fast path (LDIR/LDDR/INIR/INDR/OTIR/OTDR) ---
+    int blockPassCycles(uint8_t opcode) const;
+    uint32_t blockPasses(int passCycles, uint32_t count) const;
+    template<int Step> uint32_t passesBeforeOpcode(uint16_t address) const;
+    void finishBlockPasses(uint32_t passes, int passCycles, bool repeating);
+    template<int Step> void blockCopy(int passCycles);
+    template<int Step> void blockIn(int passCycles);
+    template<int Step> void blockOut(int passCycles);
+
     // --- Interrupt Handling ---
     void handleInterrupts();
+    void acknowledgeInterrupt();
     bool checkForInterrupts();
     void generateInterrupt(uint16_t address);
     bool interrupt_pending; // Add a flag to indicate if an interrupt is pending
@@ -66,7 +193,6 @@ private:
     void EX_iSP_HL();
     void LD_A_I();
     void LD_A_R();
-    void ADD_IX_pp(uint16_t& pp);
     
     // --- Instruction Implementations ---
     void NOP();                                     // 0x00
@@ -88,16 +214,13 @@ private:
     void RLA();                                     // 0x17
     void JR_d8();                                   // 0x18
     void RRA();                                     // 0x1F
-    void JR_NZ_d8();                                // 0x20
+    void JR_cc_d8(bool condition);                  // 0x20, 0x28, 0x30, 0x38
     void LD_HL_d16();                               // 0x21
     void LD_inn_HL();                               // 0x22
-    void JR_Z_d8();                                 // 0x28
     void DAA();                                     // 0x27
     void CPL();                                     // 0x2F
-    void JR_NC_d8();                                // 0x30
     void LD_SP_d16();                               // 0x31
     void LD_inn_A();                                // 0x32
-    void JR_C_d8();                                 // 0x38
     void SCF();                                     // 0x37
     void CCF();                                     // 0x3F
     void LD_r_r(uint8_t& dst, uint8_t& src);        // 0x40-0x7F (except 0x76)
@@ -128,7 +251,7 @@ private:
     void SBC_A_n(uint8_t value);                    // 0xDE
     void EX_DE_HL();                                // 0xEB
     void JP_iHL();                                  // 0xE9
-    void LD_iSP_HL();                               // 0xF9
+    void LD_SP_HL();                                // 0xF9
     void DI();                                      // 0xF3
     void AND_n(uint8_t value);                       // 0xE6
     void EI();                                      // 0xFB
@@ -222,7 +345,7 @@ private:
     void LD_IXIYL_n(uint8_t& reg, uint8_t value);   // 0x2E
     void LD_r_IXIYd(uint8_t& reg, uint16_t& indexReg); // 0x46, 0x4E, 0x56, 0x5E, 0x66, 0x6E, 0x7E
     void LD_IXIYd_r(uint16_t& indexReg, uint8_t& reg); // 0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x77
-    void LD_IXIYd_n(uint16_t& indexReg, uint8_t value); // 0x36
+    void LD_IXIYd_n(uint16_t& indexReg);            // 0x36
     void ADD_A_IXIYd(uint16_t& indexReg);           // 0x86
     void ADC_A_IXIYd(uint16_t& indexReg);           // 0x8E
     void SUB_IXIYd(uint16_t& indexReg);             // 0x96
@@ -237,18 +360,18 @@ private:
     void LD_SP_IXIY(uint16_t& indexReg);            // 0xF9
     void EX_iSP_IXIY(uint16_t& indexReg);           // 0xE3
 
-    // 0xDD/FD CB Prefixed Extended Instructions
-    void RLC_IXIYd(uint16_t& indexReg);
-    void RRC_IXIYd(uint16_t& indexReg);
-    void RL_IXIYd(uint16_t& indexReg);
-    void RR_IXIYd(uint16_t& indexReg);
-    void SLA_IXIYd(uint16_t& indexReg);
-    void SRA_IXIYd(uint16_t& indexReg);
-    void SLL_IXIYd(uint16_t& indexReg);
-    void SRL_IXIYd(uint16_t& indexReg);
-    void BIT_b_IXIYd(uint8_t bit, uint16_t& indexReg);
-    void RES_b_IXIYd(uint8_t bit, uint16_t& indexReg);
-    void SET_b_IXIYd(uint8_t bit, uint16_t& indexReg);
+    // 0xDD/FD CB Prefixed Extended Instructions (address = IX+d / IY+d)
+    void RLC_IXIYd(uint16_t address);
+    void RRC_IXIYd(uint16_t address);
+    void RL_IXIYd(uint16_t address);
+    void RR_IXIYd(uint16_t address);
+    void SLA_IXIYd(uint16_t address);
+    void SRA_IXIYd(uint16_t address);
+    void SLL_IXIYd(uint16_t address);
+    void SRL_IXIYd(uint16_t address);
+    void BIT_b_IXIYd(uint8_t bit, uint16_t address);
+    void RES_b_IXIYd(uint8_t bit, uint16_t address);
+    void SET_b_IXIYd(uint8_t bit, uint16_t address);
 };
 
 #endif // Z80_HPP
@@ -0,0 +1,147 @@
+#include "Z80JIT.hpp"
+#include <cstring>
+
+#ifdef Z80_JIT_X86_64
+#include <sys/mman.h>
+#endif
+
+Z80JIT::Z80JIT(const Layout& layout) : layout_(layout), arena_(nullptr), used_(0) {
+#ifdef Z80_JIT_X86_64
+    void* arena = mmap(nullptr, ARENA_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (arena != MAP_FAILED) {
+        arena_ = static_cast<uint8_t*>(arena);
+    }
+#endif
+}
+
+Z80JIT::~Z80JIT() {
+#ifdef Z80_JIT_X86_64
+    if (arena_) {
+        munmap(arena_, ARENA_SIZE);
+    }
+#endif
+}
+
+// --- Code generation ---
+// RBX holds the Z80, R12 points at the code epoch and R13D holds the epoch
+// the block started with. All three are callee-saved, so they survive the
+// handler calls. After the three pushes RSP is 16-byte aligned for calls.
+//
+// Per instruction:
+//   movzx eax, byte [rbx+R]        ; R = (R & 80h) | ((R + fetches) & 7Fh)
+//   lea   ecx, [rax+fetches]
+//   and   ecx, 7Fh
+//   and   eax, 80h
+//   or    eax, ecx
+//   mov   [rbx+R], al
+//   add   qword [rbx+cycles], cycles
+//   mov   word [rbx+PC], operandPC
+//   movzx eax, word [rbx+IX/IY]    ; DD CB / FD CB only
+//   add   eax, displacement
+//   mov   [rbx+indexAddress], ax
+//   mov   rdi, rbx
+//   mov   rax, handler
+//   call  rax
+//   cmp   word [rbx+PC], nextPC    ; Not after the last instruction
+//   jne   exit
+//   mov   rax, [rbx+cycles]
+//   cmp   rax, [rbx+sliceEnd]
+//   jae   exit
+//   cmp   [r12], r13d
+//   jne   exit
+Z80JIT::BlockFunction Z80JIT::compile(const std::vector<Op>& ops) {
+#ifdef Z80_JIT_X86_64
+    if (!arena_ || ops.empty()) {
+        return nullptr;
+    }
+
+    code_.clear();
+    std::vector<size_t> exits;
+
+    emit({0x53, 0x41, 0x54, 0x41, 0x55});                          // push rbx / r12 / r13
+    emit({0x48, 0x89, 0xFB});                                       // mov rbx, rdi
+    emit({0x49, 0xBC});                                             // mov r12, codeEpoch
+    emit64(reinterpret_cast<uintptr_t>(layout_.codeEpoch));
+    emit({0x45, 0x8B, 0x2C, 0x24});                                 // mov r13d, [r12]
+
+    for (size_t i = 0; i < ops.size(); ++i) {
+        const Op& op = ops[i];
+        emit({0x0F, 0xB6, 0x83}); emitDisp(layout_.r);
+        emit({0x8D, 0x48, op.fetches});
+        emit({0x83, 0xE1, 0x7F});
+        emit({0x25, 0x80, 0x00, 0x00, 0x00});
+        emit({0x09, 0xC8});
+        emit({0x88, 0x83}); emitDisp(layout_.r);
+
+        emit({0x48, 0x81, 0x83}); emitDisp(layout_.cycles); emit32(op.cycles);
+        emit({0x66, 0xC7, 0x83}); emitDisp(layout_.pc);
+        emit({static_cast<uint8_t>(op.operandPC), static_cast<uint8_t>(op.operandPC >> 8)});
+
+        if (op.index) {
+            emit({0x0F, 0xB7, 0x83}); emitDisp(op.index == 1 ? layout_.ix : layout_.iy);
+            emit({0x05}); emit32(static_cast<uint32_t>(static_cast<int32_t>(op.displacement)));
+            emit({0x66, 0x89, 0x83}); emitDisp(layout_.indexAddress);
+        }
+
+        emit({0x48, 0x89, 0xDF});
+        emit({0x48, 0xB8}); emit64(reinterpret_cast<uintptr_t>(op.function));
+        emit({0xFF, 0xD0});
+
+        if (i + 1 < ops.size()) {
+            emit({0x66, 0x81, 0xBB}); emitDisp(layout_.pc);
+            emit({static_cast<uint8_t>(op.nextPC), static_cast<uint8_t>(op.nextPC >> 8)});
+            exits.push_back(emitJump(0x85));
+            emit({0x48, 0x8B, 0x83}); emitDisp(layout_.cycles);
+            emit({0x48, 0x3B, 0x83}); emitDisp(layout_.sliceEnd);
+            exits.push_back(emitJump(0x83));
+            emit({0x45, 0x39, 0x2C, 0x24});
+            exits.push_back(emitJump(0x85));
+        }
+    }
+
+    const size_t exit = code_.size();
+    emit({0x41, 0x5D, 0x41, 0x5C, 0x5B, 0xC3});                     // pop r13 / r12 / rbx, ret
+    for (size_t jump : exits) {
+        const int32_t rel = static_cast<int32_t>(exit - (jump + 4));
+        std::memcpy(&code_[jump], &rel, sizeof(rel));
+    }
+
+    // Keep every block 16-byte aligned
+    const size_t size = (code_.size() + 15) & ~size_t(15);
+    if (used_ + size > ARENA_SIZE) {
+        return nullptr;
+    }
+    uint8_t* block = arena_ + used_;
+    std::memcpy(block, code_.data(), code_.size());
+    used_ += size;
+    return reinterpret_cast<BlockFunction>(block);
+#else
+    (void)ops;
+    return nullptr;
+#endif
+}
+
+void Z80JIT::emit(std::initializer_list<uint8_t> bytes) {
+    code_.insert(code_.end(), bytes);
+}
+
+void Z80JIT::emit32(uint32_t value) {
+    for (int i = 0; i < 4; ++i) code_.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+void Z80JIT::emit64(uint64_t value) {
+    for (int i = 0; i < 8; ++i) code_.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+void Z80JIT::emitDisp(size_t offset) {
+    emit32(static_cast<uint32_t>(offset));
+}
+
+// Jcc rel32 with the target patched in later; returns where rel32 goes
+size_t Z80JIT::emitJump(uint8_t condition) {
+    emit({0x0F, condition});
+    const size_t position = code_.size();
+    emit32(0);
+    return position;
+}
@@ -0,0 +1,84 @@
+#ifndef Z80_JIT_HPP
+#define Z80_JIT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+class Z80;
+
+// x86-64 backend for hot blocks of the Z80 block cache. A compiled block is
+// the block cache's replay loop unrolled into machine code: R, the cycle
+// count and PC are updated inline and every instruction becomes a direct
+// call to its handler, followed by the same exit checks the interpreter
+// makes (a jump, the end of the slice, a change of the code epoch). Because
+// it runs the same handlers with the same bookkeeping, a compiled block is
+// bit-exact with the interpreter by construction.
+//
+// Only built for x86-64 with the System V/Itanium ABIs (GCC or Clang on
+// Linux); elsewhere, or when Z80_NO_JIT is defined or the kernel refuses
+// executable memory, isAvailable() is false and nothing is ever compiled.
+// Compiled code has no unwind info, so I/O and memory callbacks must not
+// throw while the JIT is enabled.
+#if defined(__x86_64__) && defined(__GNUC__) && defined(__linux__) && !defined(Z80_NO_JIT)
+#define Z80_JIT_X86_64 1
+#endif
+
+class Z80JIT {
+public:
+    using BlockFunction = void (*)(Z80* cpu);
+
+    // Where the compiled code finds its state, as byte offsets into Z80
+    struct Layout {
+        size_t r;
+        size_t pc;
+        size_t ix;
+        size_t iy;
+        size_t indexAddress;
+        size_t cycles;          // uint64_t
+        size_t sliceEnd;        // uint64_t
+        const uint32_t* codeEpoch;
+    };
+
+    // One cached instruction, see Z80::CachedOp
+    struct Op {
+        const void* function;   // Handler entry point, called with the Z80 in RDI
+        uint16_t operandPC;
+        uint16_t nextPC;
+        uint8_t cycles;
+        uint8_t fetches;
+        uint8_t index;          // 1: IX, 2: IY
+        int8_t displacement;
+    };
+
+    static const size_t ARENA_SIZE = 4 << 20;
+
+    explicit Z80JIT(const Layout& layout);
+    ~Z80JIT();
+
+    Z80JIT(const Z80JIT&) = delete;
+    Z80JIT& operator=(const Z80JIT&) = delete;
+
+    bool isAvailable() const { return arena_ != nullptr; }
+
+    // Returns null when the arena is full; flush() and compile again.
+    BlockFunction compile(const std::vector<Op>& ops);
+
+    // Forget all compiled code. Every BlockFunction handed out is invalid.
+    void flush() { used_ = 0; }
+
+private:
+    Layout layout_;
+    uint8_t* arena_;
+    size_t used_;
+    std::vector<uint8_t> code_;     // Block being assembled
+
+    void emit(std::initializer_list<uint8_t> bytes);
+    void emit32(uint32_t value);
+    void emit64(uint64_t value);
+    void emitDisp(size_t offset);
+    size_t emitJump(uint8_t condition);
+};
+
+#endif // Z80_JIT_HPP
@@ -5,14 +5,25 @@
 
 class Z80Registers {
 public:
-    // Enum for flag names (now outside the class)
-    enum Flag {
-        Carry,
-        Subtract,
-        ParityOverflow,
-        HalfCarry,
-        Zero,
-        Sign
+    // Flag bits in the F register
+    enum Flag : uint8_t {
+        Carry          = 0x01,
+        Subtract       = 0x02,
+        ParityOverflow = 0x04,
+        HalfCarry      = 0x10,
+        Zero           = 0x40,
+        Sign           = 0x80
+    };
+
+    // 8-bit ALU operations whose flags can be left pending in the lazy record
+    enum class FlagOp : uint8_t {
+        None,   // F is up to date
+        Add,    // ADD, ADC: operand1 + operand2 + carry
+        Sub,    // SUB, SBC, CP, NEG: operand1 - operand2 - carry
+        Inc,    // INC: carry holds the preserved C flag
+        Dec,    // DEC: carry holds the preserved C flag
+        And,    // AND: S, Z, P from the result, H set
+        Logic   // OR, XOR: S, Z, P from the result
     };
 
     // 8-bit registers with 16-bit access using unions
@@ -107,29 +118,16 @@ public:
     uint8_t I;              // Interrupt Vector
     uint8_t R;              // Refresh Counter (msb not used)
 
-    // Flag bitfields in the F register
-    struct FlagRegister {
-        uint8_t C : 1;      // Carry flag
-        uint8_t N : 1;      // Add/Subtract flag
-        uint8_t PV : 1;     // Parity/Overflow flag
-        uint8_t H : 1;      // Half-Carry flag
-        uint8_t Z : 1;      // Zero flag
-        uint8_t S : 1;      // Sign flag
-        uint8_t U1 : 1;     // Undocumented bit 5 (unused)
-        uint8_t U2 : 1;     // Undocumented bit 3 (unused)
-    } flags;
-
-    // Flag bitfields in the alternate F' register
-    struct AlternateFlagRegister {
-        uint8_t C : 1;
-        uint8_t N : 1;
-        uint8_t PV : 1;
-        uint8_t H : 1;
-        uint8_t Z : 1;
-        uint8_t S : 1;
-        uint8_t U1 : 1;
-        uint8_t U2 : 1;
-    } flags_;
+    // Lazy flag record. ALU instructions store their operands and result here
+    // instead of building F; the flags are only computed when something reads
+    // them (a conditional instruction, PUSH AF, EX AF,AF' or getFlag()).
+    struct LazyFlags {
+        FlagOp op;
+        uint8_t operand1;
+        uint8_t operand2;
+        uint8_t carry;
+        uint8_t result;
+    } lazy;
 
     // Interrupt flip-flops
     bool IFF1;             // Interrupt Enable Flip-Flop 1
@@ -149,11 +147,14 @@ public:
     bool getFlag(Flag flag) const;
     void setAlternateFlag(Flag flag, bool value);
     bool getAlternateFlag(Flag flag) const;
-    void updateFlagsRegister();     // Update the F register from the flags struct
-    void updateFromFlagsRegister(); // Update the flags struct from the F register
     void setFlags(uint8_t flagsValue);
     void setFlags_(uint8_t flagsValue);
 
+    // Lazy flag evaluation
+    void setLazyFlags(FlagOp op, uint8_t operand1, uint8_t operand2, uint8_t carry, uint8_t result);
+    void flushFlags();              // Fold any pending ALU flags into F
+    uint8_t getF() const;           // F with any pending ALU flags applied
+
     // Getters for undocumented flags
     bool getUndocumentedFlagU1() const;
     bool getUndocumentedFlagU2() const;
@@ -169,6 +170,54 @@ public:
     // Setters for undocumented flags for alternate register
     void setUndocumentedFlagU1_(bool value);
     void setUndocumentedFlagU2_(bool value);
+
+private:
+    uint8_t evaluateFlags() const;  // Compute F from the lazy record
+    bool evaluateFlag(Flag flag) const;
 };
 
+// Building with Z80_EAGER_FLAGS folds every ALU result into F immediately,
+// which is handy when comparing F against another core step by step.
+#ifdef Z80_EAGER_FLAGS
+constexpr bool Z80_LAZY_FLAGS = false;
+#else
+constexpr bool Z80_LAZY_FLAGS = true;
+#endif
+
+// The flag accessors sit on every conditional instruction, so they are
+// inlined here; only the evaluation of a pending record lives in the .cpp.
+inline void Z80Registers::setLazyFlags(FlagOp op, uint8_t operand1, uint8_t operand2, uint8_t carry, uint8_t result) {
+    lazy.op = op;
+    lazy.operand1 = operand1;
+    lazy.operand2 = operand2;
+    lazy.carry = carry;
+    lazy.result = result;
+    if constexpr (!Z80_LAZY_FLAGS) flushFlags();
+}
+
+inline void Z80Registers::flushFlags() {
+    if (lazy.op != FlagOp::None) {
+        F = evaluateFlags();
+        lazy.op = FlagOp::None;
+    }
+}
+
+inline uint8_t Z80Registers::getF() const {
+    return lazy.op == FlagOp::None ? F : evaluateFlags();
+}
+
+inline bool Z80Registers::getFlag(Flag flag) const {
+    return lazy.op == FlagOp::None ? (F & flag) != 0 : evaluateFlag(flag);
+}
+
+inline void Z80Registers::setFlag(Flag flag, bool value) {
+    flushFlags();
+    F = value ? (F | flag) : (F & ~flag);
+}
+
+inline void Z80Registers::setFlags(uint8_t flagsValue) {
+    lazy.op = FlagOp::None;
+    F = flagsValue;
+}
+
 #endif // Z80_REGISTERS_HPP
\ No newline at end of file
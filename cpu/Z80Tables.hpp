@@ -0,0 +1,250 @@
+#ifndef Z80_TABLES_HPP
+#define Z80_TABLES_HPP
+
+#include <array>
+#include <cstdint>
+#include "Z80Registers.hpp"
+
+// Opcode timing and flag tables for the Z80 core, laid out like fMSX's
+// Z80/Tables.h. Each timing table is indexed by the opcode byte that follows
+// its prefix.
+
+// Base T-states for unprefixed opcodes. Conditional JR/JP/CALL/RET and DJNZ
+// hold the not-taken count; the handler adds the extra cycles when taken.
+// Prefix bytes (CB, DD, ED, FD) are 0 and are charged by their own table.
+inline constexpr std::array<uint8_t, 256> CYCLES_MAIN = {
+     4,10, 7, 6, 4, 4, 7, 4, 4,11, 7, 6, 4, 4, 7, 4,
+     8,10, 7, 6, 4, 4, 7, 4,12,11, 7, 6, 4, 4, 7, 4,
+     7,10,16, 6, 4, 4, 7, 4, 7,11,16, 6, 4, 4, 7, 4,
+     7,10,13, 6,11,11,10, 4, 7,11,13, 6, 4, 4, 7, 4,
+     4, 4, 4, 4, 4, 4, 7, 4, 4, 4, 4, 4, 4, 4, 7, 4,
+     4, 4, 4, 4, 4, 4, 7, 4, 4, 4, 4, 4, 4, 4, 7, 4,
+     4, 4, 4, 4, 4, 4, 7, 4, 4, 4, 4, 4, 4, 4, 7, 4,
+     7, 7, 7, 7, 7, 7, 4, 7, 4, 4, 4, 4, 4, 4, 7, 4,
+     4, 4, 4, 4, 4, 4, 7, 4, 4, 4, 4, 4, 4, 4, 7, 4,
+     4, 4, 4, 4, 4, 4, 7, 4, 4, 4, 4, 4, 4, 4, 7, 4,
+     4, 4, 4, 4, 4, 4, 7, 4, 4, 4, 4, 4, 4, 4, 7, 4,
+     4, 4, 4, 4, 4, 4, 7, 4, 4, 4, 4, 4, 4, 4, 7, 4,
+     5,10,10,10,10,11, 7,11, 5,10,10, 0,10,17, 7,11,
+     5,10,10,11,10,11, 7,11, 5, 4,10,11,10, 0, 7,11,
+     5,10,10,19,10,11, 7,11, 5, 4,10, 4,10, 0, 7,11,
+     5,10,10, 4,10,11, 7,11, 5, 6,10, 4,10, 0, 7,11
+};
+
+// T-states for CB-prefixed opcodes, prefix fetch included.
+inline constexpr std::array<uint8_t, 256> CYCLES_CB = {
+     8, 8, 8, 8, 8, 8,15, 8, 8, 8, 8, 8, 8, 8,15, 8,
+     8, 8, 8, 8, 8, 8,15, 8, 8, 8, 8, 8, 8, 8,15, 8,
+     8, 8, 8, 8, 8, 8,15, 8, 8, 8, 8, 8, 8, 8,15, 8,
+     8, 8, 8, 8, 8, 8,15, 8, 8, 8, 8, 8, 8, 8,15, 8,
+     8, 8, 8, 8, 8, 8,12, 8, 8, 8, 8, 8, 8, 8,12, 8,
+     8, 8, 8, 8, 8, 8,12, 8, 8, 8, 8, 8, 8, 8,12, 8,
+     8, 8, 8, 8, 8, 8,12, 8, 8, 8, 8, 8, 8, 8,12, 8,
+     8, 8, 8, 8, 8, 8,12, 8, 8, 8, 8, 8, 8, 8,12, 8,
+     8, 8, 8, 8, 8, 8,15, 8, 8, 8, 8, 8, 8, 8,15, 8,
+     8, 8, 8, 8, 8, 8,15, 8, 8, 8, 8, 8, 8, 8,15, 8,
+     8, 8, 8, 8, 8, 8,15, 8, 8, 8, 8, 8, 8, 8,15, 8,
+     8, 8, 8, 8, 8, 8,15, 8, 8, 8, 8, 8, 8, 8,15, 8,
+     8, 8, 8, 8, 8, 8,15, 8, 8, 8, 8, 8, 8, 8,15, 8,
+     8, 8, 8, 8, 8, 8,15, 8, 8, 8, 8, 8, 8, 8,15, 8,
+     8, 8, 8, 8, 8, 8,15, 8, 8, 8, 8, 8, 8, 8,15, 8,
+     8, 8, 8, 8, 8, 8,15, 8, 8, 8, 8, 8, 8, 8,15, 8
+};
+
+// T-states for ED-prefixed opcodes, prefix fetch included. Undefined entries
+// behave as an 8 T-state NOP. Block repeats hold the final-iteration count;
+// the handler adds 5 when the instruction repeats.
+inline constexpr std::array<uint8_t, 256> CYCLES_ED = {
+     8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+     8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+     8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+     8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+    12,12,15,20, 8,14, 8, 9,12,12,15,20, 8,14, 8, 9,
+    12,12,15,20, 8,14, 8, 9,12,12,15,20, 8,14, 8, 9,
+    12,12,15,20, 8,14, 8,18,12,12,15,20, 8,14, 8,18,
+    12,12,15,20, 8,14, 8, 8,12,12,15,20, 8,14, 8, 8,
+     8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+     8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+    16,16,16,16, 8, 8, 8, 8,16,16,16,16, 8, 8, 8, 8,
+    16,16,16,16, 8, 8, 8, 8,16,16,16,16, 8, 8, 8, 8,
+     8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+     8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+     8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+     8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8
+};
+
+// T-states for DD/FD-prefixed opcodes, prefix fetch included. Opcodes that do
+// not involve H, L or (HL) execute as their unprefixed form plus 4 T-states.
+// DD CB / FD CB is 0 here and charged from CYCLES_XXCB.
+inline constexpr std::array<uint8_t, 256> CYCLES_XX = {
+     8,14,11,10, 8, 8,11, 8, 8,15,11,10, 8, 8,11, 8,
+    12,14,11,10, 8, 8,11, 8,16,15,11,10, 8, 8,11, 8,
+    11,14,20,10, 8, 8,11, 8,11,15,20,10, 8, 8,11, 8,
+    11,14,17,10,23,23,19, 8,11,15,17,10, 8, 8,11, 8,
+     8, 8, 8, 8, 8, 8,19, 8, 8, 8, 8, 8, 8, 8,19, 8,
+     8, 8, 8, 8, 8, 8,19, 8, 8, 8, 8, 8, 8, 8,19, 8,
+     8, 8, 8, 8, 8, 8,19, 8, 8, 8, 8, 8, 8, 8,19, 8,
+    19,19,19,19,19,19, 8,19, 8, 8, 8, 8, 8, 8,19, 8,
+     8, 8, 8, 8, 8, 8,19, 8, 8, 8, 8, 8, 8, 8,19, 8,
+     8, 8, 8, 8, 8, 8,19, 8, 8, 8, 8, 8, 8, 8,19, 8,
+     8, 8, 8, 8, 8, 8,19, 8, 8, 8, 8, 8, 8, 8,19, 8,
+     8, 8, 8, 8, 8, 8,19, 8, 8, 8, 8, 8, 8, 8,19, 8,
+     9,14,14,14,14,15,11,15, 9,14,14, 0,14,21,11,15,
+     9,14,14,15,14,15,11,15, 9, 8,14,15,14, 4,11,15,
+     9,14,14,23,14,15,11,15, 9, 8,14, 8,14, 4,11,15,
+     9,14,14, 8,14,15,11,15, 9,10,14, 8,14, 4,11,15
+};
+
+// T-states for DD CB d op / FD CB d op, whole sequence included.
+inline constexpr std::array<uint8_t, 256> CYCLES_XXCB = {
+    23,23,23,23,23,23,23,23,23,23,23,23,23,23,23,23,
+    23,23,23,23,23,23,23,23,23,23,23,23,23,23,23,23,
+    23,23,23,23,23,23,23,23,23,23,23,23,23,23,23,23,
+    23,23,23,23,23,23,23,23,23,23,23,23,23,23,23,23,
+    20,20,20,20,20,20,20,20,20,20,20,20,20,20,20,20,
+    20,20,20,20,20,20,20,20,20,20,20,20,20,20,20,20,
+    20,20,20,20,20,20,20,20,20,20,20,20,20,20,20,20,
+    20,20,20,20,20,20,20,20,20,20,20,20,20,20,20,20,
+    23,23,23,23,23,23,23,23,23,23,23,23,23,23,23,23,
+    23,23,23,23,23,23,23,23,23,23,23,23,23,23,23,23,
+    23,23,23,23,23,23,23,23,23,23,23,23,23,23,23,23,
+    23,23,23,23,23,23,23,23,23,23,23,23,23,23,23,23,
+    23,23,23,23,23,23,23,23,23,23,23,23,23,23,23,23,
+    23,23,23,23,23,23,23,23,23,23,23,23,23,23,23,23,
+    23,23,23,23,23,23,23,23,23,23,23,23,23,23,23,23,
+    23,23,23,23,23,23,23,23,23,23,23,23,23,23,23,23
+};
+
+// T-states to accept an interrupt, up to the first instruction of the
+// handler. IM 0 is assumed to be fed an RST, as on the MSX.
+inline constexpr int CYCLES_NMI = 11;
+inline constexpr int CYCLES_IM0 = 13;
+inline constexpr int CYCLES_IM1 = 13;
+inline constexpr int CYCLES_IM2 = 19;
+
+// --- Instruction lengths ---
+// Operand bytes that follow each opcode, for the block cache's decoder.
+// DD/FD forms add a displacement byte to whatever the unprefixed opcode
+// takes when they address (IX+d)/(IY+d).
+constexpr std::array<uint8_t, 256> makeMainOperands() {
+    std::array<uint8_t, 256> t{};
+    for (int op = 0; op < 256; ++op) {
+        const int x = op >> 6, y = (op >> 3) & 7, z = op & 7;
+        if (x == 0) {
+            if (z == 0 && y >= 2) t[op] = 1;                    // DJNZ, JR
+            else if (z == 1 && !(y & 1)) t[op] = 2;             // LD rr,nn
+            else if (z == 2 && y >= 4) t[op] = 2;               // LD (nn),HL/A and back
+            else if (z == 6) t[op] = 1;                         // LD r,n
+        } else if (x == 3) {
+            if (z == 2 || z == 4 || op == 0xC3 || op == 0xCD) t[op] = 2;  // JP, CALL
+            else if (z == 6 || op == 0xD3 || op == 0xDB) t[op] = 1;      // ALU n, OUT/IN (n)
+        }
+    }
+    return t;
+}
+
+constexpr std::array<uint8_t, 256> makeEDOperands() {
+    std::array<uint8_t, 256> t{};
+    for (int op = 0; op < 256; ++op) {
+        t[op] = (op & 0xC7) == 0x43 ? 2 : 0;                    // LD (nn),rr / LD rr,(nn)
+    }
+    return t;
+}
+
+constexpr std::array<uint8_t, 256> makeIndexOperands() {
+    std::array<uint8_t, 256> t = makeMainOperands();
+    for (int op = 0; op < 256; ++op) {
+        const int x = op >> 6, y = (op >> 3) & 7, z = op & 7;
+        if ((op >= 0x34 && op <= 0x36) || (x == 1 && op != 0x76 && (y == 6 || z == 6)) || (x == 2 && z == 6)) {
+            ++t[op];
+        }
+    }
+    return t;
+}
+
+inline constexpr std::array<uint8_t, 256> OPERANDS_MAIN = makeMainOperands();
+inline constexpr std::array<uint8_t, 256> OPERANDS_ED = makeEDOperands();
+inline constexpr std::array<uint8_t, 256> OPERANDS_XX = makeIndexOperands();
+
+// --- Flag tables ---
+// F values for the 8-bit ALU, generated at compile time from the same rules
+// as fMSX's ZSTable/PZSTable and its M_ADD/M_SUB/M_INC/M_DEC macros, so the
+// undocumented bits 5 and 3 always read as 0.
+
+constexpr std::array<uint8_t, 256> makeZSTable() {
+    std::array<uint8_t, 256> table{};
+    for (int v = 0; v < 256; ++v)
+        table[v] = (v ? 0 : Z80Registers::Zero) | (v & Z80Registers::Sign);
+    return table;
+}
+
+constexpr std::array<uint8_t, 256> makePZSTable() {
+    std::array<uint8_t, 256> table = makeZSTable();
+    for (int v = 0; v < 256; ++v) {
+        int bits = 0;
+        for (int b = 0; b < 8; ++b) bits += (v >> b) & 1;
+        if (!(bits & 1)) table[v] |= Z80Registers::ParityOverflow;
+    }
+    return table;
+}
+
+// Indexed by the result. C is not included; INC/DEC preserve it.
+constexpr std::array<uint8_t, 256> makeIncTable() {
+    std::array<uint8_t, 256> table = makeZSTable();
+    for (int r = 0; r < 256; ++r) {
+        if ((r & 0x0F) == 0x00) table[r] |= Z80Registers::HalfCarry;
+        if (r == 0x80) table[r] |= Z80Registers::ParityOverflow;
+    }
+    return table;
+}
+
+constexpr std::array<uint8_t, 256> makeDecTable() {
+    std::array<uint8_t, 256> table = makeZSTable();
+    for (int r = 0; r < 256; ++r) {
+        table[r] |= Z80Registers::Subtract;
+        if ((r & 0x0F) == 0x0F) table[r] |= Z80Registers::HalfCarry;
+        if (r == 0x7F) table[r] |= Z80Registers::ParityOverflow;
+    }
+    return table;
+}
+
+// Indexed by carry << 16 | A << 8 | operand, for ADD/ADC and SUB/SBC/CP.
+constexpr std::array<uint8_t, 0x20000> makeAddTable() {
+    std::array<uint8_t, 0x20000> table{};
+    const std::array<uint8_t, 256> zs = makeZSTable();
+    for (int i = 0; i < 0x20000; ++i) {
+        const int c = i >> 16, a = (i >> 8) & 0xFF, b = i & 0xFF;
+        const int sum = a + b + c;
+        const int r = sum & 0xFF;
+        table[i] = zs[r] | ((a ^ b ^ r) & Z80Registers::HalfCarry) |
+                   ((~(a ^ b) & (b ^ r) & 0x80) ? Z80Registers::ParityOverflow : 0) |
+                   (sum > 0xFF ? Z80Registers::Carry : 0);
+    }
+    return table;
+}
+
+constexpr std::array<uint8_t, 0x20000> makeSubTable() {
+    std::array<uint8_t, 0x20000> table{};
+    const std::array<uint8_t, 256> zs = makeZSTable();
+    for (int i = 0; i < 0x20000; ++i) {
+        const int c = i >> 16, a = (i >> 8) & 0xFF, b = i & 0xFF;
+        const int diff = a - b - c;
+        const int r = diff & 0xFF;
+        table[i] = zs[r] | Z80Registers::Subtract | ((a ^ b ^ r) & Z80Registers::HalfCarry) |
+                   (((a ^ b) & (a ^ r) & 0x80) ? Z80Registers::ParityOverflow : 0) |
+                   (diff < 0 ? Z80Registers::Carry : 0);
+    }
+    return table;
+}
+
+inline constexpr std::array<uint8_t, 256> ZS_TABLE = makeZSTable();
+inline constexpr std::array<uint8_t, 256> PZS_TABLE = makePZSTable();
+inline constexpr std::array<uint8_t, 256> INC_FLAGS = makeIncTable();
+inline constexpr std::array<uint8_t, 256> DEC_FLAGS = makeDecTable();
+
+// The 128K-entry tables take a while to evaluate, so only Z80Registers.cpp
+// (which owns flag evaluation) generates them.
+extern const std::array<uint8_t, 0x20000> ADD_FLAGS;
+extern const std::array<uint8_t, 0x20000> SUB_FLAGS;
+
+#endif // Z80_TABLES_HPP
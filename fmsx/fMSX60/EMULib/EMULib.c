@@ -21,17 +21,17 @@
 #include <unistd.h>
 #endif
 
-#if defined(WINDOWS) || defined(UNIX) || defined(MAEMO) || defined(MEEGO) || defined(ANDROID)
+#if defined(WINDOWS) || (defined(UNIX) && !defined(HEADLESS)) || defined(MAEMO) || defined(MEEGO) || defined(ANDROID)
 #define NewImage GenericNewImage
 #endif
 
-#if defined(WINDOWS) || defined(UNIX) || defined(MAEMO) || defined(MEEGO)
+#if defined(WINDOWS) || (defined(UNIX) && !defined(HEADLESS)) || defined(MAEMO) || defined(MEEGO)
 #define FreeImage GenericFreeImage
 #define CropImage GenericCropImage
 extern Image BigScreen;
 #endif
 
-#if defined(UNIX) || defined(MAEMO) || defined(MEEGO) || defined(ANDROID)
+#if (defined(UNIX) && !defined(HEADLESS)) || defined(MAEMO) || defined(MEEGO) || defined(ANDROID)
 #define SetVideo GenericSetVideo
 #endif
 
@@ -39,11 +39,11 @@ extern Image BigScreen;
 /** These parameters are set with SetVideo() and used by    **/
 /** ShowVideo() to show a WxH fragment from <X,Y> of Img.   **/
 /*************************************************************/
-Image *VideoImg = 0;           /* Current ShowVideo() image  */
-int VideoX;                    /* X for ShowVideo()          */
-int VideoY;                    /* Y for ShowVideo()          */
-int VideoW;                    /* Width for ShowVideo()      */
-int VideoH;                    /* Height for ShowVideo()     */
+THREADLOCAL Image *VideoImg = 0;           /* Current ShowVideo() image  */
+THREADLOCAL int VideoX;                    /* X for ShowVideo()          */
+THREADLOCAL int VideoY;                    /* Y for ShowVideo()          */
+THREADLOCAL int VideoW;                    /* Width for ShowVideo()      */
+THREADLOCAL int VideoH;                    /* Height for ShowVideo()     */
 
 /** KeyHandler ***********************************************/
 /** This function receives key presses and releases.        **/
@@ -161,7 +161,7 @@ void SetKeyHandler(void (*Handler)(unsigned int Key))
 /*************************************************************/
 const char *GetFilePath(const char *Name)
 {
-  static char Path[256];
+  static THREADLOCAL char Path[256];
   const char *P;
   char *T;
 
@@ -182,7 +182,7 @@ const char *GetFilePath(const char *Name)
 /*************************************************************/
 const char *NewFile(const char *Pattern)
 {
-  static char Name[256];
+  static THREADLOCAL char Name[256];
   struct stat FInfo;
   const char *P;
   char S[256],*T;
@@ -151,13 +151,17 @@
 #define CON_OK       0xFE
 #define CON_EXIT     0xFF
 
+#include "ThreadLocal.h"
+
 #ifdef WINDOWS
 #include "LibWin.h"
 #endif
 #ifdef MSDOS
 #include "LibMSDOS.h"
 #endif
-#ifdef UNIX
+#if defined(UNIX) && defined(HEADLESS)
+#include "LibNull.h"
+#elif defined(UNIX)
 #include "LibUnix.h"
 #endif
 #ifdef MAEMO
@@ -241,7 +245,7 @@ typedef struct
 #ifdef MEEGO
   QImage *QImg;              /* Pointer to QImage object     */
 #endif
-#ifdef UNIX
+#if defined(UNIX) && !defined(HEADLESS)
   XImage *XImg;              /* Pointer to XImage structure  */
   int Attrs;                 /* USE_SHM and other attributes */
 #ifdef MITSHM
@@ -254,11 +258,11 @@ typedef struct
 /** These parameters are set with SetVideo() and used by    **/
 /** ShowVideo() to show a WxH fragment from <X,Y> of Img.   **/
 /*************************************************************/
-extern Image *VideoImg;        /* Current ShowVideo() image  */
-extern int VideoX;             /* X for ShowVideo()          */
-extern int VideoY;             /* Y for ShowVideo()          */
-extern int VideoW;             /* Width for ShowVideo()      */
-extern int VideoH;             /* Height for ShowVideo()     */
+extern THREADLOCAL Image *VideoImg;        /* Current ShowVideo() image  */
+extern THREADLOCAL int VideoX;             /* X for ShowVideo()          */
+extern THREADLOCAL int VideoY;             /* Y for ShowVideo()          */
+extern THREADLOCAL int VideoW;             /* Width for ShowVideo()      */
+extern THREADLOCAL int VideoH;             /* Height for ShowVideo()     */
 
 /** KeyHandler ***********************************************/
 /** This function receives key presses and releases.        **/
@@ -281,7 +285,7 @@ void FreeImage(Image *Img);
 /*************************************************************/
 Image *CropImage(Image *Dst,const Image *Src,int X,int Y,int W,int H);
 
-#if defined(WINDOWS) || defined(UNIX) || defined(MAEMO) || defined(MEEGO)
+#if defined(WINDOWS) || (defined(UNIX) && !defined(HEADLESS)) || defined(MAEMO) || defined(MEEGO)
 Image *GenericCropImage(Image *Dst,const Image *Src,int X,int Y,int W,int H);
 #endif
 
@@ -400,7 +404,7 @@ void IMGFillRect(Image *Img,int X,int Y,int W,int H,pixel Color);
 /*************************************************************/
 void SetVideo(Image *Img,int X,int Y,int W,int H);
 
-#if defined(UNIX) || defined(MAEMO) || defined(MEEGO) || defined(ANDROID)
+#if (defined(UNIX) && !defined(HEADLESS)) || defined(MAEMO) || defined(MEEGO) || defined(ANDROID)
 void GenericSetVideo(Image *Img,int X,int Y,int W,int H);
 #endif
 
@@ -437,6 +441,15 @@ unsigned int GetTotalAudio(void);
 /*************************************************************/
 unsigned int WriteAudio(sample *Data,unsigned int Length);
 
+#if defined(UNIX) && defined(HEADLESS)
+/** SetAudioHandler() ****************************************/
+/** Attach a handler receiving every buffer of samples that **/
+/** goes through WriteAudio(). The handler is per-thread,   **/
+/** SetAudioHandler(0) detaches it.                         **/
+/*************************************************************/
+void SetAudioHandler(void (*Handler)(const sample *Data,unsigned int Length));
+#endif
+
 /** PauseAudio() *********************************************/
 /** Pause/resume audio playback. Returns current playback   **/
 /** state.                                                  **/
@@ -45,17 +45,17 @@ typedef struct
   unsigned char KeyState[RPL_RECSIZE][16];
 } RPLState;
 
-static RPLState RPLData[RPL_BUFSIZE] = {{0}};
-static unsigned int StateSize = 0;
-static unsigned int TimeLeft;
-static int RPLRCount = -1;
-static int RPLWCount = -1;
-static int RPLUCount = -1;
-static int RPtr1,RPtr2;
-static int WPtr1,WPtr2;
-
-static unsigned int (*SaveState)(unsigned char *,unsigned int) = 0;
-static unsigned int (*LoadState)(unsigned char *,unsigned int) = 0;
+static THREADLOCAL RPLState RPLData[RPL_BUFSIZE] = {{0}};
+static THREADLOCAL unsigned int StateSize = 0;
+static THREADLOCAL unsigned int TimeLeft;
+static THREADLOCAL int RPLRCount = -1;
+static THREADLOCAL int RPLWCount = -1;
+static THREADLOCAL int RPLUCount = -1;
+static THREADLOCAL int RPtr1,RPtr2;
+static THREADLOCAL int WPtr1,WPtr2;
+
+static THREADLOCAL unsigned int (*SaveState)(unsigned char *,unsigned int) = 0;
+static THREADLOCAL unsigned int (*LoadState)(unsigned char *,unsigned int) = 0;
 
 /** RPLInit() ************************************************/
 /** Initialize record/relay subsystem.                      **/
@@ -370,7 +370,7 @@ unsigned int RPLCount(void)
 /*************************************************************/
 int SaveRPL(const char *FileName)
 {
-  static unsigned char Header[16] = "RPL\032\001\0\0\0\0\0\0\0\0\0\0\0";
+  static THREADLOCAL unsigned char Header[16] = "RPL\032\001\0\0\0\0\0\0\0\0\0\0\0";
   unsigned char Buf[16];
   FILE *F;
   int J,K;
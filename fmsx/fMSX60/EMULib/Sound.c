@@ -54,7 +54,7 @@ static const int Programs[] =
   80,  /* SND_WAVE */
 };
 
-static struct
+static THREADLOCAL struct
 {
   int Type;
   int Note;
@@ -81,7 +81,7 @@ static struct
   { -1,-1,-1,-1,256 }
 };
 
-static struct
+static THREADLOCAL struct
 {
   int Type;                       /* Channel type (SND_*)             */
   int Freq;                       /* Channel frequency (Hz)           */
@@ -114,20 +114,20 @@ static struct
 };
 
 /** RenderAudio() Variables *******************************************/
-static int SndRate    = 0;        /* Sound rate (0=Off)               */
-static int NoiseGen   = 0x10000;  /* Noise generator seed             */
-static int NoiseOut   = 16;       /* NoiseGen bit used for output     */
-static int NoiseXor   = 14;       /* NoiseGen bit used for XORing     */
-int MasterSwitch      = 0xFFFF;   /* Switches to turn channels on/off */
-int MasterVolume      = 192;      /* Master volume                    */
+static THREADLOCAL int SndRate    = 0;        /* Sound rate (0=Off)               */
+static THREADLOCAL int NoiseGen   = 0x10000;  /* Noise generator seed             */
+static THREADLOCAL int NoiseOut   = 16;       /* NoiseGen bit used for output     */
+static THREADLOCAL int NoiseXor   = 14;       /* NoiseGen bit used for XORing     */
+THREADLOCAL int MasterSwitch = 0xFFFF;     /* Switches to turn channels on/off */
+THREADLOCAL int MasterVolume = 192;        /* Master volume                    */
 
 /** MIDI Logging Variables ********************************************/
-static const char *LogName = 0;   /* MIDI logging file name           */
-static int  Logging   = MIDI_OFF; /* MIDI logging state (MIDI_*)      */
-static int  TickCount = 0;        /* MIDI ticks since WriteDelta()    */
-static int  LastMsg   = -1;       /* Last MIDI message                */
-static int  DrumOn    = 0;        /* 1: MIDI drums are ON             */
-static FILE *MIDIOut  = 0;        /* MIDI logging file handle         */
+static THREADLOCAL const char *LogName = 0;   /* MIDI logging file name           */
+static THREADLOCAL int  Logging   = MIDI_OFF; /* MIDI logging state (MIDI_*)      */
+static THREADLOCAL int  TickCount = 0;        /* MIDI ticks since WriteDelta()    */
+static THREADLOCAL int  LastMsg   = -1;       /* Last MIDI message                */
+static THREADLOCAL int  DrumOn    = 0;        /* 1: MIDI drums are ON             */
+static THREADLOCAL FILE *MIDIOut  = 0;        /* MIDI logging file handle         */
 
 static void MIDISound(int Channel,int Freq,int Volume);
 static void MIDISetSound(int Channel,int Type);
@@ -0,0 +1,32 @@
+/** EMULib Emulation Library *********************************/
+/**                                                         **/
+/**                      ThreadLocal.h                      **/
+/**                                                         **/
+/** This file defines THREADLOCAL, the storage class for    **/
+/** variables holding the state of an emulated machine.     **/
+/** Every thread gets its own copy of such variables, so    **/
+/** each thread can run a separate machine in one process.  **/
+/**                                                         **/
+/** Copyright (C) Marat Fayzullin 1996-2021                 **/
+/**     You are not allowed to distribute this software     **/
+/**     commercially. Please, notify me, if you make any    **/
+/**     changes to this file.                               **/
+/*************************************************************/
+#ifndef THREADLOCAL_H
+#define THREADLOCAL_H
+
+/** THREADLOCAL **********************************************/
+/** Compile with -DTHREADLOCAL= for compilers without       **/
+/** thread-local storage, limiting a process to one machine.**/
+/*************************************************************/
+#ifndef THREADLOCAL
+#if defined(_MSC_VER)
+#define THREADLOCAL __declspec(thread)
+#elif defined(__GNUC__)
+#define THREADLOCAL __thread
+#else
+#define THREADLOCAL _Thread_local
+#endif
+#endif
+
+#endif /* THREADLOCAL_H */
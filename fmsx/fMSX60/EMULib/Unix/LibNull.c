@@ -0,0 +1,184 @@
+/** EMULib Emulation Library *********************************/
+/**                                                         **/
+/**                        LibNull.c                        **/
+/**                                                         **/
+/** This file contains the headless Unix implementation     **/
+/** parts of the emulation library. Images are plain memory **/
+/** buffers from EMULib.c, ShowVideo() shows nothing, audio **/
+/** goes to the SetAudioHandler() handler, if any, and all  **/
+/** input functions report no input. The sync timer never   **/
+/** waits, it only tells how much real time has passed.     **/
+/**                                                         **/
+/** Copyright (C) Marat Fayzullin 1996-2021                 **/
+/**     You are not allowed to distribute this software     **/
+/**     commercially. Please, notify me, if you make any    **/
+/**     changes to this file.                               **/
+/*************************************************************/
+#include "EMULib.h"
+#include "Sound.h"
+
+#include <unistd.h>
+#include <sys/time.h>
+
+int  ARGC;
+char **ARGV;
+
+static THREADLOCAL int Effects = 0;        /* EFF_* bits     */
+static THREADLOCAL unsigned int AudioRate = 0; /* Sample rate */
+static THREADLOCAL void (*AudioHandler)(const sample *Data,unsigned int Length) = 0;
+static THREADLOCAL unsigned int TimerPeriod = 0; /* uSec or 0 */
+static THREADLOCAL struct timeval TimerStamp;  /* Last tick   */
+
+/** TimerTicks() *********************************************/
+/** Return the number of sync timer ticks since TimerStamp. **/
+/*************************************************************/
+static unsigned int TimerTicks(void)
+{
+  struct timeval T;
+
+  gettimeofday(&T,0);
+  return(
+    ((T.tv_sec-TimerStamp.tv_sec)*1000000+T.tv_usec-TimerStamp.tv_usec)
+    / TimerPeriod
+  );
+}
+
+/** ShowVideo() **********************************************/
+/** Show "active" image at the actual screen or window.     **/
+/** Headless video stays in VideoImg, so there is nothing   **/
+/** to do beyond checking that there is an image.           **/
+/*************************************************************/
+int ShowVideo(void) { return(VideoImg&&VideoImg->Data); }
+
+/** SetEffects() *********************************************/
+/** Set visual effects applied to video in ShowVideo().     **/
+/*************************************************************/
+void SetEffects(unsigned int NewEffects) { Effects=NewEffects; }
+
+/** ProcessEvents() ******************************************/
+/** There are no events to process.                         **/
+/*************************************************************/
+int ProcessEvents(int Wait) { return(1); }
+
+/** GetJoystick() ********************************************/
+/** Get the state of joypad buttons (1="pressed"). Refer to **/
+/** the BTN_* #defines for the button mappings.             **/
+/*************************************************************/
+unsigned int GetJoystick(void) { return(0); }
+
+/** GetMouse() ***********************************************/
+/** Get mouse position and button states in the following   **/
+/** format: RMB.LMB.Y[29-16].X[15-0].                       **/
+/*************************************************************/
+unsigned int GetMouse(void) { return(0); }
+
+/** GetKey() *************************************************/
+/** Get currently pressed key or 0 if none pressed. Returns **/
+/** CON_* definitions for arrows and special keys.          **/
+/*************************************************************/
+unsigned int GetKey(void) { return(0); }
+
+/** WaitKey() ************************************************/
+/** Nobody is going to press a key, so report CON_EXIT and  **/
+/** let menus and dialogs close instead of waiting forever. **/
+/*************************************************************/
+unsigned int WaitKey(void) { return(CON_EXIT); }
+
+/** WaitKeyOrMouse() *****************************************/
+/** Same as WaitKey(), reporting no mouse buttons.          **/
+/*************************************************************/
+unsigned int WaitKeyOrMouse(void) { return(0); }
+
+/** WaitSyncTimer() ******************************************/
+/** Headless emulation runs as fast as the CPU allows, so   **/
+/** this never waits. Returns number of timer ticks since   **/
+/** the last call, possibly 0, or 1 if there is no timer.   **/
+/*************************************************************/
+int WaitSyncTimer(void)
+{
+  unsigned int J;
+
+  if(!TimerPeriod) return(1);
+  J = TimerTicks();
+  if(J) gettimeofday(&TimerStamp,0);
+  return(J);
+}
+
+/** SyncTimerReady() *****************************************/
+/** Return 1 if sync timer ready, 0 otherwise.              **/
+/*************************************************************/
+int SyncTimerReady(void) { return(!TimerPeriod||TimerTicks()); }
+
+/** SetSyncTimer() *******************************************/
+/** Set synchronization timer to a given frequency in Hz.   **/
+/** Hz=0 turns the timer off.                               **/
+/*************************************************************/
+int SetSyncTimer(int Hz)
+{
+  TimerPeriod = Hz>0? 1000000/Hz:0;
+  gettimeofday(&TimerStamp,0);
+  return(1);
+}
+
+/** ChangeDir() **********************************************/
+/** This function is a wrapper for chdir().                 **/
+/*************************************************************/
+int ChangeDir(const char *Name) { return(chdir(Name)); }
+
+/** MicroSleep() *********************************************/
+/** Wait for a given number of microseconds.                **/
+/*************************************************************/
+void MicroSleep(unsigned int uS) { usleep(uS); }
+
+/** InitAudio() **********************************************/
+/** Initialize sound. Returns rate (Hz) on success, else 0. **/
+/** Rate=0 to skip initialization (will be silent).         **/
+/*************************************************************/
+unsigned int InitAudio(unsigned int Rate,unsigned int Latency)
+{
+  AudioRate = Rate;
+  return(Rate);
+}
+
+/** TrashAudio() *********************************************/
+/** Free resources allocated by InitAudio().                **/
+/*************************************************************/
+void TrashAudio(void) { AudioRate=0; }
+
+/** PauseAudio() *********************************************/
+/** Pause/resume audio playback. Returns current playback   **/
+/** state.                                                  **/
+/*************************************************************/
+int PauseAudio(int Switch) { return(0); }
+
+/** GetFreeAudio() *******************************************/
+/** Get the amount of free samples in the audio buffer. The **/
+/** "buffer" never fills up, so report a second of audio.   **/
+/*************************************************************/
+unsigned int GetFreeAudio(void) { return(AudioRate); }
+
+/** GetTotalAudio() ******************************************/
+/** Get total amount of samples in the audio buffer.        **/
+/*************************************************************/
+unsigned int GetTotalAudio(void) { return(AudioRate); }
+
+/** WriteAudio() *********************************************/
+/** Write up to a given number of samples to audio buffer.  **/
+/** Returns the number of samples written.                  **/
+/*************************************************************/
+unsigned int WriteAudio(sample *Data,unsigned int Length)
+{
+  if(!AudioRate) return(0);
+  if(AudioHandler) AudioHandler(Data,Length);
+  return(Length);
+}
+
+/** SetAudioHandler() ****************************************/
+/** Attach a handler receiving every buffer of samples that **/
+/** goes through WriteAudio(). The handler is per-thread,   **/
+/** SetAudioHandler(0) detaches it.                         **/
+/*************************************************************/
+void SetAudioHandler(void (*Handler)(const sample *Data,unsigned int Length))
+{
+  AudioHandler = Handler;
+}
@@ -29,8 +29,8 @@
 
 #define FPS_COLOR PIXEL(255,0,255)
 
-extern int MasterSwitch; /* Switches to turn channels on/off */
-extern int MasterVolume; /* Master volume                    */
+extern THREADLOCAL int MasterSwitch; /* Switches to turn channels on/off */
+extern THREADLOCAL int MasterVolume; /* Master volume                    */
 
 static volatile int TimerReady = 0;   /* 1: Sync timer ready */
 static volatile unsigned int JoyState = 0; /* Joystick state */
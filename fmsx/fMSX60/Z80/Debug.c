@@ -21,7 +21,8 @@
 
 #ifdef FMSX
 #include "AY8910.h"
-extern AY8910 PSG;
+#include "ThreadLocal.h"
+extern THREADLOCAL AY8910 PSG;
 #endif
 
 static const char *Mnemonics[256] =
@@ -0,0 +1,318 @@
+/** Z80: portable Z80 emulator *******************************/
+/**                                                         **/
+/**                         Profile.c                       **/
+/**                                                         **/
+/** This file contains the execution profiler. It is only   **/
+/** compiled with PROFILE #defined. OpenProfileZ80() makes  **/
+/** RunZ80()/ExecZ80() count executions and T-states per    **/
+/** PC, per opcode, and per memory bank, and follow CALLs,  **/
+/** RSTs, interrupts, and RETs to build a call tree. The    **/
+/** profile is per-thread, like the rest of machine state.  **/
+/**                                                         **/
+/** Copyright (C) Marat Fayzullin 1994-2021                 **/
+/**     You are not allowed to distribute this software     **/
+/**     commercially. Please, notify me, if you make any    **/
+/**     changes to this file.                               **/
+/*************************************************************/
+#ifdef PROFILE
+
+#include "Z80.h"
+#include "ThreadLocal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAXDEPTH  256      /* Deepest call stack tracked     */
+#define MAXOPS    (7*256)  /* Opcodes, plain and prefixed    */
+#define MAXBANKS  (256*8)  /* Bank IDs times 8kB pages       */
+
+typedef unsigned long long PrfCount;
+
+typedef struct
+{
+  word Addr;               /* Called address                 */
+  byte Bank;               /* Memory bank at Addr            */
+  int Parent,Child,Next;   /* Call tree links or -1          */
+  PrfCount Cycles;         /* T-states spent in the node     */
+} PrfNode;
+
+struct Z80Profile
+{
+  PrfCount Count[0x10000],Cycles[0x10000];     /* Per PC     */
+  PrfCount OpCount[MAXOPS],OpCycles[MAXOPS];   /* Per opcode */
+  PrfCount BankCount[MAXBANKS],BankCycles[MAXBANKS];
+
+  word PC,SP,Op;           /* Instruction being executed     */
+  byte Bank;               /* Memory bank at PC              */
+  int ICount;              /* ICount before the instruction  */
+  word NextPC,NextSP;      /* PC and SP after it             */
+  byte Ready;              /* 1: NextPC/NextSP are valid     */
+
+  PrfNode *Node;           /* Call tree, Node[0] is the root */
+  int Nodes,MaxNodes;      /* Nodes used and allocated       */
+  int Cur;                 /* Node being executed            */
+  struct { word SP;int Node; } Stack[MAXDEPTH];
+  int Depth;               /* Frames in Stack[]              */
+};
+
+THREADLOCAL struct Z80Profile *ProfZ80 = 0;
+
+static THREADLOCAL const PrfCount *SortKey;
+
+static const char *Prefixes[7] =
+{ "","CB ","ED ","DD ","FD ","DD CB ","FD CB " };
+
+/** NewNode() ************************************************/
+/** Add a call tree node under Parent. Returns node number  **/
+/** or -1 when out of memory.                               **/
+/*************************************************************/
+static int NewNode(struct Z80Profile *P,int Parent,word Addr,byte Bank)
+{
+  PrfNode *N;
+  int J;
+
+  if(P->Nodes>=P->MaxNodes)
+  {
+    J = P->MaxNodes? P->MaxNodes*2:1024;
+    N = (PrfNode *)realloc(P->Node,J*sizeof(PrfNode));
+    if(!N) return(-1);
+    P->Node     = N;
+    P->MaxNodes = J;
+  }
+
+  J = P->Nodes++;
+  N = P->Node+J;
+  N->Addr   = Addr;
+  N->Bank   = Bank;
+  N->Parent = Parent;
+  N->Child  = -1;
+  N->Next   = Parent>=0? P->Node[Parent].Child:-1;
+  N->Cycles = 0;
+  if(Parent>=0) P->Node[Parent].Child=J;
+  return(J);
+}
+
+/** Unwind() *************************************************/
+/** Drop stack frames with return addresses at SP or below. **/
+/** This handles RETs, as well as code that discards return **/
+/** addresses with POP or LD SP.                            **/
+/*************************************************************/
+static void Unwind(struct Z80Profile *P,word SP)
+{
+  while(P->Depth&&(P->Stack[P->Depth-1].SP<=SP))
+    P->Cur=P->Stack[--P->Depth].Node;
+}
+
+/** Call() ***************************************************/
+/** Enter a call to Addr with return address stored at SP.  **/
+/*************************************************************/
+static void Call(struct Z80Profile *P,word Addr,word SP)
+{
+  byte Bank;
+  int J;
+
+  Unwind(P,SP);
+  if(P->Depth>=MAXDEPTH) return;
+
+  /* Find the callee among the children of the current node */
+  Bank = BankZ80(Addr);
+  for(J=P->Node[P->Cur].Child;J>=0;J=P->Node[J].Next)
+    if((P->Node[J].Addr==Addr)&&(P->Node[J].Bank==Bank)) break;
+  if((J<0)&&((J=NewNode(P,P->Cur,Addr,Bank))<0)) return;
+
+  P->Stack[P->Depth].SP   = SP;
+  P->Stack[P->Depth].Node = P->Cur;
+  P->Depth++;
+  P->Cur = J;
+}
+
+/** OpenProfileZ80() *****************************************/
+/** Start profiling on the current thread. Returns 1 on     **/
+/** success, 0 on failure.                                  **/
+/*************************************************************/
+int OpenProfileZ80(void)
+{
+  struct Z80Profile *P;
+
+  if(ProfZ80) return(1);
+  if(!(P=(struct Z80Profile *)calloc(1,sizeof(struct Z80Profile)))) return(0);
+  if(NewNode(P,-1,0,0)<0) { free(P);return(0); }
+  ProfZ80=P;
+  return(1);
+}
+
+/** CloseProfileZ80() ****************************************/
+/** Stop profiling and free the collected profile.          **/
+/*************************************************************/
+void CloseProfileZ80(void)
+{
+  if(ProfZ80)
+  {
+    free(ProfZ80->Node);
+    free(ProfZ80);
+    ProfZ80=0;
+  }
+}
+
+/** StartOpZ80() *********************************************/
+/** Called by the CPU core before executing an instruction, **/
+/** given its opcode as Prefix*256+Opcode.                  **/
+/*************************************************************/
+void StartOpZ80(Z80 *R,word Op)
+{
+  struct Z80Profile *P = ProfZ80;
+
+  /* PC changed and a word got pushed between instructions: */
+  /* an interrupt was taken                                 */
+  if(P->Ready&&(R->PC.W!=P->NextPC)&&(R->SP.W==(word)(P->NextSP-2)))
+    Call(P,R->PC.W,R->SP.W);
+
+  P->PC     = R->PC.W;
+  P->SP     = R->SP.W;
+  P->Op     = Op;
+  P->Bank   = BankZ80(R->PC.W);
+  P->ICount = R->ICount;
+}
+
+/** EndOpZ80() ***********************************************/
+/** Called by the CPU core after executing an instruction.  **/
+/*************************************************************/
+void EndOpZ80(Z80 *R)
+{
+  struct Z80Profile *P = ProfZ80;
+  byte X,B;
+  int T,J;
+
+  X = P->Op>>8;
+  B = P->Op&0xFF;
+
+  /* EI and DI shuffle ICount around, the rest subtract */
+  /* their T-states, HALT counting the time it waits    */
+  T = !X&&((B==0xF3)||(B==0xFB))? 4:P->ICount-R->ICount;
+
+  P->Count[P->PC]++;
+  P->Cycles[P->PC]+=T;
+  P->OpCount[P->Op]++;
+  P->OpCycles[P->Op]+=T;
+  J = ((int)P->Bank<<3)|(P->PC>>13);
+  P->BankCount[J]++;
+  P->BankCycles[J]+=T;
+  P->Node[P->Cur].Cycles+=T;
+
+  /* Follow taken CALLs, RSTs, and RETs, plain or DD/FD */
+  if(!X||(X==3)||(X==4))
+  {
+    if(((B==0xCD)||((B&0xC7)==0xC4)||((B&0xC7)==0xC7))&&(R->SP.W==(word)(P->SP-2)))
+      Call(P,R->PC.W,R->SP.W);
+    else if(((B==0xC9)||((B&0xC7)==0xC0))&&(R->SP.W==(word)(P->SP+2)))
+      Unwind(P,P->SP);
+  }
+  else if((X==2)&&((B&0xC7)==0x45)) Unwind(P,P->SP);
+
+  P->NextPC = R->PC.W;
+  P->NextSP = R->SP.W;
+  P->Ready  = 1;
+}
+
+/** ByKey() **************************************************/
+/** qsort() helper ordering indices by SortKey, descending. **/
+/*************************************************************/
+static int ByKey(const void *A,const void *B)
+{
+  PrfCount KA = SortKey[*(const int *)A];
+  PrfCount KB = SortKey[*(const int *)B];
+  return(KA>KB? -1:KA<KB? 1:*(const int *)A-*(const int *)B);
+}
+
+/** Sorted() *************************************************/
+/** Fill Idx[] with indices of non-zero Count[] entries,    **/
+/** ordered by Cycles[]. Returns the number of entries.     **/
+/*************************************************************/
+static int Sorted(int *Idx,const PrfCount *Count,const PrfCount *Cycles,int N)
+{
+  int J,I;
+
+  for(J=I=0;J<N;++J) if(Count[J]) Idx[I++]=J;
+  SortKey=Cycles;
+  qsort(Idx,I,sizeof(int),ByKey);
+  return(I);
+}
+
+/** SaveProfileZ80() *****************************************/
+/** Save flat profile to a text file: executions, T-states, **/
+/** and share of time per PC, per opcode, and per bank:page.**/
+/** Returns 1 on success, 0 on failure.                     **/
+/*************************************************************/
+int SaveProfileZ80(const char *FileName)
+{
+  struct Z80Profile *P = ProfZ80;
+  PrfCount Total,Ops;
+  double Scale;
+  int *Idx,J,N;
+  FILE *F;
+
+  if(!P||!FileName) return(0);
+  if(!(Idx=(int *)malloc(0x10000*sizeof(int)))) return(0);
+  if(!(F=fopen(FileName,"wb"))) { free(Idx);return(0); }
+
+  for(J=0,Total=Ops=0;J<MAXOPS;++J) { Total+=P->OpCycles[J];Ops+=P->OpCount[J]; }
+  Scale = Total? 100.0/Total:0.0;
+
+  fprintf(F,"# Z80 profile: %llu instructions, %llu T-states\n",Ops,Total);
+
+  fprintf(F,"\n# PC        Count       T-states       %%\n");
+  N = Sorted(Idx,P->Count,P->Cycles,0x10000);
+  for(J=0;J<N;++J)
+    fprintf(F,"%04X %12llu %14llu %7.3f\n",
+      Idx[J],P->Count[Idx[J]],P->Cycles[Idx[J]],P->Cycles[Idx[J]]*Scale
+    );
+
+  fprintf(F,"\n# Opcode       Count       T-states       %%\n");
+  N = Sorted(Idx,P->OpCount,P->OpCycles,MAXOPS);
+  for(J=0;J<N;++J)
+    fprintf(F,"%-6s%02X %12llu %14llu %7.3f\n",
+      Prefixes[Idx[J]>>8],Idx[J]&0xFF,
+      P->OpCount[Idx[J]],P->OpCycles[Idx[J]],P->OpCycles[Idx[J]]*Scale
+    );
+
+  fprintf(F,"\n# Bank:Page     Count       T-states       %%\n");
+  N = Sorted(Idx,P->BankCount,P->BankCycles,MAXBANKS);
+  for(J=0;J<N;++J)
+    fprintf(F,"%02X:%04X %12llu %14llu %7.3f\n",
+      Idx[J]>>3,(Idx[J]&7)<<13,
+      P->BankCount[Idx[J]],P->BankCycles[Idx[J]],P->BankCycles[Idx[J]]*Scale
+    );
+
+  free(Idx);
+  J = !ferror(F);
+  return(!fclose(F)&&J);
+}
+
+/** SaveStacksZ80() ******************************************/
+/** Save T-states per call stack in the collapsed format    **/
+/** taken by flame graph tools: "Z80;BB:AAAA;... T-states", **/
+/** with each frame named by bank and called address.       **/
+/** Returns 1 on success, 0 on failure.                     **/
+/*************************************************************/
+int SaveStacksZ80(const char *FileName)
+{
+  struct Z80Profile *P = ProfZ80;
+  int Path[MAXDEPTH+1],J,I,N;
+  FILE *F;
+
+  if(!P||!FileName||!(F=fopen(FileName,"wb"))) return(0);
+
+  for(J=0;J<P->Nodes;++J)
+    if(P->Node[J].Cycles)
+    {
+      for(N=0,I=J;I>0;I=P->Node[I].Parent) Path[N++]=I;
+      fputs("Z80",F);
+      while(N--) fprintf(F,";%02X:%04X",P->Node[Path[N]].Bank,P->Node[Path[N]].Addr);
+      fprintf(F," %llu\n",P->Node[J].Cycles);
+    }
+
+  J = !ferror(F);
+  return(!fclose(F)&&J);
+}
+
+#endif /* PROFILE */
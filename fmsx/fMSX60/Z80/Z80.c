@@ -53,8 +53,9 @@ INLINE byte RdZ80(word A) { return(Page[A>>13][A&0x1FFF]); }
 #endif
 
 #ifdef FMSX
+#include "ThreadLocal.h"
 #define FAST_RDOP
-extern byte *RAM[];
+extern THREADLOCAL byte *RAM[];
 INLINE byte OpZ80(word A) { return(RAM[A>>13][A&0x1FFF]); }
 #endif
 
@@ -502,6 +503,33 @@ static void CodesFD(register Z80 *R)
 #undef XX
 }
 
+#ifdef PROFILE
+#include "ThreadLocal.h"
+extern THREADLOCAL struct Z80Profile *ProfZ80;
+
+/** ProfileOp() **********************************************/
+/** Return opcode at A as Prefix*256+Opcode for profiling,  **/
+/** with prefixes 0:none, 1:CB, 2:ED, 3:DD, 4:FD, 5:DD CB,  **/
+/** and 6:FD CB.                                            **/
+/*************************************************************/
+INLINE word ProfileOp(word A)
+{
+  byte I,X;
+
+  switch(I=OpZ80(A))
+  {
+    case PFX_CB: return(0x100|OpZ80(A+1));
+    case PFX_ED: return(0x200|OpZ80(A+1));
+    case PFX_DD:
+    case PFX_FD:
+      X = I==PFX_DD? 3:4;
+      I = OpZ80(A+1);
+      return(I==PFX_CB? ((X+2)<<8)|OpZ80(A+3):(X<<8)|I);
+  }
+  return(I);
+}
+#endif /* PROFILE */
+
 /** ResetZ80() ***********************************************/
 /** This function can be used to reset the register struct  **/
 /** before starting execution with Z80(). It sets the       **/
@@ -554,6 +582,11 @@ int ExecZ80(register Z80 *R,register int RunCycles)
         if(!DebugZ80(R)) return(R->ICount);
 #endif
 
+#ifdef PROFILE
+      /* Let profiler see the instruction */
+      if(ProfZ80) StartOpZ80(R,ProfileOp(R->PC.W));
+#endif
+
       /* Read opcode and count cycles */
       I=OpZ80(R->PC.W++);
       R->ICount-=Cycles[I];
@@ -570,6 +603,11 @@ int ExecZ80(register Z80 *R,register int RunCycles)
         case PFX_FD: CodesFD(R);break;
         case PFX_DD: CodesDD(R);break;
       }
+
+#ifdef PROFILE
+      /* Count T-states taken, calls and returns made */
+      if(ProfZ80) EndOpZ80(R);
+#endif
     }
 
     /* Unless we have come here after EI, exit */
@@ -673,6 +711,11 @@ word RunZ80(Z80 *R)
 }
 #endif
 
+#ifdef PROFILE
+    /* Let profiler see the instruction */
+    if(ProfZ80) StartOpZ80(R,ProfileOp(R->PC.W));
+#endif
+
     /* Read opcode and count cycles */
     I=OpZ80(R->PC.W++);
     R->ICount-=Cycles[I];
@@ -688,6 +731,11 @@ word RunZ80(Z80 *R)
       case PFX_FD: CodesFD(R);break;
       case PFX_DD: CodesDD(R);break;
     }
+
+#ifdef PROFILE
+    /* Count T-states taken, calls and returns made */
+    if(ProfZ80) EndOpZ80(R);
+#endif
  
     /* If cycle counter expired... */
     if(R->ICount<=0)
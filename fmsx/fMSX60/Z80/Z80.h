@@ -19,6 +19,7 @@ extern "C" {
 
                                /* Compilation options:       */
 /* #define DEBUG */            /* Compile debugging version  */
+/* #define PROFILE */          /* Compile execution profiler */
 /* #define LSB_FIRST */        /* Compile for low-endian CPU */
 /* #define MSB_FIRST */        /* Compile for hi-endian CPU  */
 
@@ -162,6 +163,35 @@ void PatchZ80(register Z80 *R);
 byte DebugZ80(register Z80 *R);
 #endif
 
+/** Profiler *************************************************/
+/** These functions exist if PROFILE is #defined. Once the  **/
+/** OpenProfileZ80() is called, RunZ80()/ExecZ80() count    **/
+/** executions and T-states per PC, per opcode, and per     **/
+/** memory bank, and build call stacks from CALLs, RSTs,    **/
+/** interrupts, and RETs, until CloseProfileZ80(). When not **/
+/** open, the profiler costs one test per instruction.      **/
+/** SaveProfileZ80() writes a flat profile, SaveStacksZ80() **/
+/** writes collapsed stacks for flame graph tools. The      **/
+/** profile belongs to the calling thread.                  **/
+/*************************************************************/
+#ifdef PROFILE
+int  OpenProfileZ80(void);
+void CloseProfileZ80(void);
+int  SaveProfileZ80(const char *FileName);
+int  SaveStacksZ80(const char *FileName);
+void StartOpZ80(register Z80 *R,register word Op);
+void EndOpZ80(register Z80 *R);
+#endif
+
+/** BankZ80() ************************************************/
+/** This function should exist if PROFILE is #defined. It   **/
+/** returns an ID of the memory bank currently visible at   **/
+/** the given address, such as a slot or a ROM page number. **/
+/************************************ TO BE WRITTEN BY USER **/
+#ifdef PROFILE
+byte BankZ80(register word Addr);
+#endif
+
 /** LoopZ80() ************************************************/
 /** Z80 emulation calls this function periodically to check **/
 /** if the system hardware requires any interrupts. This    **/
@@ -11,7 +11,7 @@
 /**     changes to this file.                               **/
 /*************************************************************/
 
-static byte BootBlock[] =
+static THREADLOCAL byte BootBlock[] =
 {
   0xEB,0xFE,0x90,0x56,0x46,0x42,0x2D,0x31,0x39,0x38,0x39,0x00,0x02,0x02,0x01,0x00,
   0x02,0x70,0x00,0xA0,0x05,0xF9,0x03,0x00,0x09,0x00,0x02,0x00,0x00,0x00,0xD0,0xED,
@@ -13,13 +13,14 @@
 /**     changes to this file.                               **/
 /*************************************************************/
 
-static int FirstLine = 18;     /* First scanline in the XBuf */
+#include "YJK.h"
+
+static THREADLOCAL int FirstLine = 18;     /* First scanline in the XBuf */
 
 static void  Sprites(byte Y,pixel *Line);
 static void  ColorSprites(byte Y,byte *ZBuf);
 static pixel *RefreshBorder(byte Y,pixel C);
 static void  ClearLine(pixel *P,pixel C);
-static pixel YJKColor(int Y,int J,int K);
 
 /** RefreshScreen() ******************************************/
 /** Refresh screen. This function is called in the end of   **/
@@ -37,25 +38,6 @@ static void ClearLine(register pixel *P,register pixel C)
   for(J=0;J<256;J++) P[J]=C;
 }
 
-/** YJKColor() ***********************************************/
-/** Given a color in YJK format, return the corresponding   **/
-/** palette entry.                                          **/
-/*************************************************************/
-INLINE pixel YJKColor(register int Y,register int J,register int K)
-{
-  register int R,G,B;
-		
-  R=Y+J;
-  G=Y+K;
-  B=((5*Y-2*J-K)/4);
-
-  R=R<0? 0:R>31? 31:R;
-  G=G<0? 0:G>31? 31:G;
-  B=B<0? 0:B>31? 31:B;
-
-  return(BPal[(R&0x1C)|((G&0x1C)<<3)|(B>>3)]);
-}
-
 /** RefreshBorder() ******************************************/
 /** This function is called from RefreshLine#() to refresh  **/
 /** the screen border. It returns a pointer to the start of **/
@@ -108,48 +90,15 @@ void Sprites(register byte Y,register pixel *Line)
   register unsigned int M;
   register int L,K;
 
-  /* No extra sprites yet */
-  VDPStatus[0]&=~0x5F;
-
-  /* Assign initial values before counting */
+  /* Sprites shown in this line, and 5th sprite status */
   OH = SprHeights[VDP[1]&0x03];
   IH = SprHeights[VDP[1]&0x02];
-  AT = SprTab-4;
   Y += VScroll;
-  C  = MAXSPRITE1+1;
-  M  = 0;
+  M  = ShownSprites(Y);
 
-  /* Count displayed sprites */
-  for(L=0;L<32;++L)
-  {
-    M<<=1;AT+=4;        /* Iterating through SprTab      */
-    K=AT[0];            /* K = sprite Y coordinate       */
-    if(K==208) break;   /* Iteration terminates if Y=208 */
-    if(K>256-IH) K-=256; /* Y coordinate may be negative  */
-
-    /* Mark all valid sprites with 1s, break at MAXSPRITE1 sprites */
-    if((Y>K)&&(Y<=K+OH))
-    {
-      /* If we exceed the maximum number of sprites per line... */
-      if(!--C)
-      {
-        /* Set 5thSprite flag in the VDP status register */
-        VDPStatus[0]|=0x40;
-        /* Stop drawing sprites, unless all-sprites option enabled */
-        if(!OPTION(MSX_ALLSPRITE)) break;
-      }
-
-      /* Mark sprite as ready to draw */
-      M|=1;
-    }
-  }
-
-  /* Mark last checked sprite (5th in line, Y=208, or sprite #31) */
-  VDPStatus[0]|=L<32? L:31;
-
-  /* Draw all marked sprites */
-  for(;M;M>>=1,AT-=4)
-    if(M&1)
+  /* Draw all marked sprites, from sprite #31 down */
+  for(AT=SprTab+31*4;M;M<<=1,AT-=4)
+    if(M&0x80000000)
     {
       C = AT[3];                  /* C = sprite attributes */
       L = C&0x80? AT[1]-32:AT[1]; /* Sprite may be shifted left by 32 */
@@ -254,7 +203,7 @@ void ColorSprites(register byte Y,byte *ZBuf)
   static const byte SprHeights[4] = { 8,16,16,32 };
   register byte C,IH,OH,J,OrThem;
   register byte *P,*PT,*AT;
-  register int L,K;
+  register int K;
   register unsigned int M;
 
   /* No extra sprites yet */
@@ -264,46 +213,15 @@ void ColorSprites(register byte Y,byte *ZBuf)
   memset(ZBuf+32,0,256);
   if(SpritesOFF) return;
 
-  /* Assign initial values before counting */
+  /* Sprites shown in this line, and 9th sprite status */
   OrThem = 0x00;
   OH = SprHeights[VDP[1]&0x03];
   IH = SprHeights[VDP[1]&0x02];
-  AT = SprTab-4;
-  C  = MAXSPRITE2+1;
-  M  = 0;
+  M  = ShownSprites(Y);
 
-  /* Count displayed sprites */
-  for(L=0;L<32;++L)
-  {
-    M<<=1;AT+=4;              /* Iterating through SprTab      */
-    K=AT[0];                  /* Read Y from SprTab            */
-    if(K==216) break;         /* Iteration terminates if Y=216 */
-    K=(byte)(K-VScroll);      /* Sprite's actual Y coordinate  */
-    if(K>256-IH) K-=256;       /* Y coordinate may be negative  */
-
-    /* Mark all valid sprites with 1s, break at MAXSPRITE2 sprites */
-    if((Y>K)&&(Y<=K+OH))
-    {
-      /* If we exceed the maximum number of sprites per line... */
-      if(!--C)
-      {
-        /* Set 9thSprite flag in the VDP status register */
-        VDPStatus[0]|=0x40;
-        /* Stop drawing sprites, unless all-sprites option enabled */
-        if(!OPTION(MSX_ALLSPRITE)) break;
-      }
-
-      /* Mark sprite as ready to draw */
-      M|=1;
-    }
-  }
-
-  /* Mark last checked sprite (9th in line, Y=216, or sprite #31) */
-  VDPStatus[0]|=L<32? L:31;
-
-  /* Draw all marked sprites */
-  for(;M;M>>=1,AT-=4)
-    if(M&1)
+  /* Draw all marked sprites, from sprite #31 down */
+  for(AT=SprTab+31*4;M;M<<=1,AT-=4)
+    if(M&0x80000000)
     {
       K = (byte)(AT[0]-VScroll);  /* K = sprite Y coordinate */
       if(K>256-IH) K-=256;        /* Y coordinate may be negative */
@@ -456,6 +374,9 @@ void RefreshLine0(register byte Y)
   register pixel *P,FC,BC;
   register byte X,*T,*G;
 
+  /* Keep the line if nothing shown in it has changed */
+  if(!LineChanged(Y)) return;
+
   BC=XPal[BGColor];
   P=RefreshBorder(Y,BC);
   if(!P) return;
@@ -491,6 +412,16 @@ void RefreshLine1(register byte Y)
   register pixel *P,FC,BC;
   register byte K,X,*T,*G;
 
+  /* Keep the line if nothing shown in it has changed, but */
+  /* set 5th sprite status, as Sprites() would do. It adds */
+  /* VScroll to the line already scrolled by VScroll.      */
+  if(!LineChanged(Y))
+  {
+    if(ScreenON&&!SpritesOFF&&(Y+FirstLine<HEIGHT))
+      ShownSprites(Y+VScroll+VScroll);
+    return;
+  }
+
   P=RefreshBorder(Y,XPal[BGColor]);
   if(!P) return;
 
@@ -527,6 +458,16 @@ void RefreshLine2(register byte Y)
   register byte K,X,*T;
   register int I,J;
 
+  /* Keep the line if nothing shown in it has changed, but */
+  /* set 5th sprite status, as Sprites() would do. It adds */
+  /* VScroll to the line already scrolled by VScroll.      */
+  if(!LineChanged(Y))
+  {
+    if(ScreenON&&!SpritesOFF&&(Y+FirstLine<HEIGHT))
+      ShownSprites(Y+VScroll+VScroll);
+    return;
+  }
+
   P=RefreshBorder(Y,XPal[BGColor]);
   if(!P) return;
 
@@ -715,9 +656,9 @@ void RefreshLine8(register byte Y)
 void RefreshLine10(register byte Y)
 {
   register pixel *P;
-  register byte C,X,*T,*R;
-  register int J,K;
-  byte ZBuf[320];
+  register byte C,*T,*R;
+  register int X;
+  byte ZBuf[320],I[252];
 
   P=RefreshBorder(Y,BPal[VDP[7]]);
   if(!P) return;
@@ -736,17 +677,12 @@ void RefreshLine10(register byte Y)
     C=R[3];P[3]=C? XPal[C]:BPal[VDP[7]];
     R+=4;P+=4;
 
-    for(X=0;X<63;X++,T+=4,R+=4,P+=4)
+    /* Convert YJK to BPal[] indices, then merge with sprites */
+    /* and YAE colors (Y&1), where YAE color is Y>>1=T[X]>>4  */
+    YJKIndex(I,T,252);
+    for(X=0;X<252;X++)
     {
-      K=(T[0]&0x07)|((T[1]&0x07)<<3);
-      if(K&0x20) K-=64;
-      J=(T[2]&0x07)|((T[3]&0x07)<<3);
-      if(J&0x20) J-=64;
-
-      C=R[0];Y=T[0]>>3;P[0]=C? XPal[C]:Y&1? XPal[Y>>1]:YJKColor(Y,J,K);
-      C=R[1];Y=T[1]>>3;P[1]=C? XPal[C]:Y&1? XPal[Y>>1]:YJKColor(Y,J,K);
-      C=R[2];Y=T[2]>>3;P[2]=C? XPal[C]:Y&1? XPal[Y>>1]:YJKColor(Y,J,K);
-      C=R[3];Y=T[3]>>3;P[3]=C? XPal[C]:Y&1? XPal[Y>>1]:YJKColor(Y,J,K);
+      C=R[X];P[X]=C? XPal[C]:T[X]&0x08? XPal[T[X]>>4]:BPal[I[X]];
     }
   }
 }
@@ -758,9 +694,9 @@ void RefreshLine10(register byte Y)
 void RefreshLine12(register byte Y)
 {
   register pixel *P;
-  register byte C,X,*T,*R;
-  register int J,K;
-  byte ZBuf[320];
+  register byte C,*T,*R;
+  register int X;
+  byte ZBuf[320],I[252];
 
   P=RefreshBorder(Y,BPal[VDP[7]]);
   if(!P) return;
@@ -782,17 +718,11 @@ void RefreshLine12(register byte Y)
     C=R[3];P[3]=C? XPal[C]:BPal[VDP[7]];
     R+=4;P+=4;
 
-    for(X=1;X<64;X++,T+=4,R+=4,P+=4)
+    /* Convert YJK to BPal[] indices, then merge with sprites */
+    YJKIndex(I,T,252);
+    for(X=0;X<252;X++)
     {
-      K=(T[0]&0x07)|((T[1]&0x07)<<3);
-      if(K&0x20) K-=64;
-      J=(T[2]&0x07)|((T[3]&0x07)<<3);
-      if(J&0x20) J-=64;
-
-      C=R[0];P[0]=C? XPal[C]:YJKColor(T[0]>>3,J,K);
-      C=R[1];P[1]=C? XPal[C]:YJKColor(T[1]>>3,J,K);
-      C=R[2];P[2]=C? XPal[C]:YJKColor(T[2]>>3,J,K);
-      C=R[3];P[3]=C? XPal[C]:YJKColor(T[3]>>3,J,K);
+      C=R[X];P[X]=C? XPal[C]:BPal[I[X]];
     }
   }
 }
@@ -23,7 +23,7 @@
 #undef BPP32
 
 /** Screen Mode Handlers [number of screens + 1] *************/
-extern void (*RefreshLine[MAXSCREEN+2])(byte Y);
+extern THREADLOCAL void (*RefreshLine[MAXSCREEN+2])(byte Y);
 
 #define BPP8
 #define pixel            unsigned char
@@ -34,7 +34,6 @@ extern void (*RefreshLine[MAXSCREEN+2])(byte Y);
 #define RefreshBorder512 RefreshBorder512_8
 #define ClearLine        ClearLine_8
 #define ClearLine512     ClearLine512_8
-#define YJKColor         YJKColor_8
 #define RefreshScreen    RefreshScreen_8
 #define RefreshLineF     RefreshLineF_8
 #define RefreshLine0     RefreshLine0_8
@@ -59,7 +58,6 @@ extern void (*RefreshLine[MAXSCREEN+2])(byte Y);
 #undef RefreshBorder512
 #undef ClearLine      
 #undef ClearLine512
-#undef YJKColor       
 #undef RefreshScreen  
 #undef RefreshLineF   
 #undef RefreshLine0   
@@ -85,7 +83,6 @@ extern void (*RefreshLine[MAXSCREEN+2])(byte Y);
 #define RefreshBorder512 RefreshBorder512_16
 #define ClearLine        ClearLine_16
 #define ClearLine512     ClearLine512_16
-#define YJKColor         YJKColor_16
 #define RefreshScreen    RefreshScreen_16
 #define RefreshLineF     RefreshLineF_16
 #define RefreshLine0     RefreshLine0_16
@@ -110,7 +107,6 @@ extern void (*RefreshLine[MAXSCREEN+2])(byte Y);
 #undef RefreshBorder512
 #undef ClearLine      
 #undef ClearLine512
-#undef YJKColor       
 #undef RefreshScreen  
 #undef RefreshLineF   
 #undef RefreshLine0   
@@ -136,7 +132,6 @@ extern void (*RefreshLine[MAXSCREEN+2])(byte Y);
 #define RefreshBorder512 RefreshBorder512_32
 #define ClearLine        ClearLine_32
 #define ClearLine512     ClearLine512_32
-#define YJKColor         YJKColor_32
 #define RefreshScreen    RefreshScreen_32
 #define RefreshLineF     RefreshLineF_32
 #define RefreshLine0     RefreshLine0_32
@@ -161,7 +156,6 @@ extern void (*RefreshLine[MAXSCREEN+2])(byte Y);
 #undef RefreshBorder512
 #undef ClearLine      
 #undef ClearLine512
-#undef YJKColor       
 #undef RefreshScreen  
 #undef RefreshLineF   
 #undef RefreshLine0   
@@ -27,6 +27,10 @@ static const char *HelpText[] =
   "                         8 - Memory      16 - Illegal Z80 ops",
   "                        32 - I/O",
   "  -skip <percent>     - Percentage of frames to skip [25]",
+  "  -turbo              - Run unthrottled and silent, drawing frames",
+  "                        at the sync rate [off]",
+  "  -fasttape/-nofasttape - BLOAD tape files straight to RAM,",
+  "                        ignoring BLOAD offsets [-nofasttape]",
   "  -pal/-ntsc          - Set PAL/NTSC HBlank/VBlank periods [NTSC]",
   "  -help               - Print this help page",
   "  -home <dirname>     - Set directory with system ROM files [off]",
@@ -67,6 +71,19 @@ static const char *HelpText[] =
   "                        <address>, execution will trap immediately)",
 #endif /* DEBUG */
 
+#if defined(PROFILE)
+  "  -profile <filename> - Save per-PC, per-opcode, and per-slot Z80",
+  "                        time to <filename> on exit",
+  "  -stacks <filename>  - Save Z80 time per call stack to <filename>",
+  "                        on exit, in flame graph collapsed format",
+#endif /* PROFILE */
+
+#if defined(HOSTPERF)
+  "  -perf               - Print host time per subsystem on exit",
+  "  -perflog <filename> - Same, also saving host time per frame",
+  "                        to <filename> (.CSV)",
+#endif /* HOSTPERF */
+
 #if defined(MSDOS) || defined(UNIX) || defined(MAEMO)
   "  -sync <frequency>   - Sync screen updates to <frequency> [60]",
   "  -nosync             - Do not sync screen updates",
@@ -91,6 +108,12 @@ static const char *HelpText[] =
   "  -scale <factor>     - Scale window by <factor> [2]",
 #endif /* UNIX */
 
+#if defined(UNIX) && defined(HEADLESS)
+  "  -frames <count>     - Exit after <count> frames [run forever]",
+  "  -snap <filename>    - Save the last frame to <filename> (.PPM)",
+  "                        (SIGUSR1 saves the next frame at any time)",
+#endif /* UNIX && HEADLESS */
+
 #if defined(MSDOS)
   "  -vsync              - Sync screen updates to VBlank [-vsync]",
 #if defined(BPP8)
@@ -18,6 +18,7 @@
 #include "Floppy.h"
 #include "SHA1.h"
 #include "MCF.h"
+#include "Perf.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -26,6 +27,10 @@
 #include <unistd.h>
 #include <time.h>
 
+#ifdef UNIX
+#include <sys/time.h>
+#endif
+
 #ifdef __BORLANDC__
 #include <dir.h>
 #endif
@@ -57,141 +62,176 @@
 #endif
 
 /** User-defined parameters for fMSX *************************/
-int  Mode        = MSX_MSX2|MSX_NTSC|MSX_MSXDOS2|MSX_GUESSA|MSX_GUESSB;
-byte Verbose     = 1;              /* Debug msgs ON/OFF      */
-byte UPeriod     = 75;             /* % of frames to draw    */
-int  VPeriod     = CPU_VPERIOD;    /* CPU cycles per VBlank  */
-int  HPeriod     = CPU_HPERIOD;    /* CPU cycles per HBlank  */
-int  RAMPages    = 4;              /* Number of RAM pages    */
-int  VRAMPages   = 2;              /* Number of VRAM pages   */
-byte ExitNow     = 0;              /* 1 = Exit the emulator  */
+THREADLOCAL int  Mode        = MSX_MSX2|MSX_NTSC|MSX_MSXDOS2|MSX_GUESSA|MSX_GUESSB;
+THREADLOCAL byte Verbose     = 1;              /* Debug msgs ON/OFF      */
+THREADLOCAL byte UPeriod     = 75;             /* % of frames to draw    */
+THREADLOCAL int  VPeriod     = CPU_VPERIOD;    /* CPU cycles per VBlank  */
+THREADLOCAL int  HPeriod     = CPU_HPERIOD;    /* CPU cycles per HBlank  */
+THREADLOCAL int  RAMPages    = 4;              /* Number of RAM pages    */
+THREADLOCAL int  VRAMPages   = 2;              /* Number of VRAM pages   */
+THREADLOCAL byte ExitNow     = 0;              /* 1 = Exit the emulator  */
+THREADLOCAL byte SaveFiles   = 1;              /* 0 = No CMOS/SRAM saves */
+THREADLOCAL unsigned int RTCTime = 0;          /* Fixed RTC time, 0=host */
+THREADLOCAL byte Turbo       = 0;              /* 1 = Run unthrottled    */
+THREADLOCAL double EmuTime   = 0.0;            /* Emulated seconds       */
 
 /** Main hardware: CPU, RAM, VRAM, mappers *******************/
-Z80 CPU;                           /* Z80 CPU state and regs */
+THREADLOCAL Z80 CPU;                           /* Z80 CPU state and regs */
 
-byte *VRAM,*VPAGE;                 /* Video RAM              */
+THREADLOCAL byte *VRAM,*VPAGE;                 /* Video RAM              */
 
-byte *RAM[8];                      /* Main RAM (8x8kB pages) */
-byte *EmptyRAM;                    /* Empty RAM page (8kB)   */
-byte SaveCMOS;                     /* Save CMOS.ROM on exit  */
-byte *MemMap[4][4][8];   /* Memory maps [PPage][SPage][Addr] */
+THREADLOCAL byte *RAM[8];                      /* Main RAM (8x8kB pages) */
+THREADLOCAL byte *EmptyRAM;                    /* Empty RAM page (8kB)   */
+THREADLOCAL byte SaveCMOS;                     /* Save CMOS.ROM on exit  */
+THREADLOCAL byte *MemMap[4][4][8];   /* Memory maps [PPage][SPage][Addr] */
 
-byte *RAMData;                     /* RAM Mapper contents    */
-byte RAMMapper[4];                 /* RAM Mapper state       */
-byte RAMMask;                      /* RAM Mapper mask        */
+THREADLOCAL byte *RAMData;                     /* RAM Mapper contents    */
+THREADLOCAL byte RAMMapper[4];                 /* RAM Mapper state       */
+THREADLOCAL byte RAMMask;                      /* RAM Mapper mask        */
 
-byte *ROMData[MAXSLOTS];           /* ROM Mapper contents    */
-byte ROMMapper[MAXSLOTS][4];       /* ROM Mappers state      */
-byte ROMMask[MAXSLOTS];            /* ROM Mapper masks       */
-byte ROMType[MAXSLOTS];            /* ROM Mapper types       */
+THREADLOCAL byte *ROMData[MAXSLOTS];           /* ROM Mapper contents    */
+THREADLOCAL byte ROMMapper[MAXSLOTS][4];       /* ROM Mappers state      */
+THREADLOCAL byte ROMMask[MAXSLOTS];            /* ROM Mapper masks       */
+THREADLOCAL byte ROMType[MAXSLOTS];            /* ROM Mapper types       */
 
-byte EnWrite[4];                   /* 1 if write enabled     */
-byte PSL[4],SSL[4];                /* Lists of current slots */
-byte PSLReg,SSLReg[4];   /* Storage for A8h port and (FFFFh) */
+THREADLOCAL byte EnWrite[4];                   /* 1 if write enabled     */
+THREADLOCAL byte PSL[4],SSL[4];                /* Lists of current slots */
+THREADLOCAL byte PSLReg,SSLReg[4];   /* Storage for A8h port and (FFFFh) */
 
 /** Memory blocks to free in TrashMSX() **********************/
-void *Chunks[MAXCHUNKS];           /* Memory blocks to free  */
-int NChunks;                       /* Number of memory blcks */
+THREADLOCAL void *Chunks[MAXCHUNKS];           /* Memory blocks to free  */
+THREADLOCAL int NChunks;                       /* Number of memory blcks */
 
 /** Working directory names **********************************/
-const char *ProgDir = 0;           /* Program directory      */
-const char *WorkDir;               /* Working directory      */
+THREADLOCAL const char *ProgDir = 0;           /* Program directory      */
+THREADLOCAL const char *WorkDir;               /* Working directory      */
 
 /** Cartridge files used by fMSX *****************************/
-const char *ROMName[MAXCARTS] = { "CARTA.ROM","CARTB.ROM" };
+THREADLOCAL const char *ROMName[MAXCARTS] = { "CARTA.ROM","CARTB.ROM" };
 
 /** On-cartridge SRAM data ***********************************/
-char *SRAMName[MAXSLOTS] = {0,0,0,0,0,0};/* Filenames (gen-d)*/
-byte SaveSRAM[MAXSLOTS] = {0,0,0,0,0,0}; /* Save SRAM on exit*/
-byte *SRAMData[MAXSLOTS];          /* SRAM (battery backed)  */
+THREADLOCAL char *SRAMName[MAXSLOTS] = {0,0,0,0,0,0};/* Filenames (gen-d)*/
+THREADLOCAL byte SaveSRAM[MAXSLOTS] = {0,0,0,0,0,0}; /* Save SRAM on exit*/
+THREADLOCAL byte *SRAMData[MAXSLOTS];          /* SRAM (battery backed)  */
 
 /** Disk images used by fMSX *********************************/
-const char *DSKName[MAXDRIVES] = { "DRIVEA.DSK","DRIVEB.DSK" };
+THREADLOCAL const char *DSKName[MAXDRIVES] = { "DRIVEA.DSK","DRIVEB.DSK" };
 
 /** Soundtrack logging ***************************************/
-const char *SndName = "LOG.MID";   /* Sound log file         */
+THREADLOCAL const char *SndName = "LOG.MID";   /* Sound log file         */
 
 /** Emulation state saving ***********************************/
-const char *STAName = "DEFAULT.STA";/* State file (autogen-d)*/
+THREADLOCAL const char *STAName = "DEFAULT.STA";/* State file (autogen-d)*/
 
 /** Fixed font used by fMSX **********************************/
-const char *FNTName = "DEFAULT.FNT"; /* Font file for text   */
-byte *FontBuf;                     /* Font for text modes    */
+THREADLOCAL const char *FNTName = "DEFAULT.FNT"; /* Font file for text   */
+THREADLOCAL byte *FontBuf;                     /* Font for text modes    */
 
 /** Printer **************************************************/
-const char *PrnName = 0;           /* Printer redirect. file */
-FILE *PrnStream;
+THREADLOCAL const char *PrnName = 0;           /* Printer redirect. file */
+THREADLOCAL FILE *PrnStream;
+
+/** Z80 execution profile (#ifdef PROFILE) *******************/
+THREADLOCAL const char *PrfName = 0;           /* Flat profile file      */
+THREADLOCAL const char *StkName = 0;           /* Collapsed stacks file  */
 
 /** Cassette tape ********************************************/
-const char *CasName = "DEFAULT.CAS";  /* Tape image file     */
-FILE *CasStream;
+THREADLOCAL const char *CasName = "DEFAULT.CAS";  /* Tape image file     */
+THREADLOCAL FILE *CasStream;                   /* Tape file, for writing */
+static THREADLOCAL byte *CasData;              /* Whole tape in memory   */
+static THREADLOCAL int  CasSize,CasMax;        /* Tape and buffer sizes  */
+static THREADLOCAL int  CasPos;                /* Current tape position  */
+static THREADLOCAL int  *CasBlocks;            /* Block header offsets   */
+static THREADLOCAL int  CasCount,CasBlockMax;  /* Number of headers      */
+static THREADLOCAL byte CasInject[7];          /* Served before CasData  */
+static THREADLOCAL int  CasInjectPos,CasInjectLen;
+
+/** Cassette block header, at 8-byte boundaries **************/
+static const byte CasHeader[8] =
+{ 0x1F,0xA6,0xDE,0xBA,0xCC,0x13,0x7D,0x74 };
 
 /** Serial port **********************************************/
-const char *ComName = 0;           /* Serial redirect. file  */
-FILE *ComIStream;
-FILE *ComOStream;
+THREADLOCAL const char *ComName = 0;           /* Serial redirect. file  */
+THREADLOCAL FILE *ComIStream;
+THREADLOCAL FILE *ComOStream;
 
 /** Kanji font ROM *******************************************/
-byte *Kanji;                       /* Kanji ROM 4096x32      */
-int  KanLetter;                    /* Current letter index   */
-byte KanCount;                     /* Byte count 0..31       */
+THREADLOCAL byte *Kanji;                       /* Kanji ROM 4096x32      */
+THREADLOCAL int  KanLetter;                    /* Current letter index   */
+THREADLOCAL byte KanCount;                     /* Byte count 0..31       */
 
 /** Keyboard, joystick, and mouse ****************************/
-volatile byte KeyState[16];        /* Keyboard map state     */
-word JoyState;                     /* Joystick states        */
-int  MouState[2];                  /* Mouse states           */
-byte MouseDX[2],MouseDY[2];        /* Mouse offsets          */
-byte OldMouseX[2],OldMouseY[2];    /* Old mouse coordinates  */
-byte MCount[2];                    /* Mouse nibble counter   */
+THREADLOCAL volatile byte KeyState[16];        /* Keyboard map state     */
+THREADLOCAL word JoyState;                     /* Joystick states        */
+THREADLOCAL int  MouState[2];                  /* Mouse states           */
+THREADLOCAL byte MouseDX[2],MouseDY[2];        /* Mouse offsets          */
+THREADLOCAL byte OldMouseX[2],OldMouseY[2];    /* Old mouse coordinates  */
+THREADLOCAL byte MCount[2];                    /* Mouse nibble counter   */
 
 /** General I/O registers: i8255 *****************************/
-I8255 PPI;                         /* i8255 PPI at A8h-ABh   */
-byte IOReg;                        /* Storage for AAh port   */
+THREADLOCAL I8255 PPI;                         /* i8255 PPI at A8h-ABh   */
+THREADLOCAL byte IOReg;                        /* Storage for AAh port   */
 
 /** Disk controller: WD1793 **********************************/
-WD1793 FDC;                        /* WD1793 at 7FF8h-7FFFh  */
-FDIDisk FDD[4];                    /* Floppy disk images     */
+THREADLOCAL WD1793 FDC;                        /* WD1793 at 7FF8h-7FFFh  */
+THREADLOCAL FDIDisk FDD[4];                    /* Floppy disk images     */
 
 /** Sound hardware: PSG, SCC, OPLL ***************************/
-AY8910 PSG;                        /* PSG registers & state  */
-YM2413 OPLL;                       /* OPLL registers & state */
-SCC  SCChip;                       /* SCC registers & state  */
-byte SCCOn[2];                     /* 1 = SCC page active    */
-word FMPACKey;                     /* MAGIC = SRAM active    */
+THREADLOCAL AY8910 PSG;                        /* PSG registers & state  */
+THREADLOCAL YM2413 OPLL;                       /* OPLL registers & state */
+THREADLOCAL SCC  SCChip;                       /* SCC registers & state  */
+THREADLOCAL byte SCCOn[2];                     /* 1 = SCC page active    */
+THREADLOCAL word FMPACKey;                     /* MAGIC = SRAM active    */
 
 /** Serial I/O hardware: i8251+i8253 *************************/
-I8251 SIO;                         /* SIO registers & state  */
+THREADLOCAL I8251 SIO;                         /* SIO registers & state  */
 
 /** Real-time clock ******************************************/
-byte RTCReg,RTCMode;               /* RTC register numbers   */
-byte RTC[4][13];                   /* RTC registers          */
+THREADLOCAL byte RTCReg,RTCMode;               /* RTC register numbers   */
+THREADLOCAL byte RTC[4][13];                   /* RTC registers          */
 
 /** Video processor ******************************************/
-byte *ChrGen,*ChrTab,*ColTab;      /* VDP tables (screen)    */
-byte *SprGen,*SprTab;              /* VDP tables (sprites)   */
-int  ChrGenM,ChrTabM,ColTabM;      /* VDP masks (screen)     */
-int  SprTabM;                      /* VDP masks (sprites)    */
-word VAddr;                        /* VRAM address in VDP    */
-byte VKey,PKey;                    /* Status keys for VDP    */
-byte FGColor,BGColor;              /* Colors                 */
-byte XFGColor,XBGColor;            /* Second set of colors   */
-byte ScrMode;                      /* Current screen mode    */
-byte VDP[64],VDPStatus[16];        /* VDP registers          */
-byte IRQPending;                   /* Pending interrupts     */
-int  ScanLine;                     /* Current scanline       */
-byte VDPData;                      /* VDP data buffer        */
-byte PLatch;                       /* Palette buffer         */
-byte ALatch;                       /* Address buffer         */
-int  Palette[16];                  /* Current palette        */
+THREADLOCAL byte *ChrGen,*ChrTab,*ColTab;      /* VDP tables (screen)    */
+THREADLOCAL byte *SprGen,*SprTab;              /* VDP tables (sprites)   */
+THREADLOCAL int  ChrGenM,ChrTabM,ColTabM;      /* VDP masks (screen)     */
+THREADLOCAL int  SprTabM;                      /* VDP masks (sprites)    */
+THREADLOCAL word VAddr;                        /* VRAM address in VDP    */
+THREADLOCAL byte VKey,PKey;                    /* Status keys for VDP    */
+THREADLOCAL byte FGColor,BGColor;              /* Colors                 */
+THREADLOCAL byte XFGColor,XBGColor;            /* Second set of colors   */
+THREADLOCAL byte ScrMode;                      /* Current screen mode    */
+THREADLOCAL byte VDP[64],VDPStatus[16];        /* VDP registers          */
+THREADLOCAL byte IRQPending;                   /* Pending interrupts     */
+THREADLOCAL int  ScanLine;                     /* Current scanline       */
+THREADLOCAL byte VDPData;                      /* VDP data buffer        */
+THREADLOCAL byte PLatch;                       /* Palette buffer         */
+THREADLOCAL byte ALatch;                       /* Address buffer         */
+THREADLOCAL int  Palette[16];                  /* Current palette        */
+
+/** Changes since lines were drawn, see LineChanged() ********/
+static THREADLOCAL unsigned int DrawTick = 1;  /* Stamp for changes now  */
+static THREADLOCAL unsigned int VDPTick  = 1;  /* VDP state, palette     */
+static THREADLOCAL unsigned int LineTick[256]; /* Lines last drawn       */
+static THREADLOCAL unsigned int RowTick[0x1000];  /* 32-byte VRAM rows   */
+static THREADLOCAL unsigned int BlockTick[0x40];  /* 2kB VRAM blocks     */
+static THREADLOCAL unsigned int CmdTick  = 0;  /* V9938 command wrote    */
+#define DIRTY_VRAM(A) \
+  RowTick[((A)>>5)&0xFFF]=BlockTick[((A)>>11)&0x3F]=DrawTick
+
+/** Sprites shown in every line, see ShownSprites() **********/
+static THREADLOCAL unsigned int SprTick    = 0; /* Lines listed      */
+static THREADLOCAL unsigned int SprCmdTick = 0; /* V9938 hit SprTab  */
+static THREADLOCAL unsigned int SprMask[256];  /* Sprites in lines    */
+static THREADLOCAL byte SprStat[256];          /* VDPStatus[0] bits   */
 
 /** Cheat entries ********************************************/
-int MCFCount     = 0;              /* Size of MCFEntries[]   */
-MCFEntry MCFEntries[MAXCHEATS];    /* Entries from .MCF file */
+THREADLOCAL int MCFCount     = 0;              /* Size of MCFEntries[]   */
+THREADLOCAL MCFEntry MCFEntries[MAXCHEATS];    /* Entries from .MCF file */
 
 /** Cheat codes **********************************************/
-byte CheatsON    = 0;              /* 1: Cheats are on       */
-int  CheatCount  = 0;              /* # cheats, <=MAXCHEATS  */
-CheatCode CheatCodes[MAXCHEATS];
+THREADLOCAL byte CheatsON    = 0;              /* 1: Cheats are on       */
+THREADLOCAL int  CheatCount  = 0;              /* # cheats, <=MAXCHEATS  */
+THREADLOCAL CheatCode CheatCodes[MAXCHEATS];
 
 /** Places in DiskROM to be patched with ED FE C9 ************/
 static const word DiskPatches[] =
@@ -206,7 +246,7 @@ static const byte CartMap[4][4] =
 { { 255,3,4,5 },{ 0,0,0,0 },{ 1,1,1,1 },{ 2,255,255,255 } };
 
 /** Screen Mode Handlers [number of screens + 1] *************/
-void (*RefreshLine[MAXSCREEN+2])(byte Y) =
+THREADLOCAL void (*RefreshLine[MAXSCREEN+2])(byte Y) =
 {
   RefreshLine0,   /* SCR 0:  TEXT 40x24  */
   RefreshLine1,   /* SCR 1:  TEXT 32x24  */
@@ -304,6 +344,7 @@ void MapROM(word A,byte V);       /* Switch MegaROM banks            */
 void PSlot(byte V);               /* Switch primary slots            */
 void SSlot(byte V);               /* Switch secondary slots          */
 void VDPOut(byte R,byte V);       /* Write value into a VDP register */
+void SetModel(void);              /* Select LoopZ80()/VDPOut() code  */
 void Printer(byte V);             /* Send a character to a printer   */
 void PPIOut(byte New,byte Old);   /* Set PPI bits (key click, etc.)  */
 int  CheckSprites(void);          /* Check for sprite collisions     */
@@ -317,6 +358,10 @@ static int hasext(const char *FileName,const char *Ext);
 static byte *GetMemory(int Size); /* Get memory chunk                */
 static void FreeMemory(const void *Ptr); /* Free memory chunk        */
 static void FreeAllMemory(void);  /* Free all memory chunks          */
+static void SyncVDP(void);        /* Run V9938 command up to now     */
+static void IndexTape(void);      /* Find all tape block headers     */
+static void InjectBLOAD(int N,int OldPos); /* BLOAD straight to RAM  */
+static int  PutTape(byte V);      /* Write a byte to the tape        */
 
 /** hasext() *************************************************/
 /** Check if file name has given extension.                 **/
@@ -413,6 +458,10 @@ int StartMSX(int NewMode,int NewRAMPages,int NewVRAMPages)
   int *T,I,J,K;
   byte *P;
   word A;
+#ifdef UNIX
+  struct timeval T0,T1;
+  double RealTime;
+#endif
 
   /*** STARTUP CODE starts here: ***/
 
@@ -435,6 +484,11 @@ int StartMSX(int NewMode,int NewRAMPages,int NewVRAMPages)
 
   /* Zero everyting */
   CasStream=PrnStream=ComIStream=ComOStream=0;
+  CasData     = 0;
+  CasBlocks   = 0;
+  CasSize     = CasMax = CasPos = 0;
+  CasCount    = CasBlockMax = 0;
+  CasInjectLen= CasInjectPos = 0;
   FontBuf     = 0;
   RAMData     = 0;
   VRAM        = 0;
@@ -598,12 +652,51 @@ int StartMSX(int NewMode,int NewRAMPages,int NewVRAMPages)
     printf("  %d scanlines\n",VPeriod/HPeriod);
   }
 
+#ifdef PROFILE
+  /* Profile Z80 code, if requested */
+  if((PrfName||StkName)&&!OpenProfileZ80())
+  { if(Verbose) printf("Failed starting Z80 profiler\n"); }
+#endif
+
+#ifdef HOSTPERF
+  /* Measure host time per subsystem, if requested */
+  if((PerfOn||PerfName)&&!InitPerf())
+  { if(Verbose) printf("Failed writing %s\n",PerfName); }
+#endif
+
   /* Start execution of the code */
   if(Verbose) printf("RUNNING ROM CODE...\n");
+  EmuTime=0.0;
+#ifdef UNIX
+  gettimeofday(&T0,0);
+#endif
   A=RunZ80(&CPU);
 
   /* Exiting emulation... */
   if(Verbose) printf("EXITED at PC = %04Xh.\n",A);
+
+#ifdef UNIX
+  /* Report emulated speed relative to real time */
+  gettimeofday(&T1,0);
+  RealTime=(T1.tv_sec-T0.tv_sec)+(T1.tv_usec-T0.tv_usec)/1000000.0;
+  if(Verbose&&(RealTime>0.0))
+    printf("  Emulated %.2fs in %.2fs (%.2fx real time)\n",EmuTime,RealTime,EmuTime/RealTime);
+#endif
+
+#ifdef HOSTPERF
+  /* Report host time per subsystem */
+  TrashPerf();
+#endif
+
+#ifdef PROFILE
+  /* Save Z80 profile */
+  if(PrfName&&!SaveProfileZ80(PrfName))
+  { if(Verbose) printf("Failed writing %s\n",PrfName); }
+  if(StkName&&!SaveStacksZ80(StkName))
+  { if(Verbose) printf("Failed writing %s\n",StkName); }
+  CloseProfileZ80();
+#endif
+
   return(1);
 }
 
@@ -620,7 +713,7 @@ void TrashMSX(void)
   { if(Verbose) printf("Failed changing to '%s' directory!\n",ProgDir); }
 
   /* Save CMOS RAM, if present */
-  if(SaveCMOS)
+  if(SaveCMOS&&SaveFiles)
   {
     if(Verbose) printf("Writing CMOS.ROM...");
     if(!(F=fopen("CMOS.ROM","wb"))) SaveCMOS=0;
@@ -648,9 +741,9 @@ void TrashMSX(void)
   /* Close tape */
   ChangeTape(0);
   
-  /* Close all IO streams */
+  /* Close all IO streams (ComName opens one stream for both) */
   if(ComOStream&&(ComOStream!=stdout)) fclose(ComOStream);
-  if(ComIStream&&(ComIStream!=stdin))  fclose(ComIStream);
+  if(ComIStream&&(ComIStream!=stdin)&&(ComIStream!=ComOStream)) fclose(ComIStream);
 
   /* Eject all cartridges (will save SRAM) */
   for(J=0;J<MAXSLOTS;++J) LoadCart(0,J,ROMType[J]);
@@ -962,6 +1055,7 @@ int ResetMSX(int NewMode,int NewRAMPages,int NewVRAMPages)
     Palette[J]=PalInit[J];
     SetColor(J,(Palette[J]>>16)&0xFF,(Palette[J]>>8)&0xFF,Palette[J]&0xFF);
   }
+  RedrawAll();
 
   /* Reset mouse coordinates/counters */
   for(J=0;J<2;++J)
@@ -986,6 +1080,9 @@ int ResetMSX(int NewMode,int NewRAMPages,int NewVRAMPages)
   /* Set "V9958" VDP version for MSX2+ */
   if(MODEL(MSX_MSX2P)) VDPStatus[1]|=0x04;
 
+  /* Select model-specific LoopZ80()/VDPOut() */
+  SetModel();
+
   /* Reset CPU */
   ResetZ80(&CPU);
 
@@ -1119,6 +1216,8 @@ case 0x87:
   /*return(Rd8251(&SIO,Port&0x07));*/
 
 case 0x98: /* VRAM read port */
+  /* Let V9938 command catch up with the CPU */
+  if(VDPStatus[2]&0x01) SyncVDP();
   /* Read from VRAM data buffer */
   Port=VDPData;
   /* Reset VAddr latch sequencer */
@@ -1136,6 +1235,8 @@ case 0x98: /* VRAM read port */
   return(Port);
 
 case 0x99: /* VDP status registers */
+  /* Let V9938 command catch up with the CPU */
+  if(VDPStatus[2]&0x01) SyncVDP();
   /* Read an appropriate status register */
   Port=VDPStatus[VDP[15]];
   /* Reset VAddr latch sequencer */
@@ -1266,8 +1367,10 @@ case 0x87:
   return;*/
 
 case 0x98: /* VDP Data */
+  if(VDPStatus[2]&0x01) SyncVDP();
   VKey=1;
   VDPData=VPAGE[VAddr]=Value;
+  DIRTY_VRAM(VPAGE-VRAM+VAddr);
   VAddr=(VAddr+1)&0x3FFF;
   /* If VAddr rolled over, modify VRAM page# */
   if(!VAddr&&(ScrMode>3)) 
@@ -1295,6 +1398,7 @@ case 0x99: /* VDP Address Latch */
         /* When set for reading, perform first read */
         if(!(Value&0x40))
         {
+          if(VDPStatus[2]&0x01) SyncVDP();
           VDPData=VPAGE[VAddr];
           VAddr=(VAddr+1)&0x3FFF;
           if(!VAddr&&(ScrMode>3))
@@ -1323,6 +1427,7 @@ case 0x9A: /* VDP Palette Latch */
     /* Set new color for palette entry J */
     Palette[J]=RGB2INT(R,G,B);
     SetColor(J,R,G,B);
+    RedrawAll();
     /* Next palette entry */
     VDP[16]=(J+1)&0x0F;
   }
@@ -1793,6 +1898,17 @@ void SSlot(register byte V)
     }
 }
 
+#ifdef PROFILE
+/** BankZ80() ************************************************/
+/** Tell the Z80 profiler which slot is visible at a given  **/
+/** address, as PrimarySlot*16+SecondarySlot.               **/
+/*************************************************************/
+byte BankZ80(register word A)
+{
+  return((PSL[A>>14]<<4)|SSL[A>>14]);
+}
+#endif /* PROFILE */
+
 /** SetIRQ() *************************************************/
 /** Set or reset IRQ. Returns IRQ vector assigned to        **/
 /** CPU.IRequest. When upper bit of IRQ is 1, IRQ is reset. **/
@@ -1826,6 +1942,9 @@ byte SetScreen(void)
     default:   J=ScrMode;break;
   }
 
+  /* Screen needs to be redrawn */
+  RedrawAll();
+
   /* Recompute table addresses */
   I=(J>6)&&(J!=MAXSCREEN+1)? 11:10;
   ChrTab  = VRAM+((int)(VDP[2]&MSK[J].R2)<<I);
@@ -1843,6 +1962,204 @@ byte SetScreen(void)
   return(J);
 }
 
+/** RedrawAll() **********************************************/
+/** Make RefreshLine0/1/2() redraw every line of the next   **/
+/** frame, and ShownSprites() list sprites again. Call it   **/
+/** after drawing over the screen image, or after changing  **/
+/** the VDP state or palette outside of VDPOut() and        **/
+/** SetScreen().                                            **/
+/*************************************************************/
+void RedrawAll(void) { VDPTick=DrawTick; }
+
+/** NextTick() ***********************************************/
+/** Return the current stamp and advance it. On rollover,   **/
+/** forget all stamps, so that everything gets redone.      **/
+/*************************************************************/
+static unsigned int NextTick(void)
+{
+  register unsigned int T;
+
+  T=DrawTick++;
+  if(!DrawTick)
+  {
+    memset(LineTick,0,sizeof(LineTick));
+    memset(RowTick,0,sizeof(RowTick));
+    memset(BlockTick,0,sizeof(BlockTick));
+    DrawTick=VDPTick=1;
+    CmdTick=SprCmdTick=SprTick=0;
+    T=0;
+  }
+  return(T);
+}
+
+/** RowsChanged() ********************************************/
+/** Check if any 32-byte VRAM row in N bytes from address A **/
+/** was written later than stamp T.                         **/
+/*************************************************************/
+static int RowsChanged(register int A,register int N,register unsigned int T)
+{
+  for(N=(A+N-1)>>5,A>>=5;A<=N;++A)
+    if(RowTick[A&0xFFF]>T) return(1);
+  return(0);
+}
+
+/** LineChanged() ********************************************/
+/** Check if anything shown in line Y (0..191/211) of       **/
+/** SCREEN0/1/2 has changed since the line was last drawn.  **/
+/** Returns 1 and marks the line as drawn if the caller has **/
+/** to redraw it, or returns 0 if the line in the screen    **/
+/** image is still valid.                                   **/
+/*************************************************************/
+int LineChanged(register byte Y)
+{
+  register unsigned int T;
+  register int A,N;
+  register byte L;
+
+  /* Any change stamped later than T has not been drawn */
+  T=LineTick[Y];
+
+  /* VDP state or palette changed, or VDP command wrote */
+  if((VDPTick>T)||(CmdTick>T)) N=1;
+  else if(!ScrMode)
+  {
+    /* SCREEN0: 40-byte name table row, pattern table */
+    N=RowsChanged(ChrTab-VRAM+40*(Y>>3),40,T)
+    ||(BlockTick[((ChrGen-VRAM)>>11)&0x3F]>T);
+  }
+  else
+  {
+    /* SCREEN1/2: 32-byte name table row */
+    L=Y+VScroll;
+    N=RowsChanged(ChrTab-VRAM+((int)(L&0xF8)<<2),32,T);
+
+    /* SCREEN1: pattern table, 32-byte color table */
+    if(ScrMode==1)
+      N=N||(BlockTick[((ChrGen-VRAM)>>11)&0x3F]>T)
+      ||RowsChanged(ColTab-VRAM,32,T);
+    else
+    {
+      /* SCREEN2: pattern and color blocks of this third */
+      A=(int)(L&0xC0)<<5;
+      N=N||(BlockTick[((ChrGen-VRAM+(A&ChrGenM))>>11)&0x3F]>T)
+      ||(BlockTick[((ColTab-VRAM+(A&ColTabM))>>11)&0x3F]>T);
+    }
+
+    /* Sprite patterns and attributes */
+    if(!SpritesOFF)
+      N=N||(BlockTick[((SprGen-VRAM)>>11)&0x3F]>T)
+      ||RowsChanged(SprTab-VRAM,128,T);
+  }
+
+  /* Line is still valid */
+  if(!N) return(0);
+
+  /* Mark line as drawn, changes from now on come later */
+  LineTick[Y]=NextTick();
+  return(1);
+}
+
+/** CommandWrote() *******************************************/
+/** Stamp VRAM the V9938 command engine may have written.   **/
+/*************************************************************/
+static void CommandWrote(void)
+{
+  CmdTick=DrawTick;
+  if(VDPTouches(SprTab-VRAM,128)) SprCmdTick=DrawTick;
+}
+
+/** V9938 time, see SyncVDP() *******************************/
+static THREADLOCAL int VDPGiven = 0;   /* Cycles of this period  */
+
+/** SyncVDP() ************************************************/
+/** Give the V9938 command engine CPU cycles run since the  **/
+/** last call and let it catch up with the CPU. Call it     **/
+/** before the CPU looks at VRAM or VDP status, or changes  **/
+/** VDP registers.                                          **/
+/*************************************************************/
+static void SyncVDP(void)
+{
+  register int J;
+
+  /* Cycles run in this period, the instruction included */
+  J=CPU.IPeriod-CPU.ICount;
+  J=J>CPU.IPeriod? CPU.IPeriod:J;
+  if(J>VDPGiven) { VDPSync(J-VDPGiven);VDPGiven=J; }
+  else VDPSync(0);
+
+  /* Run command, stamp VRAM it may have written */
+  if(VDPStatus[2]&0x01)
+  {
+    PERF_START(PERF_VDP);
+    LoopVDP();
+    CommandWrote();
+    PERF_STOP(PERF_VDP);
+  }
+}
+
+/** ListSprites() ********************************************/
+/** List sprites shown in every line, as Sprites() (SCREEN  **/
+/** 1-3) or ColorSprites() (SCREEN 4-8) would count them,   **/
+/** along with the 5th/9th sprite status for each line.     **/
+/*************************************************************/
+static void ListSprites(void)
+{
+  static const byte SprHeights[4] = { 8,16,16,32 };
+  register byte *AT,OH,IH,Max,Stop;
+  register int J,K,L,Y;
+  byte Count[256];
+
+  /* SCREEN4-8 stop at Y=216 and subtract vertical scroll */
+  Stop = ScrMode>3? 216:208;
+  Max  = ScrMode>3? MAXSPRITE2:MAXSPRITE1;
+  OH   = SprHeights[VDP[1]&0x03];
+  IH   = SprHeights[VDP[1]&0x02];
+
+  /* Find the last sprite checked (Y=Stop, or sprite #31) */
+  for(L=0,AT=SprTab;(L<32)&&(AT[0]!=Stop);++L,AT+=4);
+
+  memset(SprMask,0,sizeof(SprMask));
+  memset(SprStat,L<32? L:31,sizeof(SprStat));
+  memset(Count,0,sizeof(Count));
+
+  /* Add every sprite to the lines it covers */
+  for(J=0,AT=SprTab;J<L;++J,AT+=4)
+  {
+    K=ScrMode>3? (byte)(AT[0]-VScroll):AT[0];
+    if(K>256-IH) K-=256;
+
+    for(Y=K<0? 0:K+1;(Y<=K+OH)&&(Y<256);++Y)
+      if(!(SprStat[Y]&0x40)||OPTION(MSX_ALLSPRITE))
+      {
+        /* Too many sprites: set 5th/9th flag, note this one */
+        if(++Count[Y]>Max)
+        {
+          if(OPTION(MSX_ALLSPRITE)) SprStat[Y]|=0x40;
+          else { SprStat[Y]=0x40|J;continue; }
+        }
+
+        SprMask[Y]|=1<<J;
+      }
+  }
+}
+
+/** ShownSprites() *******************************************/
+/** Return sprites shown in line Y, bit N set for sprite N, **/
+/** and set the 5th/9th sprite status in VDPStatus[0]. Line **/
+/** lists are kept until sprite attributes or VDP change.   **/
+/*************************************************************/
+unsigned int ShownSprites(register byte Y)
+{
+  if((VDPTick>SprTick)||(SprCmdTick>SprTick)||RowsChanged(SprTab-VRAM,128,SprTick))
+  {
+    ListSprites();
+    SprTick=NextTick();
+  }
+
+  VDPStatus[0]=(VDPStatus[0]&~0x5F)|SprStat[Y];
+  return(SprMask[Y]);
+}
+
 /** SetMegaROM() *********************************************/
 /** Set MegaROM pages for a given slot. SetMegaROM() always **/
 /** assumes 8kB pages.                                      **/
@@ -1882,66 +2199,6 @@ void SetMegaROM(int Slot,byte P0,byte P1,byte P2,byte P3)
   ROMMapper[Slot][3]=P3;
 }
 
-/** VDPOut() *************************************************/
-/** Write value into a given VDP register.                  **/
-/*************************************************************/
-void VDPOut(register byte R,register byte V)
-{ 
-  register byte J;
-
-  switch(R)  
-  {
-    case  0: /* Reset HBlank interrupt if disabled */
-             if((VDPStatus[1]&0x01)&&!(V&0x10))
-             {
-               VDPStatus[1]&=0xFE;
-               SetIRQ(~INT_IE1);
-             }
-             /* Set screen mode */
-             if(VDP[0]!=V) { VDP[0]=V;SetScreen(); }
-             break;
-    case  1: /* Set/Reset VBlank interrupt if enabled or disabled */
-             if(VDPStatus[0]&0x80) SetIRQ(V&0x20? INT_IE0:~INT_IE0);
-             /* Set screen mode */
-             if(VDP[1]!=V) { VDP[1]=V;SetScreen(); }
-             break;
-    case  2: J=(ScrMode>6)&&(ScrMode!=MAXSCREEN+1)? 11:10;
-             ChrTab  = VRAM+((int)(V&MSK[ScrMode].R2)<<J);
-             ChrTabM = ((int)(V|~MSK[ScrMode].M2)<<J)|((1<<J)-1);
-             break;
-    case  3: ColTab  = VRAM+((int)(V&MSK[ScrMode].R3)<<6)+((int)VDP[10]<<14);
-             ColTabM = ((int)(V|~MSK[ScrMode].M3)<<6)|0x1C03F;
-             break;
-    case  4: ChrGen  = VRAM+((int)(V&MSK[ScrMode].R4)<<11);
-             ChrGenM = ((int)(V|~MSK[ScrMode].M4)<<11)|0x007FF;
-             break;
-    case  5: SprTab  = VRAM+((int)(V&MSK[ScrMode].R5)<<7)+((int)VDP[11]<<15);
-             SprTabM = ((int)(V|~MSK[ScrMode].M5)<<7)|0x1807F;
-             break;
-    case  6: V&=0x3F;SprGen=VRAM+((int)V<<11);break;
-    case  7: FGColor=V>>4;BGColor=V&0x0F;break;
-    case 10: V&=0x07;
-             ColTab=VRAM+((int)(VDP[3]&MSK[ScrMode].R3)<<6)+((int)V<<14);
-             break;
-    case 11: V&=0x03;
-             SprTab=VRAM+((int)(VDP[5]&MSK[ScrMode].R5)<<7)+((int)V<<15);
-             break;
-    case 14: V&=VRAMPages-1;VPAGE=VRAM+((int)V<<14);
-             break;
-    case 15: V&=0x0F;break;
-    case 16: V&=0x0F;PKey=1;break;
-    case 17: V&=0xBF;break;
-    case 25: VDP[25]=V;
-             SetScreen();
-             break;
-    case 44: VDPWrite(V);break;
-    case 46: VDPDraw(V);break;
-  }
-
-  /* Write value into a register */
-  VDP[R]=V;
-} 
-
 /** Printer() ************************************************/
 /** Send a character to the printer.                        **/
 /*************************************************************/
@@ -1972,8 +2229,8 @@ void PPIOut(register byte New,register byte Old)
 /*************************************************************/
 byte RTCIn(register byte R)
 {
-  static time_t PrevTime;
-  static struct tm TM;
+  static THREADLOCAL time_t PrevTime;
+  static THREADLOCAL struct tm TM;
   register byte J;
   time_t CurTime;
 
@@ -1989,10 +2246,15 @@ byte RTCIn(register byte R)
     else
     {
       /* Retrieve system time if any time passed */
-      CurTime=time(NULL);
+      CurTime=RTCTime? (time_t)RTCTime:time(NULL);
       if(CurTime!=PrevTime)
       {
-        TM=*localtime(&CurTime);
+        /* Fixed time is UTC, so it reads the same everywhere */
+#ifdef UNIX
+        if(RTCTime) gmtime_r(&CurTime,&TM); else localtime_r(&CurTime,&TM);
+#else
+        TM=*(RTCTime? gmtime(&CurTime):localtime(&CurTime));
+#endif
         PrevTime=CurTime;
       }
 
@@ -2020,312 +2282,95 @@ byte RTCIn(register byte R)
   return(J|0xF0);
 }
 
+/** LoopZ80() state ******************************************/
+/** These variables are shared by all LoopZ80() instances.  **/
+/*************************************************************/
+static THREADLOCAL byte BFlag   = 0;   /* TEXT80 blink phase     */
+static THREADLOCAL byte BCount  = 0;   /* TEXT80 blink counter   */
+static THREADLOCAL int  UCount  = 0;   /* Frames to next update  */
+static THREADLOCAL byte ACount  = 0;   /* Frames to autofire     */
+static THREADLOCAL byte Drawing = 0;   /* 1: Drawing scanlines   */
+#ifdef DEBUG
+static THREADLOCAL byte Traced  = 0;   /* 1: Debugger was on     */
+#endif
+
+/** ModelMux.h ***********************************************/
+/** LoopZ80() and VDPOut() are instantiated for every MSX   **/
+/** model and PAL/NTSC video from the code in Model.h.      **/
+/*************************************************************/
+#include "ModelMux.h"
+
 /** LoopZ80() ************************************************/
 /** Refresh screen, check keyboard and sprites. Call this   **/
 /** function on each interrupt.                             **/
 /*************************************************************/
-word LoopZ80(Z80 *R)
-{
-  static byte BFlag=0;
-  static byte BCount=0;
-  static int  UCount=0;
-  static byte ACount=0;
-  static byte Drawing=0;
-  register int J;
-
-  /* Flip HRefresh bit */
-  VDPStatus[2]^=0x20;
-
-  /* If HRefresh is now in progress... */
-  if(!(VDPStatus[2]&0x20))
-  {
-    /* HRefresh takes most of the scanline */
-    R->IPeriod=!ScrMode||(ScrMode==MAXSCREEN+1)? CPU_H240:CPU_H256;
-
-    /* New scanline */
-    ScanLine=ScanLine<(PALVideo? 312:261)? ScanLine+1:0;
-
-    /* If first scanline of the screen... */
-    if(!ScanLine)
-    {
-      /* Drawing now... */
-      Drawing=1;
-
-      /* Reset VRefresh bit */
-      VDPStatus[2]&=0xBF;
-
-      /* Refresh display */
-      if(UCount>=100) { UCount-=100;RefreshScreen(); }
-      UCount+=UPeriod;
-
-      /* Blinking for TEXT80 */
-      if(BCount) BCount--;
-      else
-      {
-        BFlag=!BFlag;
-        if(!VDP[13]) { XFGColor=FGColor;XBGColor=BGColor; }
-        else
-        {
-          BCount=(BFlag? VDP[13]&0x0F:VDP[13]>>4)*10;
-          if(BCount)
-          {
-            if(BFlag) { XFGColor=FGColor;XBGColor=BGColor; }
-            else      { XFGColor=VDP[12]>>4;XBGColor=VDP[12]&0x0F; }
-          }
-        }
-      }
-    }
-
-    /* Line coincidence is active at 0..255 */
-    /* in PAL and 0..234/244 in NTSC        */
-    J=PALVideo? 256:ScanLines212? 245:235;
-
-    /* When reaching end of screen, reset line coincidence */
-    if(ScanLine==J)
-    {
-      VDPStatus[1]&=0xFE;
-      SetIRQ(~INT_IE1);
-    }
+word LoopZ80(Z80 *R) { return((*LoopModel)(R)); }
 
-    /* When line coincidence is active... */
-    if(ScanLine<J)
-    {
-      /* Line coincidence processing */
-      J=(((ScanLine+VScroll)&0xFF)-VDP[19])&0xFF;
-      if(J==2)
-      {
-        /* Set HBlank flag on line coincidence */
-        VDPStatus[1]|=0x01;
-        /* Generate IE1 interrupt */
-        if(VDP[0]&0x10) SetIRQ(INT_IE1);
-      }
-      else
-      {
-        /* Reset flag immediately if IE1 interrupt disabled */
-        if(!(VDP[0]&0x10)) VDPStatus[1]&=0xFE;
-      }
-    }
-
-    /* Return whatever interrupt is pending */
-    R->IRequest=IRQPending? INT_IRQ:INT_NONE;
-    return(R->IRequest);
-  }
-
-  /*********************************/
-  /* We come here for HBlanks only */
-  /*********************************/
-
-  /* HBlank takes HPeriod-HRefresh */
-  R->IPeriod=!ScrMode||(ScrMode==MAXSCREEN+1)? CPU_H240:CPU_H256;
-  R->IPeriod=HPeriod-R->IPeriod;
-
-  /* If last scanline of VBlank, see if we need to wait more */
-  J=PALVideo? 313:262;
-  if(ScanLine>=J-1)
-  {
-    J*=CPU_HPERIOD;
-    if(VPeriod>J) R->IPeriod+=VPeriod-J;
-  }
-
-  /* If first scanline of the bottom border... */
-  if(ScanLine==(ScanLines212? 212:192)) Drawing=0;
-
-  /* If first scanline of VBlank... */
-  J=PALVideo? (ScanLines212? 212+42:192+52):(ScanLines212? 212+18:192+28);
-  if(!Drawing&&(ScanLine==J))
-  {
-    /* Set VBlank bit, set VRefresh bit */
-    VDPStatus[0]|=0x80;
-    VDPStatus[2]|=0x40;
-
-    /* Generate VBlank interrupt */
-    if(VDP[1]&0x20) SetIRQ(INT_IE0);
-  }
-
-  /* Run V9938 engine */
-  LoopVDP();
-
-  /* Refresh scanline, possibly with the overscan */
-  if((UCount>=100)&&Drawing&&(ScanLine<256))
-  {
-    if(!ModeYJK||(ScrMode<7)||(ScrMode>8))
-      (RefreshLine[ScrMode])(ScanLine);
-    else
-      if(ModeYAE) RefreshLine10(ScanLine);
-      else RefreshLine12(ScanLine);
-  }
-
-  /* Every few scanlines, update sound */
-  if(!(ScanLine&0x07))
-  {
-    /* Compute number of microseconds */
-    J = (int)(1000000L*(CPU_HPERIOD<<3)/CPU_CLOCK);
-
-    /* Update AY8910 state */
-    Loop8910(&PSG,J);
-
-    /* Flush changes to sound channels, only hit drums once a frame */
-    Sync8910(&PSG,AY8910_FLUSH|(!ScanLine&&OPTION(MSX_DRUMS)? AY8910_DRUMS:0));
-    SyncSCC(&SCChip,SCC_FLUSH);
-    Sync2413(&OPLL,YM2413_FLUSH);
-
-    /* Render and play all sound now */
-    PlayAllSound(J);
-  }
-
-  /* Keyboard, sound, and other stuff always runs at line 192    */
-  /* This way, it can't be shut off by overscan tricks (Maarten) */
-  if(ScanLine==192)
-  {
-    /* Clear 5thSprite fields (wrong place to do it?) */
-    VDPStatus[0]=(VDPStatus[0]&~0x40)|0x1F;
-
-    /* Check sprites and set Collision bit */
-    if(!(VDPStatus[0]&0x20)&&CheckSprites()) VDPStatus[0]|=0x20;
-
-    /* Count MIDI ticks */
-    MIDITicks(1000*VPeriod/CPU_CLOCK);
-
-    /* Apply RAM-based cheats */
-    if(CheatsON&&CheatCount) ApplyCheats();
-
-    /* Check joystick */
-    JoyState=Joystick();
-
-    /* Check keyboard */
-    Keyboard();
-
-    /* Exit emulation if requested */
-    if(ExitNow) return(INT_QUIT);
-
-    /* Check mouse in joystick port #1 */
-    if(JOYTYPE(0)>=JOY_MOUSTICK)
-    {
-      /* Get new mouse state */
-      MouState[0]=Mouse(0);
-      /* Merge mouse buttons into joystick buttons */
-      JoyState|=(MouState[0]>>12)&0x0030;
-      /* If mouse-as-joystick... */
-      if(JOYTYPE(0)==JOY_MOUSTICK)
-      {
-        J=MouState[0]&0xFF;
-        JoyState|=J>OldMouseX[0]? 0x0008:J<OldMouseX[0]? 0x0004:0;
-        OldMouseX[0]=J;
-        J=(MouState[0]>>8)&0xFF;
-        JoyState|=J>OldMouseY[0]? 0x0002:J<OldMouseY[0]? 0x0001:0;
-        OldMouseY[0]=J;
-      }
-    }
-
-    /* Check mouse in joystick port #2 */
-    if(JOYTYPE(1)>=JOY_MOUSTICK)
-    {
-      /* Get new mouse state */
-      MouState[1]=Mouse(1);
-      /* Merge mouse buttons into joystick buttons */
-      JoyState|=(MouState[1]>>4)&0x3000;
-      /* If mouse-as-joystick... */
-      if(JOYTYPE(1)==JOY_MOUSTICK)
-      {
-        J=MouState[1]&0xFF;
-        JoyState|=J>OldMouseX[1]? 0x0800:J<OldMouseX[1]? 0x0400:0;
-        OldMouseX[1]=J;
-        J=(MouState[1]>>8)&0xFF;
-        JoyState|=J>OldMouseY[1]? 0x0200:J<OldMouseY[1]? 0x0100:0;
-        OldMouseY[1]=J;
-      }
-    }
-
-    /* If any autofire options selected, run autofire counter */
-    if(OPTION(MSX_AUTOSPACE|MSX_AUTOFIREA|MSX_AUTOFIREB))
-      if((ACount=(ACount+1)&0x07)>3)
-      {
-        /* Autofire spacebar if needed */
-        if(OPTION(MSX_AUTOSPACE)) KBD_RES(' ');
-        /* Autofire FIRE-A if needed */
-        if(OPTION(MSX_AUTOFIREA)) JoyState&=~(JST_FIREA|(JST_FIREA<<8));
-        /* Autofire FIRE-B if needed */
-        if(OPTION(MSX_AUTOFIREB)) JoyState&=~(JST_FIREB|(JST_FIREB<<8));
-      }
-  }
-
-  /* Return whatever interrupt is pending */
-  R->IRequest=IRQPending? INT_IRQ:INT_NONE;
-  return(R->IRequest);
+/** VDPOut() *************************************************/
+/** Write value into a given VDP register, once the V9938   **/
+/** command has caught up with the CPU. This calls the      **/
+/** VDPOut_*() instance SetModel() picked for the model.    **/
+/*************************************************************/
+void VDPOut(register byte R,register byte V)
+{
+  SyncVDP();
+  (*VDPOutModel)(R,V);
 }
 
 /** CheckSprites() *******************************************/
-/** Check for sprite collisions.                            **/
+/** Check for sprite collisions. Every line lists sprites   **/
+/** covering it, and lines with two or more sprites have    **/
+/** their pixels ORed into a 256-pixel ring, so that any    **/
+/** pixel set twice is a collision. Like sprite coordinates **/
+/** themselves, the ring wraps around in both directions.   **/
 /*************************************************************/
 int CheckSprites(void)
 {
-  unsigned int I,J,LS,LD;
-  byte DH,DV,*S,*D,*PS,*PD,*T;
+  unsigned long long Ring[4],V,A,B;
+  unsigned int Lines[256];
+  unsigned int I,M,LS,LD,H;
+  byte DH,*S,*P;
+  int Y;
 
   /* Must be showing sprites */
   if(SpritesOFF||!ScrMode||(ScrMode>=MAXSCREEN+1)) return(0);
 
   /* Find bottom/top scanlines */
   DH = ScrMode>3? 216:208;
-  LD = 255-(Sprites16x16? 16:8);
+  H  = Sprites16x16? 16:8;
+  LD = 255-H;
   LS = ScanLines212? 211:191;
 
-  /* Find valid, displayed sprites */
-  for(I=J=0,S=SprTab;(I<32)&&(S[0]!=DH);++I,S+=4)
-    if((S[0]<LS)||(S[0]>LD)) J|=1<<I;
+  /* List valid, displayed sprites in lines they cover */
+  memset(Lines,0,sizeof(Lines));
+  for(I=0,S=SprTab;(I<32)&&(S[0]!=DH);++I,S+=4)
+    if((S[0]<LS)||(S[0]>LD))
+      for(Y=0;Y<H;++Y) Lines[(S[0]+Y)&0xFF]|=1<<I;
 
-  if(Sprites16x16)
-  {
-    for(S=SprTab;J;J>>=1,S+=4)
-      if(J&1)
-        for(I=J>>1,D=S+4;I;I>>=1,D+=4)
-          if(I&1) 
-          {
-            DV=S[0]-D[0];
-            if((DV<16)||(DV>240))
-	    {
-              DH=S[1]-D[1];
-              if((DH<16)||(DH>240))
-	      {
-                PS=SprGen+((int)(S[2]&0xFC)<<3);
-                PD=SprGen+((int)(D[2]&0xFC)<<3);
-                if(DV<16) PD+=DV; else { DV=256-DV;PS+=DV; }
-                if(DH>240) { DH=256-DH;T=PS;PS=PD;PD=T; }
-                while(DV<16)
-                {
-                  LS=((unsigned int)*PS<<8)+*(PS+16);
-                  LD=((unsigned int)*PD<<8)+*(PD+16);
-                  if(LD&(LS>>DH)) break;
-                  else { ++DV;++PS;++PD; }
-                }
-                if(DV<16) return(1);
-              }
-            }
-          }
-  }
-  else
-  {
-    for(S=SprTab;J;J>>=1,S+=4)
-      if(J&1)
-        for(I=J>>1,D=S+4;I;I>>=1,D+=4)
-          if(I&1) 
-          {
-            DV=S[0]-D[0];
-            if((DV<8)||(DV>248))
-            {
-              DH=S[1]-D[1];
-              if((DH<8)||(DH>248))
-              {
-                PS=SprGen+((int)S[2]<<3);
-                PD=SprGen+((int)D[2]<<3);
-                if(DV<8) PD+=DV; else { DV=256-DV;PS+=DV; }
-                if(DH>248) { DH=256-DH;T=PS;PS=PD;PD=T; }
-                while((DV<8)&&!(*PD&(*PS>>DH))) { ++DV;++PS;++PD; }
-                if(DV<8) return(1);
-              }
-            }
-          }
-  }
+  /* Put sprites from lines with two or more into the ring */
+  for(Y=0;Y<256;++Y)
+    if(Lines[Y]&(Lines[Y]-1))
+    {
+      memset(Ring,0,sizeof(Ring));
+      for(M=Lines[Y],S=SprTab;M;M>>=1,S+=4)
+        if(M&1)
+        {
+          /* Sprite line as 16 pixels, leftmost in bit #63 */
+          P = SprGen+((Y-S[0])&(H-1));
+          if(H>8) { P+=(int)(S[2]&0xFC)<<3;V=((int)P[0]<<8)|P[16]; }
+          else    { P+=(int)S[2]<<3;V=(int)P[0]<<8; }
+          V<<=48;
+
+          /* Split it between two ring words at X */
+          I = S[1]&0x3F;
+          A = V>>I;
+          B = I? V<<(64-I):0;
+          I = S[1]>>6;
+          if((Ring[I]&A)||(Ring[(I+1)&3]&B)) return(1);
+          Ring[I]|=A;
+          Ring[(I+1)&3]|=B;
+        }
+    }
 
   /* No collisions */
   return(0);
@@ -2387,8 +2432,14 @@ char *MakeFileName(const char *Name,const char *Ext)
 /*************************************************************/
 byte ChangeTape(const char *FileName)
 {
+  long Size;
+
   /* Close previous tape image, if open */
   if(CasStream) { fclose(CasStream);CasStream=0; }
+  if(CasData)   { free(CasData);CasData=0; }
+  if(CasBlocks) { free(CasBlocks);CasBlocks=0; }
+  CasSize=CasMax=CasPos=CasCount=CasBlockMax=0;
+  CasInjectLen=CasInjectPos=0;
 
   /* If opening a new tape image... */
   if(FileName)
@@ -2396,16 +2447,191 @@ byte ChangeTape(const char *FileName)
     /* Try read+append first, then read-only */
     CasStream = fopen(FileName,"r+b");
     CasStream = CasStream? CasStream:fopen(FileName,"rb");
+    if(!CasStream) return(0);
+
+    /* Read the whole tape into memory */
+    if(fseek(CasStream,0,SEEK_END)||((Size=ftell(CasStream))<0)) Size=-1;
+    else
+    {
+      CasMax  = Size+1;
+      CasData = malloc(CasMax);
+      rewind(CasStream);
+      if(!CasData||(fread(CasData,1,Size,CasStream)!=Size)) Size=-1;
+    }
+
+    /* Failed reading the tape */
+    if(Size<0) { ChangeTape(0);return(0); }
+
+    /* Find all blocks once */
+    CasSize=Size;
+    IndexTape();
   }
 
   /* Done */
-  return(!FileName||CasStream);
+  return(1);
 }
 
 /** RewindTape() *********************************************/
 /** Rewind currenly open tape.                              **/
 /*************************************************************/
-void RewindTape(void) { if(CasStream) rewind(CasStream); }
+void RewindTape(void) { CasPos=CasInjectPos=CasInjectLen=0; }
+
+/** IndexTape() **********************************************/
+/** Find all block headers in the tape image, so that       **/
+/** ReadTapeHeader() does not have to search the tape.      **/
+/*************************************************************/
+static void IndexTape(void)
+{
+  int J,*P;
+
+  for(CasCount=J=0;J+8<=CasSize;J+=8)
+    if(!memcmp(CasData+J,CasHeader,8))
+    {
+      if(CasCount>=CasBlockMax)
+      {
+        P=realloc(CasBlocks,(CasBlockMax*2+16)*sizeof(int));
+        if(!P) return;
+        CasBlocks    = P;
+        CasBlockMax  = CasBlockMax*2+16;
+      }
+      CasBlocks[CasCount++]=J;
+    }
+}
+
+/** ReadTapeHeader() *****************************************/
+/** Move tape past the next block header. Returns 1 on      **/
+/** success, rewinds tape and returns 0 on failure.         **/
+/*************************************************************/
+int ReadTapeHeader(void)
+{
+  int L,H,M,OldPos;
+
+  /* Forget any injected data */
+  CasInjectPos=CasInjectLen=0;
+
+  /* Headers start at 8-byte boundaries */
+  OldPos = CasPos;
+  CasPos = (CasPos+7)&~7;
+
+  /* Find first header at or after CasPos */
+  for(L=0,H=CasCount;L<H;)
+  {
+    M=(L+H)>>1;
+    if(CasBlocks[M]<CasPos) L=M+1; else H=M;
+  }
+
+  /* No more headers: rewind */
+  if(L>=CasCount) { RewindTape();return(0); }
+
+  /* Position tape right after the header */
+  CasPos=CasBlocks[L]+8;
+  if(OPTION(MSX_FASTTAPE)) InjectBLOAD(L,OldPos);
+  return(1);
+}
+
+/** InjectBLOAD() ********************************************/
+/** If block N holds BLOAD data following the header block  **/
+/** that has just been read, write it straight to RAM. The  **/
+/** loader is then fed a one-byte file containing the last  **/
+/** byte, so it still sees the right end and exec addresses.**/
+/*************************************************************/
+static void InjectBLOAD(int N,int OldPos)
+{
+  static const byte BinaryID[10] =
+  { 0xD0,0xD0,0xD0,0xD0,0xD0,0xD0,0xD0,0xD0,0xD0,0xD0 };
+  int P,End,Start,Stop,J;
+
+  /* Previous block must be a binary file header we have read */
+  if(!N||(OldPos<=CasBlocks[N-1])||(OldPos>CasBlocks[N])) return;
+  P=CasBlocks[N-1]+8;
+  if((P+10>CasSize)||memcmp(CasData+P,BinaryID,10)) return;
+
+  /* Data block: start, end, and exec addresses, then data */
+  P   = CasBlocks[N]+8;
+  End = N+1<CasCount? CasBlocks[N+1]:CasSize;
+  if(P+6>End) return;
+  Start = CasData[P]+((int)CasData[P+1]<<8);
+  Stop  = CasData[P+2]+((int)CasData[P+3]<<8);
+  if((Stop<Start)||(P+7+Stop-Start>End)) return;
+
+  if(Verbose&0x04) printf("BLOAD %04Xh..%04Xh to RAM..",Start,Stop);
+
+  /* Write all data but the last byte */
+  for(J=Start;J<Stop;++J) WrZ80(J,CasData[P+6+J-Start]);
+
+  /* The loader reads Stop,Stop,Exec and the last byte */
+  CasInject[0] = CasInject[2] = Stop&0xFF;
+  CasInject[1] = CasInject[3] = Stop>>8;
+  CasInject[4] = CasData[P+4];
+  CasInject[5] = CasData[P+5];
+  CasInject[6] = CasData[P+6+Stop-Start];
+  CasInjectPos = 0;
+  CasInjectLen = 7;
+
+  /* Tape continues after the data */
+  CasPos=P+7+Stop-Start;
+}
+
+/** ReadTape() ***********************************************/
+/** Read next byte from the tape. Returns the byte, or it   **/
+/** rewinds tape and returns -1 at the end of the tape.     **/
+/*************************************************************/
+int ReadTape(void)
+{
+  if(CasInjectPos<CasInjectLen) return(CasInject[CasInjectPos++]);
+  if(CasPos<CasSize) return(CasData[CasPos++]);
+  RewindTape();
+  return(-1);
+}
+
+/** PutTape() ************************************************/
+/** Write a byte to the tape file and its memory copy, at   **/
+/** the current position. Returns 1 on success, else 0.     **/
+/*************************************************************/
+static int PutTape(byte V)
+{
+  byte *P;
+  int J;
+
+  /* Write to the file first */
+  if(!CasStream||fseek(CasStream,CasPos,SEEK_SET)||(fputc(V,CasStream)<0))
+    return(0);
+
+  /* Grow the memory copy as needed */
+  if(CasPos>=CasMax)
+  {
+    J=CasPos*2+1024;
+    if(!(P=realloc(CasData,J))) return(0);
+    CasData = P;
+    CasMax  = J;
+  }
+
+  /* Any gap past the end reads as zeros, as in the file */
+  if(CasPos>CasSize) memset(CasData+CasSize,0,CasPos-CasSize);
+  CasData[CasPos++]=V;
+  CasSize=CasPos>CasSize? CasPos:CasSize;
+  return(1);
+}
+
+/** WriteTapeHeader() ****************************************/
+/** Write a block header at the next 8-byte boundary.       **/
+/** Returns 1 on success, 0 on failure.                     **/
+/*************************************************************/
+int WriteTapeHeader(void)
+{
+  int J;
+
+  CasInjectPos=CasInjectLen=0;
+  CasPos=(CasPos+7)&~7;
+  for(J=0;(J<8)&&PutTape(CasHeader[J]);++J);
+  IndexTape();
+  return(J==8);
+}
+
+/** WriteTape() **********************************************/
+/** Write a byte to the tape. Returns 1 on success, else 0. **/
+/*************************************************************/
+int WriteTape(byte V) { return(PutTape(V)); }
 
 /** ChangePrinter() ******************************************/
 /** Change printer output to a given file. The previous     **/
@@ -2886,6 +3112,9 @@ byte LoadFNT(const char *FileName)
 {
   FILE *F;
 
+  /* Text screens will have to be redrawn */
+  RedrawAll();
+
   /* Drop out if no new font requested */
   if(!FileName) { FreeMemory(FontBuf);FontBuf=0;return(1); }
   /* Try opening font file */
@@ -3031,7 +3260,7 @@ int LoadCart(const char *FileName,int Slot,int Type)
   if(PS>=4) return(0);
 
   /* If there is a SRAM in this cartridge slot... */
-  if(SRAMData[Slot]&&SaveSRAM[Slot]&&SRAMName[Slot])
+  if(SRAMData[Slot]&&SaveSRAM[Slot]&&SRAMName[Slot]&&SaveFiles)
   {
     /* Open .SAV file */
     if(Verbose) printf("Writing %s...",SRAMName[Slot]);
@@ -3393,6 +3622,7 @@ int LoadPAL(const char *Name)
   }
 
   fclose(F);
+  RedrawAll();
   return(J);
 }
 
@@ -14,6 +14,7 @@
 #ifndef MSX_H
 #define MSX_H
 
+#include "ThreadLocal.h"    /* THREADLOCAL machine state     */
 #include "Z80.h"            /* Z80 CPU emulation             */
 #include "V9938.h"          /* V9938 VDP opcode emulation    */
 #include "AY8910.h"         /* AY8910 PSG emulation          */
@@ -150,6 +151,7 @@ extern "C" {
 #define MSX_GUESSB    0x00020000 /* Guess ROM mapper type B  */
 
 #define MSX_OPTIONS   0x7FFC0000 /* Miscellaneous Options:   */
+#define MSX_FASTTAPE  0x00400000 /* BLOAD tapes right to RAM */
 #define MSX_ALLSPRITE 0x00800000 /* Show ALL sprites         */
 #define MSX_AUTOFIREA 0x01000000 /* Autofire joystick FIRE-A */
 #define MSX_AUTOFIREB 0x02000000 /* Autofire joystick FIRE-B */
@@ -162,7 +164,7 @@ extern "C" {
 
 /** Keyboard codes and macros ********************************/
 extern const byte Keys[130][2];
-extern volatile byte KeyState[16];
+extern THREADLOCAL volatile byte KeyState[16];
 
 #define KBD_SET(K)   KeyState[Keys[K][0]]&=~Keys[K][1]
 #define KBD_RES(K)   KeyState[Keys[K][0]]|=Keys[K][1]
@@ -231,47 +233,53 @@ extern volatile byte KeyState[16];
 /*************************************************************/
 
 /** Variables used to control emulator behavior **************/
-extern byte Verbose;                  /* Debug msgs ON/OFF   */
-extern int  Mode;                     /* ORed MSX_* bits     */
-extern int  RAMPages,VRAMPages;       /* Number of RAM pages */
-extern byte UPeriod;                  /* % of frames to draw */
+extern THREADLOCAL byte Verbose;                  /* Debug msgs ON/OFF   */
+extern THREADLOCAL int  Mode;                     /* ORed MSX_* bits     */
+extern THREADLOCAL int  RAMPages,VRAMPages;       /* Number of RAM pages */
+extern THREADLOCAL byte UPeriod;                  /* % of frames to draw */
+extern THREADLOCAL byte SaveFiles;                /* Write CMOS/SRAM     */
+extern THREADLOCAL unsigned int RTCTime;          /* Fixed RTC time or 0 */
+extern THREADLOCAL byte Turbo;                    /* 1: Run unthrottled  */
+extern THREADLOCAL double EmuTime;                /* Emulated seconds    */
 /*************************************************************/
 
 /** Screen Mode Handlers [number of screens + 1] *************/
-extern void (*RefreshLine[MAXSCREEN+2])(byte Y);
-/*************************************************************/
-
-extern Z80  CPU;                      /* CPU state/registers */
-extern byte *VRAM;                    /* Video RAM           */
-extern byte VDP[64];                  /* VDP control reg-ers */
-extern byte VDPStatus[16];            /* VDP status reg-ers  */
-extern byte *ChrGen,*ChrTab,*ColTab;  /* VDP tables (screen) */
-extern byte *SprGen,*SprTab;          /* VDP tables (sprites)*/
-extern int  ChrGenM,ChrTabM,ColTabM;  /* VDP masks (screen)  */
-extern int  SprTabM;                  /* VDP masks (sprites) */
-extern byte FGColor,BGColor;          /* Colors              */
-extern byte XFGColor,XBGColor;        /* Alternative colors  */
-extern byte ScrMode;                  /* Current screen mode */
-extern int  ScanLine;                 /* Current scanline    */
-extern byte *FontBuf;                 /* Optional fixed font */
-
-extern byte ExitNow;                  /* 1: Exit emulator    */
-
-extern byte PSLReg;                   /* Primary slot reg.   */
-extern byte SSLReg[4];                /* Secondary slot reg. */
-
-extern const char *ProgDir;           /* Program directory   */
-extern const char *ROMName[MAXCARTS]; /* Cart A/B ROM files  */
-extern const char *DSKName[MAXDRIVES];/* Disk A/B images     */
-extern const char *SndName;           /* Soundtrack log file */
-extern const char *PrnName;           /* Printer redir. file */
-extern const char *CasName;           /* Tape image file     */
-extern const char *ComName;           /* Serial redir. file  */
-extern const char *STAName;           /* State save name     */
-extern const char *FNTName;           /* Font file for text  */ 
-
-extern FDIDisk FDD[4];                /* Floppy disk images  */
-extern FILE *CasStream;               /* Cassette I/O stream */
+extern THREADLOCAL void (*RefreshLine[MAXSCREEN+2])(byte Y);
+/*************************************************************/
+
+extern THREADLOCAL Z80  CPU;                      /* CPU state/registers */
+extern THREADLOCAL byte *VRAM;                    /* Video RAM           */
+extern THREADLOCAL byte VDP[64];                  /* VDP control reg-ers */
+extern THREADLOCAL byte VDPStatus[16];            /* VDP status reg-ers  */
+extern THREADLOCAL byte *ChrGen,*ChrTab,*ColTab;  /* VDP tables (screen) */
+extern THREADLOCAL byte *SprGen,*SprTab;          /* VDP tables (sprites)*/
+extern THREADLOCAL int  ChrGenM,ChrTabM,ColTabM;  /* VDP masks (screen)  */
+extern THREADLOCAL int  SprTabM;                  /* VDP masks (sprites) */
+extern THREADLOCAL byte FGColor,BGColor;          /* Colors              */
+extern THREADLOCAL byte XFGColor,XBGColor;        /* Alternative colors  */
+extern THREADLOCAL byte ScrMode;                  /* Current screen mode */
+extern THREADLOCAL int  ScanLine;                 /* Current scanline    */
+extern THREADLOCAL byte *FontBuf;                 /* Optional fixed font */
+
+extern THREADLOCAL byte ExitNow;                  /* 1: Exit emulator    */
+
+extern THREADLOCAL byte PSLReg;                   /* Primary slot reg.   */
+extern THREADLOCAL byte SSLReg[4];                /* Secondary slot reg. */
+
+extern THREADLOCAL const char *ProgDir;           /* Program directory   */
+extern THREADLOCAL const char *ROMName[MAXCARTS]; /* Cart A/B ROM files  */
+extern THREADLOCAL const char *DSKName[MAXDRIVES];/* Disk A/B images     */
+extern THREADLOCAL const char *SndName;           /* Soundtrack log file */
+extern THREADLOCAL const char *PrnName;           /* Printer redir. file */
+extern THREADLOCAL const char *CasName;           /* Tape image file     */
+extern THREADLOCAL const char *ComName;           /* Serial redir. file  */
+extern THREADLOCAL const char *STAName;           /* State save name     */
+extern THREADLOCAL const char *FNTName;           /* Font file for text  */ 
+extern THREADLOCAL const char *PrfName;           /* Z80 flat profile    */
+extern THREADLOCAL const char *StkName;           /* Z80 call stacks     */
+
+extern THREADLOCAL FDIDisk FDD[4];                /* Floppy disk images  */
+extern THREADLOCAL FILE *CasStream;               /* Cassette file       */
 
 typedef struct
 {
@@ -384,6 +392,29 @@ byte ChangeTape(const char *FileName);
 /*************************************************************/
 void RewindTape(void);
 
+/** ReadTapeHeader() *****************************************/
+/** Move tape past the next block header. Returns 1 on      **/
+/** success, rewinds tape and returns 0 on failure.         **/
+/*************************************************************/
+int ReadTapeHeader(void);
+
+/** ReadTape() ***********************************************/
+/** Read next byte from the tape. Returns the byte, or it   **/
+/** rewinds tape and returns -1 at the end of the tape.     **/
+/*************************************************************/
+int ReadTape(void);
+
+/** WriteTapeHeader() ****************************************/
+/** Write a block header at the next 8-byte boundary.       **/
+/** Returns 1 on success, 0 on failure.                     **/
+/*************************************************************/
+int WriteTapeHeader(void);
+
+/** WriteTape() **********************************************/
+/** Write a byte to the tape. Returns 1 on success, else 0. **/
+/*************************************************************/
+int WriteTape(byte V);
+
 /** ChangeDisk() *********************************************/
 /** Change disk image in a given drive. Closes current disk **/
 /** image if Name=0 was given. Creates a new disk image if  **/
@@ -398,6 +429,31 @@ byte ChangeDisk(byte N,const char *FileName);
 /*************************************************************/
 byte LoadFNT(const char *FileName);
 
+/** RedrawAll() **********************************************/
+/** Make RefreshLine0/1/2() redraw every line of the next   **/
+/** frame, and ShownSprites() list sprites again. Call it   **/
+/** after drawing over the screen image, or after changing  **/
+/** the VDP state or palette outside of VDPOut() and        **/
+/** SetScreen().                                            **/
+/*************************************************************/
+void RedrawAll(void);
+
+/** LineChanged() ********************************************/
+/** Check if anything shown in line Y (0..191/211) of       **/
+/** SCREEN0/1/2 has changed since the line was last drawn.  **/
+/** Returns 1 and marks the line as drawn if the caller has **/
+/** to redraw it, or returns 0 if the line in the screen    **/
+/** image is still valid.                                   **/
+/*************************************************************/
+int LineChanged(byte Y);
+
+/** ShownSprites() *******************************************/
+/** Return sprites shown in line Y, bit N set for sprite N, **/
+/** and set the 5th/9th sprite status in VDPStatus[0]. Line **/
+/** lists are kept until sprite attributes or VDP change.   **/
+/*************************************************************/
+unsigned int ShownSprites(byte Y);
+
 /** SetScreenDepth() *****************************************/
 /** Set screen depth for the display drivers. Returns 1 on  **/
 /** success, 0 on failure.                                  **/
@@ -32,14 +32,14 @@
 
 static char SndNameBuf[256];
 
-extern byte *MemMap[4][4][8];         /* [PPage][SPage][Adr] */
-extern byte *EmptyRAM;                /* Dummy memory area   */
+extern THREADLOCAL byte *MemMap[4][4][8];         /* [PPage][SPage][Adr] */
+extern THREADLOCAL byte *EmptyRAM;                /* Dummy memory area   */
 
 /** Cheat Structures *****************************************/
-extern int CheatCount;       /* # of cheats in CheatCodes[]  */
-extern int MCFCount;         /* # of entries in MCFEntries[] */
-extern CheatCode CheatCodes[MAXCHEATS];
-extern MCFEntry MCFEntries[MAXCHEATS];
+extern THREADLOCAL int CheatCount;       /* # of cheats in CheatCodes[]  */
+extern THREADLOCAL int MCFCount;         /* # of entries in MCFEntries[] */
+extern THREADLOCAL CheatCode CheatCodes[MAXCHEATS];
+extern THREADLOCAL MCFEntry MCFEntries[MAXCHEATS];
 
 /** MenuMSX() ************************************************/
 /** Invoke a menu system allowing to configure the emulator **/
@@ -664,4 +664,7 @@ void MenuMSX(void)
         break;
     }
   }
+
+  /* Menus have been drawn over the screen */
+  RedrawAll();
 }
@@ -0,0 +1,397 @@
+/** fMSX: portable MSX emulator ******************************/
+/**                                                         **/
+/**                          Model.h                        **/
+/**                                                         **/
+/** This file contains LoopZ80() and VDPOut() code that is  **/
+/** compiled separately for each MSX model and PAL/NTSC     **/
+/** video, so that per-scanline and per-register checks    **/
+/** for features the model does not have are compiled out.  **/
+/** ModelMux.h includes this file with MODEL_ID set to the  **/
+/** MSX_MSX1/MSX_MSX2/MSX_MSX2P model and MODEL_PAL to the  **/
+/** PALVideo value. VDPOutM() is only compiled when         **/
+/** MODEL_PAL is 0, as it does not depend on video.         **/
+/**                                                         **/
+/** Copyright (C) Marat Fayzullin 1994-2021                 **/
+/**     You are not allowed to distribute this software     **/
+/**     commercially. Please, notify me, if you make any    **/
+/**     changes to this file.                               **/
+/*************************************************************/
+
+/** MODEL_212 ************************************************/
+/** TMS9918 only shows 192 scanlines.                       **/
+/*************************************************************/
+#if MODEL_ID==MSX_MSX1
+#define MODEL_212 0
+#else
+#define MODEL_212 ScanLines212
+#endif
+
+#if !MODEL_PAL
+/** VDPOutM() ***********************************************/
+/** Write value into a given VDP register. VDPOut() calls   **/
+/** this function.                                          **/
+/*************************************************************/
+void VDPOutM(register byte R,register byte V)
+{ 
+  register byte J;
+
+#if MODEL_ID==MSX_MSX1
+  /* TMS9918 decodes three register bits, has no M4/M5/IE1 */
+  R&=0x07;
+  if(!R) V&=0x03;
+#elif MODEL_ID==MSX_MSX2
+  /* V9938 does not have V9958 registers 25-27 */
+  if((R>=25)&&(R<=27)) return;
+#endif
+
+  /* Lines drawn so far do not show the new register value */
+  if((VDP[R]!=V)&&((R<14)||((R>17)&&(R<32)))) RedrawAll();
+
+  switch(R)  
+  {
+    case  0: /* Reset HBlank interrupt if disabled */
+             if((VDPStatus[1]&0x01)&&!(V&0x10))
+             {
+               VDPStatus[1]&=0xFE;
+               SetIRQ(~INT_IE1);
+             }
+             /* Set screen mode */
+             if(VDP[0]!=V) { VDP[0]=V;SetScreen(); }
+             break;
+    case  1: /* Set/Reset VBlank interrupt if enabled or disabled */
+             if(VDPStatus[0]&0x80) SetIRQ(V&0x20? INT_IE0:~INT_IE0);
+             /* Set screen mode */
+             if(VDP[1]!=V) { VDP[1]=V;SetScreen(); }
+             break;
+    case  2: J=(ScrMode>6)&&(ScrMode!=MAXSCREEN+1)? 11:10;
+             ChrTab  = VRAM+((int)(V&MSK[ScrMode].R2)<<J);
+             ChrTabM = ((int)(V|~MSK[ScrMode].M2)<<J)|((1<<J)-1);
+             break;
+    case  3: ColTab  = VRAM+((int)(V&MSK[ScrMode].R3)<<6)+((int)VDP[10]<<14);
+             ColTabM = ((int)(V|~MSK[ScrMode].M3)<<6)|0x1C03F;
+             break;
+    case  4: ChrGen  = VRAM+((int)(V&MSK[ScrMode].R4)<<11);
+             ChrGenM = ((int)(V|~MSK[ScrMode].M4)<<11)|0x007FF;
+             break;
+    case  5: SprTab  = VRAM+((int)(V&MSK[ScrMode].R5)<<7)+((int)VDP[11]<<15);
+             SprTabM = ((int)(V|~MSK[ScrMode].M5)<<7)|0x1807F;
+             break;
+    case  6: V&=0x3F;SprGen=VRAM+((int)V<<11);break;
+    case  7: FGColor=V>>4;BGColor=V&0x0F;break;
+#if MODEL_ID!=MSX_MSX1
+    case  9: /* LoopZ80() depends on PAL/NTSC */
+             if((VDP[9]^V)&0x02) { VDP[9]=V;SetModel(); }
+             break;
+    case 10: V&=0x07;
+             ColTab=VRAM+((int)(VDP[3]&MSK[ScrMode].R3)<<6)+((int)V<<14);
+             break;
+    case 11: V&=0x03;
+             SprTab=VRAM+((int)(VDP[5]&MSK[ScrMode].R5)<<7)+((int)V<<15);
+             break;
+    case 14: V&=VRAMPages-1;VPAGE=VRAM+((int)V<<14);
+             break;
+    case 15: V&=0x0F;break;
+    case 16: V&=0x0F;PKey=1;break;
+    case 17: V&=0xBF;break;
+#if MODEL_ID==MSX_MSX2P
+    case 25: VDP[25]=V;
+             SetScreen();
+             break;
+#endif
+    case 44: VDPWrite(V);CommandWrote();break;
+    case 46: PERF_START(PERF_VDP);VDPDraw(V);PERF_STOP(PERF_VDP);
+             CommandWrote();
+             break;
+#endif /* MODEL_ID!=MSX_MSX1 */
+  }
+
+  /* Write value into a register */
+  VDP[R]=V;
+} 
+
+#endif /* !MODEL_PAL */
+
+/** LoopZ80M() ***********************************************/
+/** Refresh screen, check keyboard and sprites. LoopZ80()   **/
+/** calls this function on each interrupt.                  **/
+/*************************************************************/
+word LoopZ80M(Z80 *R)
+{
+  register int J;
+
+#if MODEL_ID!=MSX_MSX1
+  /* Give V9938 engine the rest of the period that ended */
+  VDPSync(R->IPeriod-VDPGiven);
+  VDPGiven=0;
+#endif
+
+  /* Flip HRefresh bit */
+  VDPStatus[2]^=0x20;
+
+  /* If HRefresh is now in progress... */
+  if(!(VDPStatus[2]&0x20))
+  {
+    /* HRefresh takes most of the scanline */
+    R->IPeriod=!ScrMode||(ScrMode==MAXSCREEN+1)? CPU_H240:CPU_H256;
+
+    /* New scanline */
+    ScanLine=ScanLine<(MODEL_PAL? 312:261)? ScanLine+1:0;
+
+    /* If first scanline of the screen... */
+    if(!ScanLine)
+    {
+      /* Drawing now... */
+      Drawing=1;
+
+      /* Reset VRefresh bit */
+      VDPStatus[2]&=0xBF;
+
+      /* Count host time taken by the last frame */
+      PERF_FRAME();
+
+      /* Refresh display */
+      if(UCount>=100)
+      {
+        UCount-=100;
+        PERF_START(PERF_VIDEO);
+        RefreshScreen();
+        PERF_STOP(PERF_VIDEO);
+      }
+
+      /* Turbo mode draws whenever the sync timer fires, so */
+      /* drawing follows real time, not emulated frames     */
+      if(!Turbo) UCount+=UPeriod;
+      else if(SyncTimerReady()) { WaitSyncTimer();UCount=100; }
+
+      /* Count emulated time */
+      EmuTime+=(double)VPeriod/CPU_CLOCK;
+
+#if MODEL_ID!=MSX_MSX1
+      /* Blinking for TEXT80 */
+      if(BCount) BCount--;
+      else
+      {
+        BFlag=!BFlag;
+        if(!VDP[13]) { XFGColor=FGColor;XBGColor=BGColor; }
+        else
+        {
+          BCount=(BFlag? VDP[13]&0x0F:VDP[13]>>4)*10;
+          if(BCount)
+          {
+            if(BFlag) { XFGColor=FGColor;XBGColor=BGColor; }
+            else      { XFGColor=VDP[12]>>4;XBGColor=VDP[12]&0x0F; }
+          }
+        }
+      }
+#endif
+    }
+
+#if MODEL_ID!=MSX_MSX1
+    /* Line coincidence is active at 0..255 */
+    /* in PAL and 0..234/244 in NTSC        */
+    J=MODEL_PAL? 256:MODEL_212? 245:235;
+
+    /* When reaching end of screen, reset line coincidence */
+    if(ScanLine==J)
+    {
+      VDPStatus[1]&=0xFE;
+      SetIRQ(~INT_IE1);
+    }
+
+    /* When line coincidence is active... */
+    if(ScanLine<J)
+    {
+      /* Line coincidence processing */
+      J=(((ScanLine+VScroll)&0xFF)-VDP[19])&0xFF;
+      if(J==2)
+      {
+        /* Set HBlank flag on line coincidence */
+        VDPStatus[1]|=0x01;
+        /* Generate IE1 interrupt */
+        if(VDP[0]&0x10) SetIRQ(INT_IE1);
+      }
+      else
+      {
+        /* Reset flag immediately if IE1 interrupt disabled */
+        if(!(VDP[0]&0x10)) VDPStatus[1]&=0xFE;
+      }
+    }
+#endif
+
+    /* Return whatever interrupt is pending */
+    R->IRequest=IRQPending? INT_IRQ:INT_NONE;
+    return(R->IRequest);
+  }
+
+  /*********************************/
+  /* We come here for HBlanks only */
+  /*********************************/
+
+  /* HBlank takes HPeriod-HRefresh */
+  R->IPeriod=!ScrMode||(ScrMode==MAXSCREEN+1)? CPU_H240:CPU_H256;
+  R->IPeriod=HPeriod-R->IPeriod;
+
+  /* If last scanline of VBlank, see if we need to wait more */
+  J=MODEL_PAL? 313:262;
+  if(ScanLine>=J-1)
+  {
+    J*=CPU_HPERIOD;
+    if(VPeriod>J) R->IPeriod+=VPeriod-J;
+  }
+
+  /* If first scanline of the bottom border... */
+  if(ScanLine==(MODEL_212? 212:192)) Drawing=0;
+
+  /* If first scanline of VBlank... */
+  J=MODEL_PAL? (MODEL_212? 212+42:192+52):(MODEL_212? 212+18:192+28);
+  if(!Drawing&&(ScanLine==J))
+  {
+    /* Set VBlank bit, set VRefresh bit */
+    VDPStatus[0]|=0x80;
+    VDPStatus[2]|=0x40;
+
+    /* Generate VBlank interrupt */
+    if(VDP[1]&0x20) SetIRQ(INT_IE0);
+  }
+
+#if MODEL_ID!=MSX_MSX1
+  /* Run V9938 command when its results get drawn or checked */
+  /* for sprite collisions. Otherwise, it saves up its time  */
+  /* until the CPU looks at VRAM or VDP, see SyncVDP().      */
+  if((VDPStatus[2]&0x01)&&((ScanLine==192)||((UCount>=100)&&Drawing&&(ScanLine<256))))
+  {
+    PERF_START(PERF_VDP);
+    LoopVDP();
+    CommandWrote();
+    PERF_STOP(PERF_VDP);
+  }
+#endif
+
+#ifdef DEBUG
+  /* Debugger draws over the screen, redraw it after tracing */
+  if(R->Trace) Traced=1;
+  else if(Traced) { Traced=0;RedrawAll(); }
+#endif
+
+  /* Refresh scanline, possibly with the overscan */
+  if((UCount>=100)&&Drawing&&(ScanLine<256))
+  {
+    PERF_START(PERF_LINE);
+#if MODEL_ID==MSX_MSX2P
+    if(!ModeYJK||(ScrMode<7)||(ScrMode>8))
+      (RefreshLine[ScrMode])(ScanLine);
+    else
+      if(ModeYAE) RefreshLine10(ScanLine);
+      else RefreshLine12(ScanLine);
+#else
+    (RefreshLine[ScrMode])(ScanLine);
+#endif
+    PERF_STOP(PERF_LINE);
+  }
+
+  /* Every few scanlines, update sound */
+  if(!(ScanLine&0x07))
+  {
+    PERF_START(PERF_SOUND);
+
+    /* Compute number of microseconds */
+    J = (int)(1000000L*(CPU_HPERIOD<<3)/CPU_CLOCK);
+
+    /* Update AY8910 state */
+    Loop8910(&PSG,J);
+
+    /* Flush changes to sound channels, only hit drums once a frame */
+    Sync8910(&PSG,AY8910_FLUSH|(!ScanLine&&OPTION(MSX_DRUMS)? AY8910_DRUMS:0));
+    SyncSCC(&SCChip,SCC_FLUSH);
+    Sync2413(&OPLL,YM2413_FLUSH);
+
+    /* Render and play all sound now, turbo mode is silent */
+    if(!Turbo) PlayAllSound(J);
+
+    PERF_STOP(PERF_SOUND);
+  }
+
+  /* Keyboard, sound, and other stuff always runs at line 192    */
+  /* This way, it can't be shut off by overscan tricks (Maarten) */
+  if(ScanLine==192)
+  {
+    /* Clear 5thSprite fields (wrong place to do it?) */
+    VDPStatus[0]=(VDPStatus[0]&~0x40)|0x1F;
+
+    /* Check sprites and set Collision bit, turbo mode */
+    /* only does it on frames that are being drawn      */
+    if(!(VDPStatus[0]&0x20)&&(!Turbo||(UCount>=100))&&CheckSprites())
+      VDPStatus[0]|=0x20;
+
+    /* Count MIDI ticks */
+    MIDITicks(1000*VPeriod/CPU_CLOCK);
+
+    /* Apply RAM-based cheats */
+    if(CheatsON&&CheatCount) ApplyCheats();
+
+    /* Check joystick */
+    JoyState=Joystick();
+
+    /* Check keyboard */
+    Keyboard();
+
+    /* Exit emulation if requested */
+    if(ExitNow) return(INT_QUIT);
+
+    /* Check mouse in joystick port #1 */
+    if(JOYTYPE(0)>=JOY_MOUSTICK)
+    {
+      /* Get new mouse state */
+      MouState[0]=Mouse(0);
+      /* Merge mouse buttons into joystick buttons */
+      JoyState|=(MouState[0]>>12)&0x0030;
+      /* If mouse-as-joystick... */
+      if(JOYTYPE(0)==JOY_MOUSTICK)
+      {
+        J=MouState[0]&0xFF;
+        JoyState|=J>OldMouseX[0]? 0x0008:J<OldMouseX[0]? 0x0004:0;
+        OldMouseX[0]=J;
+        J=(MouState[0]>>8)&0xFF;
+        JoyState|=J>OldMouseY[0]? 0x0002:J<OldMouseY[0]? 0x0001:0;
+        OldMouseY[0]=J;
+      }
+    }
+
+    /* Check mouse in joystick port #2 */
+    if(JOYTYPE(1)>=JOY_MOUSTICK)
+    {
+      /* Get new mouse state */
+      MouState[1]=Mouse(1);
+      /* Merge mouse buttons into joystick buttons */
+      JoyState|=(MouState[1]>>4)&0x3000;
+      /* If mouse-as-joystick... */
+      if(JOYTYPE(1)==JOY_MOUSTICK)
+      {
+        J=MouState[1]&0xFF;
+        JoyState|=J>OldMouseX[1]? 0x0800:J<OldMouseX[1]? 0x0400:0;
+        OldMouseX[1]=J;
+        J=(MouState[1]>>8)&0xFF;
+        JoyState|=J>OldMouseY[1]? 0x0200:J<OldMouseY[1]? 0x0100:0;
+        OldMouseY[1]=J;
+      }
+    }
+
+    /* If any autofire options selected, run autofire counter */
+    if(OPTION(MSX_AUTOSPACE|MSX_AUTOFIREA|MSX_AUTOFIREB))
+      if((ACount=(ACount+1)&0x07)>3)
+      {
+        /* Autofire spacebar if needed */
+        if(OPTION(MSX_AUTOSPACE)) KBD_RES(' ');
+        /* Autofire FIRE-A if needed */
+        if(OPTION(MSX_AUTOFIREA)) JoyState&=~(JST_FIREA|(JST_FIREA<<8));
+        /* Autofire FIRE-B if needed */
+        if(OPTION(MSX_AUTOFIREB)) JoyState&=~(JST_FIREB|(JST_FIREB<<8));
+      }
+  }
+
+  /* Return whatever interrupt is pending */
+  R->IRequest=IRQPending? INT_IRQ:INT_NONE;
+  return(R->IRequest);
+}
+
+#undef MODEL_212
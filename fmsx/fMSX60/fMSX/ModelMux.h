@@ -0,0 +1,91 @@
+/** fMSX: portable MSX emulator ******************************/
+/**                                                         **/
+/**                       ModelMux.h                        **/
+/**                                                         **/
+/** This file instantiates LoopZ80() and VDPOut() for every **/
+/** MSX model and PAL/NTSC video. It includes common code   **/
+/** from Model.h. SetModel() selects the instances to run.  **/
+/**                                                         **/
+/** Copyright (C) Marat Fayzullin 1994-2021                 **/
+/**     You are not allowed to distribute this software     **/
+/**     commercially. Please, notify me, if you make any    **/
+/**     changes to this file.                               **/
+/*************************************************************/
+#ifndef MODELMUX_H
+#define MODELMUX_H
+
+/** Current LoopZ80() and VDPOut() instances *****************/
+static THREADLOCAL word (*LoopModel)(Z80 *R);
+static THREADLOCAL void (*VDPOutModel)(byte R,byte V);
+
+#define MODEL_ID  MSX_MSX1
+#define MODEL_PAL 0
+#define LoopZ80M  LoopZ80_MSX1
+#define VDPOutM   VDPOut_MSX1
+#include "Model.h"
+#undef MODEL_ID
+#undef MODEL_PAL
+#undef LoopZ80M
+#undef VDPOutM
+
+#define MODEL_ID  MSX_MSX2
+#define MODEL_PAL 0
+#define LoopZ80M  LoopZ80_MSX2
+#define VDPOutM   VDPOut_MSX2
+#include "Model.h"
+#undef MODEL_ID
+#undef MODEL_PAL
+#undef LoopZ80M
+#undef VDPOutM
+
+#define MODEL_ID  MSX_MSX2
+#define MODEL_PAL 1
+#define LoopZ80M  LoopZ80_MSX2_PAL
+#include "Model.h"
+#undef MODEL_ID
+#undef MODEL_PAL
+#undef LoopZ80M
+
+#define MODEL_ID  MSX_MSX2P
+#define MODEL_PAL 0
+#define LoopZ80M  LoopZ80_MSX2P
+#define VDPOutM   VDPOut_MSX2P
+#include "Model.h"
+#undef MODEL_ID
+#undef MODEL_PAL
+#undef LoopZ80M
+#undef VDPOutM
+
+#define MODEL_ID  MSX_MSX2P
+#define MODEL_PAL 1
+#define LoopZ80M  LoopZ80_MSX2P_PAL
+#include "Model.h"
+#undef MODEL_ID
+#undef MODEL_PAL
+#undef LoopZ80M
+
+/** SetModel() ***********************************************/
+/** Select LoopZ80() and VDPOut() instances for the current **/
+/** MSX model and PAL/NTSC video. Call it after changing    **/
+/** either of them.                                         **/
+/*************************************************************/
+void SetModel(void)
+{
+  if(MODEL(MSX_MSX1))
+  {
+    LoopModel   = LoopZ80_MSX1;
+    VDPOutModel = VDPOut_MSX1;
+  }
+  else if(MODEL(MSX_MSX2))
+  {
+    LoopModel   = PALVideo? LoopZ80_MSX2_PAL:LoopZ80_MSX2;
+    VDPOutModel = VDPOut_MSX2;
+  }
+  else
+  {
+    LoopModel   = PALVideo? LoopZ80_MSX2P_PAL:LoopZ80_MSX2P;
+    VDPOutModel = VDPOut_MSX2P;
+  }
+}
+
+#endif /* MODELMUX_H */
@@ -77,8 +77,6 @@ byte DiskWrite(byte ID,const byte *Buf,int N)
 /*************************************************************/
 void PatchZ80(Z80 *R)
 {
-  static const byte TapeHeader[8] = { 0x1F,0xA6,0xDE,0xBA,0xCC,0x13,0x7D,0x74 };
-
   static const struct
   { int Sectors;byte Heads,Names,PerTrack,PerFAT,PerCluster; }
   Info[8] =
@@ -363,32 +361,12 @@ case 0x00E1:
 /** TAPION: Open for read and read header ***********************
 ****************************************************************/
 {
-  long Pos;
-
   if(Verbose&0x04) printf("TAPE: Looking for header...");
 
-  R->AF.B.l|=C_FLAG;
-  if(CasStream)
-  {
-    Pos=ftell(CasStream);
-    if(Pos&7)
-      if(fseek(CasStream,8-(Pos&7),SEEK_CUR))
-      {
-        if(Verbose&0x04) puts("FAILED");
-        rewind(CasStream);return;
-      }
-
-    while(fread(Buf,1,8,CasStream)==8)
-      if(!memcmp(Buf,TapeHeader,8))
-      {
-        if(Verbose&0x04) puts("OK");
-        R->AF.B.l&=~C_FLAG;return;
-      }
-
-    rewind(CasStream);
-  }
+  if(!ReadTapeHeader()) R->AF.B.l|=C_FLAG;
+  else R->AF.B.l&=~C_FLAG;
 
-  if(Verbose&0x04) puts("FAILED");
+  if(Verbose&0x04) puts(R->AF.B.l&C_FLAG? "FAILED":"OK");
   return;
 }
 
@@ -398,12 +376,8 @@ case 0x00E4:
 {
   R->AF.B.l|=C_FLAG;
 
-  if(CasStream)
-  {
-    J=fgetc(CasStream);
-    if(J<0) rewind(CasStream);
-    else { R->AF.B.h=J;R->AF.B.l&=~C_FLAG; }
-  }
+  J=ReadTape();
+  if(J>=0) { R->AF.B.h=J;R->AF.B.l&=~C_FLAG; }
 
   return;
 }
@@ -418,20 +392,8 @@ case 0x00EA:
 /** TAPOON: *****************************************************
 ****************************************************************/
 {
-  long Pos;
-
-  R->AF.B.l|=C_FLAG;
-
-  if(CasStream)
-  {
-    Pos=ftell(CasStream);
-    if(Pos&7)
-      if(fseek(CasStream,8-(Pos&7),SEEK_CUR))
-      { R->AF.B.l|=C_FLAG;return; }
-
-    fwrite(TapeHeader,1,8,CasStream);
-    R->AF.B.l&=~C_FLAG;
-  }   
+  if(!WriteTapeHeader()) R->AF.B.l|=C_FLAG;
+  else R->AF.B.l&=~C_FLAG;
 
   return;
 }
@@ -439,13 +401,8 @@ case 0x00EA:
 case 0x00ED:
 /** TAPOUT: Write tape ******************************************
 ****************************************************************/
-  R->AF.B.l|=C_FLAG;
-
-  if(CasStream)
-  {
-    fputc(R->AF.B.h,CasStream);
-    R->AF.B.l&=~C_FLAG;
-  }
+  if(!WriteTape(R->AF.B.h)) R->AF.B.l|=C_FLAG;
+  else R->AF.B.l&=~C_FLAG;
 
   return;
 
@@ -0,0 +1,171 @@
+/** fMSX: portable MSX emulator ******************************/
+/**                                                         **/
+/**                          Perf.c                         **/
+/**                                                         **/
+/** This file contains the host time instrumentation. It    **/
+/** measures how much real time each frame spends in every  **/
+/** PERF_* subsystem, counting whatever is not measured as  **/
+/** PERF_CPU, keeps totals and histograms of time per       **/
+/** frame, and optionally writes each frame to a .CSV file. **/
+/** All state is per-thread.                                **/
+/**                                                         **/
+/** Copyright (C) Marat Fayzullin 1994-2021                 **/
+/**     You are not allowed to distribute this software     **/
+/**     commercially. Please, notify me, if you make any    **/
+/**     changes to this file.                               **/
+/*************************************************************/
+#ifdef HOSTPERF
+
+#include "Perf.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define BUCKETS 18         /* <1us, <2us, ... <64ms, more    */
+
+typedef long long nsec;
+
+THREADLOCAL byte PerfOn = 0;           /* 1: Collect host times  */
+THREADLOCAL const char *PerfName = 0;  /* Per-frame .CSV or 0    */
+
+static const char *Names[PERF_COUNT] =
+{ "cpu","vdp","line","sound","video" };
+
+static THREADLOCAL nsec Started[PERF_COUNT];     /* PerfStart()  */
+static THREADLOCAL nsec Frame[PERF_COUNT];       /* This frame   */
+static THREADLOCAL nsec Total[PERF_COUNT+1];     /* All frames   */
+static THREADLOCAL nsec Worst[PERF_COUNT+1];     /* Worst frame  */
+static THREADLOCAL unsigned int Hist[PERF_COUNT+1][BUCKETS];
+static THREADLOCAL nsec FrameStart;    /* When frame started     */
+static THREADLOCAL unsigned int Frames;/* Frames counted so far  */
+static THREADLOCAL FILE *CSV;          /* Per-frame .CSV file    */
+
+/** Now() ****************************************************/
+/** Return current host time in nanoseconds.                **/
+/*************************************************************/
+static nsec Now(void)
+{
+#ifdef CLOCK_MONOTONIC
+  struct timespec T;
+  clock_gettime(CLOCK_MONOTONIC,&T);
+  return((nsec)T.tv_sec*1000000000+T.tv_nsec);
+#else
+  return((nsec)clock()*1000000000/CLOCKS_PER_SEC);
+#endif
+}
+
+/** Count() **************************************************/
+/** Add one frame's time T for subsystem N to its totals.   **/
+/*************************************************************/
+static void Count(int N,nsec T)
+{
+  int J;
+
+  Total[N]+=T;
+  if(T>Worst[N]) Worst[N]=T;
+  for(J=0,T/=1000;T&&(J<BUCKETS-1);++J,T>>=1);
+  Hist[N][J]++;
+}
+
+/** InitPerf() ***********************************************/
+/** Start collecting host times, writing them to PerfName,  **/
+/** if given. Returns 1 on success, 0 on failure.           **/
+/*************************************************************/
+int InitPerf(void)
+{
+  int J;
+
+  memset(Frame,0,sizeof(Frame));
+  memset(Total,0,sizeof(Total));
+  memset(Worst,0,sizeof(Worst));
+  memset(Hist,0,sizeof(Hist));
+  Frames = 0;
+  CSV    = 0;
+
+  if(PerfName)
+  {
+    if(!(CSV=fopen(PerfName,"wb"))) return(0);
+    fprintf(CSV,"frame,total_us");
+    for(J=0;J<PERF_COUNT;++J) fprintf(CSV,",%s_us",Names[J]);
+    fprintf(CSV,"\n");
+  }
+
+  PerfOn     = 1;
+  FrameStart = Now();
+  return(1);
+}
+
+/** TrashPerf() **********************************************/
+/** Stop collecting host times, print time per subsystem    **/
+/** and histograms of time per frame.                       **/
+/*************************************************************/
+void TrashPerf(void)
+{
+  nsec All;
+  int J,I;
+
+  if(!PerfOn) return;
+  PerfOn = 0;
+  if(CSV) { fclose(CSV);CSV=0; }
+  if(!Frames) return;
+
+  All = Total[PERF_COUNT]? Total[PERF_COUNT]:1;
+  printf("Host time over %u frames:\n",Frames);
+  printf("  %-6s %10s %7s %10s %10s\n","","total ms","%","us/frame","worst us");
+  for(J=0;J<=PERF_COUNT;++J)
+    printf("  %-6s %10.1f %7.2f %10.1f %10.1f\n",
+      J<PERF_COUNT? Names[J]:"all",Total[J]/1000000.0,100.0*Total[J]/All,
+      Total[J]/1000.0/Frames,Worst[J]/1000.0
+    );
+
+  printf("Frames by host time spent:\n  %-8s","us");
+  for(J=0;J<=PERF_COUNT;++J) printf(" %7s",J<PERF_COUNT? Names[J]:"all");
+  printf("\n");
+  for(I=0;I<BUCKETS;++I)
+  {
+    for(J=0;(J<=PERF_COUNT)&&!Hist[J][I];++J);
+    if(J>PERF_COUNT) continue;
+    if(!I) printf("  %-8s","<1");
+    else if(I<BUCKETS-1) printf("  <%-7d",1<<I);
+    else printf("  >=%-6d",1<<(I-1));
+    for(J=0;J<=PERF_COUNT;++J) printf(" %7u",Hist[J][I]);
+    printf("\n");
+  }
+}
+
+/** PerfStart()/PerfStop() ***********************************/
+/** Start and stop timing subsystem N. Do not nest them.    **/
+/*************************************************************/
+void PerfStart(int N) { Started[N]=Now(); }
+void PerfStop(int N)  { Frame[N]+=Now()-Started[N]; }
+
+/** PerfFrame() **********************************************/
+/** Close the current frame: add its times to histograms    **/
+/** and to the .CSV file.                                   **/
+/*************************************************************/
+void PerfFrame(void)
+{
+  nsec T,Rest;
+  int J;
+
+  T = Now();
+  for(J=0,Rest=T-FrameStart;J<PERF_COUNT;++J) Rest-=Frame[J];
+  Frame[PERF_CPU] = Rest>0? Rest:0;
+
+  Count(PERF_COUNT,T-FrameStart);
+  for(J=0;J<PERF_COUNT;++J) Count(J,Frame[J]);
+
+  if(CSV)
+  {
+    fprintf(CSV,"%u,%.3f",Frames,(T-FrameStart)/1000.0);
+    for(J=0;J<PERF_COUNT;++J) fprintf(CSV,",%.3f",Frame[J]/1000.0);
+    fprintf(CSV,"\n");
+  }
+
+  memset(Frame,0,sizeof(Frame));
+  FrameStart = T;
+  Frames++;
+}
+
+#endif /* HOSTPERF */
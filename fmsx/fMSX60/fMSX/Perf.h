@@ -0,0 +1,81 @@
+/** fMSX: portable MSX emulator ******************************/
+/**                                                         **/
+/**                          Perf.h                         **/
+/**                                                         **/
+/** This file contains definitions and declarations for the **/
+/** host time instrumentation in Perf.c. Compile with       **/
+/** HOSTPERF #defined to have it, and run with -perf or     **/
+/** -perflog to turn it on.                                 **/
+/**                                                         **/
+/** Copyright (C) Marat Fayzullin 1994-2021                 **/
+/**     You are not allowed to distribute this software     **/
+/**     commercially. Please, notify me, if you make any    **/
+/**     changes to this file.                               **/
+/*************************************************************/
+#ifndef PERF_H
+#define PERF_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "ThreadLocal.h"
+
+                           /* Host time is split between:    */
+#define PERF_CPU     0     /* Z80, I/O, and everything else  */
+#define PERF_VDP     1     /* V9938 command engine           */
+#define PERF_LINE    2     /* RefreshLine*() renderers       */
+#define PERF_SOUND   3     /* Sound chips, PlayAllSound()    */
+#define PERF_VIDEO   4     /* RefreshScreen(), ShowVideo()   */
+#define PERF_COUNT   5     /* Number of subsystems           */
+
+#ifndef BYTE_TYPE_DEFINED
+#define BYTE_TYPE_DEFINED
+typedef unsigned char byte;
+#endif
+
+/** PERF_*() *************************************************/
+/** Use these macros around subsystem calls. They compile   **/
+/** to nothing without HOSTPERF, and to a test of PerfOn    **/
+/** with it. PERF_FRAME() is called once per frame.         **/
+/*************************************************************/
+#ifdef HOSTPERF
+#define PERF_START(N) if(PerfOn) PerfStart(N)
+#define PERF_STOP(N)  if(PerfOn) PerfStop(N)
+#define PERF_FRAME()  if(PerfOn) PerfFrame()
+#else
+#define PERF_START(N)
+#define PERF_STOP(N)
+#define PERF_FRAME()
+#endif
+
+extern THREADLOCAL byte PerfOn;        /* 1: Collect host times  */
+extern THREADLOCAL const char *PerfName; /* Per-frame .CSV or 0  */
+
+/** InitPerf() ***********************************************/
+/** Start collecting host times, writing them to PerfName,  **/
+/** if given. Returns 1 on success, 0 on failure.           **/
+/*************************************************************/
+int InitPerf(void);
+
+/** TrashPerf() **********************************************/
+/** Stop collecting host times, print time per subsystem    **/
+/** and histograms of time per frame.                       **/
+/*************************************************************/
+void TrashPerf(void);
+
+/** PerfStart()/PerfStop() ***********************************/
+/** Start and stop timing subsystem N. Do not nest them.    **/
+/*************************************************************/
+void PerfStart(int N);
+void PerfStop(int N);
+
+/** PerfFrame() **********************************************/
+/** Close the current frame: add its times to histograms    **/
+/** and to the .CSV file.                                   **/
+/*************************************************************/
+void PerfFrame(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* PERF_H */
@@ -55,6 +55,9 @@ unsigned int SaveState(unsigned char *Buf,unsigned int MaxSize)
   unsigned int State[256],Size;
   int J,I,K;
 
+  /* V9938 command time is not saved, run the command now */
+  SyncVDP();
+
   /* No data written yet */
   Size = 0;
 
@@ -210,6 +213,9 @@ unsigned int LoadState(unsigned char *Buf,unsigned int MaxSize)
   /* Set screen mode and VRAM table addresses */
   SetScreen();
 
+  /* Select model-specific LoopZ80()/VDPOut() */
+  SetModel();
+
   /* Set some other variables */
   VPAGE    = VRAM+((int)VDP[14]<<14);
   FGColor  = VDP[7]>>4;
@@ -235,7 +241,7 @@ unsigned int LoadState(unsigned char *Buf,unsigned int MaxSize)
 /*************************************************************/
 int SaveSTA(const char *Name)
 {
-  static byte Header[16] = "STE\032\003\0\0\0\0\0\0\0\0\0\0\0";
+  static THREADLOCAL byte Header[16] = "STE\032\003\0\0\0\0\0\0\0\0\0\0\0";
   unsigned int J,Size;
   byte *Buf;
   FILE *F;
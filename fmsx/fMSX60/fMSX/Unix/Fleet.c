@@ -0,0 +1,342 @@
+/** fMSX: portable MSX emulator ******************************/
+/**                                                         **/
+/**                         Fleet.c                         **/
+/**                                                         **/
+/** This file contains main() for fmsx-fleet, which runs a  **/
+/** manifest of headless emulation jobs on a pool of worker **/
+/** threads and prints frame, audio, and state hashes for   **/
+/** each job. Manifest lines look like this:                **/
+/**                                                         **/
+/**   # ROM       CONFIG          REPLAY     FRAMES         **/
+/**   GAME.ROM    msx2,pal,ram=8  GAME.RPL   3000           **/
+/**   -           msx1            -          600            **/
+/**                                                         **/
+/** CONFIG is "-" or a comma-separated list of msx1, msx2,  **/
+/** msx2+, pal, ntsc, ram=N, vram=N, rom=N (mapper of the   **/
+/** cartridge), joy=N (joystick A type), and time=N (RTC    **/
+/** time in seconds since 1970). System ROMs are loaded     **/
+/** from the current directory.                             **/
+/**                                                         **/
+/** Copyright (C) Marat Fayzullin 1994-2021                 **/
+/**     You are not allowed to distribute this software     **/
+/**     commercially. Please, notify me, if you make any    **/
+/**     changes to this file.                               **/
+/*************************************************************/
+#include "MSX.h"
+#include "EMULib.h"
+#include "SHA1.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#define FLEET_TIME 946684800       /* Default RTC: 2000-01-01 */
+
+typedef struct
+{
+  char *ROM;                       /* Cartridge or 0         */
+  char *Replay;                    /* .RPL file or 0         */
+  int Mode,RAMPages,VRAMPages;     /* Machine configuration  */
+  unsigned int Time;               /* RTC time               */
+  int Frames;                      /* Frames to emulate      */
+  int Line;                        /* Manifest line number   */
+  char FrameHash[41];              /* SHA1 of the last frame */
+  char AudioHash[41];              /* SHA1 of all samples    */
+  char StateHash[41];              /* SHA1 of SaveState()    */
+} Job;
+
+typedef struct
+{
+  pthread_mutex_t Lock;
+  pthread_t Thread;
+  int Head,Tail;                   /* Queued Jobs[Head..Tail)*/
+} Worker;
+
+extern int UseSound;               /* From Headless.c        */
+extern THREADLOCAL const char *ReplayName;
+extern THREADLOCAL void (*FrameHandler)(Image *Img);
+
+static Job *Jobs;
+static int JobCount;
+static Worker *Workers;
+static int WorkerCount;
+
+static THREADLOCAL Job *CurJob;    /* Job run by this thread */
+static THREADLOCAL int FrameCount; /* Frames shown so far    */
+static THREADLOCAL SHA1 AudioSHA;  /* Running audio hash     */
+
+/** HashFrame() **********************************************/
+/** FrameHandler: count frames, hash the last one and stop. **/
+/*************************************************************/
+static void HashFrame(Image *Img)
+{
+  SHA1 C;
+  int Y;
+
+  if(++FrameCount<CurJob->Frames) return;
+
+  /* Hash visible pixels row by row, skipping the pitch */
+  ResetSHA1(&C);
+  for(Y=0;Y<VideoH;++Y)
+    InputSHA1(&C,(const unsigned char *)(Img->Data+(VideoY+Y)*Img->L+VideoX),VideoW*sizeof(pixel));
+  if(ComputeSHA1(&C)) OutputSHA1(&C,CurJob->FrameHash,sizeof(CurJob->FrameHash));
+
+  /* Done with this job */
+  ExitNow=1;
+}
+
+/** HashAudio() **********************************************/
+/** Audio handler: add samples to the running audio hash.   **/
+/*************************************************************/
+static void HashAudio(const sample *Data,unsigned int Length)
+{
+  InputSHA1(&AudioSHA,(const unsigned char *)Data,Length*sizeof(sample));
+}
+
+/** RunJob() *************************************************/
+/** Thread running one job from power-on to the last frame. **/
+/*************************************************************/
+static void *RunJob(void *Arg)
+{
+  Job *J = (Job *)Arg;
+  unsigned char *Buf;
+  unsigned int Size;
+  SHA1 C;
+
+  CurJob     = J;
+  FrameCount = 0;
+  ResetSHA1(&AudioSHA);
+
+  /* Quiet, every frame drawn, no files written or shared */
+  Verbose    = 0;
+  UPeriod    = 100;
+  SaveFiles  = 0;
+  ProgDir    = 0;
+  RTCTime    = J->Time;
+  ROMName[0] = J->ROM;
+  ROMName[1] = 0;
+  DSKName[0] = 0;
+  DSKName[1] = 0;
+  CasName    = 0;
+  SndName    = 0;
+  PrnName    = "/dev/null";
+  ComName    = "/dev/null";
+  Mode       = J->Mode;
+  RAMPages   = J->RAMPages;
+  VRAMPages  = J->VRAMPages;
+
+  ReplayName   = J->Replay;
+  FrameHandler = HashFrame;
+  SetAudioHandler(HashAudio);
+
+  if(InitMachine())
+  {
+    /* A job is only good if it ran all frames with its replay */
+    if(StartMSX(Mode,RAMPages,VRAMPages)&&J->FrameHash[0]&&!ReplayName)
+    {
+      if(ComputeSHA1(&AudioSHA)) OutputSHA1(&AudioSHA,J->AudioHash,sizeof(J->AudioHash));
+
+      Size = MAX_STASIZE;
+      if((Buf=malloc(Size)))
+      {
+        ResetSHA1(&C);
+        InputSHA1(&C,Buf,SaveState(Buf,Size));
+        if(ComputeSHA1(&C)) OutputSHA1(&C,J->StateHash,sizeof(J->StateHash));
+        free(Buf);
+      }
+    }
+    TrashMSX();
+    TrashMachine();
+  }
+
+  SetAudioHandler(0);
+  return(0);
+}
+
+/** NextJob() ************************************************/
+/** Take the next job from worker N's own queue, or steal   **/
+/** one from the back of another worker's queue. Returns 0  **/
+/** when all queues are empty.                              **/
+/*************************************************************/
+static Job *NextJob(int N)
+{
+  Worker *W;
+  Job *J;
+  int I;
+
+  for(J=0,I=0;!J&&(I<WorkerCount);++I)
+  {
+    W = &Workers[(N+I)%WorkerCount];
+    pthread_mutex_lock(&W->Lock);
+    if(W->Head<W->Tail) J = I? &Jobs[--W->Tail]:&Jobs[W->Head++];
+    pthread_mutex_unlock(&W->Lock);
+  }
+
+  return(J);
+}
+
+/** WorkerThread() *******************************************/
+/** Run jobs until there are none left. Each job gets its   **/
+/** own thread: ResetMSX() does not reset every static (the **/
+/** refresh phase in LoopZ80(), say), so a reused thread    **/
+/** would make hashes depend on which jobs ran before. A    **/
+/** new thread starts from the THREADLOCAL initializers.    **/
+/*************************************************************/
+static void *WorkerThread(void *Arg)
+{
+  int N = (Worker *)Arg-Workers;
+  pthread_t T;
+  Job *J;
+
+  while((J=NextJob(N)))
+    if(!pthread_create(&T,0,RunJob,J)) pthread_join(T,0);
+
+  return(0);
+}
+
+/** ParseConfig() ********************************************/
+/** Apply a comma-separated CONFIG list to job J. Returns 1 **/
+/** on success, 0 on an unknown option.                     **/
+/*************************************************************/
+static int ParseConfig(Job *J,char *Config)
+{
+  char *P,*Next;
+  int N;
+
+  if(!strcmp(Config,"-")) return(1);
+
+  for(P=Config;P;P=Next)
+  {
+    if((Next=strchr(P,','))) *Next++='\0';
+
+    if(!strcmp(P,"msx1"))       J->Mode=(J->Mode&~MSX_MODEL)|MSX_MSX1;
+    else if(!strcmp(P,"msx2"))  J->Mode=(J->Mode&~MSX_MODEL)|MSX_MSX2;
+    else if(!strcmp(P,"msx2+")) J->Mode=(J->Mode&~MSX_MODEL)|MSX_MSX2P;
+    else if(!strcmp(P,"pal"))   J->Mode=(J->Mode&~MSX_VIDEO)|MSX_PAL;
+    else if(!strcmp(P,"ntsc"))  J->Mode=(J->Mode&~MSX_VIDEO)|MSX_NTSC;
+    else if(sscanf(P,"ram=%d",&N)==1)  J->RAMPages=N;
+    else if(sscanf(P,"vram=%d",&N)==1) J->VRAMPages=N;
+    else if(sscanf(P,"time=%d",&N)==1) J->Time=N;
+    else if(sscanf(P,"joy=%d",&N)==1)
+      J->Mode=(J->Mode&~MSX_SOCKET1)|((N&0x03)<<4);
+    else if(sscanf(P,"rom=%d",&N)==1)
+    {
+      if(N>=MAP_GUESS) J->Mode|=MSX_GUESSA;
+      else J->Mode=(J->Mode&~(MSX_GUESSA|MSX_MAPPERA))|((N&0x0F)<<8);
+    }
+    else return(0);
+  }
+
+  return(1);
+}
+
+/** LoadManifest() *******************************************/
+/** Load jobs from a manifest file. Returns the number of   **/
+/** jobs loaded or -1 on failure.                           **/
+/*************************************************************/
+static int LoadManifest(const char *FileName)
+{
+  char S[1024],ROM[1024],Config[256],Replay[1024];
+  int Line,Frames;
+  Job *J;
+  FILE *F;
+
+  if(!(F=fopen(FileName,"rb"))) { printf("Failed opening %s\n",FileName);return(-1); }
+
+  for(Line=1;fgets(S,sizeof(S),F);++Line)
+  {
+    /* Skip comments and empty lines */
+    if(sscanf(S,"%1023s",ROM)!=1 || (ROM[0]=='#')) continue;
+
+    if(sscanf(S,"%1023s %255s %1023s %d",ROM,Config,Replay,&Frames)!=4 || (Frames<1))
+    { printf("%s:%d: Expected ROM CONFIG REPLAY FRAMES\n",FileName,Line);fclose(F);return(-1); }
+
+    if(!(J=realloc(Jobs,(JobCount+1)*sizeof(Job)))) { fclose(F);return(-1); }
+    Jobs = J;
+    J    = &Jobs[JobCount++];
+    memset(J,0,sizeof(Job));
+
+    /* Start from fMSX defaults */
+    J->Mode      = Mode;
+    J->RAMPages  = RAMPages;
+    J->VRAMPages = VRAMPages;
+    J->Time      = FLEET_TIME;
+    J->Frames    = Frames;
+    J->Line      = Line;
+    J->ROM       = strcmp(ROM,"-")? strdup(ROM):0;
+    J->Replay    = strcmp(Replay,"-")? strdup(Replay):0;
+
+    if(!ParseConfig(J,Config))
+    { printf("%s:%d: Wrong config '%s'\n",FileName,Line,Config);fclose(F);return(-1); }
+  }
+
+  fclose(F);
+  return(JobCount);
+}
+
+/** main() ***************************************************/
+/** Parse command line, run all jobs, and print results in  **/
+/** manifest order, so that runs can be diffed.             **/
+/*************************************************************/
+int main(int argc,char *argv[])
+{
+  struct timeval T0,T1;
+  const char *Manifest;
+  int N,Failed;
+  Job *J;
+
+  Manifest    = 0;
+  WorkerCount = sysconf(_SC_NPROCESSORS_ONLN);
+
+  for(N=1;N<argc;++N)
+    if(!strcmp(argv[N],"-threads")&&(N+1<argc)) WorkerCount=atoi(argv[++N]);
+    else if(!strcmp(argv[N],"-sound")&&(N+1<argc)) UseSound=atoi(argv[++N]);
+    else if(!strcmp(argv[N],"-nosound")) UseSound=0;
+    else if((argv[N][0]=='-')||Manifest) break;
+    else Manifest=argv[N];
+
+  if((N<argc)||!Manifest)
+  {
+    printf("Usage: %s [-threads N] [-sound Hz] [-nosound] manifest\n",argv[0]);
+    return(2);
+  }
+
+  if(LoadManifest(Manifest)<0) return(2);
+  WorkerCount = WorkerCount<1? 1:WorkerCount>JobCount? JobCount:WorkerCount;
+  if(!JobCount) return(0);
+
+  /* Give each worker a contiguous share of the jobs */
+  if(!(Workers=calloc(WorkerCount,sizeof(Worker)))) return(2);
+  for(N=0;N<WorkerCount;++N)
+  {
+    pthread_mutex_init(&Workers[N].Lock,0);
+    Workers[N].Head = N*JobCount/WorkerCount;
+    Workers[N].Tail = (N+1)*JobCount/WorkerCount;
+  }
+
+  gettimeofday(&T0,0);
+  for(N=0;N<WorkerCount;++N)
+    if(pthread_create(&Workers[N].Thread,0,WorkerThread,&Workers[N]))
+    { printf("Failed starting worker #%d\n",N);return(2); }
+  for(N=0;N<WorkerCount;++N) pthread_join(Workers[N].Thread,0);
+  gettimeofday(&T1,0);
+
+  /* Report */
+  for(N=Failed=0,J=Jobs;N<JobCount;++N,++J)
+    if(J->FrameHash[0]&&J->AudioHash[0]&&J->StateHash[0])
+      printf("%d: %s %d frame=%s audio=%s state=%s\n",
+        J->Line,J->ROM? J->ROM:"-",J->Frames,J->FrameHash,J->AudioHash,J->StateHash);
+    else
+    {
+      printf("%d: %s %d FAILED\n",J->Line,J->ROM? J->ROM:"-",J->Frames);
+      ++Failed;
+    }
+
+  fprintf(stderr,"%d jobs, %d failed, %d threads, %.2f seconds\n",JobCount,Failed,WorkerCount,
+    (T1.tv_sec-T0.tv_sec)+(T1.tv_usec-T0.tv_usec)/1000000.0);
+
+  return(Failed? 1:0);
+}
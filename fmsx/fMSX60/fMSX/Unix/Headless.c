@@ -0,0 +1,270 @@
+/** fMSX: portable MSX emulator ******************************/
+/**                                                         **/
+/**                       Headless.c                        **/
+/**                                                         **/
+/** This file contains headless Unix drivers, used with the **/
+/** null EMULib back-end (LibNull.c). Frames are rendered   **/
+/** into memory and handed to FrameHandler, sound goes to   **/
+/** the SetAudioHandler() handler, input comes only from a  **/
+/** replay. All driver state is per-thread, so each thread  **/
+/** can run its own emulated MSX. SIGUSR1 saves the next    **/
+/** frame to a new fMSXNNNN.ppm file.                       **/
+/**                                                         **/
+/** Copyright (C) Marat Fayzullin 1994-2021                 **/
+/**     You are not allowed to distribute this software     **/
+/**     commercially. Please, notify me, if you make any    **/
+/**     changes to this file.                               **/
+/*************************************************************/
+#include "MSX.h"
+#include "EMULib.h"
+#include "Sound.h"
+#include "Record.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <signal.h>
+
+#define WIDTH       272                   /* Buffer width    */
+#define HEIGHT      228                   /* Buffer height   */
+
+int UseEffects  = 0;       /* No visual effects              */
+int UseZoom     = 1;       /* No zoom                        */
+int UseSound    = 22050;   /* Audio sampling frequency (Hz)  */
+int SyncFreq    = 0;       /* No sync, run as fast as we can */
+int MaxFrames   = 0;       /* Exit after so many frames or 0 */
+const char *SnapName = 0;  /* Save the last frame here or 0  */
+
+const char *Title     = "fMSX 6.0";       /* Program version */
+const char *Disks[2][MAXDISKS+1];         /* Disk names      */
+
+THREADLOCAL const char *ReplayName = 0;   /* .RPL to play    */
+THREADLOCAL void (*FrameHandler)(Image *Img) = 0;
+
+THREADLOCAL Image NormScreen;      /* Main screen image      */
+THREADLOCAL Image WideScreen;      /* Wide screen image      */
+static THREADLOCAL pixel *WBuf;    /* From Wide.h            */
+static THREADLOCAL pixel *XBuf;    /* From Common.h          */
+static THREADLOCAL unsigned int XPal[80];
+static THREADLOCAL unsigned int BPal[256];
+static THREADLOCAL unsigned int XPal0;
+static THREADLOCAL int OldScrMode; /* fMSX "ScrMode" storage */
+static THREADLOCAL unsigned int SndTime; /* uSec*Hz left over*/
+static THREADLOCAL int Frames;     /* Frames emulated so far */
+static volatile sig_atomic_t SnapNow; /* SIGUSR1 received    */
+
+void PutImage(void);
+int SaveFrame(const char *FileName);
+
+/** SnapHandler() ********************************************/
+/** SIGUSR1 handler: save the next frame that comes along.  **/
+/*************************************************************/
+static void SnapHandler(int Signal) { SnapNow=1; }
+
+/** CommonMux.h **********************************************/
+/** Display drivers for all possible screen depths.         **/
+/*************************************************************/
+#include "CommonMux.h"
+
+/** InitMachine() ********************************************/
+/** Allocate resources needed by machine-dependent code.    **/
+/*************************************************************/
+int InitMachine(void)
+{
+  int J;
+
+  /* Initialize variables */
+  OldScrMode      = 0;
+  SndTime         = 0;
+  Frames          = 0;
+  NormScreen.Data = 0;
+  WideScreen.Data = 0;
+
+  /* Create main image buffer */
+  if(!NewImage(&NormScreen,WIDTH,HEIGHT)) return(0);
+  XBuf = NormScreen.Data;
+
+#ifndef NARROW
+  /* Create wide image buffer */
+  if(!NewImage(&WideScreen,WIDTH*2,HEIGHT)) { FreeImage(&NormScreen);return(0); }
+  WBuf = WideScreen.Data;
+#endif
+
+  /* Set correct screen drivers */
+  if(!SetScreenDepth(NormScreen.D))
+  {
+#ifndef NARROW
+    FreeImage(&WideScreen);
+#endif
+    FreeImage(&NormScreen);
+    return(0);
+  }
+
+  /* Initialize video to main image */
+  SetVideo(&NormScreen,0,0,WIDTH,HEIGHT);
+
+  /* Set all colors to black */
+  for(J=0;J<80;J++) SetColor(J,0,0,0);
+
+  /* Create SCREEN8 palette (GGGRRRBB) */
+  for(J=0;J<256;J++)
+    BPal[J]=PIXEL(((J>>2)&0x07)*255/7,((J>>5)&0x07)*255/7,(J&0x03)*255/3);
+
+  /* Initialize sound, no sync timer: run as fast as we can */
+  InitSound(UseSound,0);
+  SetChannels(64,(1<<MAXCHANNELS)-1);
+
+  /* Turbo mode uses the timer to draw at a real-time rate */
+  if(Turbo) SetSyncTimer(SyncFreq>0? SyncFreq:60);
+
+  /* Initialize replay, there is nothing to record */
+  RPLInit(SaveState,LoadState,MAX_STASIZE);
+
+  /* SIGUSR1 saves the next frame */
+  signal(SIGUSR1,SnapHandler);
+
+  /* Done */
+  return(1);
+}
+
+/** TrashMachine() *******************************************/
+/** Deallocate all resources taken by InitMachine().        **/
+/*************************************************************/
+void TrashMachine(void)
+{
+  /* Save the last frame, if requested */
+  if(SnapName&&Frames&&!SaveFrame(SnapName))
+  { if(Verbose) printf("Failed writing %s\n",SnapName); }
+
+  RPLTrash();
+#ifndef NARROW
+  FreeImage(&WideScreen);
+#endif
+  FreeImage(&NormScreen);
+  TrashSound();
+}
+
+/** PutImage() ***********************************************/
+/** Hand a finished frame over to FrameHandler and save it  **/
+/** on SIGUSR1.                                             **/
+/*************************************************************/
+void PutImage(void)
+{
+  const char *P;
+
+#ifndef NARROW
+  /* If screen mode changed... */
+  if(ScrMode!=OldScrMode)
+  {
+    /* Switch to the new screen mode */
+    OldScrMode=ScrMode;
+    /* Depending on the new screen width... */
+    if((ScrMode==6)||((ScrMode==7)&&!ModeYJK)||(ScrMode==MAXSCREEN+1))
+      SetVideo(&WideScreen,0,0,WIDTH*2,HEIGHT);
+    else
+      SetVideo(&NormScreen,0,0,WIDTH,HEIGHT);
+  }
+#endif
+
+  /* Pass the frame on */
+  if(FrameHandler) FrameHandler(VideoImg);
+  ShowVideo();
+
+  /* Save the frame if SIGUSR1 asked for it */
+  if(SnapNow)
+  {
+    SnapNow=0;
+    P=NewFile("fMSX.ppm");
+    if(!SaveFrame(P)&&Verbose) printf("Failed writing %s\n",P);
+  }
+}
+
+/** SaveFrame() **********************************************/
+/** Save the current frame to a binary .PPM file. Returns 1 **/
+/** on success, 0 on failure.                               **/
+/*************************************************************/
+int SaveFrame(const char *FileName)
+{
+  const pixel *P;
+  unsigned int C;
+  FILE *F;
+  int X,Y;
+
+  if(!VideoImg||!VideoImg->Data||!FileName||!(F=fopen(FileName,"wb"))) return(0);
+
+  fprintf(F,"P6\n%d %d\n255\n",VideoW,VideoH);
+  for(Y=0;Y<VideoH;++Y)
+    for(X=0,P=VideoImg->Data+(VideoY+Y)*VideoImg->L+VideoX;X<VideoW;++X,++P)
+    {
+      C=*P;
+      fputc((C&RMASK)*255/RMASK,F);
+      fputc((C&GMASK)*255/GMASK,F);
+      fputc((C&BMASK)*255/BMASK,F);
+    }
+
+  X=!ferror(F);
+  return(!fclose(F)&&X);
+}
+
+/** PlayAllSound() *******************************************/
+/** Render and play given number of microseconds of sound.  **/
+/** Nothing throttles us here, so render exactly that much, **/
+/** carrying the fraction of a sample over to the next call.**/
+/*************************************************************/
+void PlayAllSound(int uSec)
+{
+  SndTime += uSec*UseSound;
+  RenderAndPlayAudio(SndTime/1000000);
+  SndTime %= 1000000;
+}
+
+/** Joystick() ***********************************************/
+/** Query positions of two joystick connected to ports 0/1. **/
+/** Returns 0.0.B2.A2.R2.L2.D2.U2.0.0.B1.A1.R1.L1.D1.U1.    **/
+/** The only input is ReplayName, started on the first call **/
+/** and cleared once it is playing.                         **/
+/*************************************************************/
+unsigned int Joystick(void)
+{
+  unsigned int I;
+
+  /* Start replay now that the machine is running */
+  if(ReplayName)
+  {
+    if(LoadRPL(ReplayName)&&RPLPlay(RPL_ON)) ReplayName=0;
+    else
+    {
+      if(Verbose) printf("Failed playing %s\n",ReplayName);
+      ExitNow=1;
+      return(0);
+    }
+  }
+
+  /* Called once per frame: stop after MaxFrames, drawn or not */
+  if((++Frames>=MaxFrames)&&MaxFrames) ExitNow=1;
+
+  /* .RPL files only carry joystick states */
+  I = RPLPlay(RPL_NEXT);
+  return(I!=RPL_ENDED? I:0);
+}
+
+/** Keyboard() ***********************************************/
+/** Modify keyboard matrix.                                 **/
+/*************************************************************/
+void Keyboard(void)
+{
+  /* No keyboard */
+}
+
+/** Mouse() **************************************************/
+/** Query coordinates of a mouse connected to port N.       **/
+/** Returns F2.F1.Y.Y.Y.Y.Y.Y.Y.Y.X.X.X.X.X.X.X.X.          **/
+/*************************************************************/
+unsigned int Mouse(byte N) { return(0); }
+
+/** SetColor() ***********************************************/
+/** Set color N to (R,G,B).                                 **/
+/*************************************************************/
+void SetColor(byte N,byte R,byte G,byte B)
+{
+  if(N) XPal[N]=PIXEL(R,G,B); else XPal0=PIXEL(R,G,B);
+}
@@ -34,7 +34,7 @@ int InMenu;                /* 1: In MenuMSX(), ignore keys   */
 int UseZoom     = 2;       /* Zoom factor (1=no zoom)        */
 int UseSound    = 22050;   /* Audio sampling frequency (Hz)  */
 int SyncFreq    = 60;      /* Sync frequency (0=sync off)    */
-int FastForward;           /* Fast-forwarded UPeriod backup  */
+int FastForward;           /* 1: Turbo mode while F9 is held */
 int SndSwitch;             /* Mask of enabled sound channels */
 int SndVolume;             /* Master volume for audio        */
 int OldScrMode;            /* fMSX "ScrMode" variable storage*/
@@ -78,8 +78,8 @@ int InitMachine(void)
   /* Initialize system resources */
   InitUnix(Title,UseZoom*WIDTH,UseZoom*HEIGHT);
 
-  /* Set visual effects */
-  SetEffects(UseEffects);
+  /* Set visual effects, turbo mode never waits for the timer */
+  SetEffects(Turbo? UseEffects&~EFF_SYNC:UseEffects);
 
   /* Create main image buffer */
   if(!NewImage(&NormScreen,WIDTH,HEIGHT)) { TrashUnix();return(0); }
@@ -163,7 +163,7 @@ void PutImage(void)
 #endif
 
   /* Show replay icon */
-  if(RPLPlay(RPL_QUERY)) RPLShow(VideoImg,VideoX+10,VideoY+10);
+  if(RPLPlay(RPL_QUERY)) { RPLShow(VideoImg,VideoX+10,VideoY+10);RedrawAll(); }
 
   /* Show display buffer */
   ShowVideo();
@@ -296,7 +296,7 @@ void HandleKeys(unsigned int Key)
         if(FastForward)
         {
           SetEffects(UseEffects);
-          UPeriod=FastForward;
+          Turbo=0;
           FastForward=0;
         }
         break;
@@ -360,11 +360,11 @@ void HandleKeys(unsigned int Key)
         }
         break;
       case XK_F9:
-        if(!FastForward) 
+        if(!FastForward&&!Turbo)
         {
           SetEffects(UseEffects&~EFF_SYNC);
-          FastForward=UPeriod;
-          UPeriod=10;  
+          Turbo=1;
+          FastForward=1;
         }
         break;
       case XK_F10:
@@ -379,6 +379,7 @@ void HandleKeys(unsigned int Key)
           XKBD_RES(KBD_GRAPH);
           InMenu=1;
           if(NETPlay(NET_TOGGLE)) ResetMSX(Mode,RAMPages,VRAMPages);
+          RedrawAll();
           InMenu=0;
           break;
         }
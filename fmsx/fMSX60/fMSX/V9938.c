@@ -55,6 +55,8 @@
 #define CM_YMMM  0xE
 #define CM_HMMC  0xF
 
+#define VDP_LINE_OPS 12500 /* Command time per scanline   */
+
 /*************************************************************/
 /* Many VDP commands are executed in some kind of loop but   */
 /* essentially, there are only a few basic loop structures   */
@@ -102,7 +104,7 @@
 /*************************************************************/
 /** Structures and stuff                                    **/
 /*************************************************************/
-static struct {
+static THREADLOCAL struct {
   int SX,SY;
   int DX,DY;
   int TX,TY;
@@ -143,6 +145,17 @@ static void VDPpset(register byte SM,
                     register int DX, register int DY,
                     register byte CL, register byte OP);
 
+static int  VDPwidth(register int TX, register int Dot, register byte CL);
+static int  VDPspan(register int X, register int TX, register int MX);
+static int  VDPsteps(register int cnt, register int delta);
+static void VDPfillbytes(register byte *P, register int N,
+                         register byte CL, register byte OP);
+static void VDPfill(register byte SM,
+                    register int X, register int Y, register int N,
+                    register byte CL, register byte OP);
+static void VDPcopy(register byte *D, register byte *S,
+                    register int N, register int TX);
+
 static int GetVdpTimingValue(register int *);
 
 static void SrchEngine(void);
@@ -164,8 +177,11 @@ void ReportVdpCommand(register byte Op);
 static byte Mask[4] = { 0x0F,0x03,0x0F,0xFF };
 static int  PPB[4]  = { 2,4,2,1 };
 static int  PPL[4]  = { 256,512,512,256 };
-static int  VdpOpsCnt=1;
-static void (*VdpEngine)(void)=0;
+static THREADLOCAL int VdpOpsCnt=1;
+static THREADLOCAL int VdpCycles=0;    /* Op fraction, in cycles */
+static THREADLOCAL void (*VdpEngine)(void)=0;
+static THREADLOCAL int CmdLo=0;        /* VRAM the last command  */
+static THREADLOCAL int CmdN=0x20000;   /* may write, from CmdLo  */
 
                       /*  SprOn SprOn SprOf SprOf */
                       /*  ScrOf ScrOn ScrOf ScrOn */
@@ -331,6 +347,107 @@ INLINE void VDPpset(byte SM, int DX, int DY, byte CL, byte OP)
   }
 }
 
+/** VDPwidth() ***********************************************/
+/** Get screen width in pixels for the row span code, or 0  **/
+/** if screen mode has changed since the command started,   **/
+/** so that X steps of TX no longer go byte by byte (or dot **/
+/** by dot with color CL if Dot=1).                         **/
+/*************************************************************/
+INLINE int VDPwidth(int TX, int Dot, byte CL)
+{
+  register int PX;
+
+  if ((ScrMode<5) || (ScrMode>8))
+    return(0);
+  if (Dot && (CL&~Mask[ScrMode-5]))
+    return(0);
+  PX = Dot? 1:PPB[ScrMode-5];
+  return((TX==PX)||(TX==-PX)? PPL[ScrMode-5]:0);
+}
+
+/** VDPspan() ************************************************/
+/** Count steps of TX from X until X leaves 0..MX-1. X must **/
+/** be in 0..MX-1.                                          **/
+/*************************************************************/
+INLINE int VDPspan(int X, int TX, int MX)
+{
+  return(TX>0? (MX-X+TX-1)/TX:X/(-TX)+1);
+}
+
+/** VDPsteps() ***********************************************/
+/** Count how many steps costing delta the pre_loop macro   **/
+/** would run with cnt time units left.                     **/
+/*************************************************************/
+INLINE int VDPsteps(int cnt, int delta)
+{
+  return(cnt>0? (cnt-1)/delta:0);
+}
+
+/** VDPfillbytes() *******************************************/
+/** Apply logical operation OP with color byte CL to N      **/
+/** bytes at P. CL must have the color in every pixel.      **/
+/*************************************************************/
+static void VDPfillbytes(byte *P, int N, byte CL, byte OP)
+{
+  /* Transparent operations skip color 0 */
+  if ((OP&8) && !CL)
+    return;
+
+  switch (OP&7)
+  {
+    case 0: memset(P, CL, N); break;
+    case 1: while (N-->0) *P++ &= CL; break;
+    case 2: while (N-->0) *P++ |= CL; break;
+    case 3: while (N-->0) *P++ ^= CL; break;
+    case 4: memset(P, ~CL, N); break;
+  }
+}
+
+/** VDPfill() ************************************************/
+/** Apply logical operation OP with color CL to N pixels    **/
+/** starting at (X,Y) and going right. All pixels must be   **/
+/** on the same line, and CL must fit into a pixel.         **/
+/*************************************************************/
+static void VDPfill(byte SM, int X, int Y, int N, byte CL, byte OP)
+{
+  register int J;
+
+  /* Pixels before the first whole byte */
+  for (J=PPB[SM]-1; (N>0) && (X&J); --N, ++X)
+    VDP_PSET(SM, X, Y, CL, OP);
+
+  /* Whole bytes, color repeated for every pixel in a byte */
+  J = N/PPB[SM];
+  if (J>0) {
+    VDPfillbytes(VDP_VRMP(SM, X, Y), J,
+                 SM==3? CL:SM==1? CL*0x55:CL*0x11, OP);
+    X += J*PPB[SM];
+    N -= J*PPB[SM];
+  }
+
+  /* Pixels after the last whole byte */
+  for (; N>0; --N, ++X)
+    VDP_PSET(SM, X, Y, CL, OP);
+}
+
+/** VDPcopy() ************************************************/
+/** Copy N bytes from S to D, going right if TX>0, left     **/
+/** otherwise. D and S point to the first byte copied.      **/
+/** Overlapping bytes are copied one by one, like the VDP   **/
+/** does it.                                                **/
+/*************************************************************/
+static void VDPcopy(byte *D, byte *S, int N, int TX)
+{
+  if (TX>0) {
+    if ((D<=S) || (D>=S+N)) memmove(D, S, N);
+    else while (N-->0) *D++ = *S++;
+  }
+  else {
+    if ((D>=S) || (D<=S-N)) memmove(D-N+1, S-N+1, N);
+    else while (N-->0) *D-- = *S--;
+  }
+}
+
 /** GetVdpTimingValue() **************************************/
 /** Get timing value for a certain VDP command              **/
 /*************************************************************/
@@ -389,6 +506,8 @@ void SrchEngine(void)
     VDPStatus[9]=(SX>>8)|0xFE;
   }
   else {
+    /* Out of time, keep time for the step not taken */
+    VdpOpsCnt+=delta;
     MMC.SX=SX;
   }
 }
@@ -468,6 +587,8 @@ void LineEngine(void)
     VDP[39]=(DY>>8) & 0x03;
   }
   else {
+    /* Out of time, keep time for the step not taken */
+    VdpOpsCnt+=delta;
     MMC.DX=DX;
     MMC.DY=DY;
     MMC.ASX=ASX;
@@ -492,20 +613,43 @@ void LmmvEngine(void)
   register byte LO=MMC.LO;
   register int cnt;
   register int delta;
+  register int MX,N,J;
 
   delta = GetVdpTimingValue(lmmv_timing);
   cnt = VdpOpsCnt;
-
-  switch (ScrMode) {
-    case 5: pre_loop VDPpset5(ADX, DY, CL, LO); post__x_y(256)
-            break;
-    case 6: pre_loop VDPpset6(ADX, DY, CL, LO); post__x_y(512)
-            break;
-    case 7: pre_loop VDPpset7(ADX, DY, CL, LO); post__x_y(512)
-            break;
-    case 8: pre_loop VDPpset8(ADX, DY, CL, LO); post__x_y(256)
-            break;
-  }
+  MX = VDPwidth(TX, 1, CL);
+
+  if ((unsigned)DX<(unsigned)MX && (unsigned)ADX<(unsigned)MX)
+    /* Fill whole rows, or as much of a row as time allows */
+    for (;;) {
+      N = VDPspan(ADX, TX, MX);
+      if (ANX>0 && ANX<N) N=ANX;
+      J = VDPsteps(cnt, delta);
+      if (J<N) {
+        VDPfill(ScrMode-5, TX>0? ADX:ADX-J+1, DY, J, CL, LO);
+        ADX+=J*TX;
+        ANX-=J;
+        cnt-=(J+1)*delta;
+        break;
+      }
+      VDPfill(ScrMode-5, TX>0? ADX:ADX-N+1, DY, N, CL, LO);
+      cnt-=N*delta;
+      if (!(--NY&1023) || (DY+=TY)==-1)
+        break;
+      ADX=DX;
+      ANX=NX;
+    }
+  else
+    switch (ScrMode) {
+      case 5: pre_loop VDPpset5(ADX, DY, CL, LO); post__x_y(256)
+              break;
+      case 6: pre_loop VDPpset6(ADX, DY, CL, LO); post__x_y(512)
+              break;
+      case 7: pre_loop VDPpset7(ADX, DY, CL, LO); post__x_y(512)
+              break;
+      case 8: pre_loop VDPpset8(ADX, DY, CL, LO); post__x_y(256)
+              break;
+    }
 
   if ((VdpOpsCnt=cnt)>0) {
     /* Command execution done */
@@ -519,6 +663,8 @@ void LmmvEngine(void)
     VDP[43]=(NY>>8) & 0x03;
   }
   else {
+    /* Out of time, keep time for the step not taken */
+    VdpOpsCnt+=delta;
     MMC.DY=DY;
     MMC.NY=NY;
     MMC.ANX=ANX;
@@ -579,6 +725,8 @@ void LmmmEngine(void)
     VDP[39]=(DY>>8) & 0x03;
   }
   else {
+    /* Out of time, keep time for the step not taken */
+    VdpOpsCnt+=delta;
     MMC.SY=SY;
     MMC.DY=DY;
     MMC.NY=NY;
@@ -666,20 +814,44 @@ void HmmvEngine(void)
   register byte CL=MMC.CL;
   register int cnt;
   register int delta;
+  register int MX,N,J;
  
   delta = GetVdpTimingValue(hmmv_timing);
   cnt = VdpOpsCnt;
-
-  switch (ScrMode) {
-    case 5: pre_loop *VDP_VRMP5(ADX, DY) = CL; post__x_y(256)
-            break;
-    case 6: pre_loop *VDP_VRMP6(ADX, DY) = CL; post__x_y(512)
-            break;
-    case 7: pre_loop *VDP_VRMP7(ADX, DY) = CL; post__x_y(512)
-            break;
-    case 8: pre_loop *VDP_VRMP8(ADX, DY) = CL; post__x_y(256)
-            break;
-  }
+  MX = VDPwidth(TX, 0, 0);
+
+  if ((unsigned)DX<(unsigned)MX && (unsigned)ADX<(unsigned)MX)
+    /* Fill whole rows, or as much of a row as time allows */
+    for (;;) {
+      N = VDPspan(ADX, TX, MX);
+      if (ANX>0 && ANX<N) N=ANX;
+      J = VDPsteps(cnt, delta);
+      if (J<N) {
+        if (J>0)
+          memset(VDP_VRMP(ScrMode-5, ADX, DY)-(TX>0? 0:J-1), CL, J);
+        ADX+=J*TX;
+        ANX-=J;
+        cnt-=(J+1)*delta;
+        break;
+      }
+      memset(VDP_VRMP(ScrMode-5, ADX, DY)-(TX>0? 0:N-1), CL, N);
+      cnt-=N*delta;
+      if (!(--NY&1023) || (DY+=TY)==-1)
+        break;
+      ADX=DX;
+      ANX=NX;
+    }
+  else
+    switch (ScrMode) {
+      case 5: pre_loop *VDP_VRMP5(ADX, DY) = CL; post__x_y(256)
+              break;
+      case 6: pre_loop *VDP_VRMP6(ADX, DY) = CL; post__x_y(512)
+              break;
+      case 7: pre_loop *VDP_VRMP7(ADX, DY) = CL; post__x_y(512)
+              break;
+      case 8: pre_loop *VDP_VRMP8(ADX, DY) = CL; post__x_y(256)
+              break;
+    }
 
   if ((VdpOpsCnt=cnt)>0) {
     /* Command execution done */
@@ -693,6 +865,8 @@ void HmmvEngine(void)
     VDP[39]=(DY>>8) & 0x03;
   }
   else {
+    /* Out of time, keep time for the step not taken */
+    VdpOpsCnt+=delta;
     MMC.DY=DY;
     MMC.NY=NY;
     MMC.ANX=ANX;
@@ -718,20 +892,51 @@ void HmmmEngine(void)
   register int ANX=MMC.ANX;
   register int cnt;
   register int delta;
+  register int MX,N,J;
  
   delta = GetVdpTimingValue(hmmm_timing);
   cnt = VdpOpsCnt;
-
-  switch (ScrMode) {
-    case 5: pre_loop *VDP_VRMP5(ADX, DY) = *VDP_VRMP5(ASX, SY); post_xxyy(256)
-            break;
-    case 6: pre_loop *VDP_VRMP6(ADX, DY) = *VDP_VRMP6(ASX, SY); post_xxyy(512)
-            break;
-    case 7: pre_loop *VDP_VRMP7(ADX, DY) = *VDP_VRMP7(ASX, SY); post_xxyy(512)
-            break;
-    case 8: pre_loop *VDP_VRMP8(ADX, DY) = *VDP_VRMP8(ASX, SY); post_xxyy(256)
-            break;
-  }
+  MX = VDPwidth(TX, 0, 0);
+
+  if ((unsigned)SX<(unsigned)MX && (unsigned)ASX<(unsigned)MX &&
+      (unsigned)DX<(unsigned)MX && (unsigned)ADX<(unsigned)MX)
+    /* Copy whole rows, or as much of a row as time allows */
+    for (;;) {
+      N = VDPspan(ASX, TX, MX);
+      J = VDPspan(ADX, TX, MX);
+      if (J<N) N=J;
+      if (ANX>0 && ANX<N) N=ANX;
+      J = VDPsteps(cnt, delta);
+      if (J<N) {
+        if (J>0)
+          VDPcopy(VDP_VRMP(ScrMode-5, ADX, DY),
+                  VDP_VRMP(ScrMode-5, ASX, SY), J, TX);
+        ASX+=J*TX;
+        ADX+=J*TX;
+        ANX-=J;
+        cnt-=(J+1)*delta;
+        break;
+      }
+      VDPcopy(VDP_VRMP(ScrMode-5, ADX, DY),
+              VDP_VRMP(ScrMode-5, ASX, SY), N, TX);
+      cnt-=N*delta;
+      if (!(--NY&1023) || (SY+=TY)==-1 || (DY+=TY)==-1)
+        break;
+      ASX=SX;
+      ADX=DX;
+      ANX=NX;
+    }
+  else
+    switch (ScrMode) {
+      case 5: pre_loop *VDP_VRMP5(ADX, DY) = *VDP_VRMP5(ASX, SY); post_xxyy(256)
+              break;
+      case 6: pre_loop *VDP_VRMP6(ADX, DY) = *VDP_VRMP6(ASX, SY); post_xxyy(512)
+              break;
+      case 7: pre_loop *VDP_VRMP7(ADX, DY) = *VDP_VRMP7(ASX, SY); post_xxyy(512)
+              break;
+      case 8: pre_loop *VDP_VRMP8(ADX, DY) = *VDP_VRMP8(ASX, SY); post_xxyy(256)
+              break;
+    }
 
   if ((VdpOpsCnt=cnt)>0) {
     /* Command execution done */
@@ -752,6 +957,8 @@ void HmmmEngine(void)
     VDP[39]=(DY>>8) & 0x03;
   }
   else {
+    /* Out of time, keep time for the step not taken */
+    VdpOpsCnt+=delta;
     MMC.SY=SY;
     MMC.DY=DY;
     MMC.NY=NY;
@@ -775,20 +982,43 @@ void YmmmEngine(void)
   register int ADX=MMC.ADX;
   register int cnt;
   register int delta;
+  register int MX,N,J;
  
   delta = GetVdpTimingValue(ymmm_timing);
   cnt = VdpOpsCnt;
-
-  switch (ScrMode) {
-    case 5: pre_loop *VDP_VRMP5(ADX, DY) = *VDP_VRMP5(ADX, SY); post__xyy(256)
-            break;
-    case 6: pre_loop *VDP_VRMP6(ADX, DY) = *VDP_VRMP6(ADX, SY); post__xyy(512)
-            break;
-    case 7: pre_loop *VDP_VRMP7(ADX, DY) = *VDP_VRMP7(ADX, SY); post__xyy(512)
-            break;
-    case 8: pre_loop *VDP_VRMP8(ADX, DY) = *VDP_VRMP8(ADX, SY); post__xyy(256)
-            break;
-  }
+  MX = VDPwidth(TX, 0, 0);
+
+  if ((unsigned)DX<(unsigned)MX && (unsigned)ADX<(unsigned)MX)
+    /* Copy whole rows, or as much of a row as time allows */
+    for (;;) {
+      N = VDPspan(ADX, TX, MX);
+      J = VDPsteps(cnt, delta);
+      if (J<N) {
+        if (J>0)
+          VDPcopy(VDP_VRMP(ScrMode-5, ADX, DY),
+                  VDP_VRMP(ScrMode-5, ADX, SY), J, TX);
+        ADX+=J*TX;
+        cnt-=(J+1)*delta;
+        break;
+      }
+      VDPcopy(VDP_VRMP(ScrMode-5, ADX, DY),
+              VDP_VRMP(ScrMode-5, ADX, SY), N, TX);
+      cnt-=N*delta;
+      if (!(--NY&1023) || (SY+=TY)==-1 || (DY+=TY)==-1)
+        break;
+      ADX=DX;
+    }
+  else
+    switch (ScrMode) {
+      case 5: pre_loop *VDP_VRMP5(ADX, DY) = *VDP_VRMP5(ADX, SY); post__xyy(256)
+              break;
+      case 6: pre_loop *VDP_VRMP6(ADX, DY) = *VDP_VRMP6(ADX, SY); post__xyy(512)
+              break;
+      case 7: pre_loop *VDP_VRMP7(ADX, DY) = *VDP_VRMP7(ADX, SY); post__xyy(512)
+              break;
+      case 8: pre_loop *VDP_VRMP8(ADX, DY) = *VDP_VRMP8(ADX, SY); post__xyy(256)
+              break;
+    }
 
   if ((VdpOpsCnt=cnt)>0) {
     /* Command execution done */
@@ -809,6 +1039,8 @@ void YmmmEngine(void)
     VDP[39]=(DY>>8) & 0x03;
   }
   else {
+    /* Out of time, keep time for the step not taken */
+    VdpOpsCnt+=delta;
     MMC.SY=SY;
     MMC.DY=DY;
     MMC.NY=NY;
@@ -903,6 +1135,32 @@ void ReportVdpCommand(register byte Op)
         );
 }
 
+/** CmdRows() ************************************************/
+/** Note that the command may write N rows of VRAM from row **/
+/** DY, going in direction TY, for VDPTouches().            **/
+/*************************************************************/
+static void CmdRows(register int SM,register int DY,register int N,register int TY)
+{
+  /* SCREEN5/6 rows take 128 bytes, SCREEN7/8 rows take 256 */
+  SM=SM>1? 256:128;
+
+  if(N>=1024) { CmdLo=0;CmdN=0x20000; }
+  else
+  {
+    CmdLo=((TY<0? DY-N+1:DY)*SM)&0x1FFFF;
+    CmdN=N*SM<0x20000? N*SM:0x20000;
+  }
+}
+
+/** VDPTouches() *********************************************/
+/** Check if the last command may have written any VRAM in  **/
+/** N bytes from address A.                                 **/
+/*************************************************************/
+int VDPTouches(register int A,register int N)
+{
+  return(CmdN&&((((A-CmdLo)&0x1FFFF)<CmdN)||(((CmdLo-A)&0x1FFFF)<N)));
+}
+
 /** VDPDraw() ************************************************/
 /** Perform a given V9938 operation Op.                     **/
 /*************************************************************/
@@ -939,6 +1197,7 @@ byte VDPDraw(byte Op)
     case CM_PSET:
       VDPStatus[2]&=0xFE;
       VdpEngine=0;  
+      CmdRows(SM,VDP[38]+((int)VDP[39]<<8),1,1);
       VDP_PSET(SM, 
                VDP[36]+((int)VDP[37]<<8),
                VDP[38]+((int)VDP[39]<<8),
@@ -1017,6 +1276,13 @@ byte VDPDraw(byte Op)
   else
     MMC.ANX = MMC.NX;
 
+  /* Note rows of VRAM the command may write */
+  if((MMC.CM==CM_SRCH)||(MMC.CM==CM_LMCM)) CmdN=0;
+  else if(MMC.CM==CM_LINE)
+    CmdRows(SM,MMC.DY,(MMC.NX>MMC.NY? MMC.NX:MMC.NY)+1,MMC.TY);
+  else
+    CmdRows(SM,MMC.DY,MMC.NY? MMC.NY:1024,MMC.TY);
+
   /* Command execution started */
   VDPStatus[2]|=0x01;
 
@@ -1027,20 +1293,40 @@ byte VDPDraw(byte Op)
   return(1);
 }
 
+/** GiveOps() ************************************************/
+/** Add Ops to the time the active command has to run. Time **/
+/** an idle engine or a transfer waiting for the CPU cannot **/
+/** use is not kept, except for one scanline of the latter. **/
+/*************************************************************/
+static void GiveOps(register int Ops)
+{
+  VdpOpsCnt+=Ops;
+  if(!VdpEngine) { if(VdpOpsCnt>0) VdpOpsCnt=0; }
+  else if((VDPStatus[2]&0x80)&&(VdpOpsCnt>VDP_LINE_OPS))
+    if((VdpEngine==LmmcEngine)||(VdpEngine==HmmcEngine)||(VdpEngine==LmcmEngine))
+      VdpOpsCnt=VDP_LINE_OPS;
+}
+
+/** VDPSync() ************************************************/
+/** Give the active command the time of Cycles CPU cycles.  **/
+/** It does not run until LoopVDP() is called, so callers   **/
+/** can save up time while nobody looks at VRAM or status.  **/
+/*************************************************************/
+void VDPSync(register int Cycles)
+{
+  /* VDP_LINE_OPS per scanline, carry cycle fractions */
+  VdpCycles+=Cycles*VDP_LINE_OPS;
+  GiveOps(VdpCycles/CPU_HPERIOD);
+  VdpCycles%=CPU_HPERIOD;
+}
+
 /** LoopVDP() ************************************************/
-/** Run X steps of active VDP command                       **/
+/** Run the active command for the time given by VDPSync(). **/
+/** Running it in one go or in pieces has the same result.  **/
 /*************************************************************/
 void LoopVDP(void)
 {
-  if(VdpOpsCnt<=0)
-  {
-    VdpOpsCnt+=12500;
-    if(VdpEngine&&(VdpOpsCnt>0)) VdpEngine();
-  }
-  else
-  {
-    VdpOpsCnt=12500;
-    if(VdpEngine) VdpEngine();
-  }
+  if(VdpEngine&&(VdpOpsCnt>0)) VdpEngine();
+  GiveOps(0);
 }
 
@@ -30,8 +30,21 @@ byte VDPRead(void);
 /*************************************************************/
 byte VDPDraw(register byte Op);
 
+/** VDPTouches() *********************************************/
+/** Check if the last V9938 operation may have written any  **/
+/** VRAM in N bytes from address A.                         **/
+/*************************************************************/
+int VDPTouches(register int A,register int N);
+
+/** VDPSync() ************************************************/
+/** Give the active operation the time of Cycles CPU cycles **/
+/** to run at the next LoopVDP() call.                      **/
+/*************************************************************/
+void VDPSync(register int Cycles);
+
 /** LoopVDP() ************************************************/
-/** Perform a number of steps of the active operation       **/
+/** Perform all steps of the active operation that the time **/
+/** given by VDPSync() allows.                              **/
 /*************************************************************/
 void LoopVDP(void);
 
@@ -0,0 +1,162 @@
+/** fMSX: portable MSX emulator ******************************/
+/**                                                         **/
+/**                           YJK.h                         **/
+/**                                                         **/
+/** This file contains YJKIndex(), used by RefreshLine10()  **/
+/** and RefreshLine12() in Common.h to turn a line of YJK   **/
+/** data into BPal[] indices. It does not depend on pixel   **/
+/** size, so it is compiled only once. With GCC or Clang,   **/
+/** it converts 8 or 16 pixels at a time using portable     **/
+/** vector extensions, picking the 16 pixel variant on x86  **/
+/** CPUs supporting AVX2. #define NO_VECTORS to disable.    **/
+/**                                                         **/
+/** Copyright (C) Marat Fayzullin 1994-2021                 **/
+/**     You are not allowed to distribute this software     **/
+/**     commercially. Please, notify me, if you make any    **/
+/**     changes to this file.                               **/
+/*************************************************************/
+#ifndef YJK_H
+#define YJK_H
+
+#if !defined(NO_VECTORS) && (defined(__clang__) || (defined(__GNUC__) && (__GNUC__>=9)))
+#define YJK_VECTORS
+#if defined(__x86_64__) || defined(__i386__)
+#define YJK_AVX2
+#endif
+#endif
+
+/** YJKGroup() ***********************************************/
+/** Convert a group of 4 YJK pixels at T into BPal indices  **/
+/** at I. This is what YJKIndex() does for every group.     **/
+/*************************************************************/
+static void YJKGroup(register byte *I,register const byte *T)
+{
+  register int J,K,Y,R,G,B,N;
+
+  K=(T[0]&0x07)|((T[1]&0x07)<<3);
+  if(K&0x20) K-=64;
+  J=(T[2]&0x07)|((T[3]&0x07)<<3);
+  if(J&0x20) J-=64;
+
+  for(N=0;N<4;N++)
+  {
+    Y=T[N]>>3;
+    R=Y+J;
+    G=Y+K;
+    B=((5*Y-2*J-K)/4);
+
+    R=R<0? 0:R>31? 31:R;
+    G=G<0? 0:G>31? 31:G;
+    B=B<0? 0:B>31? 31:B;
+
+    I[N]=(R&0x1C)|((G&0x1C)<<3)|(B>>3);
+  }
+}
+
+#ifdef YJK_VECTORS
+/** YJK_SHUFFLE() ********************************************/
+/** Pick given lanes of vector V of type VS. Lanes 0,1 of  **/
+/** every group carry K, and lanes 2,3 carry J.             **/
+/*************************************************************/
+#ifdef __clang__
+#define YJK_SHUFFLE(VS,V,...) __builtin_shufflevector(V,V,__VA_ARGS__)
+#else
+#define YJK_SHUFFLE(VS,V,...) __builtin_shuffle(V,(VS){__VA_ARGS__})
+#endif
+
+#define YJK_K0_8  0,0,0,0,4,4,4,4
+#define YJK_K1_8  1,1,1,1,5,5,5,5
+#define YJK_J0_8  2,2,2,2,6,6,6,6
+#define YJK_J1_8  3,3,3,3,7,7,7,7
+#define YJK_K0_16 YJK_K0_8,8,8,8,8,12,12,12,12
+#define YJK_K1_16 YJK_K1_8,9,9,9,9,13,13,13,13
+#define YJK_J0_16 YJK_J0_8,10,10,10,10,14,14,14,14
+#define YJK_J1_16 YJK_J1_8,11,11,11,11,15,15,15,15
+
+/** YJK_CLAMP() **********************************************/
+/** Clamp every lane of X to 0..31, using M as a temporary. **/
+/*************************************************************/
+#define YJK_CLAMP(X,M) X&=~(X<0);M=X>31;X=(X&~M)|(M&31)
+
+/** YJK_CONVERT() ********************************************/
+/** Convert N bytes at T into N indices at I, in the same   **/
+/** way as YJKGroup() does, using N-byte vector type VB and **/
+/** N-short vector type VS. I and T must not use the names  **/
+/** declared inside.                                        **/
+/*************************************************************/
+#define YJK_CONVERT(I,T,N,VB,VS,K0,K1,J0,J1) \
+  { \
+    VB D; \
+    VS S,Y,L,J,K,R,G,B,M; \
+    memcpy(&D,T,N); \
+    S = __builtin_convertvector(D,VS); \
+    Y = S>>3; \
+    L = S&7; \
+    K = YJK_SHUFFLE(VS,L,K0)|(YJK_SHUFFLE(VS,L,K1)<<3); \
+    K = (K^32)-32; \
+    J = YJK_SHUFFLE(VS,L,J0)|(YJK_SHUFFLE(VS,L,J1)<<3); \
+    J = (J^32)-32; \
+    R = Y+J; \
+    G = Y+K; \
+    B = (5*Y-2*J-K)/4; \
+    YJK_CLAMP(R,M); \
+    YJK_CLAMP(G,M); \
+    YJK_CLAMP(B,M); \
+    D = __builtin_convertvector((R&0x1C)|((G&0x1C)<<3)|(B>>3),VB); \
+    memcpy(I,&D,N); \
+  }
+
+typedef unsigned char YJKByte8 __attribute__((vector_size(8)));
+typedef short YJKShort8 __attribute__((vector_size(16)));
+
+/** YJKIndex8() **********************************************/
+/** Convert N YJK bytes into indices, 8 bytes at a time.    **/
+/*************************************************************/
+static void YJKIndex8(byte *I,const byte *T,int N)
+{
+  int X;
+
+  for(X=0;X+8<=N;X+=8)
+    YJK_CONVERT(I+X,T+X,8,YJKByte8,YJKShort8,YJK_K0_8,YJK_K1_8,YJK_J0_8,YJK_J1_8);
+  for(;X<N;X+=4) YJKGroup(I+X,T+X);
+}
+
+#ifdef YJK_AVX2
+typedef unsigned char YJKByte16 __attribute__((vector_size(16)));
+typedef short YJKShort16 __attribute__((vector_size(32)));
+
+/** YJKIndex16() *********************************************/
+/** Convert N YJK bytes into indices, 16 bytes at a time.   **/
+/** Only call it when the CPU supports AVX2.                **/
+/*************************************************************/
+__attribute__((target("avx2")))
+static void YJKIndex16(byte *I,const byte *T,int N)
+{
+  int X;
+
+  for(X=0;X+16<=N;X+=16)
+    YJK_CONVERT(I+X,T+X,16,YJKByte16,YJKShort16,YJK_K0_16,YJK_K1_16,YJK_J0_16,YJK_J1_16);
+  for(;X<N;X+=4) YJKGroup(I+X,T+X);
+}
+#endif /* YJK_AVX2 */
+#endif /* YJK_VECTORS */
+
+/** YJKIndex() ***********************************************/
+/** Convert N YJK bytes at T into N BPal[] indices at I.    **/
+/** N must be a multiple of 4.                              **/
+/*************************************************************/
+static void YJKIndex(byte *I,const byte *T,int N)
+{
+#if defined(YJK_AVX2)
+  static THREADLOCAL int AVX2 = -1;
+  if(AVX2<0) AVX2=__builtin_cpu_supports("avx2")? 1:0;
+  if(AVX2) YJKIndex16(I,T,N); else YJKIndex8(I,T,N);
+#elif defined(YJK_VECTORS)
+  YJKIndex8(I,T,N);
+#else
+  int J;
+  for(J=0;J<N;J+=4) YJKGroup(I+J,T+J);
+#endif
+}
+
+#endif /* YJK_H */
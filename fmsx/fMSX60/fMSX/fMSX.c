@@ -13,6 +13,7 @@
 
 #include "MSX.h"
 #include "Help.h"
+#include "Perf.h"
 #include "EMULib.h"
 
 #include <stdio.h>
@@ -27,6 +28,8 @@ static const char *Options[]=
   "ram","vram","rom","auto","noauto","msx1","msx2","msx2+","joy",
   "home","simbdos","wd1793","sound","nosound","trap","sync","nosync",
   "scale","static","nostatic","vsync","480","200",
+  "frames","snap","turbo","fasttape","nofasttape",
+  "profile","stacks","perf","perflog",
   0
 };
 
@@ -39,6 +42,8 @@ extern int   FullScreen; /* Use 640x480 screen (#ifdef MSDOS)   */
 extern int   SyncFreq;   /* Sync scr updates (UNIX/MAEMO/MSDOS) */
 extern int   ARGC;       /* argc/argv from main (#ifdef UNIX)   */
 extern char **ARGV;
+extern int   MaxFrames;  /* Exit after frames (#ifdef HEADLESS) */
+extern const char *SnapName; /* Last frame file (HEADLESS)  */
 
 /** Zero-terminated arrays of disk names for each drive ******/
 extern const char *Disks[2][MAXDISKS+1];
@@ -256,6 +261,40 @@ int main(int argc,char *argv[])
         case 35: FullScreen=0;break;
 #endif /* MSDOS */
 
+        case 38: Turbo=1;break;
+        case 39: Mode|=MSX_FASTTAPE;break;
+        case 40: Mode&=~MSX_FASTTAPE;break;
+
+#if defined(UNIX) && defined(HEADLESS)
+        case 36: N++;
+                 if(N<argc) MaxFrames=atoi(argv[N]);
+                 else printf("%s: No frame count supplied\n",argv[0]);
+                 break;
+        case 37: N++;
+                 if(N<argc) SnapName=argv[N];
+                 else printf("%s: No file for the last frame\n",argv[0]);
+                 break;
+#endif /* UNIX && HEADLESS */
+
+#if defined(PROFILE)
+        case 41: N++;
+                 if(N<argc) PrfName=argv[N];
+                 else printf("%s: No file for the Z80 profile\n",argv[0]);
+                 break;
+        case 42: N++;
+                 if(N<argc) StkName=argv[N];
+                 else printf("%s: No file for the Z80 call stacks\n",argv[0]);
+                 break;
+#endif /* PROFILE */
+
+#if defined(HOSTPERF)
+        case 43: PerfOn=1;break;
+        case 44: N++;
+                 if(N<argc) PerfName=argv[N];
+                 else printf("%s: No file for host times\n",argv[0]);
+                 break;
+#endif /* HOSTPERF */
+
         default: printf("%s: Wrong option '%s'\n",argv[0],argv[N]);
       }
     }
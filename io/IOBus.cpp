@@ -0,0 +1,36 @@
+#include "IOBus.hpp"
+#include <stdexcept>
+
+IOBus::IOBus() {
+    ports_.fill({nullptr, &unmappedIn, &unmappedOut, nullptr, nullptr});
+}
+
+void IOBus::map(uint8_t first, uint8_t last, void* device, InHandler in, OutHandler out) {
+    if (first > last) {
+        throw std::invalid_argument("Invalid I/O port range");
+    }
+    for (unsigned port = first; port <= last; ++port) {
+        ports_[port] = {device, in ? in : &unmappedIn, out ? out : &unmappedOut, nullptr, nullptr};
+    }
+}
+
+void IOBus::mapBlock(uint8_t first, uint8_t last, InBlockHandler in, OutBlockHandler out) {
+    if (first > last) {
+        throw std::invalid_argument("Invalid I/O port range");
+    }
+    for (unsigned port = first; port <= last; ++port) {
+        ports_[port].inBlock = in;
+        ports_[port].outBlock = out;
+    }
+}
+
+void IOBus::unmap(uint8_t first, uint8_t last) {
+    map(first, last, nullptr, nullptr, nullptr);
+}
+
+uint8_t IOBus::unmappedIn(void*, uint8_t) {
+    return 0xFF;
+}
+
+void IOBus::unmappedOut(void*, uint8_t, uint8_t) {
+}
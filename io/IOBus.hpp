@@ -0,0 +1,109 @@
+#ifndef IO_BUS_HPP
+#define IO_BUS_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+// Z80 I/O port bus, the C++ side of fMSX's InZ80()/OutZ80(). Only the low
+// byte of the port address is decoded, as on the MSX. Every one of the 256
+// ports always holds a handler (unmapped ports read FFh and ignore writes),
+// so dispatch is one table index and one indirect call, with no search.
+//
+// Handlers are plain function pointers with a device context. Member
+// functions are adapted at compile time by the map<> template below.
+class IOBus {
+public:
+    static const size_t NUM_PORTS = 256;
+
+    using InHandler = uint8_t (*)(void* device, uint8_t port);
+    using OutHandler = void (*)(void* device, uint8_t port, uint8_t value);
+    using InBlockHandler = void (*)(void* device, uint8_t port, uint8_t* data, size_t count);
+    using OutBlockHandler = void (*)(void* device, uint8_t port, const uint8_t* data, size_t count);
+
+    IOBus();
+
+    // Register a device for ports first..last. A null handler leaves that
+    // direction unmapped.
+    void map(uint8_t first, uint8_t last, void* device, InHandler in, OutHandler out);
+    void unmap(uint8_t first, uint8_t last);
+
+    // Register member functions of a device, e.g.
+    //   bus.map<PSG, &PSG::readPort, &PSG::writePort>(0xA0, 0xA2, psg);
+    template<class Device, uint8_t (Device::*In)(uint8_t), void (Device::*Out)(uint8_t, uint8_t)>
+    void map(uint8_t first, uint8_t last, Device& device) {
+        map(first, last, &device, &callIn<Device, In>, &callOut<Device, Out>);
+    }
+
+    // Optional batched handlers for INIR/INDR/OTIR/OTDR, which then move a
+    // whole run of bytes through the port in one call. A device should only
+    // register them if its port writes never change the memory map. map()
+    // and unmap() clear them.
+    void mapBlock(uint8_t first, uint8_t last, InBlockHandler in, OutBlockHandler out);
+
+    template<class Device, void (Device::*In)(uint8_t, uint8_t*, size_t),
+             void (Device::*Out)(uint8_t, const uint8_t*, size_t)>
+    void mapBlock(uint8_t first, uint8_t last) {
+        mapBlock(first, last, &callInBlock<Device, In>, &callOutBlock<Device, Out>);
+    }
+
+    bool hasInBlock(uint8_t port) const { return ports_[port].inBlock != nullptr; }
+    bool hasOutBlock(uint8_t port) const { return ports_[port].outBlock != nullptr; }
+
+    uint8_t in(uint16_t port) const {
+        const Port& entry = ports_[port & 0xFF];
+        return entry.in(entry.device, static_cast<uint8_t>(port));
+    }
+
+    void out(uint16_t port, uint8_t value) const {
+        const Port& entry = ports_[port & 0xFF];
+        entry.out(entry.device, static_cast<uint8_t>(port), value);
+    }
+
+    // Only valid on ports with a block handler, see hasInBlock()/hasOutBlock()
+    void inBlock(uint8_t port, uint8_t* data, size_t count) const {
+        const Port& entry = ports_[port];
+        entry.inBlock(entry.device, port, data, count);
+    }
+
+    void outBlock(uint8_t port, const uint8_t* data, size_t count) const {
+        const Port& entry = ports_[port];
+        entry.outBlock(entry.device, port, data, count);
+    }
+
+private:
+    struct Port {
+        void* device;
+        InHandler in;
+        OutHandler out;
+        InBlockHandler inBlock;     // Null: no batched transfers
+        OutBlockHandler outBlock;
+    };
+
+    std::array<Port, NUM_PORTS> ports_;
+
+    static uint8_t unmappedIn(void* device, uint8_t port);
+    static void unmappedOut(void* device, uint8_t port, uint8_t value);
+
+    template<class Device, uint8_t (Device::*In)(uint8_t)>
+    static uint8_t callIn(void* device, uint8_t port) {
+        return (static_cast<Device*>(device)->*In)(port);
+    }
+
+    template<class Device, void (Device::*Out)(uint8_t, uint8_t)>
+    static void callOut(void* device, uint8_t port, uint8_t value) {
+        (static_cast<Device*>(device)->*Out)(port, value);
+    }
+
+    template<class Device, void (Device::*In)(uint8_t, uint8_t*, size_t)>
+    static void callInBlock(void* device, uint8_t port, uint8_t* data, size_t count) {
+        (static_cast<Device*>(device)->*In)(port, data, count);
+    }
+
+    template<class Device, void (Device::*Out)(uint8_t, const uint8_t*, size_t)>
+    static void callOutBlock(void* device, uint8_t port, const uint8_t* data, size_t count) {
+        (static_cast<Device*>(device)->*Out)(port, data, count);
+    }
+};
+
+#endif // IO_BUS_HPP
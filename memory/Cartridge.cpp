@@ -0,0 +1,224 @@
+#include "Cartridge.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+Cartridge::Cartridge(const std::vector<uint8_t>& rom, MapperType type)
+    : type_(type), romMask_(0), banks_{}, fmpacKey_(0), sramDirty_(false) {
+    if (rom.empty()) {
+        throw std::invalid_argument("Empty cartridge ROM");
+    }
+
+    // Round the ROM up to a power-of-two number of 8KB pages, as fMSX does,
+    // so that bank numbers can simply be masked
+    size_t pages = 1;
+    while (pages * PAGE_SIZE < rom.size()) {
+        pages <<= 1;
+    }
+    if (pages > 256) {
+        throw std::invalid_argument("Cartridge ROM larger than 2MB");
+    }
+    romMask_ = static_cast<uint8_t>(pages - 1);
+    rom_.assign(pages * PAGE_SIZE, 0xFF);
+    std::copy(rom.begin(), rom.end(), rom_.begin());
+
+    if (hasSRAM()) {
+        sram_.assign(SRAM_SIZE, 0xFF);
+    }
+    empty_.fill(0xFF);
+    reset();
+}
+
+bool Cartridge::hasSRAM() const {
+    return type_ == MapperType::ASCII8 || type_ == MapperType::ASCII16 ||
+           type_ == MapperType::GameMaster2 || type_ == MapperType::FMPAC;
+}
+
+void Cartridge::reset() {
+    fmpacKey_ = 0;
+    pages_.fill(empty_.data());
+    sramPages_.fill(nullptr);
+
+    if (type_ == MapperType::None) {
+        mapPlainROM();
+        return;
+    }
+
+    // MegaROMs start with pages 0:1:2:3 at 4000h-BFFFh, except generic 16kB
+    // carts with more than 32kB, which show 0:1:N-2:N-1
+    for (unsigned bank = 0; bank < 4; ++bank) {
+        selectROM(bank, bank & romMask_);
+    }
+    if (type_ == MapperType::Generic16 && romMask_ + 1 > 4) {
+        selectROM(2, romMask_ - 1);
+        selectROM(3, romMask_);
+    }
+}
+
+// ROMs without a mapper are mirrored over the slot like in fMSX's LoadCart():
+// 8/16kB four times, 24/32kB twice, 48/64kB fill the slot.
+void Cartridge::mapPlainROM() {
+    const unsigned count = romMask_ + 1u;
+    for (unsigned page = 0; page < 8; ++page) {
+        unsigned romPage;
+        if (count <= 2) romPage = page & romMask_;
+        else if (count == 4) romPage = (page & 1) | ((page >> 2) << 1);
+        else romPage = page;
+        pages_[page] = &rom_[romPage * PAGE_SIZE];
+    }
+}
+
+void Cartridge::selectROM(unsigned bank, uint8_t page) {
+    banks_[bank] = page;
+    pages_[bank + 2] = &rom_[page * PAGE_SIZE];
+    sramPages_[bank + 2] = nullptr;
+}
+
+void Cartridge::selectSRAM(unsigned bank, size_t offset) {
+    banks_[bank] = 0xFF;
+    pages_[bank + 2] = sramPages_[bank + 2] = &sram_[offset];
+}
+
+bool Cartridge::write(uint16_t address, uint8_t value) {
+    unsigned bank;
+
+    switch (type_) {
+        case MapperType::Generic8:
+            // Any write to 4000h-BFFFh selects the page it lands in
+            if (address < 0x4000 || address > 0xBFFF) return false;
+            bank = (address - 0x4000) >> 13;
+            value &= romMask_;
+            if (value == banks_[bank]) return false;
+            selectROM(bank, value);
+            return true;
+
+        case MapperType::Generic16:
+            if (address < 0x4000 || address > 0xBFFF) return false;
+            bank = (address & 0x8000) >> 14;
+            value = (value << 1) & romMask_;
+            if (value == banks_[bank]) return false;
+            selectROM(bank, value);
+            selectROM(bank + 1, value | 1);
+            return true;
+
+        case MapperType::Konami5:
+            // 5000h/7000h/9000h/B000h
+            if (address < 0x5000 || address > 0xB000 || (address & 0x1FFF) != 0x1000) return false;
+            bank = (address - 0x5000) >> 13;
+            value &= romMask_;
+            if (value == banks_[bank]) return false;
+            selectROM(bank, value);
+            return true;
+
+        case MapperType::Konami4:
+            // 6000h/8000h/A000h, the page at 4000h is fixed
+            if (address < 0x6000 || address > 0xA000 || (address & 0x1FFF)) return false;
+            bank = (address - 0x4000) >> 13;
+            value &= romMask_;
+            if (value == banks_[bank]) return false;
+            selectROM(bank, value);
+            return true;
+
+        case MapperType::ASCII8:
+            if (address >= 0x6000 && address < 0x8000) {
+                bank = (address & 0x1800) >> 11;
+                if (value & (romMask_ + 1)) {
+                    if (banks_[bank] == 0xFF) return false;
+                    selectSRAM(bank, 0);
+                    return true;
+                }
+                value &= romMask_;
+                if (value == banks_[bank]) return false;
+                selectROM(bank, value);
+                return true;
+            }
+            if (address >= 0x8000 && address < 0xC000 && banks_[((address >> 13) & 1) + 2] == 0xFF) {
+                sramPages_[address >> 13][address & (PAGE_SIZE - 1)] = value;
+                sramDirty_ = true;
+            }
+            return false;
+
+        case MapperType::ASCII16:
+            // Some games write garbage to 7xxxh, so only accept sensible
+            // page numbers unless the address is exactly 6000h/7000h
+            if (address >= 0x6000 && address < 0x8000 && (value <= romMask_ + 1 || !(address & 0x0FFF))) {
+                bank = (address & 0x1000) >> 11;
+                if (value & (romMask_ + 1)) {
+                    if (banks_[bank] == 0xFF) return false;
+                    selectSRAM(bank, 0);
+                    selectSRAM(bank + 1, 0x2000);
+                    return true;
+                }
+                value = (value << 1) & romMask_;
+                if (value == banks_[bank]) return false;
+                selectROM(bank, value);
+                selectROM(bank + 1, value | 1);
+                return true;
+            }
+            // 2kB of SRAM, mirrored all over the 16kB window
+            if (address >= 0x8000 && address < 0xC000 && banks_[2] == 0xFF) {
+                for (size_t offset = 0; offset < SRAM_SIZE; offset += 0x0800) {
+                    sram_[offset + (address & 0x07FF)] = value;
+                }
+                sramDirty_ = true;
+            }
+            return false;
+
+        case MapperType::GameMaster2:
+            if (address >= 0x6000 && address <= 0xA000 && !(address & 0x1FFF)) {
+                bank = (address - 0x4000) >> 13;
+                if (value & 0x10) {
+                    selectSRAM(bank, (value & 0x20) ? 0x2000 : 0);
+                    return true;
+                }
+                value &= romMask_;
+                if (value == banks_[bank]) return false;
+                selectROM(bank, value);
+                return true;
+            }
+            // 4kB SRAM pages, mirrored twice in B000h-BFFFh's 8kB page
+            if (address >= 0xB000 && address < 0xC000 && banks_[3] == 0xFF) {
+                sramPages_[5][(address & 0x0FFF) | 0x1000] = value;
+                sramPages_[5][address & 0x0FFF] = value;
+                sramDirty_ = true;
+            }
+            return false;
+
+        case MapperType::FMPAC:
+            switch (address) {
+                case 0x7FF7: {
+                    // ROM page select; SRAM stays at 4000h while the key is set
+                    value = (value << 1) & romMask_;
+                    banks_[0] = value;
+                    banks_[1] = value | 1;
+                    if (fmpacKey_ == FMPAC_MAGIC) return false;
+                    pages_[2] = &rom_[value * PAGE_SIZE];
+                    pages_[3] = pages_[2] + PAGE_SIZE;
+                    return true;
+                }
+                case 0x7FF6:
+                    // OPLL enable, not emulated
+                    return false;
+                case 0x5FFE:
+                case 0x5FFF: {
+                    // Write 4Dh to 5FFEh and 69h to 5FFFh to map SRAM in
+                    fmpacKey_ = (address & 1) ? ((fmpacKey_ & 0x00FF) | (value << 8))
+                                              : ((fmpacKey_ & 0xFF00) | value);
+                    const bool sram = fmpacKey_ == FMPAC_MAGIC;
+                    uint8_t* page = sram ? sram_.data() : &rom_[banks_[0] * PAGE_SIZE];
+                    pages_[2] = page;
+                    pages_[3] = page + PAGE_SIZE;
+                    sramPages_[2] = sram ? page : nullptr;
+                    return true;
+                }
+            }
+            if (address >= 0x4000 && address < 0x5FFE && fmpacKey_ == FMPAC_MAGIC) {
+                sram_[address - 0x4000] = value;
+                sramDirty_ = true;
+            }
+            return false;
+
+        case MapperType::None:
+            return false;
+    }
+    return false;
+}
@@ -0,0 +1,64 @@
+#ifndef CARTRIDGE_HPP
+#define CARTRIDGE_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// MegaROM mapper types, numbered as fMSX's MAP_* constants
+enum class MapperType : uint8_t {
+    Generic8,       // Generic switch, 8kB pages
+    Generic16,      // Generic switch, 16kB pages
+    Konami5,        // Konami 5000/7000/9000/B000h
+    Konami4,        // Konami 4000/6000/8000/A000h
+    ASCII8,         // ASCII 6000/6800/7000/7800h
+    ASCII16,        // ASCII 6000/7000h
+    GameMaster2,    // Konami GameMaster2 cartridge
+    FMPAC,          // Panasonic FMPAC cartridge
+    None            // Plain ROM without a mapper
+};
+
+// A ROM cartridge and its mapper, ported from fMSX's MapROM(). The cartridge
+// presents eight 8KB page pointers for its slot; a bank switch only rewrites
+// those pointers and never copies ROM data.
+class Cartridge {
+public:
+    static const size_t PAGE_SIZE = 8192;
+    static const size_t SRAM_SIZE = 16384;
+    static const uint16_t FMPAC_MAGIC = 0x694D;  // Key that maps FMPAC SRAM in
+
+    Cartridge(const std::vector<uint8_t>& rom, MapperType type);
+
+    MapperType getType() const { return type_; }
+    bool hasSRAM() const;
+    bool isSRAMDirty() const { return sramDirty_; }
+    std::vector<uint8_t>& getSRAM() { return sram_; }
+
+    // What the cartridge shows at each 8KB page of its slot
+    const uint8_t* getPage(unsigned page) const { return pages_[page]; }
+
+    // Handle a write to the cartridge's slot: bank switching, SRAM enable
+    // and SRAM writes. Returns true when any page pointer has changed.
+    bool write(uint16_t address, uint8_t value);
+
+    void reset();
+
+private:
+    MapperType type_;
+    std::vector<uint8_t> rom_;              // Padded to a power-of-two number of pages
+    std::vector<uint8_t> sram_;             // Battery-backed RAM, if the mapper has any
+    uint8_t romMask_;                       // Number of 8KB ROM pages - 1
+    std::array<uint8_t, 4> banks_;          // Page shown at 4000h/6000h/8000h/A000h, FFh = SRAM
+    uint16_t fmpacKey_;
+    bool sramDirty_;
+    std::array<const uint8_t*, 8> pages_;
+    std::array<uint8_t*, 8> sramPages_;     // SRAM behind each page, or null
+    std::array<uint8_t, PAGE_SIZE> empty_;  // Unmapped pages read as FFh
+
+    void mapPlainROM();
+    void selectROM(unsigned bank, uint8_t page);
+    void selectSRAM(unsigned bank, size_t offset);
+};
+
+#endif // CARTRIDGE_HPP
@@ -7,46 +7,101 @@ Memory::Memory() : activeBank_(0) {
     for (auto& bank : banks_) {
         bank.fill(0);
     }
+    for (size_t page = 0; page < NUM_PAGES; ++page) {
+        readPages_[page] = writePages_[page] = &memory_[page * PAGE_SIZE];
+    }
+    mapBankPages();
 }
 
-void Memory::writeByte(uint16_t address, uint8_t value) {
-    IOHandler handler;
+// The active bank covers 0x0000-0x3FFF, i.e. pages 0 and 1
+void Memory::mapBankPages() {
+    for (size_t page = 0; page < BANK_SIZE / PAGE_SIZE; ++page) {
+        readPages_[page] = writePages_[page] = &banks_[activeBank_][page * PAGE_SIZE];
+        invalidateCode(page);
+    }
+}
 
-    if (isIOAddress(address, handler)) {
-        handler.write(address, value);
-        return;
+void Memory::mapPage(uint8_t page, const uint8_t* read, uint8_t* write) {
+    if (page >= NUM_PAGES || !read) {
+        throw std::invalid_argument("Invalid page mapping");
     }
+    readPages_[page] = read;
+    writePages_[page] = write ? write : discard_.data();
+    invalidateCode(page);
+}
 
-    // For addresses within bank size, write to active bank
-    if (address < BANK_SIZE) {
-        if (activeBank_ >= NUM_BANKS) {
-            throw std::out_of_range("Invalid active bank.");
-        }
-        banks_[activeBank_][address] = value;
-    } else if (address < MEMORY_SIZE) {
-        memory_[address] = value;
-    } else {
-        throw std::out_of_range("Address out of bounds.");
+void Memory::setPageTrap(PageTrap* trap, uint8_t readPages, uint8_t writePages) {
+    trap_ = trap;
+    trapReadPages_ = trap ? readPages : 0;
+    trapWritePages_ = trap ? writePages : 0;
+    updateSlowPages();
+    // Which pages can be read directly may have changed under running code
+    ++codeEpoch_;
+}
+
+void Memory::updateSlowPages() {
+    readSlowPages_ = ioPages_ | trapReadPages_;
+    writeSlowPages_ = ioPages_ | trapWritePages_ | codePages_;
+}
+
+void Memory::watchCode(uint16_t address, uint16_t length) {
+    const unsigned page = address >> 13;
+    // Read-only pages never change under the cache; trapped ones might (SRAM)
+    if (writePages_[page] != readPages_[page] && !(trapWritePages_ & (1u << page))) {
+        return;
+    }
+    const unsigned first = (address & (PAGE_SIZE - 1)) / CODE_CHUNK_SIZE;
+    const unsigned last = ((address & (PAGE_SIZE - 1)) + length - 1) / CODE_CHUNK_SIZE;
+    for (unsigned chunk = first; chunk <= last && chunk < 32; ++chunk) {
+        codeChunks_[page] |= 1u << chunk;
+    }
+    if (!(codePages_ & (1u << page))) {
+        codePages_ |= 1u << page;
+        updateSlowPages();
     }
 }
 
-uint8_t Memory::readByte(uint16_t address) const {
-    IOHandler handler;
+void Memory::invalidateCode(unsigned page) {
+    ++pageGenerations_[page];
+    ++codeEpoch_;
+    if (codePages_ & (1u << page)) {
+        codeChunks_[page] = 0;
+        codePages_ &= ~(1u << page);
+        updateSlowPages();
+    }
+}
 
-    if (isIOAddress(address, handler)) {
-        return handler.read(address);
+// Slow path for pages with an I/O handler, a trap or watched code: a handler
+// wins if it covers the address, then the trap, otherwise the page map as
+// usual.
+uint8_t Memory::readHandled(uint16_t address) const {
+    for (const auto& ioHandler : ioHandlers_) {
+        if (address >= ioHandler.start && address <= ioHandler.end) {
+            return ioHandler.read(address);
+        }
     }
+    if (trapReadPages_ & (1u << (address >> 13))) {
+        return trap_->trapRead(address);
+    }
+    return readPages_[address >> 13][address & (PAGE_SIZE - 1)];
+}
 
-    if (address < BANK_SIZE) {
-        if (activeBank_ >= NUM_BANKS) {
-            throw std::out_of_range("Invalid active bank.");
+void Memory::writeHandled(uint16_t address, uint8_t value) {
+    const unsigned page = address >> 13;
+    if (codeChunks_[page] & (1u << ((address & (PAGE_SIZE - 1)) / CODE_CHUNK_SIZE))) {
+        invalidateCode(page);
+    }
+    for (const auto& ioHandler : ioHandlers_) {
+        if (address >= ioHandler.start && address <= ioHandler.end) {
+            ioHandler.write(address, value);
+            return;
         }
-        return banks_[activeBank_][address];
-    } else if (address < MEMORY_SIZE) {
-        return memory_[address];
-    } else {
-        throw std::out_of_range("Address out of bounds.");
     }
+    if (trapWritePages_ & (1u << page)) {
+        trap_->trapWrite(address, value);
+        return;
+    }
+    writePages_[page][address & (PAGE_SIZE - 1)] = value;
 }
 
 uint16_t Memory::readWord(uint16_t address) const {
@@ -63,7 +118,11 @@ void Memory::loadData(const std::vector<uint8_t>& data, uint16_t startAddress) {
         throw std::out_of_range("Data size exceeds memory bounds.");
     }
     for (size_t i = 0; i < data.size(); ++i) {
-        memory_[startAddress + i] = data[i];
+        const size_t address = startAddress + i;
+        writePages_[address >> 13][address & (PAGE_SIZE - 1)] = data[i];
+    }
+    for (size_t page = startAddress >> 13; page <= (startAddress + data.size() - 1) >> 13 && !data.empty(); ++page) {
+        invalidateCode(page);
     }
 }
 
@@ -86,7 +145,7 @@ void Memory::dumpMemory(uint16_t start, size_t length) const {
                 ascii += '?';
                 continue;
             }
-            uint8_t byte = memory_[addr];
+            uint8_t byte = readPages_[addr >> 13][addr & (PAGE_SIZE - 1)];
             std::cout << std::setw(2) << static_cast<int>(byte) << " ";
             ascii += (byte >= 32 && byte <= 126) ? static_cast<char>(byte) : '.';
         }
@@ -112,22 +171,10 @@ void Memory::setIOHandler(uint16_t start, uint16_t end,
         throw std::invalid_argument("Invalid I/O range");
     }
     ioHandlers_.push_back({start, end, readHandler, writeHandler});
-}
-
-void Memory::validateAddress(uint16_t address) const {
-    if (address >= MEMORY_SIZE) {
-        throw std::out_of_range("Address out of bounds.");
+    for (unsigned page = start >> 13; page <= (unsigned)(end >> 13); ++page) {
+        ioPages_ |= 1u << page;
     }
-}
-
-bool Memory::isIOAddress(uint16_t address, IOHandler& handler) const {
-    for (const auto& ioHandler : ioHandlers_) {
-        if (address >= ioHandler.start && address <= ioHandler.end) {
-            handler = ioHandler;
-            return true;
-        }
-    }
-    return false;
+    updateSlowPages();
 }
 
 // Banked memory
@@ -139,6 +186,9 @@ void Memory::loadBank(const std::vector<uint8_t>& data, uint8_t bank) {
         throw std::invalid_argument("Bank data size exceeds 16KB");
     }
     std::copy(data.begin(), data.end(), banks_[bank].begin());
+    if (bank == activeBank_) {
+        mapBankPages();
+    }
 }
 
 void Memory::selectBank(uint8_t bank) {
@@ -146,6 +196,7 @@ void Memory::selectBank(uint8_t bank) {
         throw std::out_of_range("Invalid bank selection");
     }
     activeBank_ = bank;
+    mapBankPages();
 }
 
 void Memory::saveState(std::ostream& os) const {
@@ -196,4 +247,8 @@ void Memory::loadState(std::istream& is) {
     if (activeBank_ >= NUM_BANKS) {
         throw std::runtime_error("Invalid active bank in state data.");
     }
+    mapBankPages();
+    for (unsigned page = 0; page < NUM_PAGES; ++page) {
+        invalidateCode(page);
+    }
 }
\ No newline at end of file
@@ -13,10 +13,13 @@ public:
     static const size_t MEMORY_SIZE = 65536; // Full 16-bit address space
     static const size_t BANK_SIZE = 16384;    // 16KB per bank
     static const size_t NUM_BANKS = 4;        // 4 banks for 64KB
+    static const size_t PAGE_SIZE = 8192;     // 8KB pages, as fMSX's RAM[A>>13]
+    static const size_t NUM_PAGES = 8;        // 8 pages for 64KB
 
     Memory(); // Constructor
 
-    // Read and write methods (renamed for clarity)
+    // Read and write methods (renamed for clarity). Inlined below: a page
+    // without an I/O handler is one shift, one load and one index.
     uint8_t readByte(uint16_t address) const;
     void writeByte(uint16_t address, uint8_t value);
     uint16_t readWord(uint16_t address) const;
@@ -37,6 +40,41 @@ public:
     void loadBank(const std::vector<uint8_t>& data, uint8_t bank);
     void selectBank(uint8_t bank);
 
+    // Point an 8KB page at external storage (ROM, mapper banks). A null
+    // write pointer makes the page read-only; writes to it are discarded.
+    void mapPage(uint8_t page, const uint8_t* read, uint8_t* write);
+
+    // Accesses the page map cannot serve by itself (mapper registers, SRAM,
+    // the secondary slot register at FFFFh) go to a trap. Only pages whose
+    // bit is set in the masks leave the fast path.
+    class PageTrap {
+    public:
+        virtual ~PageTrap() = default;
+        virtual uint8_t trapRead(uint16_t address) = 0;
+        virtual void trapWrite(uint16_t address, uint8_t value) = 0;
+    };
+    void setPageTrap(PageTrap* trap, uint8_t readPages, uint8_t writePages);
+
+    // Page storage for bulk transfers (LDIR and friends), or null when the
+    // page has an I/O handler or trap and must go through readByte() and
+    // writeByte() one access at a time
+    const uint8_t* getDirectReadPage(unsigned page) const {
+        return (readSlowPages_ & (1u << page)) ? nullptr : readPages_[page];
+    }
+    uint8_t* getDirectWritePage(unsigned page) const {
+        return (writeSlowPages_ & (1u << page)) ? nullptr : writePages_[page];
+    }
+
+    // Code tracking for the Z80 block cache. The cache marks the 256-byte
+    // chunks it has decoded instructions from. A write into a marked chunk, or
+    // a change to the page's mapping, bumps the page's generation (its blocks
+    // are stale) and the global code epoch (a block that is running stops).
+    static const size_t CODE_CHUNK_SIZE = 256;
+    void watchCode(uint16_t address, uint16_t length);
+    uint32_t getPageGeneration(unsigned page) const { return pageGenerations_[page]; }
+    uint32_t getCodeEpoch() const { return codeEpoch_; }
+    const uint32_t* getCodeEpochAddress() const { return &codeEpoch_; }  // For compiled code
+
     // Save and restore (fixed)
     void saveState(std::ostream& os) const;
     void loadState(std::istream& is);
@@ -46,6 +84,24 @@ private:
     std::array<std::array<uint8_t, BANK_SIZE>, NUM_BANKS> banks_;
     uint8_t activeBank_{};
 
+    // Page map: where each 8KB page is read from and written to
+    std::array<const uint8_t*, NUM_PAGES> readPages_;
+    std::array<uint8_t*, NUM_PAGES> writePages_;
+    uint8_t ioPages_{};                         // Bit n set: page n has an I/O handler
+    uint8_t readSlowPages_{};                   // I/O handler or read trap
+    uint8_t writeSlowPages_{};                  // I/O handler or write trap
+    PageTrap* trap_{};
+    uint8_t trapReadPages_{};
+    uint8_t trapWritePages_{};
+    std::array<uint8_t, PAGE_SIZE> discard_;    // Write target for read-only pages
+
+    // Block cache tracking. Pages holding watched code take the write slow
+    // path so writeHandled() can spot writes into it.
+    std::array<uint32_t, NUM_PAGES> codeChunks_{};      // Bit n: chunk n holds cached code
+    std::array<uint32_t, NUM_PAGES> pageGenerations_{};
+    uint32_t codeEpoch_{};
+    uint8_t codePages_{};                               // Pages with any watched chunk
+
     struct IOHandler {
         uint16_t start, end;
         std::function<uint8_t(uint16_t)> read;
@@ -54,8 +110,28 @@ private:
 
     std::vector<IOHandler> ioHandlers_;
 
-    void validateAddress(uint16_t address) const;
-    bool isIOAddress(uint16_t address, IOHandler& handler) const;
+    void mapBankPages();
+    void updateSlowPages();
+    void invalidateCode(unsigned page);
+    uint8_t readHandled(uint16_t address) const;
+    void writeHandled(uint16_t address, uint8_t value);
 };
 
+inline uint8_t Memory::readByte(uint16_t address) const {
+    const unsigned page = address >> 13;
+    if (readSlowPages_ & (1u << page)) {
+        return readHandled(address);
+    }
+    return readPages_[page][address & (PAGE_SIZE - 1)];
+}
+
+inline void Memory::writeByte(uint16_t address, uint8_t value) {
+    const unsigned page = address >> 13;
+    if (writeSlowPages_ & (1u << page)) {
+        writeHandled(address, value);
+        return;
+    }
+    writePages_[page][address & (PAGE_SIZE - 1)] = value;
+}
+
 #endif // MEMORY_HPP
\ No newline at end of file
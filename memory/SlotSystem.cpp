@@ -0,0 +1,166 @@
+#include "SlotSystem.hpp"
+#include <stdexcept>
+
+SlotSystem::SlotSystem(Memory& memory)
+    : memory_(memory), cartridges_{}, expanded_{}, primaryReg_(0),
+      secondaryReg_{}, primary_{}, secondary_{} {
+    empty_.fill(0xFF);
+    for (auto& primary : map_) {
+        for (auto& secondary : primary) {
+            secondary.fill({empty_.data(), nullptr});
+        }
+    }
+    for (unsigned page = 0; page < 4; ++page) {
+        updatePage(page);
+    }
+    updateTraps();
+}
+
+SlotSystem::~SlotSystem() {
+    memory_.setPageTrap(nullptr, 0, 0);
+}
+
+void SlotSystem::validateSlot(uint8_t primary, uint8_t secondary) const {
+    if (primary >= NUM_SLOTS || secondary >= NUM_SLOTS) {
+        throw std::out_of_range("Invalid slot number");
+    }
+}
+
+void SlotSystem::setExpanded(uint8_t primary, bool expanded) {
+    validateSlot(primary, 0);
+    expanded_[primary] = expanded;
+    secondaryReg_[primary] = 0;
+    writePrimary(primaryReg_);
+}
+
+void SlotSystem::mapPages(uint8_t primary, uint8_t secondary, uint8_t firstPage, uint8_t count,
+                          const uint8_t* read, uint8_t* write) {
+    validateSlot(primary, secondary);
+    if (firstPage + count > NUM_PAGES) {
+        throw std::out_of_range("Page range exceeds the slot");
+    }
+    for (unsigned i = 0; i < count; ++i) {
+        map_[primary][secondary][firstPage + i] = {
+            read ? read + i * Memory::PAGE_SIZE : empty_.data(),
+            write ? write + i * Memory::PAGE_SIZE : nullptr
+        };
+    }
+    refreshSlot(primary, secondary);
+}
+
+void SlotSystem::insertCartridge(uint8_t primary, uint8_t secondary, Cartridge& cartridge) {
+    validateSlot(primary, secondary);
+    cartridges_[primary][secondary] = &cartridge;
+    loadCartridgePages(primary, secondary);
+    refreshSlot(primary, secondary);
+    updateTraps();
+}
+
+void SlotSystem::ejectCartridge(uint8_t primary, uint8_t secondary) {
+    validateSlot(primary, secondary);
+    cartridges_[primary][secondary] = nullptr;
+    map_[primary][secondary].fill({empty_.data(), nullptr});
+    refreshSlot(primary, secondary);
+    updateTraps();
+}
+
+void SlotSystem::loadCartridgePages(uint8_t primary, uint8_t secondary) {
+    const Cartridge* cartridge = cartridges_[primary][secondary];
+    for (unsigned page = 0; page < NUM_PAGES; ++page) {
+        map_[primary][secondary][page] = {cartridge->getPage(page), nullptr};
+    }
+}
+
+// Port A8h: two bits of primary slot per 16KB page
+void SlotSystem::writePrimary(uint8_t value) {
+    primaryReg_ = value;
+    for (unsigned page = 0; page < 4; ++page, value >>= 2) {
+        primary_[page] = value & 3;
+        secondary_[page] = expanded_[primary_[page]]
+            ? (secondaryReg_[primary_[page]] >> (page * 2)) & 3 : 0;
+        updatePage(page);
+    }
+    updateTraps();
+}
+
+// (FFFFh): two bits of secondary slot per 16KB page, for the primary slot
+// currently shown at page 3 only. Cartridge slots are not expanded.
+void SlotSystem::writeSecondary(uint8_t value) {
+    const uint8_t primary = primary_[3];
+    if (!expanded_[primary]) {
+        return;
+    }
+    secondaryReg_[primary] = value;
+    for (unsigned page = 0; page < 4; ++page, value >>= 2) {
+        if (primary_[page] == primary) {
+            secondary_[page] = value & 3;
+            updatePage(page);
+        }
+    }
+    updateTraps();
+}
+
+uint8_t SlotSystem::readSecondary() const {
+    return ~secondaryReg_[primary_[3]];
+}
+
+void SlotSystem::updatePage(unsigned page) {
+    const auto& slot = map_[primary_[page]][secondary_[page]];
+    for (unsigned i = page * 2; i < page * 2 + 2; ++i) {
+        memory_.mapPage(i, slot[i].read, slot[i].write);
+    }
+}
+
+void SlotSystem::refreshSlot(uint8_t primary, uint8_t secondary) {
+    for (unsigned page = 0; page < 4; ++page) {
+        if (primary_[page] == primary && secondary_[page] == secondary) {
+            updatePage(page);
+        }
+    }
+}
+
+void SlotSystem::updateTraps() {
+    uint8_t readPages = 0;
+    uint8_t writePages = 0;
+    for (unsigned page = 0; page < NUM_PAGES; ++page) {
+        if (cartridges_[primary_[page >> 1]][secondary_[page >> 1]]) {
+            writePages |= 1u << page;
+        }
+    }
+    if (expanded_[primary_[3]]) {
+        readPages |= 0x80;
+        writePages |= 0x80;
+    }
+    memory_.setPageTrap(this, readPages, writePages);
+}
+
+uint8_t SlotSystem::trapRead(uint16_t address) {
+    if (address == 0xFFFF && expanded_[primary_[3]]) {
+        return readSecondary();
+    }
+    const unsigned page = address >> 14;
+    return map_[primary_[page]][secondary_[page]][address >> 13].read[address & (Memory::PAGE_SIZE - 1)];
+}
+
+void SlotSystem::trapWrite(uint16_t address, uint8_t value) {
+    if (address == 0xFFFF && expanded_[primary_[3]]) {
+        writeSecondary(value);
+        return;
+    }
+
+    const unsigned page = address >> 14;
+    const uint8_t primary = primary_[page];
+    const uint8_t secondary = secondary_[page];
+    if (Cartridge* cartridge = cartridges_[primary][secondary]) {
+        // Bank switch: repoint the slot's pages, no data is moved
+        if (cartridge->write(address, value)) {
+            loadCartridgePages(primary, secondary);
+            refreshSlot(primary, secondary);
+        }
+        return;
+    }
+
+    if (uint8_t* write = map_[primary][secondary][address >> 13].write) {
+        write[address & (Memory::PAGE_SIZE - 1)] = value;
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef SLOT_SYSTEM_HPP
+#define SLOT_SYSTEM_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include "Memory.hpp"
+#include "Cartridge.hpp"
+
+// MSX primary/secondary slots, ported from fMSX's PSlot()/SSlot() and its
+// MemMap[PS][SS][page] table. The slot system owns Memory's page map: slot
+// and bank switches only rewrite page pointers, nothing is copied.
+//
+// Writes to cartridge pages are trapped so mappers can see them. So are
+// accesses to page 7 while page 3 shows an expanded slot, because FFFFh then
+// holds the secondary slot register.
+class SlotSystem : public Memory::PageTrap {
+public:
+    static const size_t NUM_SLOTS = 4;
+    static const size_t NUM_PAGES = Memory::NUM_PAGES;
+
+    explicit SlotSystem(Memory& memory);
+    ~SlotSystem() override;
+
+    SlotSystem(const SlotSystem&) = delete;
+    SlotSystem& operator=(const SlotSystem&) = delete;
+
+    // Slot contents. A null write pointer maps read-only memory (ROM).
+    void setExpanded(uint8_t primary, bool expanded);
+    void mapPages(uint8_t primary, uint8_t secondary, uint8_t firstPage, uint8_t count,
+                  const uint8_t* read, uint8_t* write);
+    void insertCartridge(uint8_t primary, uint8_t secondary, Cartridge& cartridge);
+    void ejectCartridge(uint8_t primary, uint8_t secondary);
+
+    // Slot select registers
+    void writePrimary(uint8_t value);       // Port A8h
+    uint8_t readPrimary() const { return primaryReg_; }
+    void writeSecondary(uint8_t value);     // (FFFFh) in the slot shown at page 3
+    uint8_t readSecondary() const;
+
+    // Memory::PageTrap
+    uint8_t trapRead(uint16_t address) override;
+    void trapWrite(uint16_t address, uint8_t value) override;
+
+private:
+    struct SlotPage {
+        const uint8_t* read;
+        uint8_t* write;
+    };
+
+    Memory& memory_;
+    std::array<std::array<std::array<SlotPage, NUM_PAGES>, NUM_SLOTS>, NUM_SLOTS> map_;
+    std::array<std::array<Cartridge*, NUM_SLOTS>, NUM_SLOTS> cartridges_;
+    std::array<bool, NUM_SLOTS> expanded_;
+    uint8_t primaryReg_;
+    std::array<uint8_t, NUM_SLOTS> secondaryReg_;
+    std::array<uint8_t, 4> primary_;        // Primary slot shown at each 16KB page
+    std::array<uint8_t, 4> secondary_;      // Secondary slot shown at each 16KB page
+    std::array<uint8_t, Memory::PAGE_SIZE> empty_;
+
+    void validateSlot(uint8_t primary, uint8_t secondary) const;
+    void loadCartridgePages(uint8_t primary, uint8_t secondary);
+    void updatePage(unsigned page);         // 16KB page 0-3
+    void refreshSlot(uint8_t primary, uint8_t secondary);
+    void updateTraps();
+};
+
+#endif // SLOT_SYSTEM_HPP
@@ -0,0 +1,42 @@
+#include "RefZ80.h"
+#include "Z80.h"
+#include "ThreadLocal.h"
+#include <string.h>
+
+/* Same page layout fMSX's OpZ80() reads opcodes through with -DFMSX */
+static byte Memory[0x10000];
+THREADLOCAL byte* RAM[8];
+
+static Z80 CPU;
+static RefZ80OutHandler OutHandler;
+static void* OutContext;
+
+void RefZ80Reset(const unsigned char* memory, unsigned short pc, RefZ80OutHandler out, void* context) {
+  int J;
+
+  memcpy(Memory, memory, sizeof(Memory));
+  for (J = 0; J < 8; ++J) RAM[J] = Memory + J * 0x2000;
+  OutHandler = out;
+  OutContext = context;
+
+  CPU.IPeriod = 0x10000;
+  CPU.TrapBadOps = 0;
+  ResetZ80(&CPU);
+  CPU.PC.W = pc;
+}
+
+int RefZ80Exec(int cycles) {
+  return cycles - ExecZ80(&CPU, cycles);
+}
+
+unsigned char RefZ80Read(unsigned short address) {
+  return Memory[address];
+}
+
+/* Z80.c callbacks */
+byte RdZ80(word A) { return Memory[A]; }
+void WrZ80(word A, byte V) { Memory[A] = V; }
+byte InZ80(word Port) { (void)Port; return 0xFF; }
+void OutZ80(word Port, byte Value) { OutHandler(OutContext, (byte)Port, Value); }
+void PatchZ80(Z80* R) { (void)R; }
+word LoopZ80(Z80* R) { (void)R; return INT_NONE; }
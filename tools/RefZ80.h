@@ -0,0 +1,27 @@
+#ifndef REF_Z80_H
+#define REF_Z80_H
+
+/* fMSX's ExecZ80() as a reference core for tools/zexrun.cpp. fMSX's Z80
+   typedef clashes with the C++ Z80 class, so it stays behind this small C
+   interface and RefZ80.c is the only file that includes Z80/Z80.h. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*RefZ80OutHandler)(void* context, unsigned char port, unsigned char value);
+
+/* Load 64kB of flat RAM and reset the CPU to start at PC. Port writes go to
+   out, port reads return FFh. */
+void RefZ80Reset(const unsigned char* memory, unsigned short pc, RefZ80OutHandler out, void* context);
+
+/* Run at least the given number of T-states, return how many were run */
+int RefZ80Exec(int cycles);
+
+unsigned char RefZ80Read(unsigned short address);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* REF_Z80_H */
@@ -0,0 +1,252 @@
+// Headless conformance and throughput runner for the Z80 core. It runs a
+// CP/M .COM image such as zexdoc/zexall on the C++ core and on fMSX's
+// ExecZ80() side by side, reports pass/fail per instruction group and the
+// emulated MHz of each core.
+//
+// Build from the repository root:
+//   gcc -O2 -DFMSX -DLSB_FIRST -DEXECZ80 -Ifmsx/fMSX60/Z80 -Ifmsx/fMSX60/EMULib
+//       -c tools/RefZ80.c fmsx/fMSX60/Z80/Z80.c
+//   g++ -std=c++17 -O2 -I. tools/zexrun.cpp cpu/Z80.cpp cpu/Z80JIT.cpp cpu/Z80Registers.cpp
+//       memory/*.cpp io/IOBus.cpp RefZ80.o Z80.o -o zexrun
+//
+// Usage: zexrun [--no-ref] [--no-cache | --jit] [--quiet] [--m1-wait N] image.com
+//
+// The exit status is 0 only if the C++ core passed every group it ran.
+
+#include "cpu/Z80.hpp"
+#include "memory/Memory.hpp"
+#include "tools/RefZ80.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// --- Minimal CP/M ---
+// Page zero gets a warm boot at 0000h and a BDOS entry at 0005h. Both are
+// tiny Z80 stubs that hand their arguments to the host through OUT, so a
+// core needs no special hooks and runs at full speed between calls:
+//   0000h: OUT (EXIT_PORT),A / HALT
+//   0005h: JP BDOS_STUB        ; (0006h) doubles as the top of the TPA
+//   BDOS_STUB: LD A,E / OUT (0),A / LD A,D / OUT (1),A / LD A,C / OUT (2),A / RET
+static const uint16_t TPA_START = 0x0100;
+static const uint16_t BDOS_STUB = 0xFE00;
+static const uint8_t BDOS_E_PORT = 0x00;
+static const uint8_t BDOS_D_PORT = 0x01;
+static const uint8_t BDOS_CALL_PORT = 0x02;
+static const uint8_t EXIT_PORT = 0xFF;
+
+static std::vector<uint8_t> makeCPMImage(const std::vector<uint8_t>& program) {
+    std::vector<uint8_t> image(0x10000, 0);
+    const uint8_t boot[] = {0xD3, EXIT_PORT, 0x76, 0x00, 0x00,
+                            0xC3, BDOS_STUB & 0xFF, BDOS_STUB >> 8};
+    const uint8_t bdos[] = {0x7B, 0xD3, BDOS_E_PORT, 0x7A, 0xD3, BDOS_D_PORT,
+                            0x79, 0xD3, BDOS_CALL_PORT, 0xC9};
+    std::memcpy(&image[0], boot, sizeof(boot));
+    std::memcpy(&image[BDOS_STUB], bdos, sizeof(bdos));
+    std::copy(program.begin(), program.end(), image.begin() + TPA_START);
+    return image;
+}
+
+// Console side of the BDOS: functions 2 (print E) and 9 (print the
+// $-terminated string at DE). Function 0 and the warm boot end the run.
+class BDOS {
+public:
+    BDOS(std::function<uint8_t(uint16_t)> read, bool echo) : read_(std::move(read)), echo_(echo) {}
+
+    void out(uint8_t port, uint8_t value) {
+        switch (port) {
+            case BDOS_E_PORT: de_ = (de_ & 0xFF00) | value; break;
+            case BDOS_D_PORT: de_ = (de_ & 0x00FF) | (value << 8); break;
+            case BDOS_CALL_PORT: call(value); break;
+            case EXIT_PORT: done_ = true; break;
+        }
+    }
+
+    bool isDone() const { return done_; }
+    const std::string& getOutput() const { return output_; }
+
+    static void outHandler(void* bdos, uint8_t port, uint8_t value) {
+        static_cast<BDOS*>(bdos)->out(port, value);
+    }
+
+private:
+    std::function<uint8_t(uint16_t)> read_;
+    bool echo_;
+    bool done_ = false;
+    uint16_t de_ = 0;
+    std::string output_;
+
+    void call(uint8_t function) {
+        switch (function) {
+            case 0:
+                done_ = true;
+                break;
+            case 2:
+                print(static_cast<char>(de_ & 0xFF));
+                break;
+            case 9:
+                for (uint16_t address = de_; read_(address) != '$'; ++address) {
+                    print(static_cast<char>(read_(address)));
+                }
+                break;
+        }
+    }
+
+    void print(char c) {
+        if (c == '\r') return;
+        output_ += c;
+        if (echo_) {
+            std::cout << c << std::flush;
+        }
+    }
+};
+
+// --- Cores ---
+struct RunResult {
+    std::string output;
+    uint64_t cycles;
+    double seconds;
+};
+
+static const int SLICE_CYCLES = 100000;
+
+static RunResult runCore(const std::vector<uint8_t>& image, uint8_t m1Wait, bool cache, bool jit, bool echo) {
+    Memory memory;
+    memory.loadData(image, 0);
+    Z80 cpu(memory);
+    cpu.setM1WaitStates(m1Wait);
+    cpu.setBlockCacheEnabled(cache);
+    cpu.setJITEnabled(jit);
+    if (jit && !cpu.isJITAvailable()) {
+        std::fprintf(stderr, "No JIT on this host, interpreting\n");
+    }
+    cpu.setProgramCounter(TPA_START);
+
+    BDOS bdos([&memory](uint16_t address) { return memory.readByte(address); }, echo);
+    cpu.getIOBus().map(0x00, 0xFF, &bdos, nullptr, &BDOS::outHandler);
+
+    const auto start = std::chrono::steady_clock::now();
+    while (!bdos.isDone()) {
+        cpu.run(SLICE_CYCLES);
+    }
+    const auto end = std::chrono::steady_clock::now();
+    return {bdos.getOutput(), cpu.getCycleCount(), std::chrono::duration<double>(end - start).count()};
+}
+
+static RunResult runReference(const std::vector<uint8_t>& image) {
+    BDOS bdos([](uint16_t address) { return RefZ80Read(address); }, false);
+    RefZ80Reset(image.data(), TPA_START, &BDOS::outHandler, &bdos);
+
+    uint64_t cycles = 0;
+    const auto start = std::chrono::steady_clock::now();
+    while (!bdos.isDone()) {
+        cycles += RefZ80Exec(SLICE_CYCLES);
+    }
+    const auto end = std::chrono::steady_clock::now();
+    return {bdos.getOutput(), cycles, std::chrono::duration<double>(end - start).count()};
+}
+
+// --- Report ---
+// zexdoc/zexall print one line per group: "<name>....  OK", or the name
+// followed by "ERROR **** crc expected:... found:..." on a failure.
+struct Group {
+    std::string name;
+    bool passed;
+};
+
+static std::vector<Group> parseGroups(const std::string& output) {
+    std::vector<Group> groups;
+    size_t lineStart = 0;
+    while (lineStart < output.size()) {
+        size_t lineEnd = output.find('\n', lineStart);
+        if (lineEnd == std::string::npos) lineEnd = output.size();
+        const std::string line = output.substr(lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+
+        const size_t dots = line.find("....");
+        if (dots == std::string::npos) continue;
+        const bool passed = line.find("OK", dots) != std::string::npos;
+        const bool failed = line.find("ERROR", dots) != std::string::npos;
+        if (passed || failed) {
+            groups.push_back({line.substr(0, dots), passed && !failed});
+        }
+    }
+    return groups;
+}
+
+static void printSpeed(const char* name, const RunResult& result) {
+    std::printf("%-6s %llu T-states in %.2f s = %.1f emulated MHz\n", name,
+                static_cast<unsigned long long>(result.cycles), result.seconds,
+                result.seconds > 0 ? result.cycles / result.seconds / 1e6 : 0.0);
+}
+
+static void usage() {
+    std::fprintf(stderr, "Usage: zexrun [--no-ref] [--no-cache | --jit] [--quiet] [--m1-wait N] image.com\n");
+    std::exit(2);
+}
+
+int main(int argc, char* argv[]) {
+    bool reference = true;
+    bool cache = true;
+    bool jit = false;
+    bool echo = true;
+    // Plain Z80 timing by default, so cycle counts compare with ExecZ80()
+    uint8_t m1Wait = 0;
+    const char* path = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--no-ref")) reference = false;
+        else if (!std::strcmp(argv[i], "--no-cache")) cache = false;
+        else if (!std::strcmp(argv[i], "--jit")) jit = true;
+        else if (!std::strcmp(argv[i], "--quiet")) echo = false;
+        else if (!std::strcmp(argv[i], "--m1-wait") && i + 1 < argc) m1Wait = static_cast<uint8_t>(std::atoi(argv[++i]));
+        else if (argv[i][0] == '-' || path) usage();
+        else path = argv[i];
+    }
+    if (!path) usage();
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::fprintf(stderr, "Cannot open %s\n", path);
+        return 2;
+    }
+    const std::vector<uint8_t> program((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (program.size() > BDOS_STUB - TPA_START) {
+        std::fprintf(stderr, "%s does not fit in the TPA\n", path);
+        return 2;
+    }
+    const std::vector<uint8_t> image = makeCPMImage(program);
+
+    const RunResult core = runCore(image, m1Wait, cache, jit, echo);
+    RunResult ref{};
+    if (reference) {
+        ref = runReference(image);
+    }
+
+    const std::vector<Group> coreGroups = parseGroups(core.output);
+    const std::vector<Group> refGroups = parseGroups(ref.output);
+    int failures = 0;
+    std::printf("\n%-40s %-6s %s\n", "group", "core", reference ? "fMSX" : "");
+    for (size_t i = 0; i < coreGroups.size(); ++i) {
+        const char* refResult = "";
+        if (i < refGroups.size()) refResult = refGroups[i].passed ? "OK" : "ERROR";
+        std::printf("%-40s %-6s %s\n", coreGroups[i].name.c_str(), coreGroups[i].passed ? "OK" : "ERROR", refResult);
+        failures += !coreGroups[i].passed;
+    }
+    std::printf("%d of %zu groups passed\n\n", static_cast<int>(coreGroups.size()) - failures, coreGroups.size());
+
+    printSpeed("core", core);
+    if (reference) {
+        printSpeed("fMSX", ref);
+        if (ref.seconds > 0 && core.seconds > 0) {
+            std::printf("core runs at %.2fx fMSX\n", (core.cycles / core.seconds) / (ref.cycles / ref.seconds));
+        }
+    }
+    return failures || coreGroups.empty() ? 1 : 0;
+}